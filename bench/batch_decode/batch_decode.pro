@@ -0,0 +1,47 @@
+#
+#  canspy - A simple tool for users who need to interface with a device based on
+#           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+#           sensors and many other devices.
+#  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# This code is made available on the understanding that it will not be
+# used in safety-critical situations without a full and competent review.
+#
+
+
+# Micro-benchmark of the bulk signal decoder, prints frames/s.
+
+QT += core
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+TARGET = batch_decode
+TEMPLATE = app
+
+INCLUDEPATH = ../../include
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+SOURCES += main.cxx \
+           ../../src/analysis/dbc.cxx \
+           ../../src/analysis/dbc_batch.cxx \
+           ../../src/analysis/capture.cxx
+
+HEADERS += ../../include/analysis/dbc.h \
+           ../../include/analysis/dbc_batch.h \
+           ../../include/analysis/capture.h
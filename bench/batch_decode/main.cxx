@@ -0,0 +1,137 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+/*
+ * Decodes one signal out of a synthetic capture, in memory and through a
+ * mapped capture file, and prints the throughput in frames per second.
+ *
+ *   batch_decode [frames] [capture file]
+ */
+
+#include "analysis/dbc.h"
+#include "analysis/dbc_batch.h"
+#include "analysis/capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define BENCH_ID     0x100
+#define BENCH_IDS    32
+#define BENCH_ROUNDS 5
+
+typedef size_t (*decode_fn_t)(const can_packet_t *, size_t, uint32_t,
+    const dbc_signal_t *, double *, uint32_t *);
+
+/* What a consumer would do without the batch API */
+static size_t
+decode_naive(const can_packet_t *frames, size_t count, uint32_t id,
+    const dbc_signal_t *sig, double *values, uint32_t *)
+{
+	size_t n = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if (frames[i].id != id || frames[i].dlc < sig->min_dlc)
+			continue;
+		values[n++] = dbc_scale(sig, dbc_raw(sig, dbc_load_le64(frames[i].data),
+		    dbc_load_be64(frames[i].data)));
+	}
+
+	return n;
+}
+
+static void
+run(const char *name, decode_fn_t fn, const can_packet_t *frames, size_t count,
+    const dbc_signal_t *sig, double *values)
+{
+	double best = 0, sum = 0;
+	size_t n = 0;
+
+	for (int r = 0; r < BENCH_ROUNDS; r++) {
+		auto t0 = std::chrono::steady_clock::now();
+		n = fn(frames, count, BENCH_ID, sig, values, NULL);
+		auto t1 = std::chrono::steady_clock::now();
+		double s = std::chrono::duration<double>(t1 - t0).count();
+		double rate = (s > 0) ? count / s : 0;
+
+		if (rate > best)
+			best = rate;
+	}
+	for (size_t i = 0; i < n; i++)
+		sum += values[i];
+
+	printf("%-16s %12.0f frames/s  %zu values  sum %.2f\n", name, best, n, sum);
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 8 * 1024 * 1024;
+	const char *path = (argc > 2) ? argv[2] : "batch_decode.cap";
+	std::vector<can_packet_t> frames(count);
+	std::vector<double> values(count);
+	dbc_signal_t sig;
+	capture_map_t map;
+
+	srand(1);
+	for (size_t i = 0; i < count; i++) {
+		can_packet_t &p = frames[i];
+
+		memset(&p, 0, sizeof(p));
+		p.id = BENCH_ID + rand() % BENCH_IDS;
+		p.dlc = 8;
+		for (int b = 0; b < 8; b++)
+			p.data[b] = rand();
+		p.tv_sec = i / 1000;
+		p.tv_usec = (i % 1000) * 1000;
+	}
+
+	/* 16 bit Intel signal at bit 8, 0.25 rpm/bit */
+	memset(&sig, 0, sizeof(sig));
+	sig.mask = 0xFFFF;
+	sig.shift = 8;
+	sig.factor = 0.25;
+	sig.min_dlc = 3;
+	sig.mux_value = DBC_NO_MUX;
+
+	printf("%zu frames, filter isa: %s\n", count, dbc_batch_isa());
+	run("naive", decode_naive, frames.data(), count, &sig, values.data());
+	run("batch", dbc_batch_decode, frames.data(), count, &sig, values.data());
+
+	if (capture_write(path, frames.data(), count) < 0 ||
+	    capture_map(path, &map) < 0) {
+		fprintf(stderr, "cannot write/map %s\n", path);
+		return 1;
+	}
+	run("batch (mapped)", dbc_batch_decode, map.frames, map.count, &sig,
+	    values.data());
+	capture_unmap(&map);
+	remove(path);
+
+	return 0;
+}
@@ -0,0 +1,367 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+/*
+ * Micro benchmarks of the functions run once per frame, each on the same
+ * fixed dataset so numbers of two builds compare:
+ *
+ *   microbench [--reps n] [--warmup n] [--only name] [--json]
+ *
+ * Every repetition runs the function over the whole dataset; the
+ * statistics are over the repetitions in ns per frame.  The median and
+ * its absolute deviation are the numbers to compare, the mean is skewed
+ * by the repetitions the scheduler interrupted.
+ */
+
+#include "qcanmonitor.h"
+#include "qpacketstats.h"
+#include "logmodel.h"
+#include "drivers/simulation_ops.h"
+#include "canbus/can_drv.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QString>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DATASET_FRAMES 4096
+
+static inline int64_t
+mono_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Same sequence on every run and machine */
+static uint64_t
+next_rand(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+typedef struct {
+	std::vector<can_packet_t> frames;
+	/* The frames as lines of a text log, as msgseq and simulation read them */
+	std::vector<QString> lines;
+	std::vector<std::string> raw_lines;
+} dataset_t;
+
+static void
+make_dataset(dataset_t *ds)
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+	int64_t usec = 1500000000LL * 1000000;
+	int64_t last = usec;
+
+	for (int i = 0; i < DATASET_FRAMES; i++) {
+		uint64_t r = next_rand(&state);
+		can_packet_t p;
+		QString data, s, line;
+
+		memset(&p, 0, sizeof(p));
+		/* A few busy IDs and a tail of rare ones, some extended */
+		p.id = (r & 3) ? 0x100 + (r >> 8) % 16 : 0x200 + (r >> 8) % 240;
+		if ((r >> 16) % 8 == 0)
+			p.id = ((r >> 20) & EFF_MASK) | EFF_FLAG;
+		p.dlc = (r >> 32) % 9;
+		for (int b = 0; b < 8; b++)
+			p.data[b] = (b < p.dlc) ? next_rand(&state) : 0;
+		usec += 100 + (r >> 40) % 1900;
+		p.tv_sec = usec / 1000000;
+		p.tv_usec = usec % 1000000;
+		ds->frames.push_back(p);
+
+		for (unsigned b = 0; b < p.dlc; b++)
+			data += QString("%1 ").arg(p.data[b], 2, 16, QChar('0')).toUpper();
+		line = QString::number(p.id & EFF_MASK, 16).toUpper() + " ";
+		line += "[" + QString::number(p.dlc) + "] ";
+		line += data + s.fill(' ', 39 - data.length() + 5);
+		line += (p.id & EFF_FLAG) ? "Ext " : "Std ";
+		line += " T:" + QDateTime::fromMSecsSinceEpoch(usec / 1000).time()
+		        .toString("hh:mm:ss.zzz");
+		line += " " + QString::number((usec - last) / 1000) + "\n";
+		last = usec;
+		ds->lines.push_back(line);
+		ds->raw_lines.push_back(line.toStdString());
+	}
+}
+
+class Bench
+{
+public:
+	Bench(const char *name) : name(name) {
+	}
+	virtual ~Bench() {
+	}
+
+	/* Untimed, before every repetition */
+	virtual void setup(void) {
+	}
+	/* One repetition: every frame of the dataset once */
+	virtual void run(void) = 0;
+
+	const char *name;
+};
+
+class FilterBench : public Bench
+{
+public:
+	FilterBench(dataset_t *ds) : Bench("monitor_filter"), ds(ds) {
+		monitor.setFilterId("[0-9a-fA-F]+$");
+		consumer = &monitor;
+	}
+
+	virtual void setup(void) {
+		frames = ds->frames;
+	}
+
+	virtual void run(void) {
+		for (size_t i = 0; i < frames.size(); i++)
+			matched += consumer->filterCallback(&frames[i]);
+	}
+
+	dataset_t *ds;
+	QCanMonitor monitor;
+	/* filterCallback is a protected slot of the monitor */
+	QCanPacketConsumer *consumer;
+	std::vector<can_packet_t> frames;
+	unsigned long matched = 0;
+};
+
+class ModelBench : public Bench
+{
+public:
+	ModelBench(dataset_t *ds) : Bench("model_enqueue"), ds(ds) {
+	}
+
+	virtual void setup(void) {
+		if (model.rowCount() > 0)
+			model.removeRows(0, model.rowCount());
+	}
+
+	virtual void run(void) {
+		for (size_t i = 0; i < ds->frames.size(); i++)
+			model.messageEnqueued(ds->frames[i]);
+	}
+
+	dataset_t *ds;
+	logModel model;
+};
+
+class StatsBench : public Bench
+{
+public:
+	StatsBench(dataset_t *ds) : Bench("stats_update"), ds(ds) {
+	}
+
+	virtual void run(void) {
+		QString data, interval;
+		bool created;
+
+		for (size_t i = 0; i < ds->frames.size(); i++)
+			stats.update(ds->frames[i], data, interval, &created);
+	}
+
+	dataset_t *ds;
+	QPacketStats stats;
+};
+
+class DumpLineBench : public Bench
+{
+public:
+	DumpLineBench(dataset_t *ds) : Bench("dump_parse_line"), ds(ds) {
+	}
+
+	/* The parser writes into the line, give it fresh copies */
+	virtual void setup(void) {
+		buffers.resize(ds->raw_lines.size());
+		for (size_t i = 0; i < ds->raw_lines.size(); i++) {
+			const std::string &s = ds->raw_lines[i];
+
+			buffers[i].assign(s.begin(), s.end());
+			buffers[i].push_back('\0');
+		}
+	}
+
+	virtual void run(void) {
+		uint32_t id;
+		uint8_t dlc, data[8];
+		uint64_t delay;
+
+		for (size_t i = 0; i < buffers.size(); i++) {
+			simulation_parse_line(&buffers[i][0], &id, &dlc, data, &delay);
+			sum += id + dlc + delay;
+		}
+	}
+
+	dataset_t *ds;
+	std::vector<std::vector<char> > buffers;
+	unsigned long sum = 0;
+};
+
+class TextLineBench : public Bench
+{
+public:
+	TextLineBench(dataset_t *ds) : Bench("tlog_parse_line"), ds(ds) {
+	}
+
+	virtual void run(void) {
+		for (size_t i = 0; i < ds->lines.size(); i++)
+			sum += logModel::parseLine(ds->lines[i]).id;
+	}
+
+	dataset_t *ds;
+	unsigned long sum = 0;
+};
+
+typedef struct {
+	double min;
+	double median;
+	double mean;
+	double mad;
+} result_t;
+
+static double
+median_of(std::vector<double> v)
+{
+	std::sort(v.begin(), v.end());
+	size_t n = v.size();
+
+	return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+static result_t
+measure(Bench *b, int warmup, int reps)
+{
+	std::vector<double> ns, dev;
+	result_t r;
+
+	for (int i = 0; i < warmup; i++) {
+		b->setup();
+		b->run();
+	}
+
+	for (int i = 0; i < reps; i++) {
+		b->setup();
+		int64_t t = mono_nsec();
+		b->run();
+		ns.push_back((double) (mono_nsec() - t) / DATASET_FRAMES);
+	}
+
+	r.min = *std::min_element(ns.begin(), ns.end());
+	r.median = median_of(ns);
+	r.mean = 0;
+	for (size_t i = 0; i < ns.size(); i++) {
+		r.mean += ns[i] / ns.size();
+		dev.push_back(ns[i] > r.median ? ns[i] - r.median : r.median - ns[i]);
+	}
+	r.mad = median_of(dev);
+
+	return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int reps = 30, warmup = 5;
+	const char *only = NULL;
+	bool json = false, first = true;
+	dataset_t ds;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--reps") && i + 1 < argc)
+			reps = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+			warmup = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--only") && i + 1 < argc)
+			only = argv[++i];
+		else if (!strcmp(argv[i], "--json"))
+			json = true;
+		else {
+			fprintf(stderr, "usage: %s [--reps n] [--warmup n] [--only name] "
+			        "[--json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (reps <= 0 || warmup < 0)
+		return 1;
+
+	make_dataset(&ds);
+
+	FilterBench filter(&ds);
+	ModelBench model(&ds);
+	StatsBench stats(&ds);
+	DumpLineBench dump(&ds);
+	TextLineBench text(&ds);
+	Bench *benches[] = { &filter, &model, &stats, &dump, &text };
+
+	if (json)
+		printf("{\"bench\":\"microbench\",\"frames\":%d,\"reps\":%d,\"warmup\":%d,"
+		       "\"results\":{", DATASET_FRAMES, reps, warmup);
+	else {
+		printf("%d frames, %d repetitions after %d warmup, ns/frame\n",
+		       DATASET_FRAMES, reps, warmup);
+		printf("  %-16s %10s %10s %10s %10s\n", "function", "min", "median",
+		       "mean", "mad");
+	}
+
+	for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		Bench *b = benches[i];
+
+		if (only != NULL && strcmp(only, b->name) != 0)
+			continue;
+
+		result_t r = measure(b, warmup, reps);
+		if (json) {
+			printf("%s\"%s\":{\"min_ns\":%.1f,\"median_ns\":%.1f,"
+			       "\"mean_ns\":%.1f,\"mad_ns\":%.1f}", first ? "" : ",",
+			       b->name, r.min, r.median, r.mean, r.mad);
+		} else
+			printf("  %-16s %10.1f %10.1f %10.1f %10.1f\n", b->name, r.min,
+			       r.median, r.mean, r.mad);
+		first = false;
+	}
+
+	if (json)
+		printf("}}\n");
+
+	return 0;
+}
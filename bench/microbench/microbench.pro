@@ -0,0 +1,70 @@
+#
+#  canspy - A simple tool for users who need to interface with a device based on
+#           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+#           sensors and many other devices.
+#  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# This code is made available on the understanding that it will not be
+# used in safety-critical situations without a full and competent review.
+#
+
+
+
+# Micro benchmarks of the per-frame functions: monitor filter, log model
+# insert, statistics update and the text log line parsers.  Prints
+# min/median/mean/MAD in ns per frame over repetitions on a fixed dataset.
+
+QT += core
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+TARGET = microbench
+TEMPLATE = app
+
+INCLUDEPATH = ../../include
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+SOURCES += main.cxx \
+           ../../src/qcanmonitor.cxx \
+           ../../src/qpacketstats.cxx \
+           ../../src/qmetrics.cxx \
+           ../../src/logmodel.cxx \
+           ../../src/qcanpkgabstractmodel.cxx \
+           ../../src/can_drv.cxx \
+           ../../src/analysis/dbc.cxx \
+           ../../src/drivers/general/generator_ops.cxx \
+           ../../src/drivers/general/net_ops.cxx \
+           ../../src/drivers/general/tcp_ops.cxx \
+           ../../src/drivers/general/simulation_ops.cxx
+
+HEADERS += ../../include/qcanpacketconsumer.h \
+           ../../include/qcanmonitor.h \
+           ../../include/qpacketstats.h \
+           ../../include/qmetrics.h \
+           ../../include/logmodel.h \
+           ../../include/qcanpkgabstractmodel.h \
+           ../../include/drivers/simulation_ops.h
+
+linux-* {
+SOURCES += \
+        ../../src/drivers/linux/can_socket_ops.cxx \
+        ../../src/osdep/linux/utils_linux.cxx
+
+LIBS += -lsocketcan
+}
@@ -0,0 +1,353 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+
+/*
+ * Runs generated traffic through the same objects as the GUI: the driver
+ * feeds QCanSocket and QCanRecvThread, QCanMonitor filters and queues the
+ * frames to logModel on the main thread, QCaptureWriter streams them to
+ * a file.  Probes first and last in the consumer list time each stage.
+ *
+ *   pipeline [--frames n] [--rate fps] [--ids spec] [--write file]
+ *            [--no-model] [--json]
+ *
+ * --rate 0 (the default) measures throughput; a rate under the saturation
+ * point measures latency without queueing.  The log model keeps every
+ * frame, as the GUI does, so large frame counts need memory.
+ *
+ * dispatch and deliver start at the driver timestamp, which is wall clock
+ * in microseconds: they are reported in ns with a 1 us resolution.  The
+ * run ends with the last frame, or DRAIN_MS after the driver stopped
+ * when frames were lost on the way.
+ */
+
+#include "qcansocket.h"
+#include "qcanrecvthread.h"
+#include "qcanmonitor.h"
+#include "qcapturewriter.h"
+#include "logmodel.h"
+#include "canbus/can_drv.h"
+#include "utils.h"
+
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QString>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/* Wait for the queued frames once the driver has no more */
+#define DRAIN_MS 1000
+
+#ifdef __GLIBC__
+/* Every malloc of the process, whatever the thread or library */
+static std::atomic<unsigned long long> s_allocs(0);
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	s_allocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	s_allocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	s_allocs.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
+}
+#define ALLOCS() s_allocs.load()
+#else
+#define ALLOCS() 0ULL
+#endif
+
+static inline int64_t
+mono_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline int64_t
+wall_usec(void)
+{
+	int64_t sec, usec;
+
+	get_timestamp(&sec, &usec);
+	return sec * 1000000 + usec;
+}
+
+static double
+cpu_sec(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	    ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/* Samples are preallocated, recording never allocates */
+class Stage
+{
+public:
+	Stage(const char *name, size_t frames, int64_t resolution = 1) :
+		name(name), resolution(resolution) {
+		samples.reserve(frames);
+	}
+
+	void add(int64_t nsec) {
+		if (samples.size() < samples.capacity())
+			samples.push_back(nsec);
+	}
+
+	int64_t percentile(double p) {
+		if (samples.empty())
+			return 0;
+		size_t i = (size_t) (p / 100.0 * (samples.size() - 1));
+		std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+		return samples[i];
+	}
+
+	const char *name;
+	int64_t resolution;     /* ns */
+	std::vector<int64_t> samples;
+};
+
+/* First consumer: driver timestamp to dispatch */
+class HeadProbe : public QCanPacketConsumer
+{
+public:
+	HeadProbe(Stage *dispatch) : dispatch(dispatch), start(0) {
+	}
+
+	virtual void canPacketRecv(can_packet_t) {
+	}
+
+	virtual bool filterCallback(can_packet_t *packet) {
+		dispatch->add((wall_usec() - packet->tv_sec * 1000000 - packet->tv_usec) * 1000);
+		start = mono_nsec();
+		return false;
+	}
+
+	Stage *dispatch;
+	int64_t start;
+};
+
+/* Last consumer: time spent in the consumers between the probes */
+class TailProbe : public QCanPacketConsumer
+{
+public:
+	TailProbe(HeadProbe *head, Stage *filters) :
+		head(head), filters(filters) {
+	}
+
+	virtual void canPacketRecv(can_packet_t) {
+	}
+
+	virtual bool filterCallback(can_packet_t *) {
+		filters->add(mono_nsec() - head->start);
+		return false;
+	}
+
+	HeadProbe *head;
+	Stage *filters;
+};
+
+static void
+print_stage(Stage &s, bool json, bool last)
+{
+	int64_t p50 = s.percentile(50.0), p99 = s.percentile(99.0);
+	int64_t p999 = s.percentile(99.9), max = s.percentile(100.0);
+
+	if (json)
+		printf("\"%s\":{\"samples\":%zu,\"p50_ns\":%lld,\"p99_ns\":%lld,"
+		       "\"p999_ns\":%lld,\"max_ns\":%lld,\"resolution_ns\":%lld}%s",
+		       s.name, s.samples.size(), (long long) p50, (long long) p99,
+		       (long long) p999, (long long) max, (long long) s.resolution,
+		       last ? "" : ",");
+	else
+		printf("  %-10s %10zu %12lld %12lld %12lld %12lld %8lld\n", s.name,
+		       s.samples.size(), (long long) p50, (long long) p99,
+		       (long long) p999, (long long) max, (long long) s.resolution);
+}
+
+int
+main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	unsigned long long frames = 200000, rate = 0;
+	const char *ids = "zipf:256";
+	const char *path = "pipeline.cap";
+	bool json = false, model_on = true, keep = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			frames = strtoull(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--rate") && i + 1 < argc)
+			rate = strtoull(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--ids") && i + 1 < argc)
+			ids = argv[++i];
+		else if (!strcmp(argv[i], "--write") && i + 1 < argc) {
+			path = argv[++i];
+			keep = true;
+		}
+		else if (!strcmp(argv[i], "--no-model"))
+			model_on = false;
+		else if (!strcmp(argv[i], "--json"))
+			json = true;
+		else {
+			fprintf(stderr, "usage: %s [--frames n] [--rate fps] [--ids spec] "
+			        "[--write file] [--no-model] [--json]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (frames == 0)
+		return 1;
+
+	qRegisterMetaType<can_packet_t>();
+
+	/* The driver timestamp has a 1 us resolution */
+	Stage dispatch("dispatch", frames, 1000), filters("filters", frames);
+	Stage deliver("deliver", frames, 1000), insert("insert", frames);
+	HeadProbe head(&dispatch);
+	TailProbe tail(&head, &filters);
+	QCanMonitor monitor;
+	QCaptureWriter writer;
+	logModel model;
+	unsigned long long inserted = 0;
+	int64_t t_last = 0;
+
+	QString spec = QString("rate=%1 ids=%2 dlc=mix count=%3 seed=1")
+	               .arg(rate).arg(ids).arg(frames);
+	can_ops = get_can_ops("Generator");
+	QCanSocket sk(spec, 0);
+	if (can_ops == NULL || sk.connect() <= 0 || sk.start() < 0) {
+		fprintf(stderr, "cannot start the generator: %s\n", qPrintable(spec));
+		return 1;
+	}
+	if (!writer.open(path)) {
+		fprintf(stderr, "cannot write %s\n", path);
+		return 1;
+	}
+
+	/* What MainWindow connects, with the slot timed */
+	monitor.setFilterId("[0-9a-fA-F]+$");
+	QObject::connect(&monitor, &QCanMonitor::packetReceived, &app,
+	                 [&](can_packet_t packet) {
+		deliver.add((wall_usec() - packet.tv_sec * 1000000 - packet.tv_usec) * 1000);
+		if (model_on) {
+			int64_t t = mono_nsec();
+
+			model.messageEnqueued(packet);
+			insert.add(mono_nsec() - t);
+		}
+		t_last = mono_nsec();
+		if (++inserted == frames)
+			app.quit();
+	});
+
+	QCanRecvThread thr(&sk);
+	thr.linkPacketConsumer(&head);
+	thr.linkPacketConsumer(&monitor);
+	thr.linkPacketConsumer(&writer);
+	thr.linkPacketConsumer(&tail);
+
+	/* A lost frame would leave inserted short of frames forever */
+	QObject::connect(&thr, &QThread::finished, &app, [&]() {
+		QTimer::singleShot(DRAIN_MS, &app, &QCoreApplication::quit);
+	});
+
+	unsigned long long allocs = ALLOCS();
+	double cpu = cpu_sec();
+	int64_t t0 = mono_nsec();
+
+	thr.start();
+	thr.setPriority(QThread::HighestPriority);
+	app.exec();
+
+	/* Without the drain wait when frames were lost */
+	int64_t elapsed = ((t_last != 0) ? t_last : mono_nsec()) - t0;
+	double cpu_used = cpu_sec() - cpu;
+	allocs = ALLOCS() - allocs;
+
+	thr.stop();
+	writer.close();
+	if (!keep)
+		remove(path);
+
+	unsigned long long lost = frames - inserted;
+	double fps = inserted * 1e9 / elapsed;
+	if (json) {
+		printf("{\"bench\":\"pipeline\",\"frames\":%llu,\"rate\":%llu,\"model\":%s,"
+		       "\"frames_per_sec\":%.0f,\"cpu_ns_per_frame\":%.1f,"
+		       "\"allocs_per_frame\":%.2f,\"written\":%llu,\"lost\":%llu,\"stages\":{",
+		       frames, rate, model_on ? "true" : "false", fps,
+		       cpu_used * 1e9 / frames, (double) allocs / frames,
+		       (unsigned long long) writer.written(), lost);
+		print_stage(dispatch, true, false);
+		print_stage(filters, true, false);
+		print_stage(deliver, true, false);
+		print_stage(insert, true, true);
+		printf("}}\n");
+	} else {
+		printf("%llu frames, rate %llu (0 = unpaced), model %s\n", frames, rate,
+		       model_on ? "on" : "off");
+		printf("  %.0f frames/s  %.1f ns CPU/frame  %.2f allocs/frame  %llu written\n",
+		       fps, cpu_used * 1e9 / frames, (double) allocs / frames,
+		       (unsigned long long) writer.written());
+		if (lost != 0)
+			printf("  %llu frames lost\n", lost);
+		printf("  %-10s %10s %12s %12s %12s %12s %8s\n", "stage", "samples",
+		       "p50 ns", "p99 ns", "p99.9 ns", "max ns", "res ns");
+		print_stage(dispatch, false, false);
+		print_stage(filters, false, false);
+		print_stage(deliver, false, false);
+		print_stage(insert, false, true);
+	}
+
+	return (lost != 0) ? 1 : 0;
+}
@@ -0,0 +1,375 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+
+
+/*
+ * Loopback check of the CAN over TCP protocol.  A server thread speaks
+ * HELLO/DATA/CREDIT as described in drivers/tcp_ops.h and echoes every
+ * frame it receives.  Every --cut frames it throws a DATA batch away
+ * and drops the connection without acknowledging it, so tcp_ops has to
+ * reconnect, write the lost frames again and resume the echo stream
+ * where it stopped.  The client sends --frames frames with consecutive
+ * IDs and checks that each one comes back once and in order.
+ *
+ *   tcp_loopback [--frames n] [--port p] [--cut n]
+ *
+ * --cut 0 keeps a single connection.  Exits 0 on success.
+ */
+
+#include "drivers/tcp_ops.h"
+#include "utils.h"
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE   16
+/* Frames the server takes before handing credit back */
+#define SERVER_WINDOW TCP_BATCH_MAX
+/* Longest time without a frame coming back, a lost frame ends the run */
+#define TIMEOUT_SEC   10
+
+static std::atomic<bool> s_done(false);
+static std::atomic<bool> s_failed(false);
+static std::atomic<unsigned long long> s_cuts(0);
+
+/* The only thing tcp_ops needs from the OS layer */
+int
+get_timestamp(int64_t *sec, int64_t *usec)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	if (sec)
+		*sec = tv.tv_sec;
+	if (usec)
+		*usec = tv.tv_usec;
+
+	return 0;
+}
+
+static int
+write_all(int fd, const uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t r = send(fd, buf, len, MSG_NOSIGNAL);
+		if (r <= 0)
+			return -1;
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+
+static int
+read_all(int fd, uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		ssize_t r = recv(fd, buf, len, 0);
+		if (r <= 0)
+			return -1;
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+
+static int
+send_msg(int fd, uint8_t type, uint64_t seq, const uint8_t *payload, uint32_t len)
+{
+	uint8_t hdr[HEADER_SIZE];
+	uint16_t magic = htons(TCP_MSG_MAGIC);
+	uint32_t length = htonl(len);
+
+	seq = htonll(seq);
+	memcpy(hdr, &magic, sizeof(magic));
+	hdr[2] = type;
+	hdr[3] = TCP_MSG_VERSION;
+	memcpy(hdr + 4, &length, sizeof(length));
+	memcpy(hdr + 8, &seq, sizeof(seq));
+
+	if (write_all(fd, hdr, sizeof(hdr)) < 0)
+		return -1;
+	return (len != 0) ? write_all(fd, payload, len) : 0;
+}
+
+static int
+send_control(int fd, uint8_t type, uint64_t seq, uint32_t value)
+{
+	value = htonl(value);
+	return send_msg(fd, type, seq, (const uint8_t *) &value, sizeof(value));
+}
+
+static int
+read_msg(int fd, uint8_t *type, uint64_t *seq, std::vector<uint8_t> &payload)
+{
+	uint8_t hdr[HEADER_SIZE];
+	uint16_t magic;
+	uint32_t length;
+
+	if (read_all(fd, hdr, sizeof(hdr)) < 0)
+		return -1;
+	memcpy(&magic, hdr, sizeof(magic));
+	if (ntohs(magic) != TCP_MSG_MAGIC || hdr[3] != TCP_MSG_VERSION)
+		return -1;
+
+	*type = hdr[2];
+	memcpy(&length, hdr + 4, sizeof(length));
+	memcpy(seq, hdr + 8, sizeof(*seq));
+	*seq = htonll(*seq);
+	payload.resize(ntohl(length));
+
+	return payload.empty() ? 0 : read_all(fd, payload.data(), payload.size());
+}
+
+static uint32_t
+get_u32(const std::vector<uint8_t> &payload)
+{
+	uint32_t value = 0;
+
+	if (payload.size() == sizeof(value))
+		memcpy(&value, payload.data(), sizeof(value));
+	return ntohl(value);
+}
+
+/*
+ * The server side.  What it received and echoed survives a connection,
+ * as a real peer's would, so both directions resume from the HELLOs.
+ */
+static void
+serve(int lsk, unsigned long long cut)
+{
+	std::vector<uint8_t> echo, payload;
+	uint64_t rx_next = 0, tx_sent, seq, cut_at = cut;
+	uint32_t credit;
+	uint8_t type;
+
+	while (!s_done.load()) {
+		struct timeval tv = { 0, 100000 };
+		fd_set rfds;
+		int fd;
+
+		FD_ZERO(&rfds);
+		FD_SET(lsk, &rfds);
+		if (select(lsk + 1, &rfds, NULL, NULL, &tv) <= 0)
+			continue;
+		fd = accept(lsk, NULL, NULL);
+		if (fd < 0)
+			continue;
+
+		if (read_msg(fd, &type, &seq, payload) < 0 || type != TCP_MSG_HELLO ||
+		    seq > echo.size() / TCP_FRAME_SIZE ||
+		    send_control(fd, TCP_MSG_HELLO, rx_next, SERVER_WINDOW) < 0) {
+			close(fd);
+			continue;
+		}
+		tx_sent = seq;
+		credit = get_u32(payload);
+
+		while (!s_done.load()) {
+			uint64_t n = echo.size() / TCP_FRAME_SIZE - tx_sent;
+
+			if (n > credit)
+				n = credit;
+			if (n > TCP_BATCH_MAX)
+				n = TCP_BATCH_MAX;
+			if (n != 0) {
+				if (send_msg(fd, TCP_MSG_DATA, tx_sent,
+				    echo.data() + tx_sent * TCP_FRAME_SIZE, n * TCP_FRAME_SIZE) < 0)
+					break;
+				tx_sent += n;
+				credit -= n;
+				continue;
+			}
+
+			tv.tv_sec = 0;
+			tv.tv_usec = 100000;
+			FD_ZERO(&rfds);
+			FD_SET(fd, &rfds);
+			if (select(fd + 1, &rfds, NULL, NULL, &tv) <= 0)
+				continue;
+			if (read_msg(fd, &type, &seq, payload) < 0)
+				break;
+
+			if (type == TCP_MSG_CREDIT) {
+				credit += get_u32(payload);
+				continue;
+			}
+			if (type != TCP_MSG_DATA || payload.size() % TCP_FRAME_SIZE != 0)
+				continue;
+
+			n = payload.size() / TCP_FRAME_SIZE;
+			if (cut != 0 && rx_next + n >= cut_at) {
+				/* Lost in flight: never echoed, never acknowledged */
+				cut_at = rx_next + n + cut;
+				s_cuts++;
+				break;
+			}
+			if (seq > rx_next) {
+				fprintf(stderr, "server: frames %llu-%llu skipped\n",
+				    (unsigned long long) rx_next, (unsigned long long) seq - 1);
+				s_failed = true;
+				s_done = true;
+				break;
+			}
+			/* Written again after a reconnect, only the new part counts */
+			for (uint64_t i = rx_next - seq; i < n; i++)
+				echo.insert(echo.end(), payload.begin() + i * TCP_FRAME_SIZE,
+				    payload.begin() + (i + 1) * TCP_FRAME_SIZE);
+			if (seq + n > rx_next)
+				rx_next = seq + n;
+			if (send_control(fd, TCP_MSG_CREDIT, rx_next, n) < 0)
+				break;
+		}
+		shutdown(fd, SHUT_RDWR);
+		close(fd);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned long long frames = 100000, cut = 10000, last = 0;
+	uint16_t port = 18888;
+	uint32_t value;
+	struct sockaddr_in addr;
+	const char *host = "127.0.0.1";
+	std::atomic<unsigned long long> received(0);
+	tcp_stats_t stats;
+	int lsk, fd, one = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			frames = strtoull(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+			port = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--cut") && i + 1 < argc)
+			cut = strtoull(argv[++i], NULL, 0);
+		else {
+			fprintf(stderr, "usage: %s [--frames n] [--port p] [--cut n]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+
+	lsk = socket(AF_INET, SOCK_STREAM, 0);
+	setsockopt(lsk, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr(host);
+	addr.sin_port = htons(port);
+	if (lsk < 0 || bind(lsk, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    listen(lsk, 1) < 0) {
+		perror("listen");
+		return 1;
+	}
+	std::thread server(serve, lsk, cut);
+
+	tcp_ops.attribute_set(TCP_SOCKET_ADDR, host, strlen(host));
+	tcp_ops.attribute_set(TCP_SOCKET_PORT, &port, sizeof(port));
+	value = TCP_OVERFLOW_BLOCK;
+	tcp_ops.attribute_set(TCP_SOCKET_OVERFLOW, &value, sizeof(value));
+	value = 200;
+	tcp_ops.attribute_set(TCP_SOCKET_RECONNECT_MS, &value, sizeof(value));
+	fd = tcp_ops.create("", 0);
+	if (fd < 0) {
+		fprintf(stderr, "cannot connect to the loopback server\n");
+		s_done = true;
+		server.join();
+		return 1;
+	}
+
+	std::thread client([&]() {
+		unsigned id;
+		uint8_t dlc, data[8];
+		uint64_t n;
+
+		while (received.load() < frames && !s_done.load()) {
+			int r = tcp_ops.recv(fd, &id, &dlc, data, NULL, NULL);
+
+			if (r == 0)
+				continue;
+			memcpy(&n, data, sizeof(n));
+			if (r < 0 || dlc != 8 || n != received.load() ||
+			    id != (EFF_FLAG | (n & EFF_MASK))) {
+				fprintf(stderr, "frame %llu came back as %llu\n",
+				    received.load(), (unsigned long long) n);
+				s_failed = true;
+				break;
+			}
+			received++;
+		}
+	});
+
+	/* Blocks while the server holds credit back, the timeout covers it */
+	std::thread sender([&]() {
+		for (uint64_t i = 0; i < frames && !s_done.load(); i++)
+			tcp_ops.send(fd, EFF_FLAG | (i & EFF_MASK), 8, &i);
+		tcp_ops.stop("");
+	});
+
+	for (int ms = 0; received.load() < frames && !s_failed.load(); ms += 10) {
+		if (received.load() != last) {
+			last = received.load();
+			ms = 0;
+		}
+		if (ms >= TIMEOUT_SEC * 1000) {
+			fprintf(stderr, "timed out, %llu of %llu frames back\n",
+			    received.load(), frames);
+			s_failed = true;
+			break;
+		}
+		usleep(10000);
+	}
+	s_done = true;
+	tcp_ops.wakeup(fd);
+	client.join();
+	tcp_stats_get(&stats);
+	/* Releases a sender still waiting for credit */
+	tcp_ops.destroy(fd);
+	sender.join();
+	server.join();
+	close(lsk);
+
+	printf("frames %llu, back %llu, cuts %llu, reconnects %llu, resent %llu, "
+	       "lost %llu: %s\n", frames, received.load(), s_cuts.load(),
+	       (unsigned long long) stats.reconnects, (unsigned long long) stats.tx_resent,
+	       (unsigned long long) stats.rx_lost, s_failed.load() ? "FAILED" : "ok");
+
+	return s_failed.load() ? 1 : 0;
+}
@@ -0,0 +1,50 @@
+#
+#  canspy - A simple tool for users who need to interface with a device based on
+#           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+#           sensors and many other devices.
+#  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# This code is made available on the understanding that it will not be
+# used in safety-critical situations without a full and competent review.
+#
+
+
+# Loopback check of the CAN over TCP protocol: a minimal server speaking
+# HELLO/DATA/CREDIT echoes every frame back to tcp_ops, dropping the
+# connection now and then.  Exits 0 when every frame came back once and
+# in order.
+
+QT += core
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+TARGET = tcp_loopback
+TEMPLATE = app
+
+INCLUDEPATH = ../../include
+
+QMAKE_CXXFLAGS_RELEASE += -O2
+
+SOURCES += main.cxx \
+           ../../src/drivers/general/tcp_ops.cxx \
+           ../../src/drivers/general/net_ops.cxx
+
+HEADERS += ../../include/drivers/tcp_ops.h \
+           ../../include/drivers/net_ops.h
+
+LIBS += -lpthread
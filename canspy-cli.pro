@@ -0,0 +1,134 @@
+#
+#  canspy - A simple tool for users who need to interface with a device based on
+#           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+#           sensors and many other devices.
+#  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# This code is made available on the understanding that it will not be
+# used in safety-critical situations without a full and competent review.
+#
+
+
+# Headless capture/replay tool, no widgets: qmake canspy-cli.pro
+
+QT += core network
+QT -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+TARGET = canspy-cli
+TEMPLATE = app
+
+INCLUDEPATH = ./include
+
+BUILD_DIRECTORY = ./build-cli
+
+DEFINES += __STDC_FORMAT_MACROS \
+          VERSION=\\\"v1.00\\\"
+
+MOC_DIR = $$BUILD_DIRECTORY/MOCFiles
+OBJECTS_DIR = $$BUILD_DIRECTORY/ObjFiles
+
+
+SOURCES += src/main_cli.cxx \
+           src/qcanheadless.cxx \
+           src/qcapturewriter.cxx \
+           src/qcapturereplay.cxx \
+           src/qcanbuffer.cxx \
+           src/qcanrecvthread.cxx \
+           src/qcansocket.cxx \
+           src/qmetrics.cxx \
+           src/qmetricsexporter.cxx \
+           src/qrealtime.cxx \
+           src/qdropmonitor.cxx \
+           src/can_drv.cxx \
+           src/qbusloadanalyzer.cxx \
+           src/analysis/busload.cxx \
+           src/analysis/errframe.cxx \
+           src/qerroranalyzer.cxx \
+           src/analysis/capture.cxx \
+           src/analysis/idfilter.cxx \
+           src/drivers/general/net_ops.cxx \
+           src/drivers/general/tcp_ops.cxx \
+           src/drivers/general/simulation_ops.cxx \
+           src/drivers/general/generator_ops.cxx
+
+HEADERS  += include/qcanheadless.h \
+            include/qcapturewriter.h \
+            include/qcapturereplay.h \
+            include/canbus/can_drv.h \
+            include/canbus/can_state.h \
+            include/canbus/can_packet.h \
+            include/drivers/simulation_ops.h \
+            include/drivers/generator_ops.h \
+            include/drivers/net_ops.h \
+            include/drivers/tcp_ops.h \
+            include/qcanbuffer.h \
+            include/qcanrecvthread.h \
+            include/qcansocket.h \
+            include/qmetrics.h \
+            include/qmetricsexporter.h \
+            include/qrealtime.h \
+            include/qdropmonitor.h \
+            include/qcanpacketconsumer.h \
+            include/qprotocoldecoder.h \
+            include/qbusloadanalyzer.h \
+            include/utils.h \
+            include/analysis/busload.h \
+            include/analysis/errframe.h \
+            include/qerroranalyzer.h \
+            include/analysis/capture.h \
+            include/analysis/idfilter.h
+
+linux-* {
+SOURCES += \
+        src/drivers/linux/can_socket_ops.cxx \
+        src/osdep/linux/utils_linux.cxx
+
+HEADERS += \
+        include/drivers/can_socket_ops.h
+
+LIBS += -lsocketcan
+
+CONFIG += link_pkgconfig
+packagesExist(liburing) {
+DEFINES += HAVE_LIBURING
+PKGCONFIG += liburing
+SOURCES += src/drivers/linux/can_socket_uring.cxx
+HEADERS += include/drivers/can_socket_uring.h
+}
+}
+
+win32 {
+SOURCES += \
+        src/osdep/windows/utils_windows.cxx \
+        src/drivers/windows/ixxat_ops.cxx \
+        src/drivers/windows/usb2can_ops.cxx
+
+HEADERS += \
+        include/osdep/canal.h \
+        include/drivers/ixxat_ops.h \
+        include/drivers/usb2can_ops.h
+
+LIBS += -lusb2can -lvcisdk -lWs2_32 -L./lib/win -L$(IXXAT_VCI_SDK)/lib/ia32
+
+INCLUDEPATH += $(IXXAT_VCI_SDK)/inc
+
+DEFINES +=_CRT_SECURE_NO_WARNINGS \
+          "WINVER=0x0501" \
+          "_WIN32_WINNT=0x0501"
+}
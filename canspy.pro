@@ -57,18 +57,53 @@ SOURCES += src/main.cxx \
            src/logmodel.cxx \
            src/qcanpkgabstractmodel.cxx \
            src/qcanmonitor.cxx \
+           src/qpacketstats.cxx \
            src/can_drv.cxx \
            src/msgseq.cxx \
            src/trigger.cxx \
+           src/qtriggerengine.cxx \
+           src/qflightrecorder.cxx \
+           src/analysis/dbc.cxx \
+           src/analysis/dbc_batch.cxx \
+           src/analysis/capture.cxx \
+           src/protocols/canopen.cxx \
+           src/qcanopendecoder.cxx \
+           src/protocols/j1939.cxx \
+           src/qj1939decoder.cxx \
+           src/protocols/isotp.cxx \
+           src/protocols/uds.cxx \
+           src/qisotpdecoder.cxx \
+           src/qisotpsender.cxx \
+           src/qisotpdialog.cxx \
+           src/protocols/nmea2000.cxx \
+           src/qnmea2000decoder.cxx \
+           src/analysis/timing.cxx \
+           src/qtiminganalyzer.cxx \
+           src/analysis/errframe.cxx \
+           src/qerroranalyzer.cxx \
+           src/analysis/busload.cxx \
+           src/qbusloadanalyzer.cxx \
+           src/analysis/changes.cxx \
+           src/qchangetracker.cxx \
+           src/qheatmapview.cxx \
+           src/qmetrics.cxx \
+           src/qrealtime.cxx \
+           src/qdropmonitor.cxx \
+           src/qdiagnosticsview.cxx \
+           src/qprotocolview.cxx \
            src/drivers/general/net_ops.cxx \
-           src/drivers/general/simulation_ops.cxx
+           src/drivers/general/tcp_ops.cxx \
+           src/drivers/general/simulation_ops.cxx \
+           src/drivers/general/generator_ops.cxx
 
 HEADERS  += include/mainwindow.h \
             include/canbus/can_drv.h \
             include/canbus/can_state.h \
             include/canbus/can_packet.h \
             include/drivers/simulation_ops.h \
+            include/drivers/generator_ops.h \
             include/drivers/net_ops.h \
+            include/drivers/tcp_ops.h \
             include/qcanbuffer.h \
             include/qcanrecvthread.h \
             include/qcansendthread.h \
@@ -80,9 +115,41 @@ HEADERS  += include/mainwindow.h \
             include/qcanpkgabstractmodel.h \
             include/qcanpacketconsumer.h \
             include/qcanmonitor.h \
+            include/qpacketstats.h \
             include/utils.h \
             include/msgseq.h \
-            include/trigger.h
+            include/trigger.h \
+            include/qtriggerengine.h \
+            include/qflightrecorder.h \
+            include/analysis/dbc.h \
+            include/analysis/dbc_batch.h \
+            include/analysis/capture.h \
+            include/protocols/canopen.h \
+            include/qprotocoldecoder.h \
+            include/qprotocolview.h \
+            include/qcanopendecoder.h \
+            include/protocols/j1939.h \
+            include/qj1939decoder.h \
+            include/protocols/isotp.h \
+            include/protocols/uds.h \
+            include/qisotpdecoder.h \
+            include/qisotpsender.h \
+            include/qisotpdialog.h \
+            include/protocols/nmea2000.h \
+            include/qnmea2000decoder.h \
+            include/analysis/timing.h \
+            include/qtiminganalyzer.h \
+            include/analysis/errframe.h \
+            include/qerroranalyzer.h \
+            include/analysis/busload.h \
+            include/qbusloadanalyzer.h \
+            include/analysis/changes.h \
+            include/qchangetracker.h \
+            include/qheatmapview.h \
+            include/qmetrics.h \
+            include/qrealtime.h \
+            include/qdropmonitor.h \
+            include/qdiagnosticsview.h
 
 
 FORMS    += forms/mainwindow.ui \
@@ -99,6 +166,14 @@ HEADERS += \
         include/drivers/can_socket_ops.h
 
 LIBS += -lsocketcan
+
+CONFIG += link_pkgconfig
+packagesExist(liburing) {
+DEFINES += HAVE_LIBURING
+PKGCONFIG += liburing
+SOURCES += src/drivers/linux/can_socket_uring.cxx
+HEADERS += include/drivers/can_socket_uring.h
+}
 }
 
 RESOURCES += \
@@ -0,0 +1,107 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef BUSLOAD_H
+#define BUSLOAD_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+#define BUSLOAD_STUFF_NONE      0
+#define BUSLOAD_STUFF_WORST     1       /* upper bound from the frame length */
+#define BUSLOAD_STUFF_ACTUAL    2       /* stuff bits of the frame as sent */
+
+/* Error flags, echo and delimiter, plus intermission */
+#define BUSLOAD_ERROR_BITS      23
+
+/* 10 ms slots, the ring spans the 1 s window */
+#define BUSLOAD_SLOT_USEC       10000
+#define BUSLOAD_SLOTS           100
+#define BUSLOAD_SLOTS_100MS     10
+
+/* IDs with their own share, extended IDs in an open addressing table */
+#define BUSLOAD_IDS             2048
+#define BUSLOAD_EXT_SLOTS       4096
+
+typedef struct {
+	uint32_t id;            /* EFF_FLAG set for extended frames */
+	uint64_t frames;
+	uint64_t tx_frames;
+	uint64_t bits;
+	uint64_t window_bits;
+	uint64_t last_window_bits;      /* in the last full second */
+} busload_id_t;
+
+typedef struct {
+	uint32_t bitrate;
+	int stuffing;
+
+	busload_id_t ids[BUSLOAD_IDS];
+	uint32_t nids;
+	uint32_t overflow;
+	uint16_t std_index[2048];
+	uint32_t ext_keys[BUSLOAD_EXT_SLOTS];
+	uint16_t ext_index[BUSLOAD_EXT_SLOTS];
+
+	/* Bits of the completed slots and of the one being filled */
+	uint32_t slot_bits[BUSLOAD_SLOTS];
+	int64_t slot;
+	uint32_t cur_bits;
+	uint64_t sum_100ms;
+	uint64_t sum_1s;
+	int64_t second_start;
+
+	/* Loads in hundredths of a percent */
+	uint32_t load_10ms;
+	uint32_t load_100ms;
+	uint32_t load_1s;
+	uint32_t peak_10ms;
+	uint32_t peak_100ms;
+	uint32_t peak_1s;
+
+	uint64_t frames;
+	uint64_t tx_frames;
+	uint64_t error_frames;
+	uint64_t bits;
+	uint64_t tx_bits;
+	uint64_t stuff_bits;
+} busload_engine_t;
+
+void busload_init(busload_engine_t *b, uint32_t bitrate, int stuffing);
+/* Clears counters and windows, keeps bitrate and stuffing */
+void busload_reset(busload_engine_t *b);
+
+/*
+ * Bits the frame takes on the bus from SOF to the end of intermission,
+ * stuff bits according to stuffing and returned in stuff when not NULL.
+ */
+uint32_t busload_frame_bits(uint32_t id, uint8_t dlc, const uint8_t *data,
+    int stuffing, uint32_t *stuff);
+
+void busload_update(busload_engine_t *b, const can_packet_t *packet);
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "canbus/can_packet.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Raw capture file: a fixed header followed by the frames stored as
+ * can_packet_t, so a mapped file can be walked like an in-memory block.
+ */
+#define CAPTURE_MAGIC   "CSPYCAP"
+#define CAPTURE_VERSION 1
+
+#pragma pack(1)
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t frame_size;    /* sizeof(can_packet_t) of the writer */
+	uint64_t count;         /* 0 when the writer didn't close the file */
+} capture_header_t;
+#pragma pack()
+
+typedef struct {
+	const can_packet_t *frames;
+	uint64_t count;
+	void *base;
+	size_t length;
+} capture_map_t;
+
+/* Frames buffered by a streaming writer between two writes */
+#define CAPTURE_BATCH   4096
+
+typedef struct {
+	FILE *fp;
+	uint64_t count;
+	uint32_t nbuf;
+	int error;
+	can_packet_t buf[CAPTURE_BATCH];
+} capture_writer_t;
+
+int capture_write(const char *path, const can_packet_t *frames, uint64_t count);
+
+/*
+ * Streaming capture: the header count stays 0 until capture_close(), so a
+ * capture cut short by a crash is still read up to its last full frame.
+ */
+int capture_open(capture_writer_t *w, const char *path);
+int capture_flush(capture_writer_t *w);
+/* Writes frames the caller buffered itself and hands them to the OS */
+int capture_append_frames(capture_writer_t *w, const can_packet_t *frames, uint32_t n);
+int capture_close(capture_writer_t *w);
+
+static inline int
+capture_append(capture_writer_t *w, const can_packet_t *packet)
+{
+	w->buf[w->nbuf++] = *packet;
+	if (w->nbuf == CAPTURE_BATCH)
+		return capture_flush(w);
+	return 0;
+}
+
+/* Maps a capture read only, returns -1 when the file is not a capture */
+int capture_map(const char *path, capture_map_t *map);
+void capture_unmap(capture_map_t *map);
+
+#endif
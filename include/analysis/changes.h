@@ -0,0 +1,98 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef CHANGES_H
+#define CHANGES_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+/* IDs tracked, extended IDs in an open addressing table */
+#define CHANGES_IDS             2048
+#define CHANGES_EXT_SLOTS       4096
+
+#define CHANGES_BYTES           8
+#define CHANGES_BITS            (CHANGES_BYTES * 8)
+
+/* Frames compared before a field is classified */
+#define CHANGES_MIN_FRAMES      16
+
+typedef struct {
+	uint32_t id;            /* EFF_FLAG set for extended frames */
+	uint32_t frames;
+	uint32_t changes;       /* frames with a payload different from the previous */
+	uint8_t dlc;
+	uint8_t data[CHANGES_BYTES];
+	uint8_t min[CHANGES_BYTES];
+	uint8_t max[CHANGES_BYTES];
+	int64_t last_change[CHANGES_BYTES];
+
+	/* Flips of bit byte * 8 + n, n = 0 is the LSB; see changes_flips() */
+	uint32_t flips[CHANGES_BITS];
+	uint8_t pending[CHANGES_BITS];
+	uint8_t npending;
+
+	/* Field detection, counted on consecutive frames */
+	uint32_t counter_hits[CHANGES_BYTES];   /* byte incremented by one */
+	uint32_t nibble_hits[CHANGES_BYTES];    /* low nibble incremented by one */
+	uint32_t sum_hits[CHANGES_BYTES];       /* byte - sum of the others constant */
+	uint8_t sum_k[CHANGES_BYTES];
+	uint32_t xor_hits;                      /* XOR of all bytes constant */
+	uint8_t xor_k;
+} changes_id_t;
+
+typedef struct {
+	changes_id_t ids[CHANGES_IDS];
+	uint32_t nids;
+	uint32_t overflow;
+	uint16_t std_index[2048];
+	uint32_t ext_keys[CHANGES_EXT_SLOTS];
+	uint16_t ext_index[CHANGES_EXT_SLOTS];
+} changes_engine_t;
+
+#define CHANGES_FIELD_COUNTER   0x01
+#define CHANGES_FIELD_NIBBLE    0x02
+#define CHANGES_FIELD_SUM       0x04
+#define CHANGES_FIELD_CONSTANT  0x08
+
+void changes_init(changes_engine_t *c);
+void changes_reset(changes_engine_t *c);
+
+void changes_update(changes_engine_t *c, const can_packet_t *packet);
+
+static inline uint32_t
+changes_flips(const changes_id_t *s, int bit)
+{
+	return s->flips[bit] + s->pending[bit];
+}
+
+/* CHANGES_FIELD_* flags guessed for byte b of s */
+int changes_field(const changes_id_t *s, int b);
+/* Whether the XOR of the payload is constant, an XOR checksum */
+int changes_has_xor(const changes_id_t *s);
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#ifndef DBC_H
+#define DBC_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+#define DBC_NAME_LEN 64
+#define DBC_UNIT_LEN 16
+
+#define DBC_NO_MUX  -1
+
+/* Upper bound of signals decoded by the log, a frame carries at most 64 */
+#define DBC_DECODE_MAX 64
+
+/*
+ * Extraction descriptor computed at load time: the payload is loaded as a
+ * 64 bit word (little endian for Intel signals, big endian for Motorola
+ * ones) so every signal is a shift, a mask and a linear conversion.
+ */
+typedef struct {
+	uint64_t mask;
+	uint64_t sign_bit;      /* 0 for unsigned signals */
+	double factor;
+	double offset;
+	uint8_t shift;
+	uint8_t big_endian;
+	uint8_t min_dlc;        /* frames shorter than this don't carry it */
+	int8_t is_mux;          /* multiplexer switch of its message */
+	int32_t mux_value;      /* DBC_NO_MUX or the switch value selecting it */
+} dbc_signal_t;
+
+typedef struct {
+	char name[DBC_NAME_LEN];
+	char unit[DBC_UNIT_LEN];
+	double minimum;
+	double maximum;
+} dbc_signal_info_t;
+
+typedef struct {
+	uint32_t id;            /* EFF_FLAG set for extended frames */
+	uint8_t dlc;
+	int32_t mux_signal;     /* index of the switch in the message or -1 */
+	uint32_t first_signal;
+	uint32_t nsignals;
+	char name[DBC_NAME_LEN];
+} dbc_message_t;
+
+typedef struct {
+	dbc_message_t *messages;
+	uint32_t nmessages;
+	dbc_signal_t *sigs;
+	dbc_signal_info_t *info;
+	uint32_t nsignals;
+	/* Message index + 1 by standard ID, 0 when unknown */
+	uint16_t std_index[2048];
+	/* Open addressing table for extended IDs */
+	uint32_t *ext_keys;
+	uint16_t *ext_index;
+	uint32_t ext_mask;
+} dbc_db_t;
+
+dbc_db_t *dbc_load(const char *path);
+void dbc_free(dbc_db_t *db);
+
+const dbc_message_t *dbc_lookup(const dbc_db_t *db, uint32_t id);
+
+/*
+ * Decodes the signals of packet into values, in the order of the message
+ * signals.  Signals not present in this frame (short DLC or another
+ * multiplexer value) are flagged in present when not NULL.  Returns the
+ * number of signals of the message, or -1 when the ID is unknown.
+ */
+int dbc_decode(const dbc_db_t *db, const can_packet_t *packet,
+    double *values, uint8_t *present, int max, const dbc_message_t **message);
+
+static inline uint64_t
+dbc_load_le64(const uint8_t *buf)
+{
+	uint64_t w = 0;
+
+	for (int i = 7; i >= 0; i--)
+		w = (w << 8) | buf[i];
+	return w;
+}
+
+static inline uint64_t
+dbc_load_be64(const uint8_t *buf)
+{
+	uint64_t w = 0;
+
+	for (int i = 0; i < 8; i++)
+		w = (w << 8) | buf[i];
+	return w;
+}
+
+static inline uint64_t
+dbc_raw(const dbc_signal_t *sig, uint64_t le_word, uint64_t be_word)
+{
+	uint64_t raw = ((sig->big_endian ? be_word : le_word) >> sig->shift) & sig->mask;
+
+	return raw;
+}
+
+static inline double
+dbc_scale(const dbc_signal_t *sig, uint64_t raw)
+{
+	if (sig->sign_bit)
+		return (double)(int64_t)((raw ^ sig->sign_bit) - sig->sign_bit) *
+		    sig->factor + sig->offset;
+
+	return (double) raw * sig->factor + sig->offset;
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef DBC_BATCH_H
+#define DBC_BATCH_H
+
+#include "analysis/dbc.h"
+#include "canbus/can_packet.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bulk decoding of a single signal over a contiguous block of frames,
+ * such as a recorder ring or a mapped capture file.  Frames are first
+ * selected by comparing the ids of several frames at a time (an AVX2
+ * gather, or scalar loads and an SSE2 compare, plain C otherwise), then
+ * the signal is extracted from the selected frames only.
+ */
+
+/*
+ * Stores in index the positions of the frames whose id field equals id,
+ * flags included, so RTR and error frames never match.  Returns the
+ * number of positions written, at most count.
+ */
+size_t dbc_batch_filter(const can_packet_t *frames, size_t count, uint32_t id,
+    uint32_t *index);
+
+/*
+ * Decodes sig from every frame of the block with the given id and a DLC
+ * long enough to carry it.  values (and index when not NULL) must have
+ * room for count entries.  Returns the number of decoded values.
+ */
+size_t dbc_batch_decode(const can_packet_t *frames, size_t count, uint32_t id,
+    const dbc_signal_t *sig, double *values, uint32_t *index);
+
+/* Name of the instruction set used by dbc_batch_filter */
+const char *dbc_batch_isa(void);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef ERRFRAME_H
+#define ERRFRAME_H
+
+#include "canbus/can_packet.h"
+#include "canbus/can_state.h"
+
+#include <stdint.h>
+
+/*
+ * Error frame layout of socketcan (linux/can/error.h), restated here so
+ * the decoder builds where that header doesn't exist.  The class is in
+ * the ID bits, the details in the payload bytes.
+ */
+#define ERRFRAME_TX_TIMEOUT     0x0001U
+#define ERRFRAME_LOSTARB        0x0002U /* data[0] bit number */
+#define ERRFRAME_CRTL           0x0004U /* data[1] */
+#define ERRFRAME_PROT           0x0008U /* data[2] type, data[3] location */
+#define ERRFRAME_TRX            0x0010U /* data[4] */
+#define ERRFRAME_ACK            0x0020U
+#define ERRFRAME_BUSOFF         0x0040U
+#define ERRFRAME_BUSERROR       0x0080U
+#define ERRFRAME_RESTARTED      0x0100U
+#define ERRFRAME_CNT            0x0200U /* data[6] TEC, data[7] REC valid */
+#define ERRFRAME_CLASSES        10
+
+/* Every error class, the mask given to the driver */
+#define ERRFRAME_MASK           0x1FFFFFFFU
+
+/* data[1] */
+#define ERRFRAME_CRTL_RX_OVERFLOW       0x01
+#define ERRFRAME_CRTL_TX_OVERFLOW       0x02
+#define ERRFRAME_CRTL_RX_WARNING        0x04
+#define ERRFRAME_CRTL_TX_WARNING        0x08
+#define ERRFRAME_CRTL_RX_PASSIVE        0x10
+#define ERRFRAME_CRTL_TX_PASSIVE        0x20
+#define ERRFRAME_CRTL_ACTIVE            0x40
+
+/* data[2], data[3] is one of 32 frame locations */
+#define ERRFRAME_PROT_TYPES     8
+#define ERRFRAME_PROT_LOCATIONS 32
+
+/* Error counter limits of ISO 11898-1 */
+#define ERRFRAME_WARNING_LIMIT  96
+#define ERRFRAME_PASSIVE_LIMIT  128
+
+typedef struct {
+	uint64_t frames;
+	uint64_t classes[ERRFRAME_CLASSES];
+	uint64_t crtl[8];
+	uint64_t prot_type[ERRFRAME_PROT_TYPES];
+	uint64_t prot_loc[ERRFRAME_PROT_LOCATIONS];
+	uint64_t trx;
+	uint8_t trx_last;       /* last transceiver status code */
+	uint8_t arb_bit;        /* bit of the last arbitration lost, 0 unknown */
+
+	/* Counters as last reported by the controller */
+	int counters;           /* set once TEC and REC were seen */
+	uint8_t tec;
+	uint8_t rec;
+	uint8_t tec_max;
+	uint8_t rec_max;
+
+	qcan_state_t state;
+	uint32_t transitions;
+
+	/* Error frames per second of frame time */
+	int64_t window;         /* second being counted */
+	uint32_t window_count;
+	int64_t last_window;    /* previous second with errors */
+	uint32_t last_count;
+	uint32_t peak_rate;
+} errframe_stats_t;
+
+void errframe_init(errframe_stats_t *s);
+
+/*
+ * Accounts an error frame, returns its class bits or 0 when packet is
+ * not an error frame.
+ */
+uint32_t errframe_update(errframe_stats_t *s, const can_packet_t *packet);
+
+/* Error frames in the second before now_usec, 0 once errors stopped */
+uint32_t errframe_rate(const errframe_stats_t *s, int64_t now_usec);
+
+const char *errframe_class_name(int bit);
+const char *errframe_crtl_name(int bit);
+const char *errframe_prot_type_name(int bit);
+const char *errframe_prot_loc_name(int loc);
+const char *errframe_trx_name(uint8_t code);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef IDFILTER_H
+#define IDFILTER_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+#define IDFILTER_MAX 32
+
+/*
+ * Acceptance filter in the SocketCAN "id:mask" form.  EFF_FLAG is part of
+ * both, so standard and extended rules never match the other kind.
+ */
+typedef struct {
+	uint32_t id;
+	uint32_t mask;
+} idfilter_rule_t;
+
+typedef struct {
+	idfilter_rule_t rules[IDFILTER_MAX];
+	uint32_t nrules;        /* 0 accepts every frame */
+} idfilter_t;
+
+/*
+ * Parses comma or blank separated "id[:mask]" rules in hex; more than 3
+ * digits or a value above 7FF is an extended ID.  Returns the number of
+ * rules or -1 on a malformed one.
+ */
+int idfilter_parse(idfilter_t *filter, const char *spec);
+
+static inline int
+idfilter_match(const idfilter_t *filter, uint32_t id)
+{
+	if (filter->nrules == 0)
+		return 1;
+
+	for (uint32_t i = 0; i < filter->nrules; i++)
+		if (((id ^ filter->rules[i].id) & filter->rules[i].mask) == 0)
+			return 1;
+	return 0;
+}
+
+#endif
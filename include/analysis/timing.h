@@ -0,0 +1,103 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+/* IDs tracked, each with its own histogram */
+#define TIMING_IDS              1024
+/* Open addressing table of extended IDs, a power of two */
+#define TIMING_EXT_SLOTS        2048
+
+/*
+ * Log bucketed histogram of inter-arrival times in usec: values below 32
+ * have a bucket each, above that every power of two is split in 32
+ * buckets, so any value is known within about 3% up to 2^32 usec.
+ */
+#define TIMING_SUB_BITS         5
+#define TIMING_SUB              (1 << TIMING_SUB_BITS)
+#define TIMING_BUCKETS          (TIMING_SUB + (32 - TIMING_SUB_BITS) * TIMING_SUB)
+
+/* Intervals seen before the mean stands in for a missing expected period */
+#define TIMING_AUTO_MIN         16
+
+typedef struct {
+	uint32_t id;            /* EFF_FLAG set for extended frames */
+	uint32_t expected;      /* usec, 0 to compare with the mean */
+	int64_t last;
+	uint64_t count;         /* intervals */
+	uint64_t sum;
+	double sum_sq;          /* for the standard deviation */
+	uint32_t min;
+	uint32_t max;
+	uint32_t missed;        /* intervals over the deadline */
+	uint32_t hist[TIMING_BUCKETS];
+} timing_id_t;
+
+typedef struct {
+	timing_id_t ids[TIMING_IDS];
+	uint32_t nids;
+	uint32_t overflow;      /* frames of IDs beyond TIMING_IDS */
+	uint32_t tolerance;     /* percent over the expected period */
+
+	/* Index + 1 into ids, 0 when unknown */
+	uint16_t std_index[2048];
+	uint32_t ext_keys[TIMING_EXT_SLOTS];
+	uint16_t ext_index[TIMING_EXT_SLOTS];
+} timing_engine_t;
+
+void timing_init(timing_engine_t *t, uint32_t tolerance);
+/* Clears the statistics, keeps IDs and expected periods */
+void timing_reset(timing_engine_t *t);
+
+int timing_set_expected(timing_engine_t *t, uint32_t id, uint32_t usec);
+
+void timing_update(timing_engine_t *t, const can_packet_t *packet);
+
+uint32_t timing_percentile(const timing_id_t *s, double p);
+uint32_t timing_mean(const timing_id_t *s);
+uint32_t timing_stddev(const timing_id_t *s);
+/* Lowest value counted in bucket b */
+uint32_t timing_bucket_low(int b);
+
+static inline int
+timing_bucket(uint32_t usec)
+{
+	int e;
+
+	if (usec < TIMING_SUB)
+		return usec;
+	e = 31 - __builtin_clz(usec);
+
+	return TIMING_SUB + (e - TIMING_SUB_BITS) * TIMING_SUB +
+	    ((usec >> (e - TIMING_SUB_BITS)) - TIMING_SUB);
+}
+
+#endif
@@ -51,6 +51,13 @@ typedef struct {
 	int (* stop)(const char *);
 	int (* state_get)(const char *, qcan_state_t *);
 	int (* restart)(const char *);
+	/* Frames the OS dropped on the socket so far, NULL when unknown */
+	int (* rx_dropped)(int, uint32_t *);
+	/*
+	 * Makes the recv in progress, or the next one, return 0 without a
+	 * frame.  NULL when recv never blocks for long.
+	 */
+	int (* wakeup)(int);
 } can_ops_t;
 
 typedef struct {
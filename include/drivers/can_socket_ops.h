@@ -28,6 +28,29 @@
 
 #include "canbus/can_drv.h"
 
+/*
+ * uint32_t, socket receive buffer in bytes, 0 keeps the system default.
+ * Set with SO_RCVBUFFORCE when privileged, else SO_RCVBUF which the
+ * kernel caps to net.core.rmem_max.
+ */
+#define CAN_SOCKET_RCVBUF 1
+
+/*
+ * uint32_t, low latency receive: usec spent polling the socket after a
+ * frame before blocking again, 0 always blocks.  The polling period
+ * adapts between CAN_SOCKET_SPIN_MIN and this value to how often frames
+ * come in time.  Also given to SO_BUSY_POLL.
+ */
+#define CAN_SOCKET_BUSY_POLL 2
+#define CAN_SOCKET_SPIN_MIN 10
+
+/*
+ * uint32_t, non zero receives through io_uring when built with liburing
+ * and the kernel supports it, else the plain calls are used.
+ * Busy polling doesn't apply then.
+ */
+#define CAN_SOCKET_URING 3
+
 extern can_ops_t can_socket_ops;
 
 #endif
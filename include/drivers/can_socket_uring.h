@@ -0,0 +1,65 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef CAN_SOCKET_URING_H
+#define CAN_SOCKET_URING_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <linux/can.h>
+
+/*
+ * io_uring backend of the socketcan driver, built with HAVE_LIBURING.
+ * Frames are received by a multishot recvmsg into a ring of provided
+ * buffers and reaped in batches, one system call for many frames.
+ * Frames are sent with plain writes: every send completes in order and
+ * returns its own error, which ISO-TP and SDO segments depend on.
+ */
+
+/* Receive buffers, a power of two */
+#define CAN_URING_BUFS          512
+/* Completions reaped by one wait */
+#define CAN_URING_BATCH         64
+
+/*
+ * 0 when the rings are set up, -1 keeps the plain socket calls.  A
+ * write to the eventfd wakefd, opened with EFD_NONBLOCK, makes
+ * can_uring_recv() return.
+ */
+int can_uring_open(int fd, int wakefd);
+/* Before the socket is closed, once no thread uses the rings */
+void can_uring_close(void);
+int can_uring_active(void);
+
+/*
+ * Next frame, with its timestamp and the SO_RXQ_OVFL count when given.
+ * Returns the frame size, -1 on errors, or 0 when woken up or when the
+ * kernel lacks multishot receive: can_uring_active() is then 0 and the
+ * plain calls take over.
+ */
+int can_uring_recv(struct can_frame *frame, struct timeval *tv, uint32_t *dropped);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef GENERATOR_OPS_H
+#define GENERATOR_OPS_H
+
+#include "canbus/can_drv.h"
+
+/*
+ * Synthetic traffic generated in process.  The device name is the traffic
+ * description, blank separated key=value pairs, all optional:
+ *
+ *   rate=1000              frames/s, 0 as fast as the receiver takes them
+ *   ids=100-7FF            uniform over a range (hex)
+ *   ids=zipf:64[:100]      64 IDs from 100, the lowest the most frequent
+ *   ids=100,200,18FEF100   uniform over a list
+ *   dlc=8 | dlc=0-8 | dlc=mix
+ *   pattern=steady | poisson | burst:<frames>:<idle ms>
+ *   payload=counter | random | zero
+ *   count=0                frames before the end of the stream, 0 endless
+ *   seed=1                 same seed, same frames and spacing
+ *
+ * IDs above 7FF are sent as extended frames.
+ */
+#define GENERATOR_IDS_MAX 2048
+
+extern can_ops_t generator_ops;
+
+#endif
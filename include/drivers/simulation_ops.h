@@ -30,4 +30,11 @@
 
 extern can_ops_t simulation_ops;
 
+/*
+ * Parses a line of a text log (modified in place) into a frame and the
+ * delay in ms before the next one, left untouched when the line has none.
+ */
+int simulation_parse_line(char *buffer, uint32_t *id, uint8_t *dlc, uint8_t data[],
+                          uint64_t *delay);
+
 #endif
@@ -0,0 +1,94 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#ifndef TCP_OPS_H
+#define TCP_OPS_H
+
+#include "canbus/can_drv.h"
+
+/*
+ * CAN over a TCP stream.
+ *
+ * Every message starts with a 16 byte header in network byte order:
+ *
+ *   uint16_t magic     TCP_MSG_MAGIC
+ *   uint8_t  type      TCP_MSG_HELLO, TCP_MSG_DATA or TCP_MSG_CREDIT
+ *   uint8_t  version   TCP_MSG_VERSION
+ *   uint32_t length    payload bytes following the header
+ *   uint64_t seq       see below
+ *
+ * HELLO is the first message sent by both peers after connecting: seq is
+ * the next frame sequence number the sender expects to receive (so the peer
+ * can resume after a reconnect) and the payload is a uint32_t with the
+ * number of frames the sender is willing to buffer (its receive window).
+ *
+ * DATA carries a batch of TCP_FRAME_SIZE byte frame records; seq is the
+ * sequence number of the first frame of the batch.
+ *
+ * CREDIT returns window to the peer once frames have been consumed: the
+ * payload is a uint32_t with the number of frames released.  A peer never
+ * has more frames in flight than the window granted, so a slow reader
+ * throttles the writer instead of growing queues without bound.  seq is
+ * the next frame sequence number the sender expects, acknowledging every
+ * frame before it.  Unacknowledged frames are kept by the writer and sent
+ * again after a reconnect, starting from the seq of the peer's HELLO.
+ */
+#define TCP_MSG_MAGIC   0x4353
+#define TCP_MSG_VERSION 1
+
+#define TCP_MSG_HELLO   1
+#define TCP_MSG_DATA    2
+#define TCP_MSG_CREDIT  3
+
+#define TCP_FRAME_SIZE  26
+#define TCP_BATCH_MAX   256
+
+#define TCP_SOCKET_ADDR         1
+#define TCP_SOCKET_PORT         2
+#define TCP_SOCKET_FLUSH_USEC   3 /* uint32_t, max TX batching latency */
+#define TCP_SOCKET_OVERFLOW     4 /* uint32_t, TCP_OVERFLOW_* */
+#define TCP_SOCKET_RECONNECT_MS 5 /* uint32_t, max retry interval, 0 disables */
+
+#define TCP_OVERFLOW_DROP  0 /* drop and count frames the peer has no room for */
+#define TCP_OVERFLOW_BLOCK 1 /* block the sender until the peer grants credit */
+
+typedef struct {
+	uint64_t rx_frames;
+	uint64_t rx_batches;
+	uint64_t rx_lost;       /* frames skipped by the peer across a reconnect */
+	uint64_t tx_frames;
+	uint64_t tx_batches;
+	uint64_t tx_dropped;
+	uint64_t tx_resent;     /* frames written again after a reconnect */
+	uint64_t reconnects;
+	uint32_t tx_credit;
+	uint32_t tx_queued;
+} tcp_stats_t;
+
+extern can_ops_t tcp_ops;
+
+int tcp_stats_get(tcp_stats_t *stats);
+
+#endif
@@ -27,7 +27,9 @@
 #define LOGMODEL_H
 
 #include "canbus/can_packet.h"
+#include "analysis/dbc.h"
 #include "qcanpkgabstractmodel.h"
+#include "qmetrics.h"
 #include <QTime>
 
 class logModel : public QCanPkgAbstractModel
@@ -36,16 +38,25 @@ class logModel : public QCanPkgAbstractModel
 
 	public slots:
 		void messageEnqueued(can_packet_t);
+		void markerEnqueued(const QString &text);
 	public:
 		logModel(QObject *parent = 0);
 		void setEnable(bool enable);
 		~logModel();
 		void setHexLayout(bool enable);
+		/* Decodes the signals of known IDs in the Signals column, NULL disables */
+		void setDatabase(const dbc_db_t *db);
+		/* Frame of a line of a text log (.tlog) */
+		static can_packet_t parseLine(const QString &line);
 
 	QVector <can_str_packet_t> buffer;
 	QTime m_lastTimer;
 	bool m_enable;
 	bool m_hexLayout;
+	const dbc_db_t *m_dbc;
+	/* Frames shown, and dropped while the log is paused */
+	QMetrics::Counter *m_inserted;
+	QMetrics::Counter *m_discarded;
 
 };
 
@@ -40,6 +40,20 @@
 #include "qcansendthread.h"
 #include "qcansocket.h"
 #include "qcanmonitor.h"
+#include "qtriggerengine.h"
+#include "qflightrecorder.h"
+#include "qcanopendecoder.h"
+#include "qj1939decoder.h"
+#include "qisotpdecoder.h"
+#include "qnmea2000decoder.h"
+#include "qtiminganalyzer.h"
+#include "qerroranalyzer.h"
+#include "qrealtime.h"
+#include "qbusloadanalyzer.h"
+#include "qchangetracker.h"
+#include "qpacketstats.h"
+#include "qdropmonitor.h"
+#include "qisotpsender.h"
 #include "qappsettings.h"
 #include "qdelegatecolor.h"
 #include "logmodel.h"
@@ -52,14 +66,6 @@ class MainWindow : public QMainWindow
 {
 	Q_OBJECT
 
-	typedef struct {
-		int64_t lastSec;
-		int64_t lastUSec;
-		quint64 row;
-		quint64 count;
-		quint8 data[8];
-	} statistic_t;
-
 public:
 	explicit MainWindow(QWidget *parent = 0);
 	~MainWindow();
@@ -67,6 +73,8 @@ public:
 	void setLogToFileEnabled(bool);
 	bool saveFileStandard(const QString &);
 	bool saveFileAsc(const QString &);
+	bool openDatabase(const QString &);
+	void showProtocolView(QProtocolDecoder *decoder);
 	virtual bool eventFilter(QObject *, QEvent *);
 
 private slots:
@@ -89,6 +97,24 @@ private slots:
 	void cycleTimeChanged(QString);
 	void exportToCSV(void);
 	void showSendSequenceDialog(void);
+	void showTriggerDialog(void);
+	void disarmTrigger(void);
+	void triggerFired(int action, can_packet_t packet);
+	void runTriggerAction(void);
+	void flightRecorderTrigger(void);
+	void flightRecorderDumped(QString fileName, unsigned frames);
+	void loadDatabase(void);
+	void showCanOpenView(void);
+	void showJ1939View(void);
+	void showIsoTpView(void);
+	void showNmea2000View(void);
+	void showTimingView(void);
+	void showErrorView(void);
+	void showBusLoadView(void);
+	void showChangesView(void);
+	void showHeatmapView(void);
+	void showDiagnosticsView(void);
+	void showIsoTpSendDialog(void);
 
 private:
 	void initActionsConnections(void);
@@ -103,9 +129,9 @@ private:
 	QLabel *m_labPacketSend;
 	QLabel *m_labNumberPDO;
 	QLabel *m_labConfig;
+	QLabel *m_labDropped;
 	quint64 m_pkg_recv;
 	quint64 m_pkg_send;
-	quint64 m_bit_recv;
 	quint64 m_bitrate;
 	quint16 m_percent;
 	quint16 m_cycletime;
@@ -114,10 +140,29 @@ private:
 	logModel *m_model_log;
 	QStandardItemModel *m_model_stat;
 	QSortFilterProxyModel *m_model_sort_stat;
-	QMap<unsigned, statistic_t *> m_stats;
+	QPacketStats m_stats;
 	QProgressBar *m_busload;
 	bool m_sound;
 	QCanMonitor *m_monitor;
+	QTriggerEngine *m_trigger;
+	trigger_config_t m_trigger_config;
+	bool m_trigger_delay;
+	int m_trigger_delay_ms;
+	QString m_trigger_cmd;
+	int m_trigger_pending;
+	can_packet_t m_trigger_packet;
+	QFlightRecorder *m_recorder;
+	dbc_db_t *m_dbc;
+	QCanOpenDecoder *m_canopen;
+	QJ1939Decoder *m_j1939;
+	QIsoTpDecoder *m_isotp;
+	QIsoTpSender *m_isotp_sender;
+	QNmea2000Decoder *m_nmea2000;
+	QTimingAnalyzer *m_timing;
+	QErrorAnalyzer *m_errors;
+	QBusLoadAnalyzer *m_load;
+	QChangeTracker *m_changes;
+	QDropMonitor m_drops;
 };
 
 
@@ -54,7 +54,6 @@ public:
 private:
 	void rowToCanPacket(int row, can_packet_t &packet, uint64_t *msleep);
 	void loadFile(QString fileName);
-	can_packet_t processLine(const QString &line);
 
 private slots:
 	void addMsgButton_clicked(void);
@@ -0,0 +1,140 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef CANOPEN_H
+#define CANOPEN_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+#define CO_NODES        128
+#define CO_PDOS         4
+/* Largest SDO payload kept, longer transfers are counted but truncated */
+#define CO_SDO_BUF      1024
+
+/* Frame classes, from the function code of the COB-ID */
+#define CO_UNKNOWN      0
+#define CO_NMT          1
+#define CO_SYNC         2
+#define CO_EMCY         3
+#define CO_TIME         4
+#define CO_TPDO         5
+#define CO_RPDO         6
+#define CO_SDO_TX       7       /* server to client */
+#define CO_SDO_RX       8       /* client to server */
+#define CO_HEARTBEAT    9
+#define CO_LSS          10
+#define CO_CLASSES      11
+
+/* NMT states as reported by heartbeat and boot-up */
+#define CO_STATE_BOOTUP         0x00
+#define CO_STATE_STOPPED        0x04
+#define CO_STATE_OPERATIONAL    0x05
+#define CO_STATE_PREOPERATIONAL 0x7F
+#define CO_STATE_UNKNOWN        0xFF
+
+#define CO_SDO_DOWNLOAD 0
+#define CO_SDO_UPLOAD   1
+
+/* Transfer stages */
+#define CO_SDO_INIT     0
+#define CO_SDO_DATA     1
+#define CO_SDO_END      2
+
+typedef struct {
+	uint16_t index;
+	uint8_t subindex;
+	uint8_t direction;      /* CO_SDO_DOWNLOAD or CO_SDO_UPLOAD */
+	uint8_t block;
+	uint32_t size;          /* bytes transferred */
+	uint32_t abort_code;    /* 0 when completed */
+	int64_t usec;           /* duration */
+	uint8_t data[8];        /* first bytes of the payload */
+} co_sdo_result_t;
+
+typedef struct {
+	/* Transfer in progress */
+	uint8_t active;
+	uint8_t direction;
+	uint8_t block;
+	uint8_t stage;
+	uint8_t last;           /* segment with the c bit seen */
+	uint8_t seqno;          /* block transfers: last sequence number */
+	uint32_t block_base;    /* block transfers: length at the sub-block start */
+	uint16_t index;
+	uint8_t subindex;
+	uint32_t size;          /* announced size, 0 if not indicated */
+	uint32_t len;
+	int64_t start_usec;
+	uint8_t buf[CO_SDO_BUF];
+
+	uint32_t completed;
+	uint32_t aborted;
+	co_sdo_result_t result;
+} co_sdo_t;
+
+typedef struct {
+	uint8_t seen;
+	uint8_t state;
+	int64_t hb_last;        /* usec */
+	uint32_t hb_period;     /* last interval in usec */
+	uint32_t hb_min;
+	uint32_t hb_max;
+
+	uint32_t tpdo[CO_PDOS];
+	uint32_t rpdo[CO_PDOS];
+	uint32_t tpdo_window;
+	uint32_t rpdo_window;
+	uint32_t tpdo_rate;     /* frames/s in the last full second */
+	uint32_t rpdo_rate;
+
+	uint32_t emcy;
+	uint16_t emcy_code;
+	uint8_t emcy_register;
+
+	co_sdo_t sdo;
+} co_node_t;
+
+typedef struct {
+	co_node_t node[CO_NODES];
+	uint32_t frames[CO_CLASSES];
+	uint32_t sync_period;   /* usec */
+	int64_t sync_last;
+	int64_t window_start;
+} co_engine_t;
+
+void co_init(co_engine_t *co);
+
+/* Returns the class of the frame, CO_UNKNOWN for extended, RTR or error frames */
+int co_process(co_engine_t *co, const can_packet_t *packet);
+
+int co_classify(uint32_t id, uint8_t *node, uint8_t *pdo);
+
+const char *co_class_name(int type);
+const char *co_state_name(uint8_t state);
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef ISOTP_H
+#define ISOTP_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+/* ISO 15765-2 on classic CAN, normal addressing */
+#define ISOTP_MAX               4095
+#define ISOTP_CHANNELS          16
+/* Buffers shared by all multi-frame receptions in progress */
+#define ISOTP_BUFFERS           8
+
+/* N_Cr: consecutive frame timeout, usec */
+#define ISOTP_N_CR              1000000
+
+#define ISOTP_SF                0
+#define ISOTP_FF                1
+#define ISOTP_CF                2
+#define ISOTP_FC                3
+
+#define ISOTP_FC_CTS            0
+#define ISOTP_FC_WAIT           1
+#define ISOTP_FC_OVFL           2
+
+#define ISOTP_REQUEST           0
+#define ISOTP_RESPONSE          1
+
+typedef struct {
+	uint8_t *buf;           /* from the pool, NULL when idle */
+	uint16_t size;
+	uint16_t len;
+	uint8_t seq;
+	int64_t start;
+	int64_t deadline;
+} isotp_rx_t;
+
+typedef struct {
+	uint32_t id[2];         /* request and response IDs, EFF_FLAG if extended */
+	isotp_rx_t rx[2];
+	uint8_t bs;             /* last flow control seen on the channel */
+	uint8_t stmin;
+} isotp_channel_t;
+
+typedef struct {
+	int channel;
+	int direction;          /* ISOTP_REQUEST or ISOTP_RESPONSE */
+	const uint8_t *data;
+	uint16_t len;
+	int64_t start;          /* first frame, usec */
+	int64_t end;            /* last frame, usec */
+} isotp_pdu_t;
+
+typedef struct {
+	isotp_channel_t channel[ISOTP_CHANNELS];
+	int nchannels;
+	uint8_t pool[ISOTP_BUFFERS][ISOTP_MAX];
+	uint8_t pool_used[ISOTP_BUFFERS];
+
+	uint32_t pdus;
+	uint32_t seq_errors;
+	uint32_t timeouts;
+	uint32_t pool_exhausted;
+	uint32_t overflows;     /* FC overflow seen */
+} isotp_engine_t;
+
+void isotp_init(isotp_engine_t *tp);
+int isotp_add_channel(isotp_engine_t *tp, uint32_t request_id, uint32_t response_id);
+
+/*
+ * Returns 1 when packet completes a PDU and fills pdu; the data stays
+ * valid until the next call.
+ */
+int isotp_process(isotp_engine_t *tp, const can_packet_t *packet, isotp_pdu_t *pdu);
+
+/* Converts an STmin byte to usec, reserved values count as 127 ms */
+uint32_t isotp_stmin_usec(uint8_t stmin);
+
+#endif
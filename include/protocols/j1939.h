@@ -0,0 +1,140 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef J1939_H
+#define J1939_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+#define J1939_PGN_REQUEST       0xEA00
+#define J1939_PGN_ADDRESS_CLAIM 0xEE00
+#define J1939_PGN_TP_CM         0xEC00
+#define J1939_PGN_TP_DT         0xEB00
+
+#define J1939_ADDR_NULL         0xFE
+#define J1939_ADDR_GLOBAL       0xFF
+
+/* Transport protocol limits and timeouts (J1939-21), in usec */
+#define J1939_TP_MAX            1785
+#define J1939_T1                750000
+#define J1939_T2                1250000
+#define J1939_T3                1250000
+#define J1939_T4                1050000
+
+/* Concurrent transport sessions, each with its own arena buffer */
+#define J1939_SESSIONS          32
+/* PGN statistics slots, a power of two */
+#define J1939_PGN_SLOTS         1024
+
+#define J1939_TP_IDLE           0
+#define J1939_TP_BAM            1
+#define J1939_TP_RTS            2       /* waiting for CTS */
+#define J1939_TP_DATA           3       /* data after CTS */
+#define J1939_TP_HOLD           4       /* CTS with zero packets */
+#define J1939_TP_ACK            5       /* all data seen, waiting for EOMA */
+
+typedef struct {
+	uint8_t priority;
+	uint32_t pgn;
+	uint8_t sa;
+	uint8_t da;             /* J1939_ADDR_GLOBAL for PDU2 PGNs */
+} j1939_id_t;
+
+typedef struct {
+	j1939_id_t id;
+	const uint8_t *data;
+	uint16_t len;
+} j1939_message_t;
+
+typedef struct {
+	uint8_t state;
+	uint8_t sa;
+	uint8_t da;
+	uint8_t packets;
+	uint8_t next;           /* next sequence number expected */
+	uint8_t window_end;     /* last sequence number cleared by CTS */
+	uint8_t priority;
+	uint16_t size;
+	uint32_t pgn;
+	int64_t deadline;
+	uint8_t *buf;
+} j1939_session_t;
+
+typedef struct {
+	uint8_t used;
+	uint32_t pgn;
+	uint32_t frames;
+	uint32_t messages;      /* single frame and reassembled */
+	uint64_t bytes;
+	uint32_t window;
+	uint32_t rate;          /* messages/s in the last full second */
+	uint8_t last_sa;
+	uint16_t last_len;
+	uint8_t last_data[8];
+} j1939_pgn_stats_t;
+
+typedef struct {
+	uint8_t claimed;
+	uint64_t name;
+	int64_t last;
+	uint32_t conflicts;     /* claims of the address by another NAME */
+} j1939_address_t;
+
+typedef struct {
+	j1939_session_t session[J1939_SESSIONS];
+	uint8_t arena[J1939_SESSIONS][J1939_TP_MAX];
+
+	j1939_pgn_stats_t pgn[J1939_PGN_SLOTS];
+	uint32_t npgn;
+	uint32_t pgn_overflow;
+
+	j1939_address_t address[256];
+
+	uint32_t tp_completed;
+	uint32_t tp_aborted;
+	uint32_t tp_timeouts;
+	uint32_t tp_dropped;    /* no free session */
+
+	int64_t window_start;
+	int64_t next_check;
+} j1939_engine_t;
+
+void j1939_split(uint32_t id, j1939_id_t *out);
+uint32_t j1939_make_id(const j1939_id_t *id);
+
+void j1939_init(j1939_engine_t *j);
+
+/*
+ * Returns 1 when packet completes a message, single frame or transport
+ * session, and fills msg; data stays valid until the next call.  Returns 0
+ * for transport frames and non J1939 frames.
+ */
+int j1939_process(j1939_engine_t *j, const can_packet_t *packet,
+    j1939_message_t *msg);
+
+#endif
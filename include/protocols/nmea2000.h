@@ -0,0 +1,146 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef NMEA2000_H
+#define NMEA2000_H
+
+#include "canbus/can_packet.h"
+
+#include <stdint.h>
+
+/* Fast-packet: 6 bytes in frame 0, 7 in each of up to 31 more */
+#define N2K_FAST_MAX            223
+
+/* Reassembly slots keyed by (source, PGN, sequence), a power of two */
+#define N2K_FP_SLOTS            64
+/* Slots probed for a key before giving up */
+#define N2K_FP_PROBE            8
+/* Time allowed between two frames of a fast-packet, usec */
+#define N2K_FP_TIMEOUT          750000
+
+/* PGN statistics slots, a power of two */
+#define N2K_PGN_SLOTS           256
+
+/* Upper bound of fields decoded from one PGN */
+#define N2K_DECODE_MAX          16
+
+/*
+ * Little endian bit field of a PGN payload.  All ones (all ones but the
+ * sign bit for signed fields) means the value is not available.
+ */
+typedef struct {
+	const char *name;
+	uint16_t offset;        /* bits from the start of the payload */
+	uint8_t bits;
+	uint8_t is_signed;
+	double factor;
+	double add;
+	const char *unit;
+} n2k_field_t;
+
+typedef struct {
+	uint32_t pgn;
+	const char *name;
+	uint8_t fast;
+	uint8_t nfields;
+	const n2k_field_t *fields;
+} n2k_pgn_info_t;
+
+typedef struct {
+	uint8_t priority;
+	uint32_t pgn;
+	uint8_t sa;
+	uint8_t da;
+	const uint8_t *data;
+	uint16_t len;
+} n2k_message_t;
+
+typedef struct {
+	uint8_t used;
+	uint8_t sa;
+	uint8_t seq;
+	uint8_t next;           /* frame counter expected */
+	uint8_t size;
+	uint8_t len;
+	uint8_t priority;
+	uint8_t da;
+	uint32_t pgn;
+	int64_t deadline;
+	uint8_t buf[N2K_FAST_MAX];
+} n2k_slot_t;
+
+typedef struct {
+	uint8_t used;
+	uint8_t fast;
+	uint32_t pgn;
+	const n2k_pgn_info_t *info;     /* NULL for PGNs without a decoder */
+	uint32_t frames;
+	uint32_t messages;
+	uint32_t window;
+	uint32_t rate;          /* messages/s in the last full second */
+	uint8_t last_sa;
+	uint16_t last_len;
+	uint8_t last_data[N2K_FAST_MAX];
+} n2k_pgn_stats_t;
+
+typedef struct {
+	n2k_slot_t slot[N2K_FP_SLOTS];
+
+	n2k_pgn_stats_t pgn[N2K_PGN_SLOTS];
+	uint32_t npgn;
+	uint32_t pgn_overflow;
+
+	uint32_t fp_completed;
+	uint32_t fp_lost;       /* frame missing or restarted */
+	uint32_t fp_timeouts;
+	uint32_t fp_dropped;    /* no free slot */
+	uint32_t fp_orphans;    /* frames of a fast-packet whose start was missed */
+
+	int64_t window_start;
+	int64_t next_check;
+} n2k_engine_t;
+
+void n2k_init(n2k_engine_t *n);
+
+/* Decoder of pgn, NULL when unknown */
+const n2k_pgn_info_t *n2k_pgn_info(uint32_t pgn);
+/* Whether pgn is sent as fast-packet */
+int n2k_is_fast(uint32_t pgn);
+
+/*
+ * Returns 1 when packet completes a message, single frame or fast-packet,
+ * and fills msg; data stays valid until the next call.
+ */
+int n2k_process(n2k_engine_t *n, const can_packet_t *packet, n2k_message_t *msg);
+
+/*
+ * Decodes the fields of info from data into values.  Fields beyond len or
+ * not available are flagged in present.  Returns the number of fields.
+ */
+int n2k_decode(const n2k_pgn_info_t *info, const uint8_t *data, uint16_t len,
+    double *values, uint8_t *present, int max);
+
+#endif
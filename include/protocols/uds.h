@@ -0,0 +1,85 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef UDS_H
+#define UDS_H
+
+#include "protocols/isotp.h"
+
+#include <stdint.h>
+
+/* Service records kept, oldest are overwritten */
+#define UDS_RECORDS             256
+
+#define UDS_NEGATIVE_RESPONSE   0x7F
+#define UDS_NRC_PENDING         0x78
+
+/* P2 and P2* server max, usec: the wait for a response and after a pending */
+#define UDS_P2                  50000
+#define UDS_P2_EXT              5000000
+
+#define UDS_RESULT_POSITIVE     0
+#define UDS_RESULT_NEGATIVE     1
+#define UDS_RESULT_NO_RESPONSE  2       /* suppressed or never answered */
+
+typedef struct {
+	uint8_t channel;
+	uint8_t sid;
+	uint8_t result;
+	uint8_t nrc;
+	uint8_t pending;        /* response pending (NRC 0x78) received */
+	uint16_t request_len;
+	uint16_t response_len;
+	int64_t time;           /* request end, usec */
+	uint32_t latency;       /* request end to response start, usec */
+} uds_record_t;
+
+typedef struct {
+	struct {
+		uint8_t active;
+		uint8_t sid;
+		uint8_t pending;
+		uint8_t suppressed;     /* positive response suppressed */
+		uint16_t len;
+		int64_t end;
+		int64_t deadline;       /* P2 of a suppressed request, usec */
+	} request[ISOTP_CHANNELS];
+
+	uds_record_t record[UDS_RECORDS];
+	uint32_t head;          /* records written so far */
+
+	uint32_t positive;
+	uint32_t negative;
+	uint32_t unanswered;
+} uds_tracker_t;
+
+void uds_init(uds_tracker_t *uds);
+void uds_process(uds_tracker_t *uds, const isotp_pdu_t *pdu);
+
+const char *uds_service_name(uint8_t sid);
+const char *uds_nrc_name(uint8_t nrc);
+
+#endif
@@ -31,6 +31,7 @@
 #define NETCAN       2
 #define PCAN_USB     3
 #define SIMULATION   4
+#define GENERATOR    5
 
 
 #include <QSettings>
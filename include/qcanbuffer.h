@@ -27,19 +27,35 @@
 #define QCANBUFFER_H
 
 #include "canbus/can_packet.h"
+#include "qmetrics.h"
 
 #include <QObject>
+#include <QString>
 
-
+/*
+ * Hands the frames of the receive thread to a consumer of another thread.
+ * The buffer lives in the thread of the consumer, where it counts the
+ * frames delivered and their latency from the driver timestamp.
+ */
 class QCanBuffer : public QObject
 {
 	Q_OBJECT
 public:
-	explicit QCanBuffer(QObject *parent = 0);
+	explicit QCanBuffer(const QString &name, QObject *parent = 0);
 	void packetRecvFromThread(can_packet_t packet);
 
 signals:
 	void packetReceived(can_packet_t packet);
+	void packetQueued(can_packet_t packet);
+
+private slots:
+	void deliver(can_packet_t packet);
+
+private:
+	/* Counted by the receive thread, delivered ones by the consumer thread */
+	QMetrics::Counter *m_queued;
+	QMetrics::Counter *m_delivered;
+	QMetrics::Histogram *m_latency;
 };
 
 #endif // QCANBUFFER_H
@@ -0,0 +1,116 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QCANHEADLESS_H
+#define QCANHEADLESS_H
+
+#include "qcansocket.h"
+#include "qcanrecvthread.h"
+#include "qcapturewriter.h"
+#include "qcapturereplay.h"
+#include "qbusloadanalyzer.h"
+#include "qerroranalyzer.h"
+#include "qrealtime.h"
+#include "qdropmonitor.h"
+#include "qmetrics.h"
+#include "qmetricsexporter.h"
+#include "analysis/idfilter.h"
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+
+typedef struct {
+	QString driver;         /* socketcan, tcp, udp, sim or gen */
+	QString device;         /* interface, host:port, file or traffic spec */
+	unsigned bitrate;
+	unsigned rcvbuf;        /* socketcan receive buffer, 0 for the default */
+	unsigned busy_poll;     /* socketcan usec of polling before blocking */
+	unsigned uring;         /* socketcan through io_uring when available */
+	QString capture;        /* raw capture written, empty for none */
+	QString replay;         /* raw capture sent, empty for none */
+	idfilter_t filter;
+	double speed;
+	unsigned loops;
+	unsigned stats_sec;     /* 0 prints only the final statistics */
+	unsigned duration_sec;  /* 0 runs until SIGINT or SIGTERM */
+	QString metrics;        /* JSON of the pipeline metrics written at exit */
+	QString metrics_listen; /* address of the /metrics page, empty for none */
+	QRealtime::options_t realtime;
+} headless_options_t;
+
+/*
+ * Capture, replay and statistics without a display: the receive thread
+ * only runs the capture writer, the bus load and the error consumers.
+ */
+class QCanHeadless : public QObject
+{
+	Q_OBJECT
+
+public:
+	QCanHeadless(const headless_options_t &options, QObject *parent = 0);
+	~QCanHeadless();
+
+	bool start(QString &error);
+
+	/* SIGINT and SIGTERM request a clean shutdown */
+	static int installSignalHandlers(void);
+
+public slots:
+	void shutdown(void);
+
+private slots:
+	void poll(void);
+	void printStats(void);
+
+private:
+	void closeDevice(void);
+
+	headless_options_t m_options;
+	QCanSocket *m_sk;
+	QCanRecvThread *m_recvthr;
+	QCaptureWriter *m_writer;
+	QCaptureReplay *m_replay;
+	QBusLoadAnalyzer *m_load;
+	QErrorAnalyzer *m_errors;
+	QTimer *m_poll;
+	QTimer *m_stats;
+	QElapsedTimer m_clock;
+	qint64 m_last_msec;
+	quint64 m_last_frames;
+	bool m_done;
+	/* Kernel drops only, none of the consumers here queues frames */
+	QDropMonitor m_drops;
+	QMetricsExporter *m_exporter;
+	QMetrics::Counter *m_bus_state;
+	QMetrics::Counter *m_bus_transitions;
+	QMetrics::Counter *m_bus_load;
+	int m_last_state;
+	bool m_reported;
+};
+
+#endif
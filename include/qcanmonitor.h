@@ -28,8 +28,10 @@
 
 
 #include "qcanpacketconsumer.h"
+#include "qrcu.h"
 #include <QObject>
 #include <QString>
+#include <QRegExp>
 
 class QCanMonitor : public QCanPacketConsumer
 {
@@ -37,6 +39,7 @@ class QCanMonitor : public QCanPacketConsumer
 
 public:
 	explicit QCanMonitor(QObject *parent = 0);
+	/* Applied to the next frame, also while receiving */
 	void setFilterId(const QString &string);
 
 signals:
@@ -48,7 +51,15 @@ protected slots:
 	virtual bool filterCallback(can_packet_t *packet);
 
 private:
-	QString m_reg_pattern;
+	/* Compiled once per pattern, then only read by the receive thread */
+	typedef struct {
+		QRegExp regexp;
+		bool all;
+	} filter_t;
+
+	static filter_t *compile(const QString &pattern);
+
+	QRcu<filter_t> m_filter;
 };
 
 
@@ -23,6 +23,7 @@ class QCanPkgAbstractModel : public QAbstractTableModel
 			QString elapsed;
 			QString data;
 			QString direction;
+			QString decoded;
 		} can_str_packet_t;
 
 		typedef QList<can_str_packet_t> CanPkgBuffer;
@@ -30,12 +30,15 @@
 #include "qcansocket.h"
 #include "qcanbuffer.h"
 #include "qcanpacketconsumer.h"
+#include "qmetrics.h"
+#include "qrcu.h"
 
 #ifdef _linux
 #include <tr1/functional>
 #endif
 #include <QList>
 #include <QThread>
+#include <QAtomicInt>
 
 
 
@@ -48,9 +51,15 @@ public:
 	explicit QCanRecvThread(QCanSocket *sk, QObject *parent = 0);
 	~QCanRecvThread(void);
 
+	/*
+	 * From one thread at a time, also while receiving: the consumer
+	 * sees the frames from the next one on.  Once unlinked it sees no
+	 * more, those still queued to it are delivered first.
+	 */
 	void linkPacketConsumer(QCanPacketConsumer *pkt_consumer);
 	void unlinkPacketConsumer(QCanPacketConsumer *pkt_consumer);
 
+	/* Wakes the thread up and returns once it has exited */
 	void stop(void);
 	void restart(void);
 	virtual void run(void);
@@ -66,19 +75,38 @@ private:
 
 	class ConnectionFilter {
 	public:
-		ConnectionFilter(QCanPacketConsumer *consumer, QCanBuffer *buffer) {
+		ConnectionFilter(QCanPacketConsumer *consumer, QCanBuffer *buffer,
+		                 QMetrics::Counter *received) {
 			this->consumer = consumer;
 			this->buffer = buffer;
+			this->received = received;
 		}
 
 		QCanPacketConsumer *consumer;
 		QCanBuffer *buffer;
+		QMetrics::Counter *received;
 	};
 
-	QCanSocket *sk;
+	typedef QList<ConnectionFilter *> FilterList;
+
+	static QString consumerName(QCanPacketConsumer *consumer);
 
-	bool m_stop;
-	QList<ConnectionFilter *> m_filter_list;
+	QCanSocket *sk;
+	QMetrics::Counter *m_frames;
+	QMetrics::Counter *m_error_frames;
+	QMetrics::Counter *m_kernel_dropped;
+	quint32 m_last_dropped;
+	/* From the driver timestamp to the frame read */
+	QMetrics::Histogram *m_wakeup;
+	/* CPU time of the thread, sampled once per second of frames */
+	QMetrics::Counter *m_cpu;
+	int64_t m_cpu_sec;
+
+	QAtomicInt m_stop;
+	/* Set by stop(), for the recv it makes return without a frame */
+	QAtomicInt m_woken;
+	/* Read by the receive thread, replaced as a whole by the others */
+	QRcu<FilterList> m_filter_list;
 	QMap <QCanPacketConsumer *, QCanBuffer *> m_map_buffers;
 	QMap <QCanPacketConsumer *, ConnectionFilter *> m_map_filters;
 };
@@ -27,6 +27,7 @@
 #define QCANSOCKET_H
 
 #include "canbus/can_state.h"
+#include "qcanpacketconsumer.h"
 
 #include <QAbstractSocket>
 #include <QString>
@@ -55,9 +56,16 @@ public:
 
 	size_t send(unsigned id, uint8_t dlc, void *data);
 	size_t recv(unsigned *id, uint8_t *dlc, void *data, int64_t *sec, int64_t *usec);
+	/* Frames dropped before recv, -1 when the driver can't tell */
+	int rxDropped(quint32 *dropped);
+	/* Makes a recv blocked in another thread return 0, any thread */
+	int wakeup(void);
 
 	SocketState state() const;
 
+	/* Sees every frame sent, set only while nothing is being sent */
+	void setTxConsumer(QCanPacketConsumer *consumer);
+
 protected:
 	/* Check the current can bus state and performs a reset if needed */
 	int checkCurrentCanBusState(void);
@@ -72,6 +80,7 @@ private:
 	QSemaphore m_semaphore;
 	QString m_dev;
 	unsigned m_bitrate;
+	QCanPacketConsumer *m_tx_consumer;
 };
 
 #endif // QCANSOCKET_H
@@ -0,0 +1,79 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QCAPTUREREPLAY_H
+#define QCAPTUREREPLAY_H
+
+#include "qcansocket.h"
+#include "analysis/capture.h"
+#include "analysis/idfilter.h"
+
+#include <QThread>
+#include <QString>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+/* Sends the frames of a raw capture again, with their original spacing */
+class QCaptureReplay : public QThread
+{
+	Q_OBJECT
+
+public:
+	QCaptureReplay(QCanSocket *sk, QObject *parent = 0);
+	~QCaptureReplay();
+
+	bool open(const QString &fileName);
+
+	void setFilter(const idfilter_t &filter);
+	/* Time scale, 2.0 replays twice as fast, 0 as fast as the bus takes */
+	void setSpeed(double speed);
+	/* 0 loops until stopped */
+	void setLoops(unsigned loops);
+
+	void stop(void);
+
+	quint64 frames(void) const;
+	quint64 sent(void) const;
+	quint64 failed(void) const;
+
+	virtual void run(void);
+
+private:
+	void waitUntil(const QElapsedTimer &clock, qint64 nsec);
+
+	QCanSocket *m_sk;
+	capture_map_t m_map;
+	idfilter_t m_filter;
+	double m_speed;
+	unsigned m_loops;
+
+	QAtomicInt m_stop;
+	QAtomicInteger<quint64> m_sent;
+	QAtomicInteger<quint64> m_failed;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QCAPTUREWRITER_H
+#define QCAPTUREWRITER_H
+
+#include "qcanpacketconsumer.h"
+#include "analysis/capture.h"
+#include "analysis/idfilter.h"
+#include "qmetrics.h"
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+/* Batches of CAPTURE_BATCH frames queued between the two threads */
+#define CAPTURE_WRITER_BATCHES 4
+
+/*
+ * Streams the frames accepted by the filter to a raw capture and counts
+ * what it sees.  The receive thread only copies frames into batches, a
+ * writer thread takes the full ones and writes them, so the disk never
+ * stalls reception.  Without a file it only counts.
+ */
+class QCaptureWriter : public QCanPacketConsumer
+{
+	Q_OBJECT
+
+public:
+	QCaptureWriter(QObject *parent = 0);
+	~QCaptureWriter();
+
+	/* Set before the writer is linked to the receive thread */
+	void setFilter(const idfilter_t &filter);
+
+	bool open(const QString &fileName);
+	/*
+	 * Waits for the receive thread to leave the writer and for the
+	 * writer thread to write what is queued, then closes.
+	 */
+	bool close(void);
+	/* Buffered frames are queued for writing with the next frame received */
+	void requestFlush(void);
+
+	quint64 frames(void) const;
+	quint64 errors(void) const;
+	quint64 accepted(void) const;
+	quint64 written(void) const;
+	bool failed(void) const;
+
+protected slots:
+	virtual void canPacketRecv(can_packet_t packet);
+	virtual bool filterCallback(can_packet_t *packet);
+
+private:
+	typedef struct {
+		can_packet_t frames[CAPTURE_BATCH];
+		unsigned count;
+	} batch_t;
+
+	class Writer : public QThread
+	{
+	public:
+		Writer(QCaptureWriter *writer);
+		virtual void run(void);
+
+	private:
+		QCaptureWriter *m_writer;
+	};
+
+	/* Hands the batch being filled to the writer thread */
+	void queueBatch(void);
+
+	capture_writer_t *m_capture;
+	idfilter_t m_filter;
+
+	/* Filled by the receive thread, written in order by m_thread */
+	batch_t *m_batches;
+	unsigned m_fill;
+	unsigned m_take;
+	QSemaphore m_free;
+	QSemaphore m_pending;
+	Writer *m_thread;
+
+	QAtomicInt m_open;
+	QAtomicInt m_busy;
+	QAtomicInt m_flush_req;
+
+	/* Single writer, the receive thread */
+	QAtomicInteger<quint64> m_frames;
+	QAtomicInteger<quint64> m_errors;
+	QAtomicInteger<quint64> m_accepted;
+	QAtomicInteger<quint64> m_written;
+	/* Single writer, the writer thread */
+	QAtomicInteger<quint64> m_stored;
+	QAtomicInt m_failed;
+	/* Frames buffered and not yet written to the file */
+	QMetrics::Counter *m_backlog;
+	/* Frames handed to the OS for the current file */
+	QMetrics::Counter *m_flushed;
+	/* Times the receive thread waited for the writer thread */
+	QMetrics::Counter *m_stalls;
+};
+
+#endif
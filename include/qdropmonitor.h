@@ -0,0 +1,69 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QDROPMONITOR_H
+#define QDROPMONITOR_H
+
+#include "qmetrics.h"
+
+#include <QString>
+
+/* Delivery latency over an interval that points at a stalled consumer */
+#define DROP_LAG_USEC 100000
+
+/*
+ * Frames dropped by the kernel per interval, polled from the GUI or the
+ * statistics timer, with the p99 latency of a consumer over the same
+ * interval to tell drops caused by a stalled consumer.
+ */
+class QDropMonitor
+{
+public:
+	/*
+	 * consumer is the class name of the consumer whose latency is
+	 * watched, one that queues frames.  Without it only drops count.
+	 */
+	QDropMonitor(const QString &consumer = QString());
+
+	/* Frames dropped since the previous call */
+	quint64 poll(void);
+
+	quint64 total(void) const;
+	/* p99 delivery latency of the last interval in usec */
+	quint64 latency(void) const;
+	/* The last interval dropped frames while the consumer lagged */
+	bool lagging(void) const;
+
+private:
+	QMetrics::Counter *m_dropped;
+	QMetrics::Histogram *m_latency;
+	quint64 m_total;
+	quint64 m_interval;
+	quint64 m_p99;
+	quint64 m_buckets[METRICS_BUCKETS];
+};
+
+#endif
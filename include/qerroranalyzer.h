@@ -0,0 +1,67 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QERRORANALYZER_H
+#define QERRORANALYZER_H
+
+#include "qprotocoldecoder.h"
+#include "qmetrics.h"
+#include "analysis/errframe.h"
+
+/*
+ * Error frames by class, protocol violation and location, controller
+ * and transceiver status, with the error rate and the TEC/REC counters.
+ */
+class QErrorAnalyzer : public QProtocolDecoder
+{
+	Q_OBJECT
+
+public:
+	QErrorAnalyzer(QObject *parent = 0);
+
+	virtual QString title(void) const;
+	virtual QStringList header(void) const;
+
+protected slots:
+	virtual bool filterCallback(can_packet_t *packet);
+
+protected:
+	virtual void decode(const can_packet_t *packet);
+	virtual void save(void);
+	virtual void format(QList<QStringList> &rows, QString &summary);
+	virtual void clear(void);
+
+private:
+	errframe_stats_t m_stats;
+	/* Copy formatted by the GUI thread, see save() */
+	errframe_stats_t m_view;
+
+	QMetrics::Counter *m_classes[ERRFRAME_CLASSES];
+	QMetrics::Counter *m_tec;
+	QMetrics::Counter *m_rec;
+};
+
+#endif
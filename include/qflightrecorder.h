@@ -0,0 +1,127 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#ifndef QFLIGHTRECORDER_H
+#define QFLIGHTRECORDER_H
+
+#include "qcanpacketconsumer.h"
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+
+/*
+ * Keeps the last frames seen on the bus in a fixed size ring.  When
+ * triggered, the pre-trigger window is kept, the post-trigger window is
+ * captured and both are written to disk by a background thread while
+ * recording goes on in a second ring of the same size.  The window is
+ * closed by the first frame past it, or by the background thread when
+ * the bus goes quiet.
+ */
+class QFlightRecorder : public QCanPacketConsumer
+{
+	Q_OBJECT
+
+public:
+	QFlightRecorder(unsigned frames, unsigned pre_ms, unsigned post_ms,
+	    const QString &directory, QObject *parent = 0);
+	~QFlightRecorder();
+
+	/* Trigger on the receive of a Unix signal, Linux only */
+	static int installSignalTrigger(int signo);
+
+	quint64 missedTriggers(void) const;
+
+	/* Dump raw captures (.cap) instead of text logs */
+	void setRawFormat(bool enable);
+
+public slots:
+	/* Thread safe, may be called from any thread */
+	void trigger(void);
+
+signals:
+	void dumped(QString fileName, unsigned frames);
+
+protected slots:
+	virtual void canPacketRecv(can_packet_t packet);
+	virtual bool filterCallback(can_packet_t *packet);
+
+private:
+	typedef struct {
+		can_packet_t *ring;
+		quint64 head;
+		qint64 start_usec;
+		qint64 end_usec;
+	} snapshot_t;
+
+	class Writer : public QThread
+	{
+	public:
+		Writer(QFlightRecorder *recorder);
+		virtual void run(void);
+		void stop(void);
+
+	private:
+		QFlightRecorder *m_recorder;
+	};
+
+	enum {
+		WINDOW_NONE,
+		WINDOW_OPEN,
+		WINDOW_CLOSING          /* by the writer, the ring is not touched */
+	};
+
+	bool closeWindow(void);
+	void closeWindowLate(void);
+	void dump(void);
+	void dumpRaw(void);
+
+	unsigned m_frames;
+	qint64 m_pre_usec;
+	qint64 m_post_usec;
+	QString m_directory;
+	bool m_raw;
+
+	/* Receive thread state, the writer's while m_window is WINDOW_CLOSING */
+	can_packet_t *m_ring[2];
+	int m_active;
+	quint64 m_head;
+	qint64 m_trigger_usec;
+
+	QAtomicInt m_window;
+	QAtomicInt m_busy;
+	QAtomicInt m_trigger_req;
+	QAtomicInt m_writer_busy;
+	QAtomicInt m_missed;
+
+	snapshot_t m_snapshot;
+	QSemaphore m_pending;
+	Writer *m_writer;
+	bool m_stop;
+};
+
+#endif
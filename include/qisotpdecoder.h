@@ -0,0 +1,64 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QISOTPDECODER_H
+#define QISOTPDECODER_H
+
+#include "qprotocoldecoder.h"
+#include "protocols/isotp.h"
+#include "protocols/uds.h"
+
+/* ISO-TP reassembly on request/response ID pairs, shown as UDS services */
+class QIsoTpDecoder : public QProtocolDecoder
+{
+	Q_OBJECT
+
+public:
+	QIsoTpDecoder(QObject *parent = 0);
+	~QIsoTpDecoder();
+
+	/* Pairs as "request:response" hex IDs, e.g. "7E0:7E8 18DA10F1:18DAF110" */
+	void setChannels(const QString &channels);
+
+	virtual QString title(void) const;
+	virtual QStringList header(void) const;
+
+protected:
+	virtual void decode(const can_packet_t *packet);
+	virtual void save(void);
+	virtual void format(QList<QStringList> &rows, QString &summary);
+	virtual void clear(void);
+
+private:
+	isotp_engine_t *m_tp;
+	uds_tracker_t *m_uds;
+
+	/* Copies formatted by the GUI thread, see save() */
+	isotp_engine_t *m_view_tp;
+	uds_tracker_t *m_view_uds;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QISOTPSENDER_H
+#define QISOTPSENDER_H
+
+#include "qcanpacketconsumer.h"
+#include "qcansocket.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+/*
+ * Segments PDUs into ISO-TP frames and writes them straight to the socket
+ * from its own thread.  Flow control frames are picked up on the receive
+ * thread, consecutive frames are paced by BS and STmin with microsecond
+ * resolution.
+ */
+class QIsoTpSender : public QCanPacketConsumer
+{
+	Q_OBJECT
+
+public:
+	QIsoTpSender(QCanSocket *sk, QObject *parent = 0);
+	~QIsoTpSender();
+
+	/* Thread safe, PDUs are sent in order */
+	void transmit(quint32 tx_id, quint32 rx_id, const QByteArray &data);
+
+signals:
+	void sent(int bytes, qint64 usec);
+	void failed(QString reason);
+
+protected slots:
+	virtual void canPacketRecv(can_packet_t packet);
+	virtual bool filterCallback(can_packet_t *packet);
+
+private:
+	typedef struct {
+		quint32 tx_id;
+		quint32 rx_id;
+		QByteArray data;
+	} job_t;
+
+	class Worker : public QThread
+	{
+	public:
+		Worker(QIsoTpSender *sender);
+		virtual void run(void);
+		void stop(void);
+
+	private:
+		QIsoTpSender *m_sender;
+	};
+
+	bool sendFrame(quint32 id, const quint8 *data, int len);
+	bool waitFlowControl(quint8 *bs, quint8 *stmin);
+	void waitUntil(const QElapsedTimer &clock, qint64 nsec);
+	void send(const job_t &job);
+
+	QCanSocket *m_sk;
+
+	QMutex m_queue_lock;
+	QList<job_t> m_queue;
+	QSemaphore m_pending;
+	bool m_stop;
+
+	/* Flow control handed over by the receive thread */
+	QAtomicInt m_listen;
+	quint32 m_rx_id;
+	QMutex m_fc_lock;
+	quint8 m_fc[3];
+	QSemaphore m_fc_ready;
+
+	Worker *m_worker;
+};
+
+#endif
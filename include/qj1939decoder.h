@@ -0,0 +1,57 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QJ1939DECODER_H
+#define QJ1939DECODER_H
+
+#include "qprotocoldecoder.h"
+#include "protocols/j1939.h"
+
+/* PGN statistics, transport sessions and address claims */
+class QJ1939Decoder : public QProtocolDecoder
+{
+	Q_OBJECT
+
+public:
+	QJ1939Decoder(QObject *parent = 0);
+	~QJ1939Decoder();
+
+	virtual QString title(void) const;
+	virtual QStringList header(void) const;
+
+protected:
+	virtual void decode(const can_packet_t *packet);
+	virtual void save(void);
+	virtual void format(QList<QStringList> &rows, QString &summary);
+	virtual void clear(void);
+
+private:
+	j1939_engine_t *m_j1939;
+	/* Copy formatted by the GUI thread, see save() */
+	j1939_engine_t *m_view;
+};
+
+#endif
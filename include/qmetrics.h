@@ -0,0 +1,147 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QMETRICS_H
+#define QMETRICS_H
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QMutex>
+#include <QAtomicInteger>
+
+/* Log2 buckets of usec: 0, 1, 2-3, 4-7 ... the last one is open ended */
+#define METRICS_BUCKETS 32
+
+#define METRIC_COUNTER   0      /* only grows */
+#define METRIC_LEVEL     1      /* goes up and down */
+#define METRIC_HISTOGRAM 2
+
+/*
+ * Registry of the pipeline counters and histograms.  Each one is written
+ * by a single thread, so recording is a plain load and store, and read
+ * from any thread.  They are created while setting up, looked up by name,
+ * and live as long as the process: hot paths keep the pointer.
+ */
+class QMetrics
+{
+public:
+	class Counter
+	{
+	public:
+		Counter() : m_value(0) {
+		}
+
+		inline void add(quint64 n = 1) {
+			m_value.store(m_value.load() + n);
+		}
+
+		/* Levels, and counts kept elsewhere, are set instead */
+		inline void set(quint64 value) {
+			m_value.store(value);
+		}
+
+		quint64 value(void) const {
+			return m_value.load();
+		}
+
+	private:
+		QAtomicInteger<quint64> m_value;
+	};
+
+	class Histogram
+	{
+	public:
+		Histogram();
+
+		inline void record(quint64 usec) {
+			int b = (usec != 0) ? 64 - __builtin_clzll(usec) : 0;
+
+			if (b >= METRICS_BUCKETS)
+				b = METRICS_BUCKETS - 1;
+			m_buckets[b].store(m_buckets[b].load() + 1);
+			m_count.store(m_count.load() + 1);
+			m_sum.store(m_sum.load() + usec);
+			if (usec > m_max.load())
+				m_max.store(usec);
+		}
+
+		quint64 count(void) const;
+		quint64 sum(void) const;
+		quint64 max(void) const;
+		quint64 bucket(int b) const;
+		/* Upper bound of the bucket holding the p-th percentile */
+		quint64 percentile(double p) const;
+
+		/* Bucket counts, differences of two give an interval */
+		void buckets(quint64 n[METRICS_BUCKETS]) const;
+		static quint64 percentile(const quint64 n[METRICS_BUCKETS], double p);
+
+	private:
+		QAtomicInteger<quint64> m_buckets[METRICS_BUCKETS];
+		QAtomicInteger<quint64> m_count;
+		QAtomicInteger<quint64> m_sum;
+		QAtomicInteger<quint64> m_max;
+	};
+
+	typedef struct {
+		QString name;
+		int kind;               /* METRIC_* */
+		qint64 value;           /* samples of histograms */
+		/* Histograms only, in usec */
+		quint64 p50;
+		quint64 p99;
+		quint64 max;
+		quint64 sum;
+		quint64 buckets[METRICS_BUCKETS];
+	} sample_t;
+
+	static QMetrics *instance(void);
+
+	/* The same object for the same name */
+	Counter *counter(const QString &name);
+	Counter *level(const QString &name);
+	Histogram *histogram(const QString &name);
+	/* Level reported as in - out, the depth of a queue between two threads */
+	void addGauge(const QString &name, const Counter *in, const Counter *out);
+
+	/* Every metric sorted by name */
+	void snapshot(QList<sample_t> &samples) const;
+	QString toJson(void) const;
+
+private:
+	QMetrics();
+	~QMetrics();
+
+	mutable QMutex m_lock;
+	QMap<QString, Counter *> m_counters;
+	QMap<QString, Counter *> m_levels;
+	QMap<QString, Histogram *> m_histograms;
+	QMap<QString, QPair<const Counter *, const Counter *> > m_gauges;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QMETRICSEXPORTER_H
+#define QMETRICSEXPORTER_H
+
+#include <QObject>
+#include <QString>
+
+class QTcpServer;
+class QLocalServer;
+class QIODevice;
+
+/*
+ * Serves the metrics registry as a Prometheus text page on GET /metrics,
+ * over TCP or a Unix socket.  Runs in the thread of the event loop and
+ * only loads the counters, the receive thread never waits for a scrape.
+ */
+class QMetricsExporter : public QObject
+{
+	Q_OBJECT
+
+public:
+	/* bus labels every sample, the interface or device captured */
+	QMetricsExporter(const QString &bus, QObject *parent = 0);
+
+	/* "[host:]port", localhost by default, or "unix:path" */
+	bool listen(const QString &address, QString &error);
+
+	static QString format(const QString &bus);
+
+private slots:
+	void acceptTcp(void);
+	void acceptLocal(void);
+	void readRequest(void);
+
+private:
+	void accept(QIODevice *socket);
+
+	QString m_bus;
+	QTcpServer *m_tcp;
+	QLocalServer *m_local;
+};
+
+#endif
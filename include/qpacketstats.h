@@ -0,0 +1,66 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QPACKETSTATS_H
+#define QPACKETSTATS_H
+
+#include "canbus/can_packet.h"
+
+#include <QMap>
+#include <QString>
+#include <stdint.h>
+
+/* Per ID counters of the statistics table, without the widgets */
+class QPacketStats
+{
+public:
+	typedef struct {
+		int64_t lastSec;
+		int64_t lastUSec;
+		quint64 row;
+		quint64 count;
+		quint8 data[8];
+	} statistic_t;
+
+	QPacketStats();
+	~QPacketStats();
+
+	/*
+	 * Counts packet for its ID.  data gets the payload in rich text, the
+	 * bytes changed since the previous frame in red, interval the time
+	 * since that frame in ms.  created is set for an ID seen the first time.
+	 */
+	statistic_t *update(const can_packet_t &packet, QString &data, QString &interval,
+	                    bool *created);
+
+	int size(void) const;
+	void clear(void);
+
+private:
+	QMap<unsigned, statistic_t *> m_stats;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QPROTOCOLDECODER_H
+#define QPROTOCOLDECODER_H
+
+#include "qcanpacketconsumer.h"
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+/*
+ * Base of the protocol decoders run on the receive thread.  Frames are
+ * decoded in filterCallback, nothing is queued to the GUI: views poll the
+ * decoder state with snapshot(), which only holds the lock to copy it out,
+ * the rows are formatted from the copy so the receive thread never waits
+ * on the GUI.
+ */
+class QProtocolDecoder : public QCanPacketConsumer
+{
+	Q_OBJECT
+
+public:
+	QProtocolDecoder(QObject *parent = 0) :
+	    QCanPacketConsumer(parent) {
+	};
+
+	virtual QString title(void) const = 0;
+	virtual QStringList header(void) const = 0;
+
+	/* Snapshot of the decoder state, called from the GUI thread */
+	void snapshot(QList<QStringList> &rows, QString &summary) {
+		m_lock.lock();
+		save();
+		m_lock.unlock();
+		rows.clear();
+		summary.clear();
+		format(rows, summary);
+	};
+
+	void reset(void) {
+		QMutexLocker locker(&m_lock);
+		clear();
+	};
+
+protected slots:
+	virtual void canPacketRecv(can_packet_t) {
+	};
+
+	virtual bool filterCallback(can_packet_t *packet) {
+		QMutexLocker locker(&m_lock);
+		decode(packet);
+		return false;
+	};
+
+protected:
+	/* Called with the lock held, save() copies what format() reads */
+	virtual void decode(const can_packet_t *packet) = 0;
+	virtual void save(void) = 0;
+	virtual void clear(void) = 0;
+
+	/* Called from the GUI thread without the lock, on the saved copy */
+	virtual void format(QList<QStringList> &rows, QString &summary) = 0;
+
+	QMutex m_lock;
+};
+
+#endif
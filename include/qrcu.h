@@ -0,0 +1,92 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QRCU_H
+#define QRCU_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QThread>
+
+/*
+ * Read-copy-update of a value read by a single thread, the receive thread
+ * in practice.  The reader takes the current snapshot without locks and
+ * never waits.  A writer publishes a new snapshot and frees the old one
+ * once the reader has left the section it may have read it in: a grace
+ * period of at most one frame dispatch.  Writers are serialized by the
+ * caller, the GUI thread.
+ */
+template <typename T>
+class QRcu
+{
+public:
+	explicit QRcu(T *value) : m_value(value), m_epoch(0) {
+	}
+
+	~QRcu() {
+		delete m_value.loadAcquire();
+	}
+
+	/* Reader: the snapshot stays valid until readUnlock() */
+	inline const T *readLock(void) {
+		/* Odd while reading, ordered before the load of the snapshot */
+		m_epoch.fetchAndAddOrdered(1);
+		return m_value.loadAcquire();
+	}
+
+	inline void readUnlock(void) {
+		m_epoch.fetchAndAddRelease(1);
+	}
+
+	/* Writer: the current snapshot, to copy and modify */
+	const T *value(void) const {
+		return m_value.loadAcquire();
+	}
+
+	/* Writer: takes value over and frees the snapshot it replaces */
+	void publish(T *value) {
+		T *old = m_value.fetchAndStoreOrdered(value);
+
+		synchronize();
+		delete old;
+	}
+
+	/* Returns once the reader has left a section begun before the call */
+	void synchronize(void) {
+		int epoch = m_epoch.loadAcquire();
+
+		if (!(epoch & 1))
+			return;
+		while (m_epoch.loadAcquire() == epoch)
+			QThread::yieldCurrentThread();
+	}
+
+private:
+	QAtomicPointer<T> m_value;
+	QAtomicInt m_epoch;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QREALTIME_H
+#define QREALTIME_H
+
+#include <QString>
+#include <QStringList>
+
+/*
+ * Real-time settings of the capture threads: scheduling policy of the
+ * receive and transmit threads, CPU of each thread and memory locking.
+ * Set once at startup, each thread applies its part when it starts and
+ * the outcome of every setting is kept for the diagnostics.
+ */
+class QRealtime
+{
+public:
+	enum Thread {
+		Receive,
+		Transmit,       /* replay and ISO-TP senders */
+		Writer          /* capture and flight recorder writes, never real-time */
+	};
+
+	typedef struct {
+		int policy;     /* RT_POLICY_*, transmit runs one priority below */
+		int priority;
+		int cpu[3];     /* by Thread, -1 for any CPU */
+		bool lock_memory;
+	} options_t;
+
+	/* "fifo:80", "rr:50" or "other" into policy and priority */
+	static bool parsePolicy(const QString &spec, options_t &options);
+	/* "recv[,transmit[,writer]]" CPUs, empty fields for any */
+	static bool parseCpus(const QString &spec, options_t &options);
+
+	/* From the main thread before any capture thread starts */
+	static void configure(const options_t &options);
+	/* Called by each thread at the start of run() */
+	static void enter(Thread thread);
+
+	/* One line per setting asked, applied or not and why */
+	static QStringList report(void);
+};
+
+#endif
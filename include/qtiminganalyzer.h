@@ -0,0 +1,65 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#ifndef QTIMINGANALYZER_H
+#define QTIMINGANALYZER_H
+
+#include "qprotocoldecoder.h"
+#include "analysis/timing.h"
+
+#include <QVector>
+
+/* Inter-arrival statistics, percentiles and missed deadlines per ID */
+class QTimingAnalyzer : public QProtocolDecoder
+{
+	Q_OBJECT
+
+public:
+	QTimingAnalyzer(unsigned tolerance, QObject *parent = 0);
+	~QTimingAnalyzer();
+
+	/* Periods as "ID:ms" pairs, e.g. "100:10 18FEF100:100" */
+	void setExpected(const QString &periods);
+
+	virtual QString title(void) const;
+	virtual QStringList header(void) const;
+
+protected:
+	virtual void decode(const can_packet_t *packet);
+	virtual void save(void);
+	virtual void format(QList<QStringList> &rows, QString &summary);
+	virtual void clear(void);
+
+private:
+	timing_engine_t *m_timing;
+
+	/* IDs in use and counters, formatted by the GUI thread */
+	QVector<timing_id_t> m_view;
+	quint32 m_view_overflow;
+	quint32 m_view_tolerance;
+};
+
+#endif
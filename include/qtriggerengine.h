@@ -0,0 +1,140 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#ifndef QTRIGGERENGINE_H
+#define QTRIGGERENGINE_H
+
+#include "qcanpacketconsumer.h"
+
+#include <QObject>
+#include <QString>
+#include <QAtomicInt>
+
+/* Level conditions, same order as the trigger dialog */
+#define TRIGGER_LEVEL_A      0
+#define TRIGGER_LEVEL_B      1
+#define TRIGGER_LEVEL_A_AND_B 2
+#define TRIGGER_LEVEL_A_OR_B  3
+
+/* ID and value conditions, same order as the trigger dialog */
+#define TRIGGER_COND_EQUAL     0
+#define TRIGGER_COND_NOT_EQUAL 1
+#define TRIGGER_COND_GREATER   2
+#define TRIGGER_COND_LESS      3
+#define TRIGGER_COND_IN_RANGE  4
+#define TRIGGER_COND_OUT_RANGE 5
+
+/* Actions, same order as the trigger dialog */
+#define TRIGGER_ACTION_MESSAGE     0
+#define TRIGGER_ACTION_LOG_ENABLE  1
+#define TRIGGER_ACTION_LOG_DISABLE 2
+#define TRIGGER_ACTION_SOUND       3
+#define TRIGGER_ACTION_COMMAND     4
+#define TRIGGER_ACTION_STOP        5
+#define TRIGGER_ACTION_SAVE        6
+#define TRIGGER_ACTION_MARK        7
+
+typedef struct {
+	bool check_id;
+	int id_condition;
+	quint32 id_start;
+	quint32 id_end;
+	bool check_value;
+	quint8 data_mask;       /* bit n selects data byte Dn */
+	int value_condition;
+	quint32 value_start;
+	quint32 value_end;
+	int count_limit;
+} trigger_level_t;
+
+typedef struct {
+	int level_condition;
+	trigger_level_t a;
+	trigger_level_t b;
+	int action;
+} trigger_config_t;
+
+class QTriggerEngine : public QCanPacketConsumer
+{
+	Q_OBJECT
+
+public:
+	explicit QTriggerEngine(QObject *parent = 0);
+
+	/* Compiles config and starts matching, may be called at any time */
+	void arm(const trigger_config_t &config);
+	void disarm(void);
+	bool isArmed(void) const;
+
+signals:
+	/* Emitted from the receive thread, connect with Qt::QueuedConnection */
+	void triggered(int action, can_packet_t packet);
+
+protected slots:
+	virtual void canPacketRecv(can_packet_t packet);
+	virtual bool filterCallback(can_packet_t *packet);
+
+private:
+	enum {
+		OPERAND_ID,
+		OPERAND_VALUE
+	};
+
+	/*
+	 * Every condition is reduced to "operand in [lo, hi]", optionally
+	 * negated, so evaluation is a single unsigned compare.
+	 */
+	typedef struct {
+		quint8 operand;
+		quint8 negate;
+		quint8 nbytes;
+		quint8 min_dlc;
+		quint8 bytes[8];
+		quint64 lo;
+		quint64 span;   /* hi - lo */
+	} insn_t;
+
+	typedef struct {
+		insn_t insn[2];
+		int ninsn;
+		int count_limit;
+		int count;
+	} level_t;
+
+	static void compileLevel(const trigger_level_t &src, level_t *dst);
+	static bool compileCondition(int condition, quint64 start, quint64 end,
+	    quint64 max, insn_t *insn);
+	static bool matchLevel(const level_t *level, const can_packet_t *packet);
+
+	level_t m_level[2];
+	bool m_use[2];
+	bool m_need_both;
+	int m_action;
+
+	QAtomicInt m_armed;
+	QAtomicInt m_busy;
+};
+
+#endif
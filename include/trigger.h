@@ -27,6 +27,7 @@
 #define TRIGGERDIALOG_H
 
 #include "ui_triggerdialog.h"
+#include "qtriggerengine.h"
 
 #include <QObject>
 #include <QWidget>
@@ -70,6 +71,9 @@ class QTriggerDialog : public QDialog
 public:
 	explicit QTriggerDialog(QWidget *parent= 0);
 	~QTriggerDialog() {}
+	/* Shows the trigger armed last */
+	void setConfig(const trigger_config_t &config, bool delay, int delay_ms,
+	               const QString &cmd);
 	int levelCondition(void) const;
 	int action() const;
 	bool actionDelay(void) const;
@@ -146,6 +150,11 @@ private:
 	void initActionsConnections(void);
 	void setLevelACheckData(bool, int);
 	void setLevelBCheckData(bool, int);
+	static void loadLevel(const trigger_level_t &level, QSpinBox *times,
+	                      QCheckBox *value_enable, QCheckBox *const data[8],
+	                      QComboBox *value_cond, QLineEdit *value_start,
+	                      QLineEdit *value_end, QCheckBox *id_enable,
+	                      QComboBox *id_cond, QLineEdit *id_start, QLineEdit *id_end);
 
 	Ui::triggerdialog *ui;
 
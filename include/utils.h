@@ -33,9 +33,22 @@ int get_timestamp(int64_t *, int64_t *);
 can_ops_t *get_can_ops(const char *);
 uint64_t htonll(uint64_t value);
 
+/* Scheduling policies of set_thread_scheduler() */
+#define RT_POLICY_OTHER 0
+#define RT_POLICY_FIFO  1
+#define RT_POLICY_RR    2
+
+/* All act on the calling thread, -1 with errno set on failure */
+int set_thread_scheduler(int policy, int priority);
+int set_thread_cpu(int cpu);
+/* Locks the pages of the process, current and future, in memory */
+int lock_memory(void);
+/* CPU time used by the calling thread */
+int get_thread_cputime(int64_t *usec);
+
 #ifdef _WIN32
 void usleep(__int64 usec);
-char *
+char *
 strsep(char **stringp, const char *delim);
 #endif
 
@@ -0,0 +1,374 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/busload.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+
+/* CRC delimiter, ACK slot and delimiter, EOF, intermission */
+#define TRAILER_BITS    13
+
+#define CRC15_POLY      0x4599
+
+/*
+ * Stuffing state: last bit * 5 + run length - 1.  stuff_table gives, for a
+ * state and the next byte sent MSB first, the stuff bits inserted (low
+ * nibble) and the state after it (high nibble).
+ */
+static uint8_t stuff_table[10][256];
+static uint16_t crc15_table[256];
+static int tables_ready;
+
+static int
+stuff_step(int *state, int bit)
+{
+	int last = *state / 5, run = *state % 5 + 1;
+
+	if (bit == last) {
+		run++;
+	} else {
+		last = bit;
+		run = 1;
+	}
+	if (run < 5) {
+		*state = last * 5 + run - 1;
+		return 0;
+	}
+	/* The complement goes in and starts the next run */
+	*state = (!last) * 5;
+	return 1;
+}
+
+static void
+init_tables(void)
+{
+	for (int s = 0; s < 10; s++) {
+		for (int v = 0; v < 256; v++) {
+			int state = s, n = 0;
+
+			for (int i = 7; i >= 0; i--)
+				n += stuff_step(&state, (v >> i) & 1);
+			stuff_table[s][v] = (state << 4) | n;
+		}
+	}
+
+	for (int v = 0; v < 256; v++) {
+		uint16_t c = v << 7;
+
+		for (int i = 0; i < 8; i++)
+			c = (c & 0x4000) ? ((c << 1) ^ CRC15_POLY) : (c << 1);
+		crc15_table[v] = c & 0x7FFF;
+	}
+	tables_ready = 1;
+}
+
+typedef struct {
+	uint8_t buf[24];
+	unsigned len;
+} bits_t;
+
+static void
+put_bits(bits_t *w, uint32_t value, unsigned n)
+{
+	while (n-- > 0) {
+		if ((value >> n) & 1)
+			w->buf[w->len / 8] |= 0x80 >> (w->len % 8);
+		w->len++;
+	}
+}
+
+static uint16_t
+crc15(const bits_t *w)
+{
+	unsigned bytes = w->len / 8;
+	uint16_t crc = 0;
+
+	for (unsigned i = 0; i < bytes; i++)
+		crc = ((crc << 8) ^ crc15_table[((crc >> 7) ^ w->buf[i]) & 0xFF]) & 0x7FFF;
+	for (unsigned i = bytes * 8; i < w->len; i++) {
+		int bit = (w->buf[i / 8] >> (7 - i % 8)) & 1;
+
+		crc = (((crc >> 14) & 1) ^ bit) ? ((crc << 1) ^ CRC15_POLY) : (crc << 1);
+		crc &= 0x7FFF;
+	}
+
+	return crc;
+}
+
+static uint32_t
+count_stuff(const bits_t *w)
+{
+	unsigned bytes = w->len / 8;
+	int state = 5;          /* recessive idle before SOF */
+	uint32_t n = 0;
+
+	for (unsigned i = 0; i < bytes; i++) {
+		uint8_t e = stuff_table[state][w->buf[i]];
+
+		n += e & 0x0F;
+		state = e >> 4;
+	}
+	for (unsigned i = bytes * 8; i < w->len; i++)
+		n += stuff_step(&state, (w->buf[i / 8] >> (7 - i % 8)) & 1);
+
+	return n;
+}
+
+uint32_t
+busload_frame_bits(uint32_t id, uint8_t dlc, const uint8_t *data,
+    int stuffing, uint32_t *stuff)
+{
+	unsigned n = (id & RTR_FLAG) ? 0 : ((dlc > 8) ? 8 : dlc);
+	unsigned stuffed;
+	uint32_t s = 0;
+	bits_t w;
+
+	/* SOF to the end of CRC is stuffed */
+	stuffed = ((id & EFF_FLAG) ? 54 : 34) + 8 * n;
+
+	if (stuffing == BUSLOAD_STUFF_WORST) {
+		s = (stuffed - 1) / 4;
+	} else if (stuffing == BUSLOAD_STUFF_ACTUAL) {
+		if (!tables_ready)
+			init_tables();
+		memset(&w, 0, sizeof(w));
+		put_bits(&w, 0, 1);
+		if (id & EFF_FLAG) {
+			put_bits(&w, (id >> 18) & 0x7FF, 11);
+			put_bits(&w, 3, 2);             /* SRR, IDE */
+			put_bits(&w, id & 0x3FFFF, 18);
+			put_bits(&w, (id & RTR_FLAG) ? 1 : 0, 1);
+			put_bits(&w, 0, 2);             /* r1, r0 */
+		} else {
+			put_bits(&w, id & 0x7FF, 11);
+			put_bits(&w, (id & RTR_FLAG) ? 1 : 0, 1);
+			put_bits(&w, 0, 2);             /* IDE, r0 */
+		}
+		put_bits(&w, (dlc > 15) ? 15 : dlc, 4);
+		for (unsigned i = 0; i < n; i++)
+			put_bits(&w, data[i], 8);
+		put_bits(&w, crc15(&w), 15);
+		s = count_stuff(&w);
+	}
+
+	if (stuff != NULL)
+		*stuff = s;
+
+	return stuffed + s + TRAILER_BITS;
+}
+
+void
+busload_init(busload_engine_t *b, uint32_t bitrate, int stuffing)
+{
+	if (!tables_ready)
+		init_tables();
+
+	b->bitrate = bitrate;
+	b->stuffing = stuffing;
+	b->nids = 0;
+	memset(b->std_index, 0, sizeof(b->std_index));
+	memset(b->ext_keys, 0, sizeof(b->ext_keys));
+	memset(b->ext_index, 0, sizeof(b->ext_index));
+	busload_reset(b);
+}
+
+void
+busload_reset(busload_engine_t *b)
+{
+	for (uint32_t i = 0; i < b->nids; i++) {
+		b->ids[i].frames = 0;
+		b->ids[i].tx_frames = 0;
+		b->ids[i].bits = 0;
+		b->ids[i].window_bits = 0;
+		b->ids[i].last_window_bits = 0;
+	}
+	b->overflow = 0;
+
+	memset(b->slot_bits, 0, sizeof(b->slot_bits));
+	b->slot = 0;
+	b->cur_bits = 0;
+	b->sum_100ms = 0;
+	b->sum_1s = 0;
+	b->second_start = 0;
+	b->load_10ms = 0;
+	b->load_100ms = 0;
+	b->load_1s = 0;
+	b->peak_10ms = 0;
+	b->peak_100ms = 0;
+	b->peak_1s = 0;
+
+	b->frames = 0;
+	b->tx_frames = 0;
+	b->error_frames = 0;
+	b->bits = 0;
+	b->tx_bits = 0;
+	b->stuff_bits = 0;
+}
+
+static busload_id_t *
+lookup(busload_engine_t *b, uint32_t id)
+{
+	uint16_t *index;
+	busload_id_t *s;
+	uint32_t h;
+
+	if (!(id & EFF_FLAG)) {
+		index = &b->std_index[id & 0x7FF];
+	} else {
+		h = (id * 2654435761U) & (BUSLOAD_EXT_SLOTS - 1);
+		while (b->ext_keys[h] != 0 && b->ext_keys[h] != id)
+			h = (h + 1) & (BUSLOAD_EXT_SLOTS - 1);
+		index = &b->ext_index[h];
+		/* BUSLOAD_IDS is half the table, probing always ends */
+		if (b->ext_keys[h] == 0 && b->nids < BUSLOAD_IDS)
+			b->ext_keys[h] = id;
+	}
+
+	if (*index != 0)
+		return &b->ids[*index - 1];
+	if (b->nids >= BUSLOAD_IDS) {
+		b->overflow++;
+		return NULL;
+	}
+
+	s = &b->ids[b->nids++];
+	*index = b->nids;
+	memset(s, 0, sizeof(*s));
+	s->id = id;
+
+	return s;
+}
+
+static uint32_t
+load(uint64_t bits, uint64_t capacity)
+{
+	return (capacity != 0) ? (uint32_t) (bits * 10000 / capacity) : 0;
+}
+
+/* Closes the slot being filled and the empty ones up to slot */
+static void
+advance(busload_engine_t *b, int64_t slot)
+{
+	uint64_t cap = (uint64_t) b->bitrate * BUSLOAD_SLOT_USEC / USEC_PER_SEC;
+
+	while (b->slot < slot) {
+		int i = b->slot % BUSLOAD_SLOTS;
+		int old = (b->slot - BUSLOAD_SLOTS_100MS) % BUSLOAD_SLOTS;
+
+		if (old < 0)
+			old += BUSLOAD_SLOTS;
+		b->sum_100ms += b->cur_bits;
+		b->sum_100ms -= b->slot_bits[old];
+		b->sum_1s += b->cur_bits;
+		b->sum_1s -= b->slot_bits[i];
+		b->slot_bits[i] = b->cur_bits;
+
+		b->load_10ms = load(b->cur_bits, cap);
+		b->load_100ms = load(b->sum_100ms, cap * BUSLOAD_SLOTS_100MS);
+		b->load_1s = load(b->sum_1s, cap * BUSLOAD_SLOTS);
+		if (b->load_10ms > b->peak_10ms)
+			b->peak_10ms = b->load_10ms;
+		if (b->load_100ms > b->peak_100ms)
+			b->peak_100ms = b->load_100ms;
+		if (b->load_1s > b->peak_1s)
+			b->peak_1s = b->load_1s;
+
+		b->cur_bits = 0;
+		b->slot++;
+
+		/* After a long silence every slot of the ring is empty */
+		if (slot - b->slot > BUSLOAD_SLOTS) {
+			memset(b->slot_bits, 0, sizeof(b->slot_bits));
+			b->sum_100ms = 0;
+			b->sum_1s = 0;
+			b->load_10ms = 0;
+			b->load_100ms = 0;
+			b->load_1s = 0;
+			b->slot = slot;
+		}
+	}
+}
+
+static void
+roll_ids(busload_engine_t *b, int64_t t)
+{
+	if (b->second_start == 0 || t < b->second_start) {
+		b->second_start = t;
+		return;
+	}
+	if (t - b->second_start < USEC_PER_SEC)
+		return;
+
+	for (uint32_t i = 0; i < b->nids; i++) {
+		b->ids[i].last_window_bits = b->ids[i].window_bits;
+		b->ids[i].window_bits = 0;
+	}
+	b->second_start = t;
+}
+
+void
+busload_update(busload_engine_t *b, const can_packet_t *packet)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	int64_t slot = t / BUSLOAD_SLOT_USEC;
+	uint32_t bits, stuff = 0;
+	busload_id_t *s = NULL;
+
+	if (b->slot == 0 || slot < b->slot)
+		b->slot = slot;
+	else if (slot > b->slot)
+		advance(b, slot);
+	roll_ids(b, t);
+
+	if (packet->id & ERR_FLAG) {
+		bits = BUSLOAD_ERROR_BITS;
+		b->error_frames++;
+	} else {
+		bits = busload_frame_bits(packet->id, packet->dlc, packet->data,
+		    b->stuffing, &stuff);
+		s = lookup(b, packet->id & (EFF_FLAG | EFF_MASK));
+	}
+
+	b->cur_bits += bits;
+	b->frames++;
+	b->bits += bits;
+	b->stuff_bits += stuff;
+	if (packet->direction == DIRECTION_TX) {
+		b->tx_frames++;
+		b->tx_bits += bits;
+	}
+
+	if (s == NULL)
+		return;
+	s->frames++;
+	s->bits += bits;
+	s->window_bits += bits;
+	if (packet->direction == DIRECTION_TX)
+		s->tx_frames++;
+}
@@ -0,0 +1,238 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/capture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int
+write_header(FILE *fp, uint64_t count)
+{
+	capture_header_t hdr;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	hdr.version = CAPTURE_VERSION;
+	hdr.frame_size = sizeof(can_packet_t);
+	hdr.count = count;
+
+	return (fwrite(&hdr, sizeof(hdr), 1, fp) == 1) ? 0 : -1;
+}
+
+int
+capture_write(const char *path, const can_packet_t *frames, uint64_t count)
+{
+	FILE *fp;
+
+	fp = fopen(path, "wb");
+	if (fp == NULL)
+		return -1;
+
+	if (write_header(fp, count) < 0 ||
+	    (count != 0 && fwrite(frames, sizeof(can_packet_t), count, fp) != count)) {
+		fclose(fp);
+		return -1;
+	}
+
+	return fclose(fp);
+}
+
+int
+capture_open(capture_writer_t *w, const char *path)
+{
+	w->count = 0;
+	w->nbuf = 0;
+	w->error = 0;
+	w->fp = fopen(path, "wb");
+	if (w->fp == NULL)
+		return -1;
+
+	if (write_header(w->fp, 0) < 0) {
+		fclose(w->fp);
+		w->fp = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+capture_append_frames(capture_writer_t *w, const can_packet_t *frames, uint32_t n)
+{
+	if (n == 0 || w->error)
+		return w->error ? -1 : 0;
+
+	if (fwrite(frames, sizeof(can_packet_t), n, w->fp) != n || fflush(w->fp) != 0) {
+		/* Disk full or gone, later frames are dropped */
+		w->error = 1;
+		return -1;
+	}
+	w->count += n;
+
+	return 0;
+}
+
+int
+capture_flush(capture_writer_t *w)
+{
+	uint32_t n = w->nbuf;
+
+	w->nbuf = 0;
+	return capture_append_frames(w, w->buf, n);
+}
+
+int
+capture_close(capture_writer_t *w)
+{
+	int r;
+
+	if (w->fp == NULL)
+		return -1;
+
+	r = capture_flush(w);
+	if (r == 0 && fseek(w->fp, 0, SEEK_SET) == 0)
+		r = write_header(w->fp, w->count);
+	else
+		r = -1;
+	if (fclose(w->fp) != 0)
+		r = -1;
+	w->fp = NULL;
+
+	return r;
+}
+
+static int
+check_header(const void *base, size_t length, uint64_t *count)
+{
+	const capture_header_t *hdr = (const capture_header_t *) base;
+	uint64_t n;
+
+	if (length < sizeof(*hdr) ||
+	    memcmp(hdr->magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 ||
+	    hdr->version != CAPTURE_VERSION ||
+	    hdr->frame_size != sizeof(can_packet_t))
+		return -1;
+
+	/* Trust the file size over the header for captures cut short */
+	n = (length - sizeof(*hdr)) / sizeof(can_packet_t);
+	*count = (hdr->count != 0 && hdr->count < n) ? hdr->count : n;
+
+	return 0;
+}
+
+#ifdef __linux
+int
+capture_map(const char *path, capture_map_t *map)
+{
+	struct stat st;
+	void *base;
+	int fd;
+
+	memset(map, 0, sizeof(*map));
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return -1;
+	}
+
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+		return -1;
+	/* Captures are read front to back */
+	madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+	map->base = base;
+	map->length = st.st_size;
+	if (check_header(base, map->length, &map->count) < 0) {
+		capture_unmap(map);
+		return -1;
+	}
+	map->frames = (const can_packet_t *) ((const char *) base +
+	    sizeof(capture_header_t));
+
+	return 0;
+}
+
+void
+capture_unmap(capture_map_t *map)
+{
+	if (map->base != NULL)
+		munmap(map->base, map->length);
+	memset(map, 0, sizeof(*map));
+}
+#else
+/* No mmap here: the whole capture is read in memory */
+int
+capture_map(const char *path, capture_map_t *map)
+{
+	FILE *fp;
+	long length;
+
+	memset(map, 0, sizeof(*map));
+	fp = fopen(path, "rb");
+	if (fp == NULL)
+		return -1;
+	if (fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) <= 0 ||
+	    fseek(fp, 0, SEEK_SET) != 0) {
+		fclose(fp);
+		return -1;
+	}
+
+	map->base = malloc(length);
+	map->length = length;
+	if (map->base == NULL ||
+	    fread(map->base, 1, length, fp) != (size_t) length ||
+	    check_header(map->base, map->length, &map->count) < 0) {
+		fclose(fp);
+		capture_unmap(map);
+		return -1;
+	}
+	fclose(fp);
+	map->frames = (const can_packet_t *) ((const char *) map->base +
+	    sizeof(capture_header_t));
+
+	return 0;
+}
+
+void
+capture_unmap(capture_map_t *map)
+{
+	free(map->base);
+	memset(map, 0, sizeof(*map));
+}
+#endif
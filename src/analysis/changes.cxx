@@ -0,0 +1,278 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/changes.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#define CHANGES_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define USEC_PER_SEC    1000000
+
+void
+changes_init(changes_engine_t *c)
+{
+	c->nids = 0;
+	c->overflow = 0;
+	memset(c->std_index, 0, sizeof(c->std_index));
+	memset(c->ext_keys, 0, sizeof(c->ext_keys));
+	memset(c->ext_index, 0, sizeof(c->ext_index));
+}
+
+void
+changes_reset(changes_engine_t *c)
+{
+	for (uint32_t i = 0; i < c->nids; i++) {
+		uint32_t id = c->ids[i].id;
+
+		memset(&c->ids[i], 0, sizeof(c->ids[i]));
+		c->ids[i].id = id;
+	}
+	c->overflow = 0;
+}
+
+static changes_id_t *
+lookup(changes_engine_t *c, uint32_t id)
+{
+	uint16_t *index;
+	changes_id_t *s;
+	uint32_t h;
+
+	if (!(id & EFF_FLAG)) {
+		index = &c->std_index[id & 0x7FF];
+	} else {
+		h = (id * 2654435761U) & (CHANGES_EXT_SLOTS - 1);
+		while (c->ext_keys[h] != 0 && c->ext_keys[h] != id)
+			h = (h + 1) & (CHANGES_EXT_SLOTS - 1);
+		index = &c->ext_index[h];
+		/* CHANGES_IDS is half the table, probing always ends */
+		if (c->ext_keys[h] == 0 && c->nids < CHANGES_IDS)
+			c->ext_keys[h] = id;
+	}
+
+	if (*index != 0)
+		return &c->ids[*index - 1];
+	if (c->nids >= CHANGES_IDS) {
+		c->overflow++;
+		return NULL;
+	}
+
+	s = &c->ids[c->nids++];
+	*index = c->nids;
+	memset(s, 0, sizeof(*s));
+	s->id = id;
+
+	return s;
+}
+
+static inline uint64_t
+load_le64(const uint8_t *buf)
+{
+	uint64_t w = 0;
+
+	for (int i = CHANGES_BYTES - 1; i >= 0; i--)
+		w = (w << 8) | buf[i];
+	return w;
+}
+
+#ifdef CHANGES_SSE2
+static void
+flush_pending(changes_id_t *s)
+{
+	for (int i = 0; i < CHANGES_BITS; i++)
+		s->flips[i] += s->pending[i];
+	memset(s->pending, 0, sizeof(s->pending));
+	s->npending = 0;
+}
+
+/*
+ * Spreads the 64 bit XOR over 64 byte lanes (0xFF where the bit flipped)
+ * and subtracts them from the 8 bit pending counters, so every frame costs
+ * the same whatever the number of flips.
+ */
+static void
+count_flips(changes_id_t *s, uint64_t x)
+{
+	const __m128i bits = _mm_set1_epi64x(0x8040201008040201ULL);
+	__m128i v = _mm_cvtsi64_si128((long long) x);
+	__m128i b2 = _mm_unpacklo_epi8(v, v);
+	__m128i b4[2] = { _mm_unpacklo_epi16(b2, b2), _mm_unpackhi_epi16(b2, b2) };
+
+	for (int i = 0; i < 4; i++) {
+		__m128i b8 = (i & 1) ? _mm_unpackhi_epi32(b4[i / 2], b4[i / 2]) :
+		    _mm_unpacklo_epi32(b4[i / 2], b4[i / 2]);
+		__m128i set = _mm_cmpeq_epi8(_mm_and_si128(b8, bits), bits);
+		__m128i *p = (__m128i *) (s->pending + 16 * i);
+
+		_mm_storeu_si128(p, _mm_sub_epi8(_mm_loadu_si128(p), set));
+	}
+	/* 8 bit counters, move them out before they wrap */
+	if (++s->npending == 255)
+		flush_pending(s);
+}
+
+static void
+update_range(changes_id_t *s, const uint8_t *data, uint64_t mask)
+{
+	__m128i d = _mm_cvtsi64_si128((long long) load_le64(data));
+	__m128i m = _mm_cvtsi64_si128((long long) mask);
+	__m128i lo = _mm_loadl_epi64((const __m128i *) s->min);
+	__m128i hi = _mm_loadl_epi64((const __m128i *) s->max);
+
+	/* Bytes beyond the DLC neither lower the minimum nor raise the maximum */
+	lo = _mm_min_epu8(lo, _mm_or_si128(d, _mm_andnot_si128(m, _mm_set1_epi8(-1))));
+	hi = _mm_max_epu8(hi, _mm_and_si128(d, m));
+	_mm_storel_epi64((__m128i *) s->min, lo);
+	_mm_storel_epi64((__m128i *) s->max, hi);
+}
+#else
+static void
+count_flips(changes_id_t *s, uint64_t x)
+{
+	while (x != 0) {
+		s->flips[__builtin_ctzll(x)]++;
+		x &= x - 1;
+	}
+}
+
+static void
+update_range(changes_id_t *s, const uint8_t *data, uint64_t mask)
+{
+	for (int i = 0; i < CHANGES_BYTES; i++) {
+		if (!((mask >> (8 * i)) & 0xFF))
+			break;
+		if (data[i] < s->min[i])
+			s->min[i] = data[i];
+		if (data[i] > s->max[i])
+			s->max[i] = data[i];
+	}
+}
+#endif
+
+static void
+detect_fields(changes_id_t *s, const uint8_t *data, uint8_t dlc)
+{
+	uint8_t sum = 0, x = 0;
+
+	for (int i = 0; i < dlc; i++) {
+		sum += data[i];
+		x ^= data[i];
+	}
+
+	for (int i = 0; i < dlc; i++) {
+		uint8_t k = data[i] - (uint8_t) (sum - data[i]);
+
+		if ((uint8_t) (data[i] - s->data[i]) == 1)
+			s->counter_hits[i]++;
+		if (((data[i] - s->data[i]) & 0x0F) == 1)
+			s->nibble_hits[i]++;
+		if (k == s->sum_k[i])
+			s->sum_hits[i]++;
+		s->sum_k[i] = k;
+	}
+	if (x == s->xor_k)
+		s->xor_hits++;
+	s->xor_k = x;
+}
+
+void
+changes_update(changes_engine_t *c, const can_packet_t *packet)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	uint8_t dlc = (packet->dlc > CHANGES_BYTES) ? CHANGES_BYTES : packet->dlc;
+	uint8_t data[CHANGES_BYTES] = { 0 };
+	uint64_t mask, x;
+	changes_id_t *s;
+
+	if (packet->id & (ERR_FLAG | RTR_FLAG))
+		return;
+
+	s = lookup(c, packet->id & (EFF_FLAG | EFF_MASK));
+	if (s == NULL)
+		return;
+
+	memcpy(data, packet->data, dlc);
+	mask = (dlc == CHANGES_BYTES) ? ~0ULL : ((1ULL << (8 * dlc)) - 1);
+
+	if (s->frames++ == 0) {
+		memcpy(s->data, data, sizeof(data));
+		memcpy(s->min, data, sizeof(data));
+		memcpy(s->max, data, sizeof(data));
+		for (int i = 0; i < CHANGES_BYTES; i++)
+			s->last_change[i] = t;
+		s->dlc = dlc;
+		return;
+	}
+
+	/* Bytes missing from a shorter frame read as zero */
+	x = load_le64(data) ^ load_le64(s->data);
+	update_range(s, data, mask);
+	if (x != 0 || dlc != s->dlc) {
+		s->changes++;
+		count_flips(s, x);
+		for (int i = 0; i < CHANGES_BYTES; i++)
+			if ((x >> (8 * i)) & 0xFF)
+				s->last_change[i] = t;
+		detect_fields(s, data, dlc);
+	}
+
+	memcpy(s->data, data, sizeof(data));
+	s->dlc = dlc;
+}
+
+int
+changes_field(const changes_id_t *s, int b)
+{
+	uint32_t pairs = s->frames - 1;
+	int flags = 0;
+
+	if (s->frames < CHANGES_MIN_FRAMES)
+		return 0;
+
+	if (s->min[b] == s->max[b])
+		return CHANGES_FIELD_CONSTANT;
+	/* Counters move on (nearly) every frame, allow for the wrap */
+	if ((uint64_t) s->counter_hits[b] * 100 >= (uint64_t) pairs * 90)
+		flags |= CHANGES_FIELD_COUNTER;
+	else if ((uint64_t) s->nibble_hits[b] * 100 >= (uint64_t) pairs * 85)
+		flags |= CHANGES_FIELD_NIBBLE;
+	if (s->changes >= CHANGES_MIN_FRAMES &&
+	    (uint64_t) s->sum_hits[b] * 100 >= (uint64_t) s->changes * 95)
+		flags |= CHANGES_FIELD_SUM;
+
+	return flags;
+}
+
+int
+changes_has_xor(const changes_id_t *s)
+{
+	return s->changes >= CHANGES_MIN_FRAMES &&
+	    (uint64_t) s->xor_hits * 100 >= (uint64_t) s->changes * 95;
+}
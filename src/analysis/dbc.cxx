@@ -0,0 +1,332 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#include "analysis/dbc.h"
+#include "canbus/can_drv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DBC_LINE_MAX 4096
+
+static char *
+skip_blank(char *s)
+{
+	while (*s == ' ' || *s == '\t')
+		s++;
+	return s;
+}
+
+/* Copies the next blank separated token, returns the position after it */
+static char *
+next_token(char *s, char *tok, size_t len)
+{
+	size_t n = 0;
+
+	s = skip_blank(s);
+	while (*s && *s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') {
+		if (n + 1 < len)
+			tok[n++] = *s;
+		s++;
+	}
+	tok[n] = '\0';
+	return s;
+}
+
+static int
+grow(void **ptr, uint32_t count, uint32_t *capacity, size_t size)
+{
+	void *p;
+
+	if (count < *capacity)
+		return 0;
+
+	*capacity = (*capacity != 0) ? *capacity * 2 : 64;
+	p = realloc(*ptr, *capacity * size);
+	if (p == NULL)
+		return -1;
+	*ptr = p;
+	return 0;
+}
+
+static int
+parse_message(char *line, dbc_message_t *msg)
+{
+	unsigned id, dlc;
+
+	memset(msg, 0, sizeof(*msg));
+	if (sscanf(line, " BO_ %u %63[^: ] : %u", &id, msg->name, &dlc) != 3)
+		return -1;
+
+	/* DBC marks extended IDs with bit 31, like EFF_FLAG */
+	msg->id = (id & EFF_FLAG) ? (id & (EFF_MASK | EFF_FLAG)) : (id & 0x7FFU);
+	msg->dlc = (dlc > 8) ? 8 : dlc;
+	msg->mux_signal = -1;
+
+	return 0;
+}
+
+static int
+parse_signal(char *line, dbc_signal_t *sig, dbc_signal_info_t *info)
+{
+	char tok[DBC_NAME_LEN];
+	unsigned start, length;
+	char order, sign;
+	int n;
+	unsigned pos;
+
+	memset(sig, 0, sizeof(*sig));
+	memset(info, 0, sizeof(*info));
+	sig->mux_value = DBC_NO_MUX;
+
+	line = next_token(line, tok, sizeof(tok));      /* SG_ */
+	line = next_token(line, info->name, sizeof(info->name));
+	line = next_token(line, tok, sizeof(tok));
+	if (tok[0] == 'M' && tok[1] == '\0') {
+		sig->is_mux = 1;
+		line = next_token(line, tok, sizeof(tok));
+	} else if (tok[0] == 'm') {
+		sig->mux_value = atoi(tok + 1);
+		line = next_token(line, tok, sizeof(tok));
+	}
+	if (strcmp(tok, ":") != 0)
+		return -1;
+
+	n = sscanf(line, " %u|%u@%c%c (%lf,%lf) [%lf|%lf]%n",
+	    &start, &length, &order, &sign, &sig->factor, &sig->offset,
+	    &info->minimum, &info->maximum, &pos);
+	if (n < 8 || length == 0 || length > 64 || start > 63)
+		return -1;
+
+	line = strchr(line + pos, '"');
+	if (line != NULL)
+		sscanf(line, "\"%15[^\"]\"", info->unit);
+
+	sig->mask = (length == 64) ? ~0ULL : ((1ULL << length) - 1);
+	sig->sign_bit = (sign == '-') ? (1ULL << (length - 1)) : 0;
+	if (order == '1') {
+		/* Intel: start is the LSB in little endian bit numbering */
+		if (start + length > 64)
+			return -1;
+		sig->shift = start;
+		sig->min_dlc = (start + length - 1) / 8 + 1;
+	} else {
+		/* Motorola: start is the MSB in the sawtooth numbering */
+		pos = (start / 8) * 8 + (7 - start % 8);
+		if (pos + length > 64)
+			return -1;
+		sig->big_endian = 1;
+		sig->shift = 64 - pos - length;
+		sig->min_dlc = (pos + length - 1) / 8 + 1;
+	}
+
+	return 0;
+}
+
+static uint32_t
+ext_hash(uint32_t id)
+{
+	return id * 2654435761U;
+}
+
+static int
+build_index(dbc_db_t *db)
+{
+	uint32_t next = 0, size = 16;
+
+	for (uint32_t i = 0; i < db->nmessages; i++)
+		if (db->messages[i].id & EFF_FLAG)
+			next++;
+	while (size < next * 2)
+		size *= 2;
+
+	db->ext_keys = (uint32_t *) calloc(size, sizeof(uint32_t));
+	db->ext_index = (uint16_t *) calloc(size, sizeof(uint16_t));
+	if (db->ext_keys == NULL || db->ext_index == NULL)
+		return -1;
+	db->ext_mask = size - 1;
+
+	for (uint32_t i = 0; i < db->nmessages && i < 0xFFFF; i++) {
+		uint32_t id = db->messages[i].id;
+
+		if (!(id & EFF_FLAG)) {
+			db->std_index[id] = i + 1;
+			continue;
+		}
+		uint32_t h = ext_hash(id) & db->ext_mask;
+		while (db->ext_keys[h] != 0 && db->ext_keys[h] != id)
+			h = (h + 1) & db->ext_mask;
+		db->ext_keys[h] = id;
+		db->ext_index[h] = i + 1;
+	}
+
+	return 0;
+}
+
+dbc_db_t *
+dbc_load(const char *path)
+{
+	char line[DBC_LINE_MAX];
+	uint32_t msg_cap = 0, sig_cap = 0, sig_cap_info = 0;
+	dbc_message_t *cur = NULL;
+	dbc_db_t *db;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return NULL;
+
+	db = (dbc_db_t *) calloc(1, sizeof(dbc_db_t));
+	if (db == NULL)
+		goto exit_error;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		char *s = skip_blank(line);
+
+		if (strncmp(s, "BO_ ", 4) == 0) {
+			if (grow((void **) &db->messages, db->nmessages, &msg_cap,
+			    sizeof(dbc_message_t)) < 0)
+				goto exit_error;
+			cur = &db->messages[db->nmessages];
+			if (parse_message(s, cur) < 0) {
+				cur = NULL;
+				continue;
+			}
+			cur->first_signal = db->nsignals;
+			db->nmessages++;
+		} else if (strncmp(s, "SG_ ", 4) == 0 && cur != NULL) {
+			if (grow((void **) &db->sigs, db->nsignals, &sig_cap,
+			    sizeof(dbc_signal_t)) < 0 ||
+			    grow((void **) &db->info, db->nsignals, &sig_cap_info,
+			    sizeof(dbc_signal_info_t)) < 0)
+				goto exit_error;
+			if (parse_signal(s, &db->sigs[db->nsignals],
+			    &db->info[db->nsignals]) < 0)
+				continue;
+			if (db->sigs[db->nsignals].is_mux)
+				cur->mux_signal = cur->nsignals;
+			cur->nsignals++;
+			db->nsignals++;
+		} else if (*s == '\n' || *s == '\r')
+			cur = NULL;
+
+		/* Drop the rest of lines longer than the buffer */
+		while (strchr(line, '\n') == NULL && !feof(fp) &&
+		    fgets(line, sizeof(line), fp) != NULL)
+			;
+	}
+	fclose(fp);
+
+	if (build_index(db) < 0) {
+		dbc_free(db);
+		return NULL;
+	}
+
+	return db;
+
+exit_error:
+	fclose(fp);
+	dbc_free(db);
+	return NULL;
+}
+
+void
+dbc_free(dbc_db_t *db)
+{
+	if (db == NULL)
+		return;
+
+	free(db->messages);
+	free(db->sigs);
+	free(db->info);
+	free(db->ext_keys);
+	free(db->ext_index);
+	free(db);
+}
+
+const dbc_message_t *
+dbc_lookup(const dbc_db_t *db, uint32_t id)
+{
+	uint32_t h;
+
+	if (!(id & EFF_FLAG)) {
+		id &= 0x7FFU;
+		return db->std_index[id] ? &db->messages[db->std_index[id] - 1] : NULL;
+	}
+
+	id &= EFF_MASK | EFF_FLAG;
+	h = ext_hash(id) & db->ext_mask;
+	while (db->ext_keys[h] != 0) {
+		if (db->ext_keys[h] == id)
+			return &db->messages[db->ext_index[h] - 1];
+		h = (h + 1) & db->ext_mask;
+	}
+
+	return NULL;
+}
+
+int
+dbc_decode(const dbc_db_t *db, const can_packet_t *packet,
+    double *values, uint8_t *present, int max, const dbc_message_t **message)
+{
+	const dbc_message_t *msg;
+	const dbc_signal_t *sig;
+	uint8_t buf[8] = { 0 };
+	uint64_t le, be;
+	int64_t sel = DBC_NO_MUX;
+	uint8_t dlc;
+	int n;
+
+	if (packet->id & (ERR_FLAG | RTR_FLAG))
+		return -1;
+
+	msg = dbc_lookup(db, packet->id);
+	if (message != NULL)
+		*message = msg;
+	if (msg == NULL)
+		return -1;
+
+	dlc = (packet->dlc > 8) ? 8 : packet->dlc;
+	memcpy(buf, packet->data, dlc);
+	le = dbc_load_le64(buf);
+	be = dbc_load_be64(buf);
+
+	sig = &db->sigs[msg->first_signal];
+	if (msg->mux_signal >= 0)
+		sel = dbc_raw(&sig[msg->mux_signal], le, be);
+
+	n = ((int) msg->nsignals < max) ? (int) msg->nsignals : max;
+	for (int i = 0; i < n; i++, sig++) {
+		uint8_t ok = dlc >= sig->min_dlc &&
+		    (sig->mux_value == DBC_NO_MUX || sig->mux_value == sel);
+
+		values[i] = ok ? dbc_scale(sig, dbc_raw(sig, le, be)) : 0.0;
+		if (present != NULL)
+			present[i] = ok;
+	}
+
+	return msg->nsignals;
+}
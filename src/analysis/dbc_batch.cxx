@@ -0,0 +1,222 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/dbc_batch.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DBC_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+/* Frames filtered per pass when the caller doesn't want the positions */
+#define DBC_BATCH_CHUNK 4096
+
+typedef size_t (*filter_fn_t)(const can_packet_t *, size_t, uint32_t, uint32_t *);
+
+static size_t
+filter_range(const can_packet_t *frames, size_t from, size_t to, uint32_t id,
+    uint32_t *index, size_t n)
+{
+	for (size_t i = from; i < to; i++)
+		if (frames[i].id == id)
+			index[n++] = i;
+
+	return n;
+}
+
+static size_t
+filter_scalar(const can_packet_t *frames, size_t count, uint32_t id,
+    uint32_t *index)
+{
+	return filter_range(frames, 0, count, id, index, 0);
+}
+
+#ifdef DBC_BATCH_X86
+static inline uint32_t
+load_id(const can_packet_t *packet)
+{
+	uint32_t id;
+
+	/* Frames are packed, the id is not aligned */
+	memcpy(&id, &packet->id, sizeof(id));
+	return id;
+}
+
+__attribute__((target("sse2")))
+static size_t
+filter_sse2(const can_packet_t *frames, size_t count, uint32_t id,
+    uint32_t *index)
+{
+	const __m128i key = _mm_set1_epi32(id);
+	size_t i, n = 0;
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		const can_packet_t *f = frames + i;
+		/*
+		 * SSE2 has no gather: the four ids are scalar loads packed in
+		 * a register, one frame apart, only the compare is vectorized.
+		 * Frames stay an array of structures, the layout of the rings
+		 * and capture files this runs on.
+		 */
+		__m128i ids = _mm_setr_epi32(load_id(f), load_id(f + 1),
+		    load_id(f + 2), load_id(f + 3));
+		unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ids, key)));
+
+		while (mask != 0) {
+			index[n++] = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return filter_range(frames, i, count, id, index, n);
+}
+
+__attribute__((target("avx2")))
+static size_t
+filter_avx2(const can_packet_t *frames, size_t count, uint32_t id,
+    uint32_t *index)
+{
+	const int s = sizeof(can_packet_t);
+	const __m256i offsets = _mm256_setr_epi32(0, s, 2 * s, 3 * s,
+	    4 * s, 5 * s, 6 * s, 7 * s);
+	const __m256i key = _mm256_set1_epi32(id);
+	size_t i, n = 0;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		/* One gather picks the id of eight consecutive frames */
+		__m256i ids = _mm256_i32gather_epi32((const int *) (frames + i),
+		    offsets, 1);
+		unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+		    _mm256_cmpeq_epi32(ids, key)));
+
+		while (mask != 0) {
+			index[n++] = i + __builtin_ctz(mask);
+			mask &= mask - 1;
+		}
+	}
+
+	return filter_range(frames, i, count, id, index, n);
+}
+#endif
+
+static filter_fn_t
+filter_select(const char **isa)
+{
+#ifdef DBC_BATCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		*isa = "avx2";
+		return filter_avx2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		*isa = "sse2";
+		return filter_sse2;
+	}
+#endif
+	*isa = "scalar";
+	return filter_scalar;
+}
+
+static filter_fn_t
+filter_get(const char **isa)
+{
+	static const char *s_isa;
+	static const filter_fn_t s_filter = filter_select(&s_isa);
+
+	if (isa != NULL)
+		*isa = s_isa;
+	return s_filter;
+}
+
+size_t
+dbc_batch_filter(const can_packet_t *frames, size_t count, uint32_t id,
+    uint32_t *index)
+{
+	return filter_get(NULL)(frames, count, id, index);
+}
+
+static size_t
+extract(const can_packet_t *frames, const uint32_t *index, size_t n,
+    const dbc_signal_t *sig, double *values, uint32_t *index_out)
+{
+	size_t k = 0;
+
+	for (size_t j = 0; j < n; j++) {
+		const can_packet_t *p = &frames[index[j]];
+		uint64_t raw;
+
+		if (p->dlc < sig->min_dlc)
+			continue;
+		/* Bytes past the DLC are masked out, min_dlc covers the signal */
+		if (sig->big_endian)
+			raw = (dbc_load_be64(p->data) >> sig->shift) & sig->mask;
+		else
+			raw = (dbc_load_le64(p->data) >> sig->shift) & sig->mask;
+		values[k] = dbc_scale(sig, raw);
+		if (index_out != NULL)
+			index_out[k] = index[j];
+		k++;
+	}
+
+	return k;
+}
+
+size_t
+dbc_batch_decode(const can_packet_t *frames, size_t count, uint32_t id,
+    const dbc_signal_t *sig, double *values, uint32_t *index)
+{
+	uint32_t chunk[DBC_BATCH_CHUNK];
+	filter_fn_t filter = filter_get(NULL);
+	size_t n, total = 0;
+
+	if (index != NULL) {
+		/* The positions are filtered in place, then compacted by DLC */
+		n = filter(frames, count, id, index);
+		return extract(frames, index, n, sig, values, index);
+	}
+
+	for (size_t i = 0; i < count; i += DBC_BATCH_CHUNK) {
+		size_t len = (count - i < DBC_BATCH_CHUNK) ? count - i : DBC_BATCH_CHUNK;
+
+		n = filter(frames + i, len, id, chunk);
+		for (size_t j = 0; j < n; j++)
+			chunk[j] += i;
+		total += extract(frames, chunk, n, sig, values + total, NULL);
+	}
+
+	return total;
+}
+
+const char *
+dbc_batch_isa(void)
+{
+	const char *isa;
+
+	filter_get(&isa);
+	return isa;
+}
@@ -0,0 +1,233 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/errframe.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+
+static const char *class_names[ERRFRAME_CLASSES] = {
+	"TX timeout", "Arbitration lost", "Controller", "Protocol violation",
+	"Transceiver", "No ACK", "Bus off", "Bus error", "Restarted", "Counters"
+};
+
+static const char *crtl_names[8] = {
+	"RX overflow", "TX overflow", "RX warning", "TX warning",
+	"RX passive", "TX passive", "Back to active", "Unspecified"
+};
+
+static const char *prot_type_names[ERRFRAME_PROT_TYPES] = {
+	"Bit", "Form", "Stuff", "Dominant bit", "Recessive bit",
+	"Overload", "Active error", "On transmission"
+};
+
+static const char *prot_loc_names[ERRFRAME_PROT_LOCATIONS] = {
+	"Unspecified", NULL, "ID 28-21", "Start of frame",
+	"SRTR", "IDE", "ID 20-18", "ID 17-13",
+	"CRC sequence", "Reserved 0", "Data", "DLC",
+	"RTR", "Reserved 1", "ID 4-0", "ID 12-5",
+	NULL, NULL, "Intermission", NULL,
+	NULL, NULL, NULL, NULL,
+	"CRC delimiter", "ACK slot", "End of frame", "ACK delimiter",
+	NULL, NULL, NULL, NULL
+};
+
+static const struct {
+	uint8_t code;
+	const char *name;
+} trx_names[] = {
+	{ 0x00, "Unspecified" },
+	{ 0x04, "CANH no wire" },
+	{ 0x05, "CANH short to BAT" },
+	{ 0x06, "CANH short to VCC" },
+	{ 0x07, "CANH short to GND" },
+	{ 0x40, "CANL no wire" },
+	{ 0x50, "CANL short to BAT" },
+	{ 0x60, "CANL short to VCC" },
+	{ 0x70, "CANL short to GND" },
+	{ 0x80, "CANL short to CANH" }
+};
+
+static qcan_state_t
+counters_state(uint8_t tec, uint8_t rec)
+{
+	uint8_t n = (tec > rec) ? tec : rec;
+
+	if (n >= ERRFRAME_PASSIVE_LIMIT)
+		return QCAN_STATE_PASSIVE;
+	if (n >= ERRFRAME_WARNING_LIMIT)
+		return QCAN_STATE_WARNING;
+	return QCAN_STATE_ACTIVE;
+}
+
+void
+errframe_init(errframe_stats_t *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->state = QCAN_STATE_ACTIVE;
+	s->window = -1;
+	s->last_window = -1;
+}
+
+uint32_t
+errframe_update(errframe_stats_t *s, const can_packet_t *packet)
+{
+	uint32_t classes;
+	qcan_state_t state = s->state;
+	uint8_t data[8] = { 0 };
+	int64_t sec;
+
+	if (!(packet->id & ERR_FLAG))
+		return 0;
+
+	classes = packet->id & ERRFRAME_MASK & ((1U << ERRFRAME_CLASSES) - 1);
+	memcpy(data, packet->data, (packet->dlc > 8) ? 8 : packet->dlc);
+	s->frames++;
+
+	for (int b = 0; b < ERRFRAME_CLASSES; b++)
+		if (classes & (1U << b))
+			s->classes[b]++;
+
+	if (classes & ERRFRAME_LOSTARB)
+		s->arb_bit = data[0];
+
+	if (classes & ERRFRAME_CRTL) {
+		if (data[1] == 0)
+			s->crtl[7]++;
+		for (int b = 0; b < 7; b++)
+			if (data[1] & (1 << b))
+				s->crtl[b]++;
+	}
+
+	if (classes & ERRFRAME_PROT) {
+		for (int b = 0; b < ERRFRAME_PROT_TYPES; b++)
+			if (data[2] & (1 << b))
+				s->prot_type[b]++;
+		s->prot_loc[data[3] & (ERRFRAME_PROT_LOCATIONS - 1)]++;
+	}
+
+	if (classes & ERRFRAME_TRX) {
+		s->trx++;
+		s->trx_last = data[4];
+	}
+
+	/* Older drivers fill the counters without flagging them */
+	if ((classes & ERRFRAME_CNT) || data[6] != 0 || data[7] != 0) {
+		s->counters = 1;
+		s->tec = data[6];
+		s->rec = data[7];
+		if (s->tec > s->tec_max)
+			s->tec_max = s->tec;
+		if (s->rec > s->rec_max)
+			s->rec_max = s->rec;
+	}
+
+	/* The controller state wins over the one implied by the counters */
+	if (classes & ERRFRAME_BUSOFF)
+		state = QCAN_STATE_BUS_OFF;
+	else if (classes & ERRFRAME_RESTARTED) {
+		state = QCAN_STATE_ACTIVE;
+		s->tec = s->rec = 0;
+	} else if ((classes & ERRFRAME_CRTL) &&
+	    (data[1] & (ERRFRAME_CRTL_RX_PASSIVE | ERRFRAME_CRTL_TX_PASSIVE)))
+		state = QCAN_STATE_PASSIVE;
+	else if ((classes & ERRFRAME_CRTL) &&
+	    (data[1] & (ERRFRAME_CRTL_RX_WARNING | ERRFRAME_CRTL_TX_WARNING)))
+		state = QCAN_STATE_WARNING;
+	else if ((classes & ERRFRAME_CRTL) && (data[1] & ERRFRAME_CRTL_ACTIVE))
+		state = QCAN_STATE_ACTIVE;
+	else if (s->counters && (classes & ERRFRAME_CNT))
+		state = counters_state(s->tec, s->rec);
+	if (state != s->state) {
+		s->state = state;
+		s->transitions++;
+	}
+
+	sec = packet->tv_sec + packet->tv_usec / USEC_PER_SEC;
+	if (sec != s->window) {
+		if (s->window >= 0) {
+			s->last_window = s->window;
+			s->last_count = s->window_count;
+		}
+		s->window = sec;
+		s->window_count = 0;
+	}
+	s->window_count++;
+	if (s->window_count > s->peak_rate)
+		s->peak_rate = s->window_count;
+
+	return classes;
+}
+
+uint32_t
+errframe_rate(const errframe_stats_t *s, int64_t now_usec)
+{
+	int64_t sec = now_usec / USEC_PER_SEC;
+
+	if (sec == s->window + 1)
+		return s->window_count;
+	if (sec == s->window && s->last_window == s->window - 1)
+		return s->last_count;
+	return 0;
+}
+
+const char *
+errframe_class_name(int bit)
+{
+	return (bit >= 0 && bit < ERRFRAME_CLASSES) ? class_names[bit] : "Unknown";
+}
+
+const char *
+errframe_crtl_name(int bit)
+{
+	return (bit >= 0 && bit < 8) ? crtl_names[bit] : "Unknown";
+}
+
+const char *
+errframe_prot_type_name(int bit)
+{
+	return (bit >= 0 && bit < ERRFRAME_PROT_TYPES) ? prot_type_names[bit] : "Unknown";
+}
+
+const char *
+errframe_prot_loc_name(int loc)
+{
+	if (loc < 0 || loc >= ERRFRAME_PROT_LOCATIONS || prot_loc_names[loc] == NULL)
+		return "Unknown";
+	return prot_loc_names[loc];
+}
+
+const char *
+errframe_trx_name(uint8_t code)
+{
+	for (unsigned i = 0; i < sizeof(trx_names) / sizeof(trx_names[0]); i++)
+		if (trx_names[i].code == code)
+			return trx_names[i].name;
+
+	return "Unknown";
+}
@@ -0,0 +1,87 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/idfilter.h"
+#include "canbus/can_drv.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *
+parse_hex(const char *s, uint32_t *value, int *digits)
+{
+	char *end;
+	unsigned long v;
+
+	if (!isxdigit((unsigned char) *s))
+		return NULL;
+	v = strtoul(s, &end, 16);
+	if (v > EFF_MASK)
+		return NULL;
+	*value = v;
+	*digits = end - s;
+
+	return end;
+}
+
+int
+idfilter_parse(idfilter_t *filter, const char *spec)
+{
+	const char *s = spec;
+	idfilter_rule_t *rule;
+	uint32_t id, mask;
+	int digits, ext;
+
+	memset(filter, 0, sizeof(*filter));
+	for (;;) {
+		while (*s == ',' || *s == ';' || isspace((unsigned char) *s))
+			s++;
+		if (*s == '\0')
+			break;
+		if (filter->nrules >= IDFILTER_MAX)
+			return -1;
+
+		s = parse_hex(s, &id, &digits);
+		if (s == NULL)
+			return -1;
+		ext = digits > 3 || id > 0x7FF;
+		mask = ext ? EFF_MASK : 0x7FF;
+		if (*s == ':') {
+			s = parse_hex(s + 1, &mask, &digits);
+			if (s == NULL)
+				return -1;
+		}
+		if (*s != '\0' && *s != ',' && *s != ';' && !isspace((unsigned char) *s))
+			return -1;
+
+		rule = &filter->rules[filter->nrules++];
+		rule->id = (id & mask) | (ext ? EFF_FLAG : 0);
+		rule->mask = mask | EFF_FLAG;
+	}
+
+	return filter->nrules;
+}
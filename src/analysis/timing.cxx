@@ -0,0 +1,229 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "analysis/timing.h"
+#include "canbus/can_drv.h"
+
+#include <math.h>
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+
+static uint32_t
+ext_hash(uint32_t id)
+{
+	return (id * 2654435761U) & (TIMING_EXT_SLOTS - 1);
+}
+
+static void
+clear_stats(timing_id_t *s)
+{
+	s->last = 0;
+	s->count = 0;
+	s->sum = 0;
+	s->sum_sq = 0.0;
+	s->min = UINT32_MAX;
+	s->max = 0;
+	s->missed = 0;
+	memset(s->hist, 0, sizeof(s->hist));
+}
+
+void
+timing_init(timing_engine_t *t, uint32_t tolerance)
+{
+	memset(t->std_index, 0, sizeof(t->std_index));
+	memset(t->ext_keys, 0, sizeof(t->ext_keys));
+	memset(t->ext_index, 0, sizeof(t->ext_index));
+	t->nids = 0;
+	t->overflow = 0;
+	t->tolerance = tolerance;
+}
+
+void
+timing_reset(timing_engine_t *t)
+{
+	for (uint32_t i = 0; i < t->nids; i++)
+		clear_stats(&t->ids[i]);
+	t->overflow = 0;
+}
+
+/* Returns the slot of id, adding it when create is set */
+static timing_id_t *
+lookup(timing_engine_t *t, uint32_t id, int create)
+{
+	uint16_t *index;
+	timing_id_t *s;
+	uint32_t h;
+
+	if (!(id & EFF_FLAG)) {
+		index = &t->std_index[id & 0x7FF];
+	} else {
+		h = ext_hash(id);
+		while (t->ext_keys[h] != 0 && t->ext_keys[h] != id)
+			h = (h + 1) & (TIMING_EXT_SLOTS - 1);
+		index = &t->ext_index[h];
+		if (t->ext_keys[h] == 0) {
+			if (!create)
+				return NULL;
+			/* TIMING_IDS is half the table, probing always ends */
+			if (t->nids < TIMING_IDS)
+				t->ext_keys[h] = id;
+		}
+	}
+
+	if (*index != 0)
+		return &t->ids[*index - 1];
+	if (!create)
+		return NULL;
+	if (t->nids >= TIMING_IDS) {
+		t->overflow++;
+		return NULL;
+	}
+
+	s = &t->ids[t->nids++];
+	*index = t->nids;
+	s->id = id;
+	s->expected = 0;
+	clear_stats(s);
+
+	return s;
+}
+
+int
+timing_set_expected(timing_engine_t *t, uint32_t id, uint32_t usec)
+{
+	timing_id_t *s = lookup(t, id & (EFF_FLAG | EFF_MASK), 1);
+
+	if (s == NULL)
+		return -1;
+	s->expected = usec;
+
+	return 0;
+}
+
+void
+timing_update(timing_engine_t *t, const can_packet_t *packet)
+{
+	int64_t now = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	int64_t interval;
+	uint32_t usec, limit;
+	timing_id_t *s;
+
+	if (packet->id & ERR_FLAG)
+		return;
+
+	s = lookup(t, packet->id & (EFF_FLAG | EFF_MASK), 1);
+	if (s == NULL)
+		return;
+
+	interval = now - s->last;
+	if (s->last == 0 || interval < 0) {
+		/* First frame, or the clock went back: restart from here */
+		s->last = now;
+		return;
+	}
+	s->last = now;
+	usec = (interval > UINT32_MAX) ? UINT32_MAX : (uint32_t) interval;
+
+	s->count++;
+	s->sum += usec;
+	s->sum_sq += (double) usec * usec;
+	if (usec < s->min)
+		s->min = usec;
+	if (usec > s->max)
+		s->max = usec;
+	s->hist[timing_bucket(usec)]++;
+
+	if (s->expected != 0)
+		limit = s->expected;
+	else if (s->count >= TIMING_AUTO_MIN)
+		limit = timing_mean(s);
+	else
+		return;
+	if ((uint64_t) usec * 100 > (uint64_t) limit * (100 + t->tolerance))
+		s->missed++;
+}
+
+uint32_t
+timing_mean(const timing_id_t *s)
+{
+	return (s->count != 0) ? s->sum / s->count : 0;
+}
+
+uint32_t
+timing_stddev(const timing_id_t *s)
+{
+	double mean, var;
+
+	if (s->count < 2)
+		return 0;
+	mean = (double) s->sum / s->count;
+	var = s->sum_sq / s->count - mean * mean;
+
+	return (var > 0.0) ? (uint32_t) (sqrt(var) + 0.5) : 0;
+}
+
+uint32_t
+timing_bucket_low(int b)
+{
+	int e;
+
+	if (b < TIMING_SUB)
+		return b;
+	e = (b - TIMING_SUB) / TIMING_SUB + TIMING_SUB_BITS;
+
+	return (uint32_t) (TIMING_SUB + (b - TIMING_SUB) % TIMING_SUB) << (e - TIMING_SUB_BITS);
+}
+
+uint32_t
+timing_percentile(const timing_id_t *s, double p)
+{
+	uint64_t rank, seen = 0;
+	uint32_t v;
+
+	if (s->count == 0)
+		return 0;
+
+	rank = (uint64_t) (p / 100.0 * s->count + 0.5);
+	if (rank == 0)
+		rank = 1;
+	for (int b = 0; b < TIMING_BUCKETS; b++) {
+		seen += s->hist[b];
+		if (seen < rank)
+			continue;
+		/* Middle of the bucket, within the observed range */
+		v = timing_bucket_low(b);
+		if (b >= TIMING_SUB && b + 1 < TIMING_BUCKETS)
+			v += (timing_bucket_low(b + 1) - v) / 2;
+		if (v < s->min)
+			v = s->min;
+		if (v > s->max)
+			v = s->max;
+		return v;
+	}
+
+	return s->max;
+}
@@ -109,6 +109,12 @@ void QCanalyzerConfigDialog::saveSettings()
 	} else {
 		settings->setValue("canNetServerPort", "8888");
 	}
+	if (!canNetFlushLatencyLineEdit->text().isEmpty()) {
+		strValue = canNetFlushLatencyLineEdit->text().trimmed();
+		settings->setValue("canNetFlushLatency", strValue);
+	} else {
+		settings->setValue("canNetFlushLatency", "1000");
+	}
 	// for connection to PCAN-USB
 	if(!ediPCANName->text().isEmpty() && !ediPCANBitRate->text().isEmpty()) {
 		strValue = ediPCANName->text().trimmed();
@@ -119,6 +125,18 @@ void QCanalyzerConfigDialog::saveSettings()
 		settings->setValue("PCANName", "can0");
 		settings->setValue("PCANBitRate", "250000");
 	}
+	if (!ediPCANRcvBuf->text().isEmpty()) {
+		strValue = ediPCANRcvBuf->text().trimmed();
+		settings->setValue("PCANRcvBuf", strValue);
+	} else {
+		settings->setValue("PCANRcvBuf", "0");
+	}
+	if (!ediPCANBusyPoll->text().isEmpty()) {
+		strValue = ediPCANBusyPoll->text().trimmed();
+		settings->setValue("PCANBusyPoll", strValue);
+	} else {
+		settings->setValue("PCANBusyPoll", "0");
+	}
 	// for connection to Simulation
 	if(!ediSimulationName->text().isEmpty()) {
 		strValue = ediSimulationName->text().trimmed();
@@ -126,6 +144,13 @@ void QCanalyzerConfigDialog::saveSettings()
 	} else {
 		settings->setValue("SimulationName", "");
 	}
+	// for generated traffic
+	if(!ediGeneratorSpec->text().isEmpty()) {
+		strValue = ediGeneratorSpec->text().simplified();
+		settings->setValue("GeneratorSpec", strValue);
+	} else {
+		settings->setValue("GeneratorSpec", "rate=1000 ids=100-1FF dlc=mix seed=1");
+	}
 
 	settings->endGroup();
 
@@ -0,0 +1,487 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "canbus/can_drv.h"
+#include "canbus/can_state.h"
+#include "canbus/can_packet.h"
+#include "drivers/generator_ops.h"
+#include "utils.h"
+#include "os_utils.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#define NSEC_PER_SEC    1000000000LL
+#define USEC_PER_SEC    1000000LL
+
+/* Ahead of the schedule by more than this, the receiver sleeps */
+#define SLEEP_USEC      1000
+/* Longest sleep, so a wakeup is noticed in time */
+#define WAKEUP_USEC     100000
+
+enum {
+	IDS_RANGE,
+	IDS_ZIPF,
+	IDS_LIST
+};
+
+enum {
+	PATTERN_STEADY,
+	PATTERN_POISSON,
+	PATTERN_BURST
+};
+
+enum {
+	PAYLOAD_COUNTER,
+	PAYLOAD_RANDOM,
+	PAYLOAD_ZERO
+};
+
+typedef struct {
+	/* Configuration */
+	uint64_t rate;
+	int ids_mode;
+	uint32_t id_lo, id_hi;
+	uint32_t ids[GENERATOR_IDS_MAX];
+	uint64_t zipf_cdf[GENERATOR_IDS_MAX];
+	uint32_t nids;
+	int dlc_mix;
+	uint8_t dlc_lo, dlc_hi;
+	int pattern;
+	uint32_t burst_frames;
+	int64_t burst_idle_nsec;
+	int payload;
+	uint64_t count;
+	uint64_t seed;
+
+	/* Stream state, reset by start */
+	uint64_t rng;
+	uint64_t sent;
+	int64_t start_usec;
+	int64_t vt_nsec;
+	uint32_t in_burst;
+	uint8_t counter[8];
+} generator_t;
+
+static generator_t gen;
+static std::atomic<bool> wakeup(false);
+
+static int generator_create(const char *dev, unsigned bitrate);
+static int generator_destroy(int fd);
+static int generator_send(int fd, unsigned id, uint8_t dlc, void *data);
+static int generator_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
+                          int64_t *sec, int64_t *usec);
+static int generator_bitrate_set(const char *device, unsigned bitrate);
+static int generator_attribute_set(unsigned attribute, const void *value, unsigned value_len);
+static int generator_start(const char *device);
+static int generator_stop(const char *device);
+static int generator_state_get(const char *device, qcan_state_t *status);
+static int generator_restart(const char *device);
+static int generator_wakeup(int fd);
+
+can_ops_t generator_ops = {
+	/* .create =        */ generator_create,
+	/* .destroy =       */ generator_destroy,
+	/* .send =          */ generator_send,
+	/* .recv =          */ generator_recv,
+	/* .bitrate_set =   */ generator_bitrate_set,
+	/* .attribute_set = */ generator_attribute_set,
+	/* .start =         */ generator_start,
+	/* .stop =          */ generator_stop,
+	/* .state_get =     */ generator_state_get,
+	/* .restart =       */ generator_restart,
+	/* .rx_dropped =    */ NULL,
+	/* .wakeup =        */ generator_wakeup
+};
+
+/* Typical share of each DLC on a vehicle bus, in percent */
+static const uint8_t dlc_mix[9] = { 2, 2, 3, 2, 5, 2, 4, 2, 78 };
+
+/* xorshift64*, small and reproducible on every platform */
+static inline uint64_t
+next_random(void)
+{
+	gen.rng ^= gen.rng >> 12;
+	gen.rng ^= gen.rng << 25;
+	gen.rng ^= gen.rng >> 27;
+	return gen.rng * 2685821657736338717ULL;
+}
+
+static int
+parse_ids(const char *value)
+{
+	char *end;
+	unsigned long n, base = 0x100;
+
+	gen.nids = 0;
+	if (strncmp(value, "zipf:", 5) == 0) {
+		double total = 0.0, acc = 0.0;
+
+		n = strtoul(value + 5, &end, 10);
+		if (*end == ':')
+			base = strtoul(end + 1, &end, 16);
+		if (n == 0 || n > GENERATOR_IDS_MAX || *end != '\0')
+			return -1;
+		for (unsigned long k = 1; k <= n; k++)
+			total += 1.0 / k;
+		for (unsigned long k = 1; k <= n; k++) {
+			acc += 1.0 / k;
+			gen.ids[k - 1] = (base + k - 1) & EFF_MASK;
+			gen.zipf_cdf[k - 1] = (uint64_t) (acc / total * 18446744073709549568.0);
+		}
+		gen.zipf_cdf[n - 1] = ~0ULL;
+		gen.nids = n;
+		gen.ids_mode = IDS_ZIPF;
+		return 0;
+	}
+
+	if (strchr(value, ',') != NULL) {
+		const char *s = value;
+
+		while (*s != '\0') {
+			if (gen.nids >= GENERATOR_IDS_MAX)
+				return -1;
+			gen.ids[gen.nids++] = strtoul(s, &end, 16) & EFF_MASK;
+			if (end == s || (*end != ',' && *end != '\0'))
+				return -1;
+			s = (*end == ',') ? end + 1 : end;
+		}
+		gen.ids_mode = IDS_LIST;
+		return 0;
+	}
+
+	gen.id_lo = strtoul(value, &end, 16) & EFF_MASK;
+	gen.id_hi = gen.id_lo;
+	if (*end == '-')
+		gen.id_hi = strtoul(end + 1, &end, 16) & EFF_MASK;
+	if (*end != '\0' || gen.id_hi < gen.id_lo)
+		return -1;
+	gen.ids_mode = IDS_RANGE;
+
+	return 0;
+}
+
+static int
+parse_option(const char *key, const char *value)
+{
+	unsigned idle_ms;
+	char *end;
+
+	if (strcmp(key, "rate") == 0) {
+		gen.rate = strtoull(value, &end, 10);
+	} else if (strcmp(key, "ids") == 0) {
+		return parse_ids(value);
+	} else if (strcmp(key, "dlc") == 0) {
+		gen.dlc_mix = strcmp(value, "mix") == 0;
+		if (gen.dlc_mix)
+			return 0;
+		gen.dlc_lo = gen.dlc_hi = strtoul(value, &end, 10);
+		if (*end == '-')
+			gen.dlc_hi = strtoul(end + 1, &end, 10);
+		if (gen.dlc_hi > 8 || gen.dlc_lo > gen.dlc_hi)
+			return -1;
+	} else if (strcmp(key, "pattern") == 0) {
+		if (strcmp(value, "steady") == 0) {
+			gen.pattern = PATTERN_STEADY;
+			return 0;
+		}
+		if (strcmp(value, "poisson") == 0) {
+			gen.pattern = PATTERN_POISSON;
+			return 0;
+		}
+		if (sscanf(value, "burst:%u:%u", &gen.burst_frames, &idle_ms) != 2 ||
+		    gen.burst_frames == 0)
+			return -1;
+		gen.burst_idle_nsec = (int64_t) idle_ms * (NSEC_PER_SEC / 1000);
+		gen.pattern = PATTERN_BURST;
+		return 0;
+	} else if (strcmp(key, "payload") == 0) {
+		if (strcmp(value, "counter") == 0)
+			gen.payload = PAYLOAD_COUNTER;
+		else if (strcmp(value, "random") == 0)
+			gen.payload = PAYLOAD_RANDOM;
+		else if (strcmp(value, "zero") == 0)
+			gen.payload = PAYLOAD_ZERO;
+		else
+			return -1;
+		return 0;
+	} else if (strcmp(key, "count") == 0) {
+		gen.count = strtoull(value, &end, 10);
+	} else if (strcmp(key, "seed") == 0) {
+		gen.seed = strtoull(value, &end, 0);
+	} else {
+		return -1;
+	}
+
+	return (*end == '\0') ? 0 : -1;
+}
+
+int
+generator_create(const char *dev, unsigned)
+{
+	char spec[1024], *s, *token, *value;
+
+	memset(&gen, 0, sizeof(gen));
+	/* A wakeup left over from the previous capture must not end this one */
+	wakeup.store(false);
+	gen.rate = 1000;
+	gen.id_lo = 0x100;
+	gen.id_hi = 0x1FF;
+	gen.dlc_lo = gen.dlc_hi = 8;
+	gen.seed = 1;
+
+	strncpy(spec, dev, sizeof(spec) - 1);
+	spec[sizeof(spec) - 1] = '\0';
+	s = spec;
+	while ((token = strsep(&s, " \t")) != NULL) {
+		if (*token == '\0')
+			continue;
+		value = strchr(token, '=');
+		if (value == NULL)
+			return -1;
+		*value++ = '\0';
+		if (parse_option(token, value) < 0)
+			return -1;
+	}
+
+	/* Any positive descriptor, there is a single generator */
+	return 1;
+}
+
+int
+generator_destroy(int)
+{
+	return 0;
+}
+
+int
+generator_send(int, unsigned, uint8_t dlc, void *)
+{
+	/* Accepted and dropped, like a bus with no other node */
+	return 16 + dlc;
+}
+
+/* Virtual time of the next frame from the pattern */
+static void
+advance_schedule(void)
+{
+	int64_t gap;
+
+	if (gen.rate == 0)
+		return;
+
+	gap = NSEC_PER_SEC / gen.rate;
+	switch (gen.pattern) {
+	case PATTERN_POISSON:
+		/* Exponential gaps, u in (0, 1] */
+		gap = (int64_t) (-log(((next_random() >> 11) + 1) * (1.0 / 9007199254740992.0)) *
+		    NSEC_PER_SEC / gen.rate);
+		break;
+
+	case PATTERN_BURST:
+		if (++gen.in_burst == gen.burst_frames) {
+			gen.in_burst = 0;
+			gap += gen.burst_idle_nsec;
+		}
+		break;
+
+	default:
+		break;
+	}
+	gen.vt_nsec += gap;
+}
+
+static uint32_t
+next_id(void)
+{
+	uint64_t r = next_random();
+	uint32_t lo, hi, id;
+
+	switch (gen.ids_mode) {
+	case IDS_ZIPF:
+		lo = 0;
+		hi = gen.nids - 1;
+		while (lo < hi) {
+			uint32_t mid = (lo + hi) / 2;
+
+			if (gen.zipf_cdf[mid] < r)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		id = gen.ids[lo];
+		break;
+
+	case IDS_LIST:
+		id = gen.ids[r % gen.nids];
+		break;
+
+	default:
+		id = gen.id_lo + (uint32_t) (r % (gen.id_hi - gen.id_lo + 1));
+		break;
+	}
+
+	return (id > 0x7FF) ? (id | EFF_FLAG) : id;
+}
+
+static uint8_t
+next_dlc(void)
+{
+	unsigned r;
+
+	if (!gen.dlc_mix)
+		return gen.dlc_lo + next_random() % (gen.dlc_hi - gen.dlc_lo + 1);
+
+	r = next_random() % 100;
+	for (uint8_t dlc = 0; dlc < 8; dlc++) {
+		if (r < dlc_mix[dlc])
+			return dlc;
+		r -= dlc_mix[dlc];
+	}
+	return 8;
+}
+
+int
+generator_recv(int, unsigned *id, uint8_t *dlc, void *data,
+               int64_t *sec, int64_t *usec)
+{
+	uint8_t *payload = (uint8_t *) data;
+	int64_t due, now_sec, now_usec, now;
+	uint64_t r;
+
+	if (gen.count != 0 && gen.sent >= gen.count)
+		return 0;
+	/* Taken here too, at rate 0 the loop below is never entered */
+	if (wakeup.exchange(false))
+		return 0;
+
+	due = gen.start_usec + gen.vt_nsec / 1000;
+	if (gen.rate != 0) {
+		for (;;) {
+			get_timestamp(&now_sec, &now_usec);
+			now = now_sec * USEC_PER_SEC + now_usec;
+			if (now >= due)
+				break;
+			if (wakeup.exchange(false))
+				return 0;
+			/* Late frames go out back to back until the schedule is met */
+			if (due - now > SLEEP_USEC) {
+				now = due - now - SLEEP_USEC / 2;
+				usleep((now > WAKEUP_USEC) ? WAKEUP_USEC : now);
+			}
+		}
+	} else {
+		get_timestamp(&now_sec, &now_usec);
+		due = now_sec * USEC_PER_SEC + now_usec;
+	}
+
+	*id = next_id();
+	*dlc = next_dlc();
+	switch (gen.payload) {
+	case PAYLOAD_RANDOM:
+		r = next_random();
+		memcpy(payload, &r, 8);
+		break;
+
+	case PAYLOAD_ZERO:
+		memset(payload, 0, 8);
+		break;
+
+	default:
+		/* Byte 0 counts frames, byte n every 2^(8n) of them */
+		for (int i = 0; i < 8; i++)
+			if (++gen.counter[i] != 0)
+				break;
+		memcpy(payload, gen.counter, 8);
+		break;
+	}
+
+	*sec = due / USEC_PER_SEC;
+	*usec = due % USEC_PER_SEC;
+	gen.sent++;
+	advance_schedule();
+
+	return 16 + *dlc;
+}
+
+int
+generator_bitrate_set(const char *, unsigned)
+{
+	return 0;
+}
+
+int
+generator_attribute_set(unsigned, const void *, unsigned)
+{
+	return 0;
+}
+
+int
+generator_start(const char *)
+{
+	int64_t sec, usec;
+
+	get_timestamp(&sec, &usec);
+	gen.rng = gen.seed ? gen.seed : 0x9E3779B97F4A7C15ULL;
+	gen.sent = 0;
+	gen.vt_nsec = 0;
+	gen.in_burst = 0;
+	memset(gen.counter, 0, sizeof(gen.counter));
+	gen.start_usec = sec * USEC_PER_SEC + usec;
+
+	return 0;
+}
+
+int
+generator_stop(const char *)
+{
+	return 0;
+}
+
+int
+generator_restart(const char *)
+{
+	return 0;
+}
+
+int
+generator_wakeup(int)
+{
+	wakeup.store(true);
+	return 0;
+}
+
+int
+generator_state_get(const char *, qcan_state_t *status)
+{
+	/* No controller behind it */
+	*status = QCAN_STATE_UNKNOWN;
+	return 0;
+}
@@ -33,8 +33,11 @@
 #include <sys/types.h>
 #include <string.h>
 
+#include <atomic>
+
 #if __linux
 #include <sys/socket.h>
+#include <sys/select.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -61,7 +64,11 @@ static struct sockaddr_in server_addr;
 static char server_ipstr[256];
 static unsigned server_port;
 
+/* Longest wait for a datagram, so a wakeup is noticed in time */
+#define NET_WAKEUP_MS 100
+
 static int m_fd;
+static std::atomic<bool> m_wakeup(false);
 
 static int net_create(const char *dev, unsigned bitrate);
 static int net_destroy(int fd);
@@ -74,6 +81,7 @@ static int net_start(const char *device);
 static int net_stop(const char *device);
 static int net_state_get(const char *device, qcan_state_t *status);
 static int net_restart(const char *device);
+static int net_wakeup(int fd);
 
 can_ops_t net_ops = {
 	/* .create =        */ net_create,
@@ -85,7 +93,9 @@ can_ops_t net_ops = {
 	/* .start =         */ net_start,
 	/* .stop =          */ net_stop,
 	/* .state_get =     */ net_state_get,
-	/* .restart =       */ net_restart
+	/* .restart =       */ net_restart,
+	/* .rx_dropped =    */ NULL,
+	/* .wakeup =        */ net_wakeup
 };
 
 uint64_t htonll(uint64_t n)
@@ -112,6 +122,8 @@ net_create(const char *, unsigned)
 	INIT_SOCKET;
 	skt = socket(AF_INET, SOCK_DGRAM, 0);
 	m_fd = skt;
+	/* Drop a wakeup that arrived after the last recv of the previous run */
+	m_wakeup.store(false);
 
 	return skt;
 }
@@ -144,8 +156,22 @@ net_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
 {
 	can_packet_t pkt;
 	socklen_t slen;
+	struct timeval tv;
+	fd_set rfds;
 	int r;
 
+	do {
+		if (m_wakeup.exchange(false))
+			return 0;
+		tv.tv_sec = 0;
+		tv.tv_usec = NET_WAKEUP_MS * 1000;
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		r = select(fd + 1, &rfds, NULL, NULL, &tv);
+		if (r < 0)
+			return r;
+	} while (r == 0);
+
 	slen =  sizeof(server_addr);
 
 	r = recvfrom(fd, (char *)&pkt, sizeof(can_packet_t), 0,
@@ -215,8 +241,16 @@ net_restart(const char *)
 }
 
 int
-net_state_get(const char *, qcan_state_t *)
+net_state_get(const char *, qcan_state_t *status)
 {
+	/* No controller behind it */
+	*status = QCAN_STATE_UNKNOWN;
 	return 0;
 }
 
+int
+net_wakeup(int)
+{
+	m_wakeup.store(true);
+	return 0;
+}
@@ -37,7 +37,13 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 
+#include <atomic>
+
+/* Longest sleep between two lines, so a wakeup is noticed in time */
+#define SIM_WAKEUP_MS 100
+
 static int m_fd;
+static std::atomic<bool> m_wakeup(false);
 
 static int simulation_create(const char *dev, unsigned bitrate);
 static int simulation_destroy(int fd);
@@ -50,6 +56,7 @@ static int simulation_start(const char *device);
 static int simulation_stop(const char *device);
 static int simulation_state_get(const char *device, qcan_state_t *status);
 static int simulation_restart(const char *device);
+static int simulation_wakeup(int fd);
 static void reverse(char s[]);
 static int read_line(int fd, char *buf, int size);
 static int parse_dump_line(int fd, uint32_t *id, uint8_t *dlc, uint8_t data[]);
@@ -64,13 +71,16 @@ can_ops_t simulation_ops = {
 	/* .start =         */ simulation_start,
 	/* .stop =          */ simulation_stop,
 	/* .state_get =     */ simulation_state_get,
-	/* .restart =       */ simulation_restart
+	/* .restart =       */ simulation_restart,
+	/* .rx_dropped =    */ NULL,
+	/* .wakeup =        */ simulation_wakeup
 };
 
 int
 simulation_create(const char *dev, unsigned)
 {
 	m_fd = open(dev, O_RDONLY | _O_BINARY);
+	m_wakeup.store(false);
 
 	return m_fd;
 }
@@ -97,6 +107,10 @@ simulation_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
 		result = -1;
 		goto out;
 	}
+	if (m_wakeup.exchange(false)) {
+		result = 0;
+		goto out;
+	}
 	if (parse_dump_line(fd, id, dlc, (uint8_t *)data) < 0) {
 		result = -1;
 		goto out;
@@ -147,8 +161,17 @@ simulation_restart(const char *)
 }
 
 int
-simulation_state_get(const char *, qcan_state_t *)
+simulation_state_get(const char *, qcan_state_t *status)
 {
+	/* No controller behind it */
+	*status = QCAN_STATE_UNKNOWN;
+	return 0;
+}
+
+int
+simulation_wakeup(int)
+{
+	m_wakeup.store(true);
 	return 0;
 }
 
@@ -193,32 +216,14 @@ read_line(int fd, char *buf, int size)
 }
 
 int
-parse_dump_line(int fd, uint32_t *id, uint8_t *dlc, uint8_t data[])
+simulation_parse_line(char *buffer, uint32_t *id, uint8_t *dlc, uint8_t data[],
+                      uint64_t *delay)
 {
-	char *ptr = NULL, *token = NULL, buffer[1024];
+	char *ptr = NULL, *token = NULL;
 	int column = 0;
-	int ret = 0;
-	uint64_t delay = 100;
-
-	if (lseek(fd, 0, SEEK_CUR) == 0) {
-		ret = -1;
-		goto out;
-	}
-
-	if (read_line(fd, buffer, 1024) <= 0) {
-		ret = -2;
-		goto out;
-	}
-
-	if ((*buffer == '\n') || !strcmp(buffer, "\r\n")) {
-		ret = -1;
-		goto out;
-	}
-
 
 	*id  = 0U;
 	*dlc = 0U;
-	buffer[1023] = '\0';
 
 	ptr = buffer;
 	do {
@@ -255,14 +260,49 @@ parse_dump_line(int fd, uint32_t *id, uint8_t *dlc, uint8_t data[])
 
 			default:
 				if (column == *dlc + 5)
-					delay = atoi(token);
+					*delay = atoi(token);
 				break;
 			}
 		}
 	} while (token != NULL);
 
+	return 0;
+}
+
+int
+parse_dump_line(int fd, uint32_t *id, uint8_t *dlc, uint8_t data[])
+{
+	char buffer[1024];
+	int ret = 0;
+	uint64_t delay = 100;
+
+	if (lseek(fd, 0, SEEK_CUR) == 0) {
+		ret = -1;
+		goto out;
+	}
+
+	if (read_line(fd, buffer, 1024) <= 0) {
+		ret = -2;
+		goto out;
+	}
+
+	if ((*buffer == '\n') || !strcmp(buffer, "\r\n")) {
+		ret = -1;
+		goto out;
+	}
+
+
+	buffer[1023] = '\0';
+	simulation_parse_line(buffer, id, dlc, data, &delay);
+
 out:
-	usleep(delay * 1000);
+	/* The line is returned anyway, a wakeup is taken by the next recv */
+	while (delay > 0 && !m_wakeup.load()) {
+		uint64_t slice = (delay > SIM_WAKEUP_MS) ? SIM_WAKEUP_MS : delay;
+
+		usleep(slice * 1000);
+		delay -= slice;
+	}
 	return ret;
 }
 
@@ -0,0 +1,712 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#include "canbus/can_drv.h"
+#include "canbus/can_state.h"
+#include "canbus/can_packet.h"
+#include "drivers/tcp_ops.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <string.h>
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+
+#if __linux
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define closesocket close
+#define INIT_SOCKET
+#define CLEANUP_SOCKET
+#elif _WIN32
+#include <winsock2.h>
+#include <io.h>
+#include <stdio.h>
+#define socklen_t int
+#define MSG_NOSIGNAL 0
+#define SHUT_RDWR SD_BOTH
+#define INIT_SOCKET do { \
+	WSADATA wsaData = {0};\
+	WSAStartup(MAKEWORD(2, 2), &wsaData); \
+	} while(0)
+
+#define CLEANUP_SOCKET do { \
+	WSACleanup();\
+	} while(0)
+
+#endif
+
+#define TCP_HEADER_SIZE 16
+
+/* Frames we accept before handing credit back to the server */
+#define TCP_RX_WINDOW (4 * TCP_BATCH_MAX)
+
+/* Frames kept until the server acknowledges them, a power of two */
+#define TCP_TX_RING (4 * TCP_BATCH_MAX)
+
+/* Longest wait for data, so a wakeup is noticed in time */
+#define TCP_WAKEUP_MS 100
+
+static struct sockaddr_in server_addr;
+static char server_ipstr[256];
+static unsigned server_port;
+
+static int m_fd = -1;
+static int m_handle = -1;
+static std::atomic<bool> m_closing(false);
+static std::atomic<bool> m_wakeup(false);
+
+static uint32_t m_flush_usec = 1000;
+static uint32_t m_overflow = TCP_OVERFLOW_DROP;
+static uint32_t m_reconnect_ms = 1000;
+
+/* Receive side, only touched by the thread calling recv() */
+static uint8_t m_rx_buf[TCP_BATCH_MAX * TCP_FRAME_SIZE];
+static unsigned m_rx_count;
+static unsigned m_rx_pos;
+static uint64_t m_rx_seq;
+
+/*
+ * Transmit side and every write to the socket, guarded by m_tx_lock.
+ *
+ * Frames stay in m_tx_ring from the time they are queued until the server
+ * acknowledges them, so the ones in flight when a connection breaks are
+ * written again on the next one.  The positions only grow:
+ *
+ *   m_tx_tail  oldest frame not yet acknowledged
+ *   m_tx_sent  next frame to write
+ *   m_tx_head  next free slot
+ *
+ * and the frame at position p has sequence number p + m_tx_delta.
+ */
+static std::mutex m_tx_lock;
+static std::condition_variable m_tx_cond;
+static uint8_t m_tx_ring[TCP_TX_RING * TCP_FRAME_SIZE];
+static uint8_t m_tx_buf[TCP_HEADER_SIZE + TCP_BATCH_MAX * TCP_FRAME_SIZE];
+static uint64_t m_tx_tail;
+static uint64_t m_tx_sent;
+static uint64_t m_tx_head;
+static uint64_t m_tx_delta;
+static int64_t m_tx_first_usec;
+static uint32_t m_tx_credit;
+
+static tcp_stats_t m_stats;
+
+static int tcp_create(const char *dev, unsigned bitrate);
+static int tcp_destroy(int fd);
+static int tcp_send(int fd, unsigned id, uint8_t dlc, void *data);
+static int tcp_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
+    int64_t *sec, int64_t *usec);
+static int tcp_bitrate_set(const char *device, unsigned bitrate);
+static int tcp_attribute_set(unsigned attribute, const void *value, unsigned value_len);
+static int tcp_start(const char *device);
+static int tcp_stop(const char *device);
+static int tcp_state_get(const char *device, qcan_state_t *status);
+static int tcp_restart(const char *device);
+static int tcp_wakeup(int fd);
+
+can_ops_t tcp_ops = {
+	/* .create =        */ tcp_create,
+	/* .destroy =       */ tcp_destroy,
+	/* .send =          */ tcp_send,
+	/* .recv =          */ tcp_recv,
+	/* .bitrate_set =   */ tcp_bitrate_set,
+	/* .attribute_set = */ tcp_attribute_set,
+	/* .start =         */ tcp_start,
+	/* .stop =          */ tcp_stop,
+	/* .state_get =     */ tcp_state_get,
+	/* .restart =       */ tcp_restart,
+	/* .rx_dropped =    */ NULL,
+	/* .wakeup =        */ tcp_wakeup
+};
+
+static int64_t
+now_usec(void)
+{
+	int64_t sec, usec;
+
+	get_timestamp(&sec, &usec);
+	return sec * 1000000 + usec;
+}
+
+static void
+put_header(uint8_t *buf, uint8_t type, uint32_t length, uint64_t seq)
+{
+	uint16_t magic = htons(TCP_MSG_MAGIC);
+
+	length = htonl(length);
+	seq = htonll(seq);
+	memcpy(buf, &magic, sizeof(magic));
+	buf[2] = type;
+	buf[3] = TCP_MSG_VERSION;
+	memcpy(buf + 4, &length, sizeof(length));
+	memcpy(buf + 8, &seq, sizeof(seq));
+}
+
+static int
+get_header(const uint8_t *buf, uint8_t *type, uint32_t *length, uint64_t *seq)
+{
+	uint16_t magic;
+
+	memcpy(&magic, buf, sizeof(magic));
+	if (ntohs(magic) != TCP_MSG_MAGIC || buf[3] != TCP_MSG_VERSION)
+		return -1;
+
+	*type = buf[2];
+	memcpy(length, buf + 4, sizeof(*length));
+	*length = ntohl(*length);
+	memcpy(seq, buf + 8, sizeof(*seq));
+	*seq = htonll(*seq);
+
+	return 0;
+}
+
+static int
+write_all(int fd, const uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		int r = send(fd, (const char *) buf, len, MSG_NOSIGNAL);
+		if (r <= 0)
+			return -1;
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+
+static int
+read_all(int fd, uint8_t *buf, size_t len)
+{
+	while (len > 0) {
+		int r = recv(fd, (char *) buf, len, 0);
+		if (r <= 0)
+			return -1;
+		buf += r;
+		len -= r;
+	}
+	return 0;
+}
+
+/* Sends a HELLO or CREDIT message, m_tx_lock must be held */
+static int
+send_control(uint8_t type, uint64_t seq, uint32_t value)
+{
+	uint8_t buf[TCP_HEADER_SIZE + sizeof(uint32_t)];
+
+	put_header(buf, type, sizeof(uint32_t), seq);
+	value = htonl(value);
+	memcpy(buf + TCP_HEADER_SIZE, &value, sizeof(value));
+
+	return write_all(m_fd, buf, sizeof(buf));
+}
+
+/*
+ * Writes as many queued frames as the peer has granted credit for,
+ * m_tx_lock must be held.  On a write error the frames stay queued, they
+ * go out again once the connection is back.
+ */
+static int
+tcp_flush_locked(void)
+{
+	uint64_t n = m_tx_head - m_tx_sent;
+	unsigned slot, first;
+
+	if (n > m_tx_credit)
+		n = m_tx_credit;
+	if (n > TCP_BATCH_MAX)
+		n = TCP_BATCH_MAX;
+	if (n == 0 || m_fd < 0)
+		return 0;
+
+	/* The batch may wrap around the end of the ring */
+	slot = m_tx_sent % TCP_TX_RING;
+	first = (slot + n > TCP_TX_RING) ? TCP_TX_RING - slot : n;
+	memcpy(m_tx_buf + TCP_HEADER_SIZE, m_tx_ring + slot * TCP_FRAME_SIZE,
+	    first * TCP_FRAME_SIZE);
+	memcpy(m_tx_buf + TCP_HEADER_SIZE + first * TCP_FRAME_SIZE, m_tx_ring,
+	    (n - first) * TCP_FRAME_SIZE);
+
+	put_header(m_tx_buf, TCP_MSG_DATA, n * TCP_FRAME_SIZE, m_tx_sent + m_tx_delta);
+	if (write_all(m_fd, m_tx_buf, TCP_HEADER_SIZE + n * TCP_FRAME_SIZE) < 0)
+		return -1;
+
+	m_stats.tx_frames += n;
+	m_stats.tx_batches++;
+	m_tx_sent += n;
+	m_tx_credit -= n;
+	if (m_tx_head != m_tx_sent)
+		m_tx_first_usec = now_usec();
+
+	return n;
+}
+
+/* Releases the frames the peer has received up to seq, m_tx_lock must be held */
+static void
+tcp_ack_locked(uint64_t seq)
+{
+	uint64_t pos = seq - m_tx_delta;
+
+	if (pos - m_tx_tail <= m_tx_sent - m_tx_tail)
+		m_tx_tail = pos;
+}
+
+static int
+tcp_handshake(int skt)
+{
+	uint8_t buf[TCP_HEADER_SIZE + sizeof(uint32_t)];
+	uint8_t type;
+	uint32_t length, window;
+	uint64_t seq;
+
+	std::unique_lock<std::mutex> lock(m_tx_lock);
+	m_fd = skt;
+	if (send_control(TCP_MSG_HELLO, m_rx_seq, TCP_RX_WINDOW) < 0 ||
+	    read_all(skt, buf, sizeof(buf)) < 0 ||
+	    get_header(buf, &type, &length, &seq) < 0 ||
+	    type != TCP_MSG_HELLO || length != sizeof(uint32_t)) {
+		m_fd = -1;
+		return -1;
+	}
+
+	memcpy(&window, buf + TCP_HEADER_SIZE, sizeof(window));
+	seq -= m_tx_delta;
+	if (seq - m_tx_tail <= m_tx_sent - m_tx_tail) {
+		/* Resume with the first frame the server did not get */
+		m_stats.tx_resent += m_tx_sent - seq;
+		m_tx_sent = seq;
+	} else {
+		/* A server that lost its state: what it had in flight is gone */
+		m_stats.tx_dropped += m_tx_sent - m_tx_tail;
+		m_tx_delta += seq - m_tx_sent;
+	}
+	m_tx_tail = m_tx_sent;
+	m_tx_credit = ntohl(window);
+	m_rx_count = 0;
+	m_rx_pos = 0;
+	tcp_flush_locked();
+	m_tx_cond.notify_all();
+
+	return 0;
+}
+
+static int
+tcp_connect(void)
+{
+	const int nodelay = 1;
+	int skt;
+
+	skt = socket(AF_INET, SOCK_STREAM, 0);
+	if (skt < 0)
+		return skt;
+
+	setsockopt(skt, IPPROTO_TCP, TCP_NODELAY,
+	    (const char *) &nodelay, sizeof(nodelay));
+
+	if (connect(skt, (struct sockaddr *) &server_addr, sizeof(server_addr)) < 0 ||
+	    tcp_handshake(skt) < 0) {
+		closesocket(skt);
+		return -1;
+	}
+
+	return skt;
+}
+
+static int
+tcp_reconnect(void)
+{
+	uint32_t delay = 100;
+
+	if (m_fd >= 0) {
+		std::unique_lock<std::mutex> lock(m_tx_lock);
+		closesocket(m_fd);
+		m_fd = -1;
+	}
+	while (!m_closing && !m_wakeup.load() && m_reconnect_ms != 0) {
+		if (tcp_connect() >= 0) {
+			m_stats.reconnects++;
+			return 0;
+		}
+		usleep(delay * 1000);
+		delay = (delay * 2 > m_reconnect_ms) ? m_reconnect_ms : delay * 2;
+	}
+
+	return -1;
+}
+
+/*
+ * Waits for data from the server.  While transmit frames are queued the
+ * wait is bounded by the flush latency so they are never held back longer
+ * than requested.
+ */
+static int
+tcp_wait_readable(void)
+{
+	struct timeval tv;
+	fd_set rfds;
+	int64_t left = TCP_WAKEUP_MS * 1000;
+
+	{
+		std::unique_lock<std::mutex> lock(m_tx_lock);
+		if (m_tx_head != m_tx_sent && m_tx_credit != 0) {
+			left = m_tx_first_usec + m_flush_usec - now_usec();
+			if (left <= 0) {
+				tcp_flush_locked();
+				left = m_flush_usec;
+			}
+			if (left > TCP_WAKEUP_MS * 1000)
+				left = TCP_WAKEUP_MS * 1000;
+		}
+	}
+	tv.tv_sec = left / 1000000;
+	tv.tv_usec = left % 1000000;
+
+	FD_ZERO(&rfds);
+	FD_SET(m_fd, &rfds);
+
+	return select(m_fd + 1, &rfds, NULL, NULL, &tv);
+}
+
+/*
+ * Reads the next DATA batch into m_rx_buf, handling control messages on
+ * the way.  Returns the number of frames buffered, 0 on timeout or -1 when
+ * the connection is broken.
+ */
+static int
+tcp_read_batch(void)
+{
+	uint8_t hdr[TCP_HEADER_SIZE];
+	uint8_t type;
+	uint32_t length, value;
+	uint64_t seq;
+	unsigned n;
+	int r;
+
+	r = tcp_wait_readable();
+	if (r <= 0)
+		return r;
+
+	if (read_all(m_fd, hdr, sizeof(hdr)) < 0 ||
+	    get_header(hdr, &type, &length, &seq) < 0)
+		return -1;
+
+	switch (type) {
+	case TCP_MSG_DATA:
+		if (length == 0 || length > sizeof(m_rx_buf) ||
+		    length % TCP_FRAME_SIZE != 0)
+			return -1;
+		if (read_all(m_fd, m_rx_buf, length) < 0)
+			return -1;
+
+		n = length / TCP_FRAME_SIZE;
+		m_rx_count = n;
+		m_rx_pos = 0;
+		if (seq > m_rx_seq)
+			m_stats.rx_lost += seq - m_rx_seq;
+		else if (seq + n <= m_rx_seq)
+			m_rx_pos = n;
+		else
+			m_rx_pos = m_rx_seq - seq;
+		if (seq + n > m_rx_seq)
+			m_rx_seq = seq + n;
+		m_stats.rx_batches++;
+		return n;
+
+	case TCP_MSG_CREDIT:
+		if (length != sizeof(uint32_t) ||
+		    read_all(m_fd, (uint8_t *) &value, sizeof(value)) < 0)
+			return -1;
+		{
+			std::unique_lock<std::mutex> lock(m_tx_lock);
+			tcp_ack_locked(seq);
+			m_tx_credit += ntohl(value);
+			tcp_flush_locked();
+			m_tx_cond.notify_all();
+		}
+		return 0;
+
+	default:
+		/* Unknown or late HELLO: skip the payload */
+		while (length > 0) {
+			n = (length > sizeof(m_rx_buf)) ? sizeof(m_rx_buf) : length;
+			if (read_all(m_fd, m_rx_buf, n) < 0)
+				return -1;
+			length -= n;
+		}
+		return 0;
+	}
+}
+
+int
+tcp_create(const char *, unsigned)
+{
+	INIT_SOCKET;
+	memset(&server_addr, 0, sizeof(server_addr));
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_addr.s_addr = inet_addr(server_ipstr);
+	server_addr.sin_port = htons(server_port);
+
+	m_closing = false;
+	/* Stale from the last session otherwise */
+	m_wakeup.store(false);
+	m_rx_seq = 0;
+	m_tx_tail = m_tx_sent = m_tx_head = 0;
+	m_tx_delta = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	/*
+	 * The descriptor handed out identifies the connection: the socket
+	 * underneath it is replaced transparently on reconnection.
+	 */
+	m_handle = tcp_connect();
+
+	return m_handle;
+}
+
+int
+tcp_destroy(int)
+{
+	int r = 0;
+
+	m_closing = true;
+	std::unique_lock<std::mutex> lock(m_tx_lock);
+	if (m_fd >= 0) {
+		tcp_flush_locked();
+		shutdown(m_fd, SHUT_RDWR);
+		r = closesocket(m_fd);
+		m_fd = -1;
+	}
+	m_handle = -1;
+	m_tx_cond.notify_all();
+	CLEANUP_SOCKET;
+
+	return r;
+}
+
+int
+tcp_send(int, unsigned id, uint8_t dlc, void *data)
+{
+	uint8_t *rec;
+	uint32_t id32;
+	int64_t sec, usec;
+	uint64_t sec64;
+	uint32_t usec32;
+
+	if (dlc > 8)
+		return -1;
+
+	std::unique_lock<std::mutex> lock(m_tx_lock);
+	if (m_tx_head - m_tx_tail == TCP_TX_RING) {
+		tcp_flush_locked();
+		/* Room comes back only when the server acknowledges frames */
+		while (m_tx_head - m_tx_tail == TCP_TX_RING) {
+			if (m_overflow == TCP_OVERFLOW_DROP || m_closing) {
+				m_stats.tx_dropped++;
+				return 0;
+			}
+			m_tx_cond.wait_for(lock, std::chrono::milliseconds(100));
+		}
+	}
+
+	get_timestamp(&sec, &usec);
+	rec = m_tx_ring + (m_tx_head % TCP_TX_RING) * TCP_FRAME_SIZE;
+	id32 = htonl(id);
+	sec64 = htonll(sec);
+	usec32 = htonl(usec);
+	memcpy(rec, &id32, sizeof(id32));
+	rec[4] = dlc;
+	rec[5] = DIRECTION_TX;
+	memset(rec + 6, 0, 8);
+	if (dlc != 0)
+		memcpy(rec + 6, data, dlc);
+	memcpy(rec + 14, &sec64, sizeof(sec64));
+	memcpy(rec + 22, &usec32, sizeof(usec32));
+
+	if (m_tx_head++ == m_tx_sent)
+		m_tx_first_usec = sec * 1000000 + usec;
+
+	if (m_flush_usec == 0 || m_tx_head - m_tx_sent >= TCP_BATCH_MAX ||
+	    sec * 1000000 + usec - m_tx_first_usec >= m_flush_usec)
+		tcp_flush_locked();
+
+	return TCP_FRAME_SIZE;
+}
+
+int
+tcp_recv(int, unsigned *id, uint8_t *dlc, void *data,
+    int64_t *sec, int64_t *usec)
+{
+	const uint8_t *rec;
+	uint32_t id32;
+	uint64_t sec64;
+	uint32_t usec32;
+	unsigned consumed;
+	int r;
+
+	while (m_rx_pos >= m_rx_count) {
+		if (m_rx_count != 0) {
+			consumed = m_rx_count;
+			m_rx_count = 0;
+			m_rx_pos = 0;
+			std::unique_lock<std::mutex> lock(m_tx_lock);
+			send_control(TCP_MSG_CREDIT, m_rx_seq, consumed);
+		}
+		if (m_closing)
+			return -1;
+		if (m_wakeup.exchange(false))
+			return 0;
+
+		r = (m_fd >= 0) ? tcp_read_batch() : -1;
+		if (r < 0 && tcp_reconnect() < 0)
+			return m_wakeup.exchange(false) ? 0 : -1;
+	}
+
+	rec = m_rx_buf + m_rx_pos * TCP_FRAME_SIZE;
+	memcpy(&id32, rec, sizeof(id32));
+	memcpy(&sec64, rec + 14, sizeof(sec64));
+	memcpy(&usec32, rec + 22, sizeof(usec32));
+	if (rec[4] > 8)
+		return -1;
+
+	*id = ntohl(id32);
+	*dlc = rec[4];
+	memcpy(data, rec + 6, 8);
+	if (sec != NULL)
+		*sec = htonll(sec64);
+	if (usec != NULL)
+		*usec = ntohl(usec32);
+
+	m_rx_pos++;
+	m_stats.rx_frames++;
+
+	return 1;
+}
+
+int
+tcp_bitrate_set(const char *, unsigned)
+{
+	return 0;
+}
+
+int
+tcp_attribute_set(unsigned attribute, const void *value, unsigned value_len)
+{
+	switch (attribute) {
+	case TCP_SOCKET_ADDR:
+		if (value_len >= sizeof(server_ipstr))
+			return -1;
+		memcpy(server_ipstr, value, value_len);
+		server_ipstr[value_len] = '\0';
+		break;
+
+	case TCP_SOCKET_PORT:
+		if (value_len != sizeof(uint16_t))
+			return -1;
+
+		server_port = *((uint16_t *)value);
+		break;
+
+	case TCP_SOCKET_FLUSH_USEC:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+
+		m_flush_usec = *((uint32_t *)value);
+		break;
+
+	case TCP_SOCKET_OVERFLOW:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+
+		m_overflow = *((uint32_t *)value);
+		break;
+
+	case TCP_SOCKET_RECONNECT_MS:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+
+		m_reconnect_ms = *((uint32_t *)value);
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+int
+tcp_start(const char *)
+{
+	return 0;
+}
+
+int
+tcp_stop(const char *)
+{
+	std::unique_lock<std::mutex> lock(m_tx_lock);
+	tcp_flush_locked();
+	return 0;
+}
+
+int
+tcp_restart(const char *)
+{
+	return 0;
+}
+
+int
+tcp_wakeup(int)
+{
+	m_wakeup.store(true);
+	return 0;
+}
+
+int
+tcp_state_get(const char *, qcan_state_t *status)
+{
+	/* No controller behind it */
+	*status = QCAN_STATE_UNKNOWN;
+	return 0;
+}
+
+int
+tcp_stats_get(tcp_stats_t *stats)
+{
+	std::unique_lock<std::mutex> lock(m_tx_lock);
+
+	*stats = m_stats;
+	stats->tx_credit = m_tx_credit;
+	stats->tx_queued = m_tx_head - m_tx_sent;
+
+	return 0;
+}
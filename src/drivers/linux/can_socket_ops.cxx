@@ -24,15 +24,24 @@
 
 #include "canbus/can_drv.h"
 #include "canbus/can_state.h"
+#include "drivers/can_socket_ops.h"
+#ifdef HAVE_LIBURING
+#include "drivers/can_socket_uring.h"
+#endif
 
 #include <sys/socket.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+#include <time.h>
 #include <string.h>
 #include <libsocketcan.h>
 #include <unistd.h>
+#include <stdio.h>
 
 #ifndef PF_CAN
 #define PF_CAN 29
@@ -42,6 +51,10 @@
 #define AF_CAN PF_CAN
 #endif
 
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+
 
 static int can_socket_create(const char *dev, unsigned bitrate);
 static int can_socket_destroy(int fd);
@@ -54,6 +67,8 @@ static int can_socket_start(const char *device);
 static int can_socket_stop(const char *device);
 static int can_socket_state_get(const char *device, qcan_state_t *status);
 static int can_socket_restart(const char *device);
+static int can_socket_rx_dropped(int fd, uint32_t *dropped);
+static int can_socket_wakeup(int fd);
 
 
 can_ops_t can_socket_ops = {
@@ -66,21 +81,159 @@ can_ops_t can_socket_ops = {
 	.start = can_socket_start,
 	.stop = can_socket_stop,
 	.state_get = can_socket_state_get,
-	.restart = can_socket_restart
+	.restart = can_socket_restart,
+	.rx_dropped = can_socket_rx_dropped,
+	.wakeup = can_socket_wakeup
 };
 
 
 static struct sockaddr_can canaddr;
+/* Last SO_RXQ_OVFL count of the socket */
+static uint32_t rx_dropped;
+static uint32_t rcvbuf;
+/* Low latency receive, see CAN_SOCKET_BUSY_POLL */
+static uint32_t busy_poll;
+static uint32_t spin_usec;
+static int epfd = -1;
+/* Written by can_socket_wakeup(), waited on with the socket */
+static int wakefd = -1;
+static uint32_t use_uring;
+
+static void
+can_socket_set_rcvbuf(int skt, uint32_t size)
+{
+	int value = (int) size, actual = 0;
+	socklen_t len = sizeof(actual);
+
+	if (setsockopt(skt, SOL_SOCKET, SO_RCVBUFFORCE, &value, sizeof(value)) < 0)
+		setsockopt(skt, SOL_SOCKET, SO_RCVBUF, &value, sizeof(value));
+
+	/* The kernel reports twice the size asked, for its bookkeeping */
+	if (getsockopt(skt, SOL_SOCKET, SO_RCVBUF, &actual, &len) == 0 &&
+	    (uint32_t) actual / 2 < size)
+		fprintf(stderr, "Receive buffer limited to %d bytes, raise "
+		    "net.core.rmem_max or run with CAP_NET_ADMIN\n", actual / 2);
+}
+
+static void
+can_socket_poll_close(void)
+{
+	if (epfd >= 0) {
+		close(epfd);
+		epfd = -1;
+	}
+	if (wakefd >= 0) {
+		close(wakefd);
+		wakefd = -1;
+	}
+}
+
+static int
+can_socket_poll_setup(int skt)
+{
+	struct epoll_event ev;
+	int value = (int) busy_poll;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	/* Nonblocking: a wakeup already taken must not stall the reader */
+	wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (epfd < 0 || wakefd < 0)
+		return -1;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = skt;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, skt, &ev) < 0)
+		return -1;
+	ev.data.fd = wakefd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev) < 0)
+		return -1;
+
+	/* Only helps devices with NAPI polling, the spinning below does the rest */
+	if (busy_poll != 0)
+		setsockopt(skt, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value));
+	spin_usec = busy_poll;
+
+	return 0;
+}
+
+static inline void
+cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+static uint64_t
+monotonic_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ * Polls the socket for up to spin_usec, then blocks.  A frame caught
+ * while polling doubles the period up to busy_poll, a poll that ran out
+ * halves it, so a bus that goes quiet stops burning a core.  Returns 0
+ * without a frame when woken up by can_socket_wakeup().
+ */
+static int
+can_socket_recvmsg(int fd, struct msghdr *msg)
+{
+	struct epoll_event ev[2];
+	uint64_t start, value;
+	int r;
+
+	start = (spin_usec != 0) ? monotonic_usec() : 0;
+	for (;;) {
+		r = recvmsg(fd, msg, MSG_DONTWAIT);
+		if (r >= 0) {
+			if (start != 0 && spin_usec < busy_poll)
+				spin_usec = (spin_usec * 2 < busy_poll) ? spin_usec * 2 : busy_poll;
+			return r;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return r;
+
+		if (start != 0 && monotonic_usec() - start < spin_usec) {
+			cpu_relax();
+			continue;
+		}
+		if (start != 0 && spin_usec > CAN_SOCKET_SPIN_MIN)
+			spin_usec = (spin_usec / 2 > CAN_SOCKET_SPIN_MIN) ? spin_usec / 2 :
+			    CAN_SOCKET_SPIN_MIN;
+
+		/* Idle: block until the next frame, it is read without polling */
+		start = 0;
+		r = epoll_wait(epfd, ev, 2, -1);
+		if (r < 0 && errno != EINTR)
+			return r;
+		for (int i = 0; i < r; i++) {
+			if (ev[i].data.fd != wakefd)
+				continue;
+			if (read(wakefd, &value, sizeof(value)) == sizeof(value))
+				return 0;
+			if (errno != EAGAIN)
+				return -1;
+		}
+	}
+}
 
 int
 can_socket_create(const char *dev, unsigned)
 {
 	int skt;
 	int r;
-	can_err_mask_t err_mask = 0U;
+	can_err_mask_t err_mask = CAN_ERR_MASK;
 	struct can_filter filter;
 	struct ifreq ifr;
 	const int timestamp_on = 1;
+	const int rxq_ovfl_on = 1;
 
 
 	skt = socket(AF_CAN, SOCK_RAW, CAN_RAW);
@@ -95,6 +248,7 @@ can_socket_create(const char *dev, unsigned)
 	canaddr.can_family = AF_CAN;
 	canaddr.can_ifindex = ifr.ifr_ifindex;
 
+	/* Error frames come with the data, decoded by the error analyzer */
 	setsockopt(skt, SOL_CAN_RAW, CAN_RAW_ERR_FILTER,
 	    &err_mask, sizeof(err_mask));
 
@@ -106,13 +260,31 @@ can_socket_create(const char *dev, unsigned)
 	setsockopt(skt, SOL_SOCKET, SO_TIMESTAMP,
 	    &timestamp_on, sizeof(timestamp_on));
 
+	if (rcvbuf != 0)
+		can_socket_set_rcvbuf(skt, rcvbuf);
+
+	/* Frames lost for a full receive queue come with the next frame */
+	rx_dropped = 0;
+	setsockopt(skt, SOL_SOCKET, SO_RXQ_OVFL,
+	    &rxq_ovfl_on, sizeof(rxq_ovfl_on));
+
 	r = bind(skt, (struct sockaddr *) &canaddr, sizeof(canaddr));
 	if (r < 0)
 		goto exit_error;
 
+	/* Also kept with io_uring, the plain calls take over without it */
+	r = can_socket_poll_setup(skt);
+	if (r < 0)
+		goto exit_error;
+#ifdef HAVE_LIBURING
+	if (use_uring)
+		can_uring_open(skt, wakefd);
+#endif
+
 	return skt;
 
 exit_error:
+	can_socket_poll_close();
 	close(skt);
 	return r;
 }
@@ -120,6 +292,11 @@ exit_error:
 int
 can_socket_destroy(int fd)
 {
+#ifdef HAVE_LIBURING
+	can_uring_close();
+#endif
+	can_socket_poll_close();
+
 	return close(fd);
 }
 
@@ -136,22 +313,20 @@ can_socket_send(int fd, unsigned id, uint8_t dlc, void *data)
 		memcpy(frame.data, data, dlc);
 	frame.can_dlc = dlc;
 
+	/* Also with io_uring, so frames leave in order with their own error */
 	return write(fd, &frame, sizeof(frame));
 }
 
-int
-can_socket_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
-    int64_t *sec, int64_t *usec)
+static int
+can_socket_read(int fd, struct can_frame *frame, struct timeval *tv)
 {
-	struct can_frame frame;
 	struct iovec iov;
 	struct msghdr msg;
 	struct cmsghdr *cmsg;
 	char ctrlmsg[CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(__u32))];
-	struct timeval tv = { 0, 0};
 
-	iov.iov_base = &frame;
-	iov.iov_len = sizeof(frame);
+	iov.iov_base = frame;
+	iov.iov_len = sizeof(*frame);
 	msg.msg_name = &canaddr;
 	msg.msg_namelen = sizeof(canaddr);
 	msg.msg_iov = &iov;
@@ -159,17 +334,39 @@ can_socket_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
 	msg.msg_control = &ctrlmsg;
 	msg.msg_controllen = sizeof(ctrlmsg);
 	msg.msg_flags = 0;
-	int r = recvmsg(fd, &msg, 0);
+	int r = can_socket_recvmsg(fd, &msg);
 	if (r <= 0)
 		return r;
 	for (cmsg = CMSG_FIRSTHDR(&msg);
 	    cmsg && (cmsg->cmsg_level == SOL_SOCKET);
 	    cmsg = CMSG_NXTHDR(&msg,cmsg)) {
 		if (cmsg->cmsg_type == SO_TIMESTAMP)
-			tv = *(struct timeval *)CMSG_DATA(cmsg);
-
+			*tv = *(struct timeval *)CMSG_DATA(cmsg);
+		else if (cmsg->cmsg_type == SO_RXQ_OVFL)
+			memcpy(&rx_dropped, CMSG_DATA(cmsg), sizeof(rx_dropped));
 	}
 
+	return r;
+}
+
+int
+can_socket_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
+    int64_t *sec, int64_t *usec)
+{
+	struct can_frame frame;
+	struct timeval tv = { 0, 0 };
+	int r = 0;
+
+#ifdef HAVE_LIBURING
+	if (can_uring_active())
+		r = can_uring_recv(&frame, &tv, &rx_dropped);
+	/* Turned off when the kernel can't receive through io_uring */
+	if (!can_uring_active())
+#endif
+		r = can_socket_read(fd, &frame, &tv);
+	if (r <= 0)
+		return r;
+
 	*id = frame.can_id;
 	if (frame.can_dlc > 8)
 		return -1;
@@ -194,8 +391,31 @@ can_socket_bitrate_set(const char *device, unsigned bitrate)
 }
 
 int
-can_socket_attribute_set(unsigned, const void *, unsigned)
+can_socket_attribute_set(unsigned attribute, const void *value, unsigned value_len)
 {
+	switch (attribute) {
+	case CAN_SOCKET_RCVBUF:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+		memcpy(&rcvbuf, value, sizeof(uint32_t));
+		break;
+
+	case CAN_SOCKET_BUSY_POLL:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+		memcpy(&busy_poll, value, sizeof(uint32_t));
+		break;
+
+	case CAN_SOCKET_URING:
+		if (value_len != sizeof(uint32_t))
+			return -1;
+		memcpy(&use_uring, value, sizeof(uint32_t));
+		break;
+
+	default:
+		break;
+	}
+
 	return 0;
 }
 
@@ -253,3 +473,21 @@ can_socket_state_get(const char *device, qcan_state_t *status)
 	return r;
 }
 
+
+int
+can_socket_rx_dropped(int, uint32_t *dropped)
+{
+	*dropped = rx_dropped;
+	return 0;
+}
+
+int
+can_socket_wakeup(int)
+{
+	uint64_t value = 1;
+
+	if (wakefd < 0)
+		return -1;
+
+	return (write(wakefd, &value, sizeof(value)) == sizeof(value)) ? 0 : -1;
+}
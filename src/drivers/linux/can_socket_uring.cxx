@@ -0,0 +1,280 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "drivers/can_socket_uring.h"
+
+#include <liburing.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define RX_BGID         1
+/* User data of the receive ring completions */
+#define RX_RECV         0
+#define RX_WAKEUP       1
+
+/* Layout of a provided buffer, as the kernel fills it */
+#define RX_NAME_LEN     sizeof(struct sockaddr_can)
+#define RX_CTRL_LEN     (CMSG_SPACE(sizeof(struct timeval)) + CMSG_SPACE(sizeof(uint32_t)))
+#define RX_BUF_SIZE     (sizeof(struct io_uring_recvmsg_out) + RX_NAME_LEN + \
+                         RX_CTRL_LEN + sizeof(struct can_frame))
+
+static int active;
+static int sock = -1;
+static int wake = -1;
+
+/* Receive, only touched by the receive thread after can_uring_open() */
+static struct io_uring rx_ring;
+static struct io_uring_buf_ring *rx_bufs;
+static unsigned char *rx_mem;
+static struct msghdr rx_msg;
+static int rx_armed;
+static unsigned rx_frames;
+static struct io_uring_cqe *rx_cqes[CAN_URING_BATCH];
+static unsigned rx_next;
+static unsigned rx_count;
+
+static void
+rx_recycle(unsigned bid)
+{
+	io_uring_buf_ring_add(rx_bufs, rx_mem + (size_t) bid * RX_BUF_SIZE, RX_BUF_SIZE,
+	    bid, io_uring_buf_ring_mask(CAN_URING_BUFS), 0);
+	io_uring_buf_ring_advance(rx_bufs, 1);
+}
+
+/* One request keeps receiving until the kernel runs out of buffers */
+static int
+rx_arm(void)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&rx_ring);
+	if (sqe == NULL)
+		return -1;
+	io_uring_prep_recvmsg_multishot(sqe, sock, &rx_msg, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = RX_BGID;
+	io_uring_sqe_set_data64(sqe, RX_RECV);
+	rx_armed = 1;
+
+	return 0;
+}
+
+/*
+ * Polling the wakeup eventfd completes the wait of can_uring_recv(), the
+ * eventfd is then read directly.  A read request would fail with EAGAIN
+ * on the nonblocking eventfd instead of waiting.
+ */
+static int
+rx_wake_arm(void)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&rx_ring);
+	if (sqe == NULL)
+		return -1;
+	io_uring_prep_poll_add(sqe, wake, POLLIN);
+	io_uring_sqe_set_data64(sqe, RX_WAKEUP);
+
+	return 0;
+}
+
+/* The receive ring goes with its buffers, cancelling its requests */
+static void
+rx_close(void)
+{
+	if (rx_mem == NULL)
+		return;
+
+	io_uring_free_buf_ring(&rx_ring, rx_bufs, CAN_URING_BUFS, RX_BGID);
+	io_uring_queue_exit(&rx_ring);
+	free(rx_mem);
+	rx_mem = NULL;
+	rx_bufs = NULL;
+}
+
+int
+can_uring_open(int fd, int wakefd)
+{
+	int r;
+
+	if (io_uring_queue_init(CAN_URING_BATCH * 2, &rx_ring, 0) < 0)
+		return -1;
+
+	rx_bufs = io_uring_setup_buf_ring(&rx_ring, CAN_URING_BUFS, RX_BGID, 0, &r);
+	if (rx_bufs == NULL)
+		goto exit_rx;
+	rx_mem = (unsigned char *) malloc(CAN_URING_BUFS * RX_BUF_SIZE);
+	if (rx_mem == NULL)
+		goto exit_bufs;
+	memset(rx_mem, 0, CAN_URING_BUFS * RX_BUF_SIZE);
+	for (unsigned bid = 0; bid < CAN_URING_BUFS; bid++)
+		rx_recycle(bid);
+
+	/* Only the lengths matter, they lay out every buffer */
+	memset(&rx_msg, 0, sizeof(rx_msg));
+	rx_msg.msg_namelen = RX_NAME_LEN;
+	rx_msg.msg_controllen = RX_CTRL_LEN;
+
+	sock = fd;
+	wake = wakefd;
+	rx_wake_arm();
+	rx_armed = 0;
+	rx_frames = 0;
+	rx_next = rx_count = 0;
+	active = 1;
+
+	return 0;
+
+exit_bufs:
+	io_uring_free_buf_ring(&rx_ring, rx_bufs, CAN_URING_BUFS, RX_BGID);
+	rx_bufs = NULL;
+exit_rx:
+	io_uring_queue_exit(&rx_ring);
+	return -1;
+}
+
+void
+can_uring_close(void)
+{
+	if (sock < 0)
+		return;
+
+	/* Exiting the ring cancels the pending requests */
+	rx_close();
+	sock = -1;
+	wake = -1;
+	active = 0;
+}
+
+int
+can_uring_active(void)
+{
+	return active;
+}
+
+/* Copies the frame of a completion out, returns its size or -1 */
+static int
+rx_frame(struct io_uring_cqe *cqe, struct can_frame *frame, struct timeval *tv,
+    uint32_t *dropped)
+{
+	struct io_uring_recvmsg_out *out;
+	struct cmsghdr *cmsg;
+	unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+	int r = -1;
+
+	out = io_uring_recvmsg_validate(rx_mem + (size_t) bid * RX_BUF_SIZE, cqe->res, &rx_msg);
+	if (out != NULL &&
+	    io_uring_recvmsg_payload_length(out, cqe->res, &rx_msg) == sizeof(*frame)) {
+		memcpy(frame, io_uring_recvmsg_payload(out, &rx_msg), sizeof(*frame));
+		for (cmsg = io_uring_recvmsg_cmsg_firsthdr(out, &rx_msg); cmsg != NULL;
+		    cmsg = io_uring_recvmsg_cmsg_nexthdr(out, &rx_msg, cmsg)) {
+			if (cmsg->cmsg_level != SOL_SOCKET)
+				continue;
+			if (cmsg->cmsg_type == SO_TIMESTAMP)
+				memcpy(tv, CMSG_DATA(cmsg), sizeof(*tv));
+			else if (cmsg->cmsg_type == SO_RXQ_OVFL && dropped != NULL)
+				memcpy(dropped, CMSG_DATA(cmsg), sizeof(*dropped));
+		}
+		r = sizeof(*frame);
+	}
+	rx_recycle(bid);
+
+	return r;
+}
+
+int
+can_uring_recv(struct can_frame *frame, struct timeval *tv, uint32_t *dropped)
+{
+	struct io_uring_cqe *cqe;
+	uint64_t value;
+	int r;
+
+	for (;;) {
+		if (rx_next == rx_count) {
+			io_uring_cq_advance(&rx_ring, rx_count);
+			rx_next = rx_count = 0;
+			if (!rx_armed) {
+				if (rx_arm() < 0)
+					return -1;
+				io_uring_submit(&rx_ring);
+			}
+			/* Sleeps only when nothing is ready */
+			rx_count = io_uring_peek_batch_cqe(&rx_ring, rx_cqes, CAN_URING_BATCH);
+			if (rx_count == 0) {
+				r = io_uring_submit_and_wait(&rx_ring, 1);
+				if (r < 0 && r != -EINTR) {
+					errno = -r;
+					return -1;
+				}
+				rx_count = io_uring_peek_batch_cqe(&rx_ring, rx_cqes,
+				    CAN_URING_BATCH);
+				continue;
+			}
+		}
+
+		cqe = rx_cqes[rx_next++];
+		if (io_uring_cqe_get_data64(cqe) == RX_WAKEUP) {
+			rx_wake_arm();
+			io_uring_submit(&rx_ring);
+			/* Taken already, the poll saw an old write */
+			if (read(wake, &value, sizeof(value)) != sizeof(value))
+				continue;
+			return 0;
+		}
+		if (!(cqe->flags & IORING_CQE_F_MORE))
+			rx_armed = 0;
+
+		if (cqe->res < 0) {
+			/* Out of buffers ends the request, it is armed again */
+			if (cqe->res == -ENOBUFS)
+				continue;
+			if (cqe->res == -EINVAL && rx_frames == 0) {
+				/*
+				 * No multishot recvmsg, before Linux 6.0.  The wakeup
+				 * poll must not outlive the ring, epoll waits from now.
+				 */
+				rx_next = rx_count = 0;
+				rx_close();
+				active = 0;
+				return 0;
+			}
+			errno = -cqe->res;
+			return -1;
+		}
+
+		if (!(cqe->flags & IORING_CQE_F_BUFFER))
+			continue;
+		r = rx_frame(cqe, frame, tv, dropped);
+		if (r > 0) {
+			rx_frames++;
+			return r;
+		}
+	}
+}
@@ -32,6 +32,8 @@
 #include <QModelIndex>
 #include <QTime>
 #include <QDebug>
+#include <QStringList>
+#include <QRegExp>
 
 
 
@@ -40,6 +42,9 @@ logModel::logModel(QObject *parent)
 {
 	m_enable = true;
 	m_hexLayout = true;
+	m_dbc = NULL;
+	m_inserted = QMetrics::instance()->counter("model.inserted");
+	m_discarded = QMetrics::instance()->counter("model.discarded");
 }
 
 logModel::~logModel()
@@ -56,6 +61,11 @@ void logModel::setHexLayout(bool enable)
 	m_hexLayout = enable;
 }
 
+void logModel::setDatabase(const dbc_db_t *db)
+{
+	m_dbc = db;
+}
+
 void logModel::messageEnqueued(can_packet_t canpack)
 {
 	can_str_packet_t str_canpck;
@@ -64,6 +74,7 @@ void logModel::messageEnqueued(can_packet_t canpack)
 	static int64_t msec;
 
 	if (! m_enable) {
+		m_discarded->add();
 		return;
 	}
 
@@ -107,7 +118,72 @@ void logModel::messageEnqueued(can_packet_t canpack)
 			str_canpck.data += tok.sprintf("%c ", canpack.data[i]).toUpper();
 	}
 	str_canpck.direction = (canpack.direction == DIRECTION_RX) ? "Rx" : "Tx";
+
+	if (m_dbc != NULL) {
+		const dbc_message_t *msg;
+		double values[DBC_DECODE_MAX];
+		uint8_t present[DBC_DECODE_MAX];
+		int n;
+
+		n = dbc_decode(m_dbc, &canpack, values, present, DBC_DECODE_MAX, &msg);
+		for (int i = 0; i < n && i < DBC_DECODE_MAX; i++) {
+			const dbc_signal_info_t *info = &m_dbc->info[msg->first_signal + i];
+
+			if (!present[i])
+				continue;
+			str_canpck.decoded += QString("%1=%2%3 ").arg(info->name)
+			    .arg(values[i]).arg(info->unit);
+		}
+	}
+
 	beginInsertRows(QModelIndex(), 0, 0);
 	msgList.push_front(str_canpck);
 	endInsertRows();
+	m_inserted->add();
+}
+
+void logModel::markerEnqueued(const QString &text)
+{
+	can_str_packet_t str_canpck;
+
+	if (! m_enable) {
+		return;
+	}
+
+	str_canpck.id = "----";
+	str_canpck.flags = "Mark";
+	str_canpck.timestamp = QTime::currentTime().toString("hh:mm:ss.zzz");
+	str_canpck.data = text;
+	beginInsertRows(QModelIndex(), 0, 0);
+	msgList.push_front(str_canpck);
+	endInsertRows();
+}
+
+can_packet_t logModel::parseLine(const QString &line)
+{
+	can_packet_t ret;
+	unsigned col;
+
+	QStringList list = line.split(" ", QString::SkipEmptyParts);
+	col = 0;
+	foreach (QString token, list) {
+		if (col == 0)
+			ret.id = token.toUInt(NULL, 16);
+		else if (col == 1) {
+			token.replace(QRegExp( "[" + QRegExp::escape( "[]" ) + "]" ), "");
+			ret.dlc = token.toUInt();
+		} else if (col < ret.dlc + 1U) {
+			ret.data[col - 1] = token.toLongLong(NULL, 16);
+		} else if (col == ret.dlc + 1U) {
+			//TODO: Add support extended packet
+		} else if (col == ret.dlc + 3U) {
+			token = token.right(token.length() -2);
+			QDateTime d =  QDateTime::fromString(token, QString("hh:mm:ss.zzz"));
+			ret.tv_sec = d.toMSecsSinceEpoch() / 1000;
+			ret.tv_usec = (d.toMSecsSinceEpoch() % 1000) * 1000.0;
+		}
+		col++;
+	}
+
+	return ret;
 }
@@ -0,0 +1,145 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qcanheadless.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+
+#include <stdio.h>
+
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QCommandLineParser parser;
+	headless_options_t options;
+	QString error;
+
+	a.setApplicationName("canspy-cli");
+	a.setApplicationVersion(VERSION);
+	parser.setApplicationDescription("Headless CAN capture, replay and statistics");
+	parser.addHelpOption();
+	parser.addVersionOption();
+
+	QCommandLineOption optDriver(QStringList() << "d" << "driver",
+	                             "Driver: socketcan, tcp, udp, sim or gen.", "driver", "socketcan");
+	QCommandLineOption optDevice(QStringList() << "i" << "device",
+	                             "Interface, host:port, simulation file or generator spec.", "device", "can0");
+	QCommandLineOption optBitrate(QStringList() << "b" << "bitrate",
+	                              "Bitrate in bit/s, also used for the bus load.", "bitrate", "0");
+	QCommandLineOption optWrite(QStringList() << "w" << "write",
+	                            "Write the frames received to a raw capture.", "file");
+	QCommandLineOption optReplay(QStringList() << "r" << "replay",
+	                             "Send the frames of a raw capture.", "file");
+	QCommandLineOption optFilter(QStringList() << "f" << "filter",
+	                             "Accepted IDs, \"id[:mask],...\" in hex.", "rules");
+	QCommandLineOption optSpeed("speed", "Replay time scale, 0 for as fast as possible.",
+	                            "factor", "1");
+	QCommandLineOption optLoops("loops", "Replay loops, 0 until stopped.", "count", "1");
+	QCommandLineOption optStats(QStringList() << "s" << "stats",
+	                            "Print statistics every n seconds.", "n", "1");
+	QCommandLineOption optDuration(QStringList() << "t" << "duration",
+	                               "Stop after n seconds.", "n", "0");
+	QCommandLineOption optRcvBuf("rcvbuf", "Socket receive buffer in bytes (socketcan).",
+	                             "bytes", "0");
+	QCommandLineOption optBusyPoll("busy-poll",
+	                               "Poll the socket for up to usec before blocking (socketcan).",
+	                               "usec", "0");
+	QCommandLineOption optUring("io-uring",
+	                            "Receive through io_uring when available (socketcan).");
+	QCommandLineOption optMetrics("metrics", "Write the pipeline metrics as JSON at exit.",
+	                              "file");
+	QCommandLineOption optListen("metrics-listen",
+	                             "Serve the metrics on GET /metrics, \"[host:]port\" or \"unix:path\".",
+	                             "address");
+
+	QCommandLineOption optSched("sched",
+	                            "Receive thread policy, \"fifo[:priority]\", \"rr[:priority]\" or \"other\".",
+	                            "policy", "other");
+	QCommandLineOption optCpus("cpus", "CPUs of the receive, transmit and writer threads.",
+	                           "recv[,transmit[,writer]]");
+	QCommandLineOption optMlock("mlock", "Lock the process memory.");
+
+	parser.addOption(optDriver);
+	parser.addOption(optDevice);
+	parser.addOption(optBitrate);
+	parser.addOption(optWrite);
+	parser.addOption(optReplay);
+	parser.addOption(optFilter);
+	parser.addOption(optSpeed);
+	parser.addOption(optLoops);
+	parser.addOption(optStats);
+	parser.addOption(optDuration);
+	parser.addOption(optRcvBuf);
+	parser.addOption(optBusyPoll);
+	parser.addOption(optUring);
+	parser.addOption(optMetrics);
+	parser.addOption(optListen);
+	parser.addOption(optSched);
+	parser.addOption(optCpus);
+	parser.addOption(optMlock);
+	parser.process(a);
+
+	options.driver = parser.value(optDriver);
+	options.device = parser.value(optDevice);
+	options.bitrate = parser.value(optBitrate).toUInt();
+	options.rcvbuf = parser.value(optRcvBuf).toUInt();
+	options.busy_poll = parser.value(optBusyPoll).toUInt();
+	options.uring = parser.isSet(optUring) ? 1 : 0;
+	options.capture = parser.value(optWrite);
+	options.replay = parser.value(optReplay);
+	options.speed = parser.value(optSpeed).toDouble();
+	options.loops = parser.value(optLoops).toUInt();
+	options.stats_sec = parser.value(optStats).toUInt();
+	options.duration_sec = parser.value(optDuration).toUInt();
+	options.metrics = parser.value(optMetrics);
+	options.metrics_listen = parser.value(optListen);
+	if (!QRealtime::parsePolicy(parser.value(optSched), options.realtime)) {
+		fprintf(stderr, "Invalid policy %s\n", qPrintable(parser.value(optSched)));
+		return 1;
+	}
+	if (!QRealtime::parseCpus(parser.value(optCpus), options.realtime)) {
+		fprintf(stderr, "Invalid CPUs %s\n", qPrintable(parser.value(optCpus)));
+		return 1;
+	}
+	options.realtime.lock_memory = parser.isSet(optMlock);
+	if (idfilter_parse(&options.filter,
+	    parser.value(optFilter).toLatin1().constData()) < 0) {
+		fprintf(stderr, "Invalid filter %s\n", qPrintable(parser.value(optFilter)));
+		return 1;
+	}
+
+	QCanHeadless::installSignalHandlers();
+	QCanHeadless headless(options);
+	if (!headless.start(error)) {
+		fprintf(stderr, "%s\n", qPrintable(error));
+		return 1;
+	}
+
+	return a.exec();
+}
@@ -29,7 +29,13 @@
 #include "canbus/can_drv.h"
 #include "drivers/can_socket_ops.h"
 #include "drivers/net_ops.h"
+#include "drivers/tcp_ops.h"
 #include "msgseq.h"
+#include "qprotocolview.h"
+#include "qheatmapview.h"
+#include "qdiagnosticsview.h"
+#include "qisotpdialog.h"
+#include "trigger.h"
 #include "utils.h"
 
 
@@ -40,13 +46,20 @@
 #include <QFileDialog>
 #include <QMapIterator>
 #include <QInputDialog>
+#include <QProcess>
+
+#include <signal.h>
+#include <string.h>
 
 
 MainWindow::MainWindow(QWidget *parent) :
 	QMainWindow(parent),
-	ui(new Ui::MainWindow)
+	ui(new Ui::MainWindow),
+	m_drops("QCanMonitor")
 {
 	QHeaderView *hdr;
+	QString temp;
+	QRealtime::options_t rt;
 
 	ui->setupUi(this);
 	this->setFixedSize(this->size());
@@ -54,6 +67,8 @@ MainWindow::MainWindow(QWidget *parent) :
 	m_labPacketSend = new QLabel("SENT: 0", this);
 	m_labNumberPDO = new QLabel("PDO: 0", this);
 	m_labConfig = new QLabel("", this);
+	m_labDropped = new QLabel("DROPPED: 0", this);
+	m_labDropped->setToolTip(tr("Frames dropped by the kernel, total and in the last second"));
 	m_model_log = new logModel(NULL);
 	m_busload = new QProgressBar(this);
 	m_busload->setFixedWidth(100);
@@ -76,10 +91,14 @@ MainWindow::MainWindow(QWidget *parent) :
 	ui->msgLog->setColumnWidth(3, 60);
 	ui->msgLog->setColumnWidth(4, 30);
 	ui->msgLog->setColumnWidth(6, 30);
+	hdr->setSectionResizeMode(7, QHeaderView::Interactive);
+	ui->msgLog->setColumnWidth(7, 250);
+	ui->msgLog->setColumnHidden(7, true);
 	ui->msgLog->verticalHeader()->setDefaultSectionSize(17);
 	ui->msgLog->horizontalHeader()->setHighlightSections(false);
 	ui->statusBar->addPermanentWidget(m_labConfig);
 	ui->statusBar->addPermanentWidget(m_busload);
+	ui->statusBar->addPermanentWidget(m_labDropped);
 	ui->statusBar->addPermanentWidget(m_labPacketSend);
 	ui->statusBar->addPermanentWidget(m_labPacketRecv);
 	ui->statusBar->addPermanentWidget(m_labNumberPDO);
@@ -113,12 +132,59 @@ MainWindow::MainWindow(QWidget *parent) :
 	m_sk = NULL;
 	m_pkg_recv = 0;
 	m_pkg_send = 0;
-	m_bit_recv = 0;
 	m_bitrate  = 0;
 	m_percent = 0;
 	m_cycletime = 0;
 	m_sound = false;
 	m_appSettings = new QAppSettings(this);
+	m_trigger = new QTriggerEngine(this);
+	m_canopen = new QCanOpenDecoder(this);
+	m_j1939 = new QJ1939Decoder(this);
+	m_isotp = new QIsoTpDecoder(this);
+	m_isotp_sender = NULL;
+	m_nmea2000 = new QNmea2000Decoder(this);
+	m_appSettings->beginGroup("BusLoad");
+	temp = m_appSettings->value("Stuffing").toString();
+	m_load = new QBusLoadAnalyzer((temp == "none") ? BUSLOAD_STUFF_NONE :
+								  (temp == "worst") ? BUSLOAD_STUFF_WORST :
+								  BUSLOAD_STUFF_ACTUAL, this);
+	m_appSettings->endGroup();
+	m_changes = new QChangeTracker(this);
+	m_appSettings->beginGroup("Timing");
+	m_timing = new QTimingAnalyzer(m_appSettings->value("Tolerance").toUInt(), this);
+	m_timing->setExpected(m_appSettings->value("Expected").toString());
+	m_appSettings->endGroup();
+	m_errors = new QErrorAnalyzer(this);
+	m_appSettings->beginGroup("Realtime");
+	if (!QRealtime::parsePolicy(m_appSettings->value("Policy").toString(), rt) ||
+	    !QRealtime::parseCpus(m_appSettings->value("Cpus").toString(), rt))
+		qWarning() << "Invalid real-time settings, ignored";
+	else {
+		rt.lock_memory = m_appSettings->value("LockMemory").toString() == "yes";
+		QRealtime::configure(rt);
+	}
+	m_appSettings->endGroup();
+	m_appSettings->beginGroup("IsoTp");
+	m_isotp->setChannels(m_appSettings->value("Channels").toString());
+	m_appSettings->endGroup();
+	memset(&m_trigger_config, 0, sizeof(m_trigger_config));
+	m_trigger_config.a.count_limit = 1;
+	m_trigger_config.b.count_limit = 1;
+	m_trigger_delay = false;
+	m_trigger_delay_ms = 0;
+	m_trigger_pending = -1;
+	m_recorder = NULL;
+	m_dbc = NULL;
+	m_appSettings->beginGroup("Database");
+	temp = m_appSettings->value("DbcFile").toString();
+	m_appSettings->endGroup();
+	if (!temp.isEmpty())
+		openDatabase(temp);
+#ifdef __linux
+	QFlightRecorder::installSignalTrigger(SIGUSR1);
+#endif
+	connect(m_trigger, SIGNAL(triggered(int, can_packet_t)),
+			this, SLOT(triggerFired(int, can_packet_t)), Qt::QueuedConnection);
 	m_timer = new QTimer();
 	m_timer->start(1000);
 	m_timer_cycle = new QTimer();
@@ -130,6 +196,8 @@ MainWindow::MainWindow(QWidget *parent) :
 MainWindow::~MainWindow()
 {
 	delete ui;
+	m_model_log->setDatabase(NULL);
+	dbc_free(m_dbc);
 }
 
 QAppSettings *MainWindow::getSettings()
@@ -144,35 +212,32 @@ void MainWindow::setLogToFileEnabled(bool value)
 
 void MainWindow::showPacket(can_packet_t packet)
 {
-	QString temp;
+	QString data, interval;
 	static QTime curTime;
 	quint32 pck_id;
 	QStandardItem * it;
 	QList <QStandardItem *> listItems;
+	QPacketStats::statistic_t *s;
+	bool created;
 
 	m_pkg_recv++;
 	if (m_sound && ! (m_pkg_recv % 100))
 		QApplication::beep();
 
 	pck_id = packet.id & EFF_MASK;
-	if (packet.id & EFF_FLAG)
-		m_bit_recv += (389 + packet.dlc*48)/5;
-	else
-		m_bit_recv += (269 + packet.dlc*48)/5;
 	m_labPacketRecv->setText(QString("RECV:%1").arg(m_pkg_recv));
 
 	curTime = ((QDateTime::fromTime_t(packet.tv_sec)).time());
 	curTime = curTime.addMSecs(packet.tv_usec/1000);
 
-	if (! m_stats.contains(pck_id)) {
+	s = m_stats.update(packet, data, interval, &created);
+	if (created) {
 		listItems.clear();
-		statistic_t *s = new statistic_t;
-		s->lastSec = packet.tv_sec;
-		s->lastUSec = packet.tv_usec;
-		memset(s->data, 0, 8);
-		s->count = 0;
 		s->row = m_model_stat->rowCount();
-		it = new QStandardItem(QString::number(pck_id, 16).toUpper());
+		if (packet.id & ERR_FLAG)
+			it = new QStandardItem(QString("ERR %1").arg(QString::number(pck_id, 16).toUpper()));
+		else
+			it = new QStandardItem(QString::number(pck_id, 16).toUpper());
 		it->setEditable(false);
 		listItems.push_back(it);
 		it = new QStandardItem("0");
@@ -184,32 +249,14 @@ void MainWindow::showPacket(can_packet_t packet)
 		it = new QStandardItem("");
 		it->setEditable(false);
 		listItems.push_back(it);
-		m_stats[pck_id] = s;
 		m_model_stat->appendRow(listItems);
 	}
-	temp = "";
-	for (unsigned i = 0; i < packet.dlc; i++) {
-		if (m_stats[pck_id]->count <= 1 || packet.data[i] != m_stats[pck_id]->data[i])
-			temp += "<font color=\"red\">";
-		else
-			temp += "<font color=\"black\">";
-		QString tok;
-		temp += tok.sprintf("%02X ",packet.data[i]).toUpper();
-
-		if (packet.data[i] != m_stats[pck_id]->data[i])
-			temp += "</font>";
-		m_stats[pck_id]->data[i] = packet.data[i];
-	}
-	it = m_model_stat->item(m_stats[pck_id]->row,1);
-	it->setText(QString::number(++m_stats[pck_id]->count));
-	it = m_model_stat->item(m_stats[pck_id]->row,3);
-	it->setText(temp);
-	it = m_model_stat->item(m_stats[pck_id]->row,2);
-	int64_t msec = (((packet.tv_sec - m_stats[pck_id]->lastSec) * 1000000) +
-					packet.tv_usec - m_stats[pck_id]->lastUSec)/ 1000;
-	it->setText(QString::number(msec));
-	m_stats[pck_id]->lastSec  = packet.tv_sec;
-	m_stats[pck_id]->lastUSec  = packet.tv_usec;
+	it = m_model_stat->item(s->row,1);
+	it->setText(QString::number(s->count));
+	it = m_model_stat->item(s->row,3);
+	it->setText(data);
+	it = m_model_stat->item(s->row,2);
+	it->setText(interval);
 	m_labNumberPDO->setText(QString("PDO:%1").arg(m_stats.size()));
 }
 
@@ -218,6 +265,7 @@ void MainWindow::connectToDevice(void)
 	QString deviceName;
 	int actualConntection;
 	uint16_t val16;
+	uint32_t val32;
 	QString temp;
 
 	if (m_sk != NULL)
@@ -245,11 +293,21 @@ void MainWindow::connectToDevice(void)
 		deviceName = "TCP";
 		m_bitrate = 0;
 		temp = m_appSettings->value("canNetServerIP").toString();
-		can_ops->attribute_set(NET_SOCKET_ADDR,
+		can_ops->attribute_set(TCP_SOCKET_ADDR,
 							   temp.toLatin1().data(), temp.length());
 		val16 = m_appSettings->value("canNetServerPort").toUInt();
-		can_ops->attribute_set(NET_SOCKET_PORT,
+		can_ops->attribute_set(TCP_SOCKET_PORT,
 							   &val16, sizeof(uint16_t));
+		val32 = m_appSettings->value("canNetFlushLatency").toUInt();
+		can_ops->attribute_set(TCP_SOCKET_FLUSH_USEC,
+							   &val32, sizeof(uint32_t));
+		val32 = (m_appSettings->value("canNetOverflow").toString() == "block") ?
+				TCP_OVERFLOW_BLOCK : TCP_OVERFLOW_DROP;
+		can_ops->attribute_set(TCP_SOCKET_OVERFLOW,
+							   &val32, sizeof(uint32_t));
+		val32 = m_appSettings->value("canNetReconnect").toUInt();
+		can_ops->attribute_set(TCP_SOCKET_RECONNECT_MS,
+							   &val32, sizeof(uint32_t));
 		m_labConfig->setText(QString("[%1, %2:%3]:").arg(deviceName).arg(temp).arg(val16));
 		break;
 
@@ -257,6 +315,15 @@ void MainWindow::connectToDevice(void)
 		can_ops = get_can_ops("PCAN-USB");
 		deviceName = m_appSettings->value("PCANName").toString();
 		m_bitrate = m_appSettings->value("PCANBitRate").toUInt();
+		val32 = m_appSettings->value("PCANRcvBuf").toUInt();
+		can_ops->attribute_set(CAN_SOCKET_RCVBUF,
+							   &val32, sizeof(uint32_t));
+		val32 = m_appSettings->value("PCANBusyPoll").toUInt();
+		can_ops->attribute_set(CAN_SOCKET_BUSY_POLL,
+							   &val32, sizeof(uint32_t));
+		val32 = m_appSettings->value("PCANUring").toUInt();
+		can_ops->attribute_set(CAN_SOCKET_URING,
+							   &val32, sizeof(uint32_t));
 		m_labConfig->setText(QString("[%1, %2 kbit/s]:").arg(deviceName).arg(m_bitrate / 1000));
 		break;
 
@@ -267,6 +334,26 @@ void MainWindow::connectToDevice(void)
 		m_labConfig->setText(QString("[%1]:").arg(deviceName));
 		break;
 
+	case 5:
+		can_ops = get_can_ops("Generator");
+		deviceName = m_appSettings->value("GeneratorSpec").toString();
+		m_bitrate = 0;
+		m_labConfig->setText(QString("[Generator %1]:").arg(deviceName));
+		break;
+
+	case 6:
+		can_ops = get_can_ops("CAN Over UDP");
+		deviceName = "UDP";
+		m_bitrate = 0;
+		temp = m_appSettings->value("canNetServerIP").toString();
+		can_ops->attribute_set(NET_SOCKET_ADDR,
+							   temp.toLatin1().data(), temp.length());
+		val16 = m_appSettings->value("canNetServerPort").toUInt();
+		can_ops->attribute_set(NET_SOCKET_PORT,
+							   &val16, sizeof(uint16_t));
+		m_labConfig->setText(QString("[%1, %2:%3]:").arg(deviceName).arg(temp).arg(val16));
+		break;
+
 
 	default:
 		break;
@@ -298,6 +385,36 @@ void MainWindow::connectToDevice(void)
 	}
 	m_recvthr = new QCanRecvThread(m_sk);
 	m_recvthr->linkPacketConsumer(m_monitor);
+	m_recvthr->linkPacketConsumer(m_trigger);
+	m_recvthr->linkPacketConsumer(m_canopen);
+	m_recvthr->linkPacketConsumer(m_j1939);
+	m_recvthr->linkPacketConsumer(m_isotp);
+	m_recvthr->linkPacketConsumer(m_nmea2000);
+	m_recvthr->linkPacketConsumer(m_timing);
+	m_recvthr->linkPacketConsumer(m_errors);
+	m_load->setBitrate(m_bitrate);
+	m_recvthr->linkPacketConsumer(m_load);
+	m_recvthr->linkPacketConsumer(m_changes);
+	m_sk->setTxConsumer(m_load);
+	m_isotp_sender = new QIsoTpSender(m_sk, this);
+	m_recvthr->linkPacketConsumer(m_isotp_sender);
+
+	m_appSettings->beginGroup("FlightRecorder");
+	if (m_appSettings->value("Enabled").toString() == "yes") {
+		m_recorder = new QFlightRecorder(m_appSettings->value("Frames").toUInt(),
+										 m_appSettings->value("PreTriggerMs").toUInt(),
+										 m_appSettings->value("PostTriggerMs").toUInt(),
+										 m_appSettings->value("Directory").toString(),
+										 this);
+		m_recorder->setRawFormat(m_appSettings->value("Format").toString() == "raw");
+		m_recvthr->linkPacketConsumer(m_recorder);
+		/* Freeze the window from the receive thread, not after a GUI round trip */
+		connect(m_trigger, SIGNAL(triggered(int, can_packet_t)),
+				m_recorder, SLOT(trigger()), Qt::DirectConnection);
+		connect(m_recorder, SIGNAL(dumped(QString, unsigned)),
+				this, SLOT(flightRecorderDumped(QString, unsigned)));
+	}
+	m_appSettings->endGroup();
 	m_monitor->setFilterId(ui->ediFilterId->text());
 	connect(m_monitor, SIGNAL(packetReceived(can_packet_t)),
 			m_model_log, SLOT(messageEnqueued(can_packet_t)));
@@ -305,8 +422,8 @@ void MainWindow::connectToDevice(void)
 	connect(m_monitor, SIGNAL(packetReceived(can_packet_t)),
 			this, SLOT(showPacket(can_packet_t)));
 	m_sendthr = new QCanSendThread(m_sk);
-	m_recvthr->start();
-	m_recvthr->setPriority(QThread::HighestPriority);
+	/* Set at creation, so a real-time policy set by the thread stays */
+	m_recvthr->start(QThread::HighestPriority);
 }
 
 void MainWindow::disconnectFromDevice()
@@ -314,31 +431,47 @@ void MainWindow::disconnectFromDevice()
 	if (m_sk == NULL)
 		return;
 
+	/* Frames received so far still reach the consumers unlinked below */
+	m_recvthr->stop();
+
 	m_recvthr->unlinkPacketConsumer(m_monitor);
+	m_recvthr->unlinkPacketConsumer(m_trigger);
+	m_recvthr->unlinkPacketConsumer(m_canopen);
+	m_recvthr->unlinkPacketConsumer(m_j1939);
+	m_recvthr->unlinkPacketConsumer(m_isotp);
+	m_recvthr->unlinkPacketConsumer(m_nmea2000);
+	m_recvthr->unlinkPacketConsumer(m_timing);
+	m_recvthr->unlinkPacketConsumer(m_errors);
+	m_recvthr->unlinkPacketConsumer(m_load);
+	m_recvthr->unlinkPacketConsumer(m_changes);
+	m_recvthr->unlinkPacketConsumer(m_isotp_sender);
+	if (m_recorder != NULL)
+		m_recvthr->unlinkPacketConsumer(m_recorder);
 	disconnect(m_monitor);
 	disconnect(m_sendthr);
 	disconnect(m_recvthr);
 
-	m_recvthr->stop();
-	m_recvthr->terminate();
-	m_recvthr->wait();
+	/* Its worker may be in the middle of a transfer on the socket */
+	delete m_isotp_sender;
+	m_isotp_sender = NULL;
 
 	m_sk->disconnect();
 	m_sk->close();
 
 	delete m_monitor;
+	delete m_recorder;
 	delete m_recvthr;
 	delete m_sendthr;
 	delete m_sk;
 
 	m_monitor = NULL;
+	m_recorder = NULL;
 	m_sendthr = NULL;
 	m_recvthr = NULL;
 	m_sk = NULL;
 	m_model_log->moveToThread(this->thread());
 	m_pkg_recv = 0;
 	m_pkg_send = 0;
-	m_bit_recv = 0;
 	m_percent = 0;
 }
 
@@ -402,7 +535,8 @@ void MainWindow::sendPacket()
 
 void MainWindow::updateStatus()
 {
-	qcan_state_t state;
+	qcan_state_t state = QCAN_STATE_UNKNOWN;
+	quint64 dropped;
 
 	m_busload->setValue(m_percent);
 	if (m_sk == NULL) {
@@ -445,11 +579,19 @@ void MainWindow::updateStatus()
 		break;
 	}
 
-	if (m_bitrate)
-		m_percent =	(m_bit_recv *100)/ m_bitrate;
-	else
-		m_percent = 0;
-	m_bit_recv = 0;
+	dropped = m_drops.poll();
+	m_labDropped->setText(QString("DROPPED:%1 (+%2)").arg(m_drops.total()).arg(dropped));
+	if (dropped != 0) {
+		m_model_log->markerEnqueued(QString("Kernel dropped %1 frames").arg(dropped));
+		qWarning("Kernel dropped %llu frames, log latency p99 %llu ms",
+		         (unsigned long long) dropped, (unsigned long long) m_drops.latency() / 1000);
+	}
+	if (m_drops.lagging())
+		ui->statusBar->showMessage(QString("Kernel dropped %1 frames while the log lagged "
+		                                   "%2 ms: raise the receive buffer")
+		                           .arg(dropped).arg(m_drops.latency() / 1000));
+
+	m_percent = m_load->load() / 100;
 }
 
 void MainWindow::editOptions()
@@ -461,10 +603,14 @@ void MainWindow::editOptions()
 	openConfig->edi8DevicesBitRate->setText(m_appSettings->value("8DevicesBitRate").toString());
 	openConfig->ediPCANName->setText(m_appSettings->value("PCANName").toString());
 	openConfig->ediPCANBitRate->setText(m_appSettings->value("PCANBitRate").toString());
+	openConfig->ediPCANRcvBuf->setText(m_appSettings->value("PCANRcvBuf").toString());
+	openConfig->ediPCANBusyPoll->setText(m_appSettings->value("PCANBusyPoll").toString());
 	openConfig->canNetServerIPLineEdit->setText(m_appSettings->value("canNetServerIP").toString());
 	openConfig->canNetServerPortLineEdit->setText(m_appSettings->value("canNetServerPort").toString());
+	openConfig->canNetFlushLatencyLineEdit->setText(m_appSettings->value("canNetFlushLatency").toString());
 	openConfig->ixxatBitRateLineEdit->setText(m_appSettings->value("ixxatBitRate").toString());
 	openConfig->ediSimulationName->setText(m_appSettings->value("SimulationName").toString());
+	openConfig->ediGeneratorSpec->setText(m_appSettings->value("GeneratorSpec").toString());
 
 	//It sets the chosen item in the configuration dialog based on actual connection.
 	openConfig->interfaceComboBox->setCurrentIndex(m_appSettings->value("actualConnection").toInt());
@@ -564,14 +710,7 @@ void MainWindow::clearAll(void)
 	m_model_stat->removeRows(0, rows);
 	m_pkg_recv = 0;
 	m_pkg_send = 0;
-	m_bit_recv = 0;
 	m_percent = 0;
-	QMapIterator <unsigned, statistic_t *>itr(m_stats);
-	for (; itr.hasNext();) {
-		itr.next();
-		statistic_t *s = itr.value();
-		delete s;
-	}
 	m_stats.clear();
 	m_labPacketSend->setText(QString("SENT: %1").arg(m_pkg_send));
 	m_labPacketRecv->setText(QString("RECV: %1").arg(m_pkg_recv));
@@ -636,6 +775,271 @@ void MainWindow::showSendSequenceDialog()
 	delete msgSeqDialog;
 }
 
+void MainWindow::showTriggerDialog()
+{
+	QTriggerDialog dialog(this);
+	trigger_config_t config = m_trigger_config;
+
+	dialog.setConfig(m_trigger_config, m_trigger_delay, m_trigger_delay_ms, m_trigger_cmd);
+	for (;;) {
+		if (dialog.exec() != QDialog::Accepted)
+			return;
+
+		config.level_condition = dialog.levelCondition();
+		config.a.check_id = dialog.levelACheckIDEnable();
+		config.a.check_value = dialog.levelACheckValueEnable() && dialog.levelADataCheck() != 0;
+		config.b.check_id = dialog.levelBCheckIDEnable();
+		config.b.check_value = dialog.levelBCheckValueEnable() && dialog.levelBDataCheck() != 0;
+		/* A level without conditions would fire on every frame */
+		if (config.level_condition != TRIGGER_LEVEL_B &&
+		    !config.a.check_id && !config.a.check_value)
+			QMessageBox::warning(this, tr("CanSpy"),
+								 tr("Enable an ID or a value condition on level A."));
+		else if (config.level_condition != TRIGGER_LEVEL_A &&
+		         !config.b.check_id && !config.b.check_value)
+			QMessageBox::warning(this, tr("CanSpy"),
+								 tr("Enable an ID or a value condition on level B."));
+		else
+			break;
+	}
+
+	m_trigger_config.level_condition = dialog.levelCondition();
+	m_trigger_config.action = dialog.action();
+
+	m_trigger_config.a.check_id = dialog.levelACheckIDEnable();
+	m_trigger_config.a.id_condition = dialog.levelAIDCondition();
+	m_trigger_config.a.id_start = dialog.levelAIDStart();
+	m_trigger_config.a.id_end = dialog.levelAIDEnd();
+	m_trigger_config.a.check_value = dialog.levelACheckValueEnable();
+	m_trigger_config.a.data_mask = dialog.levelADataCheck();
+	m_trigger_config.a.value_condition = dialog.levelAValueCondition();
+	m_trigger_config.a.value_start = dialog.levelAValueStart();
+	m_trigger_config.a.value_end = dialog.levelAValueEnd();
+	m_trigger_config.a.count_limit = dialog.levelACountLimit();
+
+	m_trigger_config.b.check_id = dialog.levelBCheckIDEnable();
+	m_trigger_config.b.id_condition = dialog.levelBIDCondition();
+	m_trigger_config.b.id_start = dialog.levelBIDStart();
+	m_trigger_config.b.id_end = dialog.levelBIDEnd();
+	m_trigger_config.b.check_value = dialog.levelBCheckValueEnable();
+	m_trigger_config.b.data_mask = dialog.levelBDataCheck();
+	m_trigger_config.b.value_condition = dialog.levelBValueCondition();
+	m_trigger_config.b.value_start = dialog.levelBValueStart();
+	m_trigger_config.b.value_end = dialog.levelBValueEnd();
+	m_trigger_config.b.count_limit = dialog.levelBCountLimit();
+
+	m_trigger_delay = dialog.actionDelay();
+	m_trigger_delay_ms = dialog.actionDelayValue();
+	m_trigger_cmd = dialog.actionCommand();
+	m_trigger_pending = -1;
+
+	m_trigger->arm(m_trigger_config);
+}
+
+void MainWindow::disarmTrigger()
+{
+	m_trigger->disarm();
+	/* A delayed action still due is dropped, it would arm again */
+	m_trigger_pending = -1;
+}
+
+void MainWindow::triggerFired(int action, can_packet_t packet)
+{
+	/* A delayed action already pending absorbs further hits */
+	if (m_trigger_pending >= 0)
+		return;
+
+	m_trigger_pending = action;
+	m_trigger_packet = packet;
+	if (m_trigger_delay && m_trigger_delay_ms > 0)
+		QTimer::singleShot(m_trigger_delay_ms, this, SLOT(runTriggerAction()));
+	else
+		runTriggerAction();
+}
+
+void MainWindow::runTriggerAction()
+{
+	int action = m_trigger_pending;
+	QString fileName;
+
+	m_trigger_pending = -1;
+	switch (action) {
+	case TRIGGER_ACTION_MESSAGE:
+		QMessageBox::information(this, tr("CanSpy"),
+								 tr("Trigger fired on ID %1.")
+								 .arg(QString::number(m_trigger_packet.id & EFF_MASK, 16).toUpper()),
+								 QMessageBox::Ok);
+		break;
+
+	case TRIGGER_ACTION_LOG_ENABLE:
+		ui->chkEnableLog->setChecked(true);
+		enableLogChanged(true);
+		break;
+
+	case TRIGGER_ACTION_LOG_DISABLE:
+		ui->chkEnableLog->setChecked(false);
+		enableLogChanged(false);
+		break;
+
+	case TRIGGER_ACTION_SOUND:
+		QApplication::beep();
+		break;
+
+	case TRIGGER_ACTION_COMMAND:
+		if (!m_trigger_cmd.isEmpty())
+			QProcess::startDetached(m_trigger_cmd);
+		break;
+
+	case TRIGGER_ACTION_STOP:
+		disconnectFromDevice();
+		return;
+
+	case TRIGGER_ACTION_SAVE:
+		fileName = m_appSettings->value("defaultSaveFilePath").toString() +
+				QDateTime::currentDateTime().toString("/'trigger-'yyyyMMdd-hhmmss'.tlog'");
+		saveFileStandard(fileName);
+		break;
+
+	case TRIGGER_ACTION_MARK:
+		m_model_log->markerEnqueued(QString("Trigger on ID %1")
+									.arg(QString::number(m_trigger_packet.id & EFF_MASK, 16).toUpper()));
+		break;
+
+	default:
+		return;
+	}
+	m_trigger->arm(m_trigger_config);
+}
+
+void MainWindow::flightRecorderTrigger()
+{
+	if (m_recorder == NULL) {
+		ui->statusBar->showMessage("Flight recorder is disabled", 3000);
+		return;
+	}
+	m_recorder->trigger();
+}
+
+void MainWindow::flightRecorderDumped(QString fileName, unsigned frames)
+{
+	ui->statusBar->showMessage(QString("Flight recorder: %1 frames saved to %2")
+							   .arg(frames).arg(fileName), 5000);
+}
+
+bool MainWindow::openDatabase(const QString &fileName)
+{
+	dbc_db_t *db;
+
+	db = dbc_load(fileName.toLocal8Bit().constData());
+	if (db == NULL) {
+		QMessageBox::warning(this, tr("Application"),
+							 tr("Cannot load DBC file %1.").arg(fileName));
+		return false;
+	}
+
+	m_model_log->setDatabase(db);
+	dbc_free(m_dbc);
+	m_dbc = db;
+	ui->msgLog->setColumnHidden(7, false);
+	ui->statusBar->showMessage(QString("DBC: %1 messages, %2 signals loaded")
+							   .arg(db->nmessages).arg(db->nsignals), 5000);
+
+	return true;
+}
+
+void MainWindow::loadDatabase()
+{
+	QString fileName;
+
+	fileName = QFileDialog::getOpenFileName(this, tr("Load DBC File"),
+											m_appSettings->value("Paths/defaultOpenFilePath").toString(),
+											tr("CAN database (*.dbc)"));
+	if (fileName.isEmpty() || !openDatabase(fileName))
+		return;
+
+	m_appSettings->beginGroup("Database");
+	m_appSettings->setValue("DbcFile", fileName);
+	m_appSettings->endGroup();
+}
+
+void MainWindow::showProtocolView(QProtocolDecoder *decoder)
+{
+	QProtocolView *view;
+
+	view = new QProtocolView(decoder, this);
+	view->show();
+}
+
+void MainWindow::showCanOpenView()
+{
+	showProtocolView(m_canopen);
+}
+
+void MainWindow::showJ1939View()
+{
+	showProtocolView(m_j1939);
+}
+
+void MainWindow::showIsoTpView()
+{
+	showProtocolView(m_isotp);
+}
+
+void MainWindow::showNmea2000View()
+{
+	showProtocolView(m_nmea2000);
+}
+
+void MainWindow::showTimingView()
+{
+	showProtocolView(m_timing);
+}
+
+void MainWindow::showErrorView()
+{
+	showProtocolView(m_errors);
+}
+
+void MainWindow::showBusLoadView()
+{
+	showProtocolView(m_load);
+}
+
+void MainWindow::showChangesView()
+{
+	showProtocolView(m_changes);
+}
+
+void MainWindow::showHeatmapView()
+{
+	QHeatmapView *view;
+
+	view = new QHeatmapView(m_changes, this);
+	view->show();
+}
+
+void MainWindow::showDiagnosticsView()
+{
+	QDiagnosticsView *view;
+
+	view = new QDiagnosticsView(this);
+	view->show();
+}
+
+void MainWindow::showIsoTpSendDialog()
+{
+	QIsoTpDialog *dialog;
+
+	if (m_isotp_sender == NULL) {
+		QMessageBox::warning(this, tr("Send ISO-TP"),
+							 tr("Connect to a device first."),
+							 QMessageBox::Ok);
+		return;
+	}
+	dialog = new QIsoTpDialog(m_isotp_sender, this);
+	dialog->show();
+}
+
 void MainWindow::initActionsConnections(void)
 {
 	connect(ui->actionConnect, SIGNAL(triggered()),
@@ -674,6 +1078,36 @@ void MainWindow::initActionsConnections(void)
 			this, SLOT(exportToCSV()));
 	connect(ui->actionSendSequence, SIGNAL(triggered()),
 			this, SLOT(showSendSequenceDialog()));
+	connect(ui->actionTrigger, SIGNAL(triggered()),
+			this, SLOT(showTriggerDialog()));
+	connect(ui->actionTriggerDisarm, SIGNAL(triggered()),
+			this, SLOT(disarmTrigger()));
+	connect(ui->actionFlightTrigger, SIGNAL(triggered()),
+			this, SLOT(flightRecorderTrigger()));
+	connect(ui->actionLoadDbc, SIGNAL(triggered()),
+			this, SLOT(loadDatabase()));
+	connect(ui->actionCanOpenView, SIGNAL(triggered()),
+			this, SLOT(showCanOpenView()));
+	connect(ui->actionJ1939View, SIGNAL(triggered()),
+			this, SLOT(showJ1939View()));
+	connect(ui->actionIsoTpView, SIGNAL(triggered()),
+			this, SLOT(showIsoTpView()));
+	connect(ui->actionIsoTpSend, SIGNAL(triggered()),
+			this, SLOT(showIsoTpSendDialog()));
+	connect(ui->actionNmea2000View, SIGNAL(triggered()),
+			this, SLOT(showNmea2000View()));
+	connect(ui->actionTimingView, SIGNAL(triggered()),
+			this, SLOT(showTimingView()));
+	connect(ui->actionErrorView, SIGNAL(triggered()),
+			this, SLOT(showErrorView()));
+	connect(ui->actionBusLoadView, SIGNAL(triggered()),
+			this, SLOT(showBusLoadView()));
+	connect(ui->actionChangesView, SIGNAL(triggered()),
+			this, SLOT(showChangesView()));
+	connect(ui->actionHeatmapView, SIGNAL(triggered()),
+			this, SLOT(showHeatmapView()));
+	connect(ui->actionDiagnosticsView, SIGNAL(triggered()),
+			this, SLOT(showDiagnosticsView()));
 	connect(ui->chkEnableHex, SIGNAL(clicked(bool)),
 			this, SLOT(enableHexChanged(bool)));
 }
@@ -59,6 +59,7 @@ MsgSeq::MsgSeq(QMainWindow *parent, QCanMonitor *monitor, QCanSendThread *send)
 	ui->msgTableView->setColumnWidth(3, 60);
 	ui->msgTableView->setColumnWidth(4, 30);
 	ui->msgTableView->setColumnWidth(6, 30);
+	ui->msgTableView->setColumnHidden(7, true);
 	ui->msgTableView->horizontalHeader()->setHighlightSections(false);
 	ui->msgTableView->verticalHeader()->setDefaultSectionSize(17);
 	ui->msgTableView->setAlternatingRowColors(true);
@@ -165,40 +166,11 @@ void MsgSeq::loadFile(QString fileName)
 	QTextStream in(&file);
 	while (!in.atEnd()) {
 		QString line = in.readLine();
-		packet = processLine(line);
+		packet = logModel::parseLine(line);
 		emit msgEnqueue(packet);
 	}
 }
 
-can_packet_t MsgSeq::processLine(const QString &line)
-{
-	can_packet_t ret;
-	unsigned col;
-
-	QStringList list = line.split(" ", QString::SkipEmptyParts);
-	col = 0;
-	foreach (QString token, list) {
-		if (col == 0)
-			ret.id = token.toUInt(NULL, 16);
-		else if (col == 1) {
-			token.replace(QRegExp( "[" + QRegExp::escape( "[]" ) + "]" ), "");
-			ret.dlc = token.toUInt();
-		} else if (col < ret.dlc + 1U) {
-			ret.data[col - 1] = token.toLongLong(NULL, 16);
-		} else if (col == ret.dlc + 1U) {
-			//TODO: Add support extended packet
-		} else if (col == ret.dlc + 3U) {
-			token = token.right(token.length() -2);
-			QDateTime d =  QDateTime::fromString(token, QString("hh:mm:ss.zzz"));
-			ret.tv_sec = d.toMSecsSinceEpoch() / 1000;
-			ret.tv_usec = (d.toMSecsSinceEpoch() % 1000) * 1000.0;
-		}
-		col++;
-	}
-
-	return ret;
-}
-
 void MsgSeq::sendSelectedButton_clicked()
 {
 	can_packet_t packet;
@@ -22,10 +22,17 @@
  * used in safety-critical situations without a full and competent review.
  */
 #include "drivers/net_ops.h"
+#include "drivers/tcp_ops.h"
 #include "drivers/simulation_ops.h"
+#include "drivers/generator_ops.h"
 #include "drivers/can_socket_ops.h"
 #include "utils.h"
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
 
 int get_timestamp(int64_t *sec, int64_t *usec)
 {
@@ -51,9 +58,80 @@ can_ops_t *get_can_ops(const char *name)
 	if (!strcmp("PCAN-USB", name))
 		ret = &can_socket_ops;
 	if (!strcmp("CAN Over TCP", name))
+		ret = &tcp_ops;
+	if (!strcmp("CAN Over UDP", name))
 		ret = &net_ops;
 	if (!strcmp("Simulation", name))
 		ret = &simulation_ops;
+	if (!strcmp("Generator", name))
+		ret = &generator_ops;
 	return ret;
 }
 
+int set_thread_scheduler(int policy, int priority)
+{
+	struct sched_param param;
+	int r;
+
+	memset(&param, 0, sizeof(param));
+	switch (policy) {
+	case RT_POLICY_FIFO:
+		policy = SCHED_FIFO;
+		param.sched_priority = priority;
+		break;
+
+	case RT_POLICY_RR:
+		policy = SCHED_RR;
+		param.sched_priority = priority;
+		break;
+
+	default:
+		policy = SCHED_OTHER;
+		break;
+	}
+
+	r = pthread_setschedparam(pthread_self(), policy, &param);
+	if (r != 0) {
+		errno = r;
+		return -1;
+	}
+
+	return 0;
+}
+
+int set_thread_cpu(int cpu)
+{
+	cpu_set_t set;
+	int r;
+
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (r != 0) {
+		errno = r;
+		return -1;
+	}
+
+	return 0;
+}
+
+int lock_memory(void)
+{
+	return mlockall(MCL_CURRENT | MCL_FUTURE);
+}
+
+int get_thread_cputime(int64_t *usec)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0)
+		return -1;
+	*usec = (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	return 0;
+}
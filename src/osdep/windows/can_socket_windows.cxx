@@ -183,9 +183,9 @@ int can_socket_state_get(const char *, qcan_state_t *status)
 	int r;
 	canalStatus stat;
 
+	*status = QCAN_STATE_UNKNOWN;
 	return 0;
 	r = 0;
-	*status = QCAN_STATE_UNKNOWN;
 
 	r = CanalGetStatus(m_fd, &stat);
 	if (r != CANAL_ERROR_SUCCESS)
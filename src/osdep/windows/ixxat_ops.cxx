@@ -6,18 +6,24 @@
 #include <vcinpl.h>
 #include <Windows.h>
 
+#include <atomic>
+
 
 #define FLAG_LOOPBACK    1
 #define FLAG_SILENT      2
 #define FLAG_DAR         4
 #define FLAG_ENMSGSTATUS 8
 
+/* Longest wait for a message, so a wakeup is noticed in time */
+#define IXXAT_WAKEUP_MS  100
+
 static int m_fd;
 HANDLE hDevice;
 HANDLE hCanChn;
 HANDLE hCanCtl;
 static int64_t ofsSec = 0;
 static int64_t ofsUsec = 0;
+static std::atomic<bool> m_wakeup(false);
 struct BaudRate {
 	uint64_t baud_rate;
 	uint8_t bt0;
@@ -46,6 +52,7 @@ static int ixxat_start(const char *device);
 static int ixxat_stop(const char *device);
 static int ixxat_state_get(const char *device, qcan_state_t *status);
 static int ixxat_restart(const char *device);
+static int ixxat_wakeup(int fd);
 static BaudRate ixxat_getbaudrate(uint64_t baund);
 
 can_ops_t ixxat_ops = {
@@ -58,7 +65,9 @@ can_ops_t ixxat_ops = {
 	ixxat_start,
 	ixxat_stop,
 	ixxat_state_get,
-	ixxat_restart
+	ixxat_restart,
+	/* .rx_dropped = */ NULL,
+	/* .wakeup =     */ ixxat_wakeup
 };
 
 int ixxat_create(const char *, unsigned bitrate)
@@ -73,6 +82,7 @@ int ixxat_create(const char *, unsigned bitrate)
 	vciDeviceOpen(sInfo.VciObjectId, &hDevice);
 
 	m_fd = (int)hDevice;
+	m_wakeup.store(false);
 	canChannelOpen(hDevice, 0, FALSE, &hCanChn);
 	canChannelInitialize(hCanChn, 1024, 1, 128, 1);
 	canChannelActivate(hCanChn, TRUE);
@@ -125,7 +135,11 @@ int ixxat_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
 	if (fd < 0)
 		return -1;
 
-	ret = canChannelReadMessage(hCanChn, INFINITE, &msg);
+	do {
+		if (m_wakeup.exchange(false))
+			return 0;
+		ret = canChannelReadMessage(hCanChn, IXXAT_WAKEUP_MS, &msg);
+	} while (ret == VCI_E_TIMEOUT);
 	if (ret != S_OK ||
 	    !(msg.uMsgInfo.Bytes.bType == CAN_MSGTYPE_DATA || msg.uMsgInfo.Bytes.bType == CAN_MSGTYPE_ERROR))
 		return -1;
@@ -213,6 +227,12 @@ int ixxat_restart(const char *)
 	return 0;
 }
 
+int ixxat_wakeup(int)
+{
+	m_wakeup.store(true);
+	return 0;
+}
+
 BaudRate ixxat_getbaudrate(uint64_t baund)
 {
 	unsigned i;
@@ -6,6 +6,8 @@
 #include <stdio.h>
 #include <Windows.h>
 
+#include <atomic>
+
 
 #define FLAG_LOOPBACK    1
 #define FLAG_SILENT      2
@@ -15,6 +17,7 @@
 static int m_fd;
 static int64_t ofsSec = 0;
 static int64_t ofsUsec = 0;
+static std::atomic<bool> m_wakeup(false);
 
 static int usb2can_create(const char *dev, unsigned bitrate);
 static int usb2can_destroy(int fd);
@@ -27,6 +30,7 @@ static int usb2can_start(const char *device);
 static int usb2can_stop(const char *device);
 static int usb2can_state_get(const char *device, qcan_state_t *status);
 static int usb2can_restart(const char *device);
+static int usb2can_wakeup(int fd);
 
 
 can_ops_t usb2can_ops = {
@@ -39,7 +43,9 @@ can_ops_t usb2can_ops = {
 	usb2can_start,
 	usb2can_stop,
 	usb2can_state_get,
-	usb2can_restart
+	usb2can_restart,
+	/* .rx_dropped = */ NULL,
+	/* .wakeup =     */ usb2can_wakeup
 };
 
 
@@ -55,6 +61,7 @@ int usb2can_create(const char *dev, unsigned bitrate)
 		return -1;
 	}
 	m_fd = handle;
+	m_wakeup.store(false);
 
 	return handle;
 }
@@ -92,6 +99,8 @@ int usb2can_recv(int fd, unsigned *id, uint8_t *dlc, void *data,
 		return -1;
 
 	while (CanalDataAvailable(fd) == 0) {
+		if (m_wakeup.exchange(false))
+			return 0;
 		Sleep(1);
 	}
 
@@ -190,9 +199,9 @@ int usb2can_state_get(const char *, qcan_state_t *status)
 	int r;
 	canalStatus stat;
 
+	*status = QCAN_STATE_UNKNOWN;
 	return 0;
 	r = 0;
-	*status = QCAN_STATE_UNKNOWN;
 
 	r = CanalGetStatus(m_fd, &stat);
 	if (r != CANAL_ERROR_SUCCESS)
@@ -232,3 +241,9 @@ int usb2can_restart(const char *)
 {
 	return 0;
 }
+
+int usb2can_wakeup(int)
+{
+	m_wakeup.store(true);
+	return 0;
+}
@@ -25,11 +25,14 @@
 #include "drivers/usb2can_ops.h"
 #include "drivers/ixxat_ops.h"
 #include "drivers/net_ops.h"
+#include "drivers/tcp_ops.h"
 #include "canbus/simulation_ops.h"
+#include "drivers/generator_ops.h"
 #include "utils.h"
 
 #include <winsock2.h>
 #include <stdint.h>
+#include <errno.h>
 
 inline int gettimeofday(struct timeval* tp, void*)
 {
@@ -67,9 +70,13 @@ can_ops_t *get_can_ops(const char *name)
 	if (!strcmp("IXXAT USB", name))
 		ret = &ixxat_ops;
 	if (!strcmp("CAN Over TCP", name))
+		ret = &tcp_ops;
+	if (!strcmp("CAN Over UDP", name))
 		ret = &net_ops;
 	if (!strcmp("Simulation", name))
 		ret = &simulation_ops;
+	if (!strcmp("Generator", name))
+		ret = &generator_ops;
 
 
 	return ret;
@@ -131,3 +138,49 @@ strsep(char **stringp, const char *delim)
 
 }
 
+int set_thread_scheduler(int policy, int)
+{
+	int priority = (policy == RT_POLICY_OTHER) ? THREAD_PRIORITY_NORMAL :
+	    THREAD_PRIORITY_TIME_CRITICAL;
+
+	if (!SetThreadPriority(GetCurrentThread(), priority)) {
+		errno = EPERM;
+		return -1;
+	}
+
+	return 0;
+}
+
+int set_thread_cpu(int cpu)
+{
+	if (cpu < 0 || cpu >= 64 ||
+	    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu) == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+int lock_memory(void)
+{
+	/* VirtualLock works on ranges, there is no process wide lock */
+	errno = ENOSYS;
+	return -1;
+}
+
+int get_thread_cputime(int64_t *usec)
+{
+	FILETIME creation, exit, kernel, user;
+	ULARGE_INTEGER k, u;
+
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return -1;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	*usec = (int64_t) ((k.QuadPart + u.QuadPart) / 10);
+
+	return 0;
+}
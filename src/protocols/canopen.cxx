@@ -0,0 +1,540 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "protocols/canopen.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC 1000000
+
+static const uint8_t fc_class[16] = {
+	CO_NMT, CO_EMCY, CO_TIME, CO_TPDO, CO_RPDO, CO_TPDO, CO_RPDO, CO_TPDO,
+	CO_RPDO, CO_TPDO, CO_RPDO, CO_SDO_TX, CO_SDO_RX, CO_UNKNOWN, CO_HEARTBEAT,
+	CO_LSS
+};
+
+static const uint8_t fc_pdo[16] = {
+	0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 0, 0, 0, 0, 0
+};
+
+static const char *class_names[CO_CLASSES] = {
+	"Unknown", "NMT", "SYNC", "EMCY", "TIME", "TPDO", "RPDO", "SDO tx",
+	"SDO rx", "Heartbeat", "LSS"
+};
+
+static uint32_t
+get_le32(const uint8_t *d)
+{
+	return d[0] | (d[1] << 8) | (d[2] << 16) | ((uint32_t) d[3] << 24);
+}
+
+void
+co_init(co_engine_t *co)
+{
+	memset(co, 0, sizeof(*co));
+	for (int i = 0; i < CO_NODES; i++) {
+		co->node[i].state = CO_STATE_UNKNOWN;
+		co->node[i].hb_min = UINT32_MAX;
+	}
+}
+
+int
+co_classify(uint32_t id, uint8_t *node, uint8_t *pdo)
+{
+	uint8_t fc, n;
+	int type;
+
+	if (id & (EFF_FLAG | RTR_FLAG | ERR_FLAG)) {
+		/* Error frames reach here too, the outputs are always written */
+		if (node != NULL)
+			*node = 0;
+		if (pdo != NULL)
+			*pdo = 0;
+		return CO_UNKNOWN;
+	}
+
+	id &= 0x7FF;
+	fc = id >> 7;
+	n = id & 0x7F;
+	type = fc_class[fc];
+
+	switch (type) {
+	case CO_NMT:
+	case CO_TIME:
+		if (n != 0)
+			type = CO_UNKNOWN;
+		break;
+	case CO_EMCY:
+		if (n == 0)
+			type = CO_SYNC;
+		break;
+	case CO_LSS:
+		if (id != 0x7E4 && id != 0x7E5)
+			type = CO_UNKNOWN;
+		break;
+	case CO_UNKNOWN:
+		break;
+	default:
+		/* Node 0 is not a valid node ID */
+		if (n == 0)
+			type = CO_UNKNOWN;
+		break;
+	}
+
+	if (node != NULL)
+		*node = n;
+	if (pdo != NULL)
+		*pdo = fc_pdo[fc];
+
+	return type;
+}
+
+const char *
+co_class_name(int type)
+{
+	return (type >= 0 && type < CO_CLASSES) ? class_names[type] : "Unknown";
+}
+
+const char *
+co_state_name(uint8_t state)
+{
+	switch (state) {
+	case CO_STATE_BOOTUP:
+		return "Boot-up";
+	case CO_STATE_STOPPED:
+		return "Stopped";
+	case CO_STATE_OPERATIONAL:
+		return "Operational";
+	case CO_STATE_PREOPERATIONAL:
+		return "Pre-operational";
+	default:
+		return "Unknown";
+	}
+}
+
+static void
+sdo_start(co_sdo_t *s, uint8_t direction, uint8_t block, const uint8_t *d,
+    int64_t t)
+{
+	s->active = 1;
+	s->direction = direction;
+	s->block = block;
+	s->stage = CO_SDO_INIT;
+	s->last = 0;
+	s->seqno = 0;
+	s->block_base = 0;
+	s->index = d[1] | (d[2] << 8);
+	s->subindex = d[3];
+	s->size = 0;
+	s->len = 0;
+	s->start_usec = t;
+}
+
+static void
+sdo_append(co_sdo_t *s, const uint8_t *d, unsigned n)
+{
+	/* len keeps counting past the buffer, only the data is truncated */
+	if (s->len < CO_SDO_BUF)
+		memcpy(s->buf + s->len, d,
+		    (n < CO_SDO_BUF - s->len) ? n : CO_SDO_BUF - s->len);
+	s->len += n;
+}
+
+static void
+sdo_finish(co_sdo_t *s, uint32_t abort_code, int64_t t)
+{
+	co_sdo_result_t *r = &s->result;
+
+	r->index = s->index;
+	r->subindex = s->subindex;
+	r->direction = s->direction;
+	r->block = s->block;
+	r->size = s->len;
+	r->abort_code = abort_code;
+	r->usec = t - s->start_usec;
+	memset(r->data, 0, sizeof(r->data));
+	memcpy(r->data, s->buf, (s->len < sizeof(r->data)) ? s->len : sizeof(r->data));
+
+	if (abort_code != 0)
+		s->aborted++;
+	else
+		s->completed++;
+	s->active = 0;
+}
+
+static void
+sdo_abort(co_sdo_t *s, const uint8_t *d, int64_t t)
+{
+	if (!s->active)
+		sdo_start(s, CO_SDO_DOWNLOAD, 0, d, t);
+	sdo_finish(s, get_le32(d + 4), t);
+}
+
+static void
+sdo_segment(co_sdo_t *s, const uint8_t *d)
+{
+	uint8_t seqno = d[0] & 0x7F;
+
+	/* Out of sequence segments are discarded and resent after the ack */
+	if (seqno != s->seqno + 1 || s->last)
+		return;
+
+	sdo_append(s, d + 1, 7);
+	s->seqno = seqno;
+	if (d[0] & 0x80)
+		s->last = 1;
+}
+
+static void
+sdo_block_ack(co_sdo_t *s, uint8_t ackseq)
+{
+	if (ackseq < s->seqno) {
+		/* Segments after ackseq are sent again in the next sub-block */
+		s->len = s->block_base + ackseq * 7;
+		s->last = 0;
+	}
+	s->block_base = s->len;
+	s->seqno = 0;
+	if (s->last)
+		s->stage = CO_SDO_END;
+}
+
+/* Frames from the client (0x600 + node) */
+static void
+sdo_client(co_sdo_t *s, const uint8_t *d, int64_t t)
+{
+	uint8_t cmd = d[0];
+
+	if (cmd == 0x80) {
+		sdo_abort(s, d, t);
+		return;
+	}
+
+	if (s->active && s->block && s->direction == CO_SDO_DOWNLOAD &&
+	    s->stage == CO_SDO_DATA) {
+		sdo_segment(s, d);
+		return;
+	}
+
+	switch (cmd >> 5) {
+	case 0: /* download segment */
+		if (!s->active || s->block || s->direction != CO_SDO_DOWNLOAD)
+			break;
+		sdo_append(s, d + 1, 7 - ((cmd >> 1) & 7));
+		if (cmd & 1)
+			s->stage = CO_SDO_END;
+		break;
+
+	case 1: /* initiate download */
+		sdo_start(s, CO_SDO_DOWNLOAD, 0, d, t);
+		if (cmd & 0x02) {
+			sdo_append(s, d + 4, (cmd & 0x01) ? 4 - ((cmd >> 2) & 3) : 4);
+			s->stage = CO_SDO_END;
+		} else if (cmd & 0x01)
+			s->size = get_le32(d + 4);
+		break;
+
+	case 2: /* initiate upload */
+		sdo_start(s, CO_SDO_UPLOAD, 0, d, t);
+		break;
+
+	case 5: /* block upload */
+		switch (cmd & 3) {
+		case 0:
+			sdo_start(s, CO_SDO_UPLOAD, 1, d, t);
+			break;
+		case 3:
+			if (s->active && s->block) {
+				s->stage = CO_SDO_DATA;
+				s->seqno = 0;
+				s->block_base = s->len;
+			}
+			break;
+		case 2:
+			if (s->active && s->block && s->stage == CO_SDO_DATA)
+				sdo_block_ack(s, d[1]);
+			break;
+		case 1:
+			if (s->active && s->block)
+				sdo_finish(s, 0, t);
+			break;
+		}
+		break;
+
+	case 6: /* block download */
+		if (!(cmd & 1)) {
+			sdo_start(s, CO_SDO_DOWNLOAD, 1, d, t);
+			if (cmd & 0x02)
+				s->size = get_le32(d + 4);
+		} else if (s->active && s->block) {
+			uint8_t n = (cmd >> 2) & 7;
+
+			/* n bytes of the last segment carry no data */
+			s->len = (s->len > n) ? s->len - n : 0;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Frames from the server (0x580 + node) */
+static void
+sdo_server(co_sdo_t *s, const uint8_t *d, int64_t t)
+{
+	uint8_t cmd = d[0];
+
+	if (cmd == 0x80) {
+		sdo_abort(s, d, t);
+		return;
+	}
+
+	if (s->active && s->block && s->direction == CO_SDO_UPLOAD &&
+	    s->stage == CO_SDO_DATA) {
+		sdo_segment(s, d);
+		return;
+	}
+
+	if (!s->active)
+		return;
+
+	switch (cmd >> 5) {
+	case 0: /* upload segment */
+		if (s->block || s->direction != CO_SDO_UPLOAD)
+			break;
+		sdo_append(s, d + 1, 7 - ((cmd >> 1) & 7));
+		if (cmd & 1)
+			sdo_finish(s, 0, t);
+		break;
+
+	case 1: /* download segment response */
+		if (!s->block && s->direction == CO_SDO_DOWNLOAD &&
+		    s->stage == CO_SDO_END)
+			sdo_finish(s, 0, t);
+		break;
+
+	case 2: /* initiate upload response, also the block upload fallback */
+		if (s->direction != CO_SDO_UPLOAD)
+			break;
+		s->block = 0;
+		if (cmd & 0x02) {
+			sdo_append(s, d + 4, (cmd & 0x01) ? 4 - ((cmd >> 2) & 3) : 4);
+			sdo_finish(s, 0, t);
+		} else {
+			if (cmd & 0x01)
+				s->size = get_le32(d + 4);
+			s->stage = CO_SDO_DATA;
+		}
+		break;
+
+	case 3: /* initiate download response */
+		if (s->block || s->direction != CO_SDO_DOWNLOAD)
+			break;
+		if (s->stage == CO_SDO_END)
+			sdo_finish(s, 0, t);
+		else
+			s->stage = CO_SDO_DATA;
+		break;
+
+	case 5: /* block download response */
+		if (!s->block || s->direction != CO_SDO_DOWNLOAD)
+			break;
+		switch (cmd & 3) {
+		case 0:
+			s->stage = CO_SDO_DATA;
+			s->seqno = 0;
+			s->block_base = s->len;
+			break;
+		case 2:
+			sdo_block_ack(s, d[1]);
+			break;
+		case 1:
+			sdo_finish(s, 0, t);
+			break;
+		}
+		break;
+
+	case 6: /* block upload response */
+		if (!s->block || s->direction != CO_SDO_UPLOAD)
+			break;
+		if (!(cmd & 1)) {
+			if (cmd & 0x02)
+				s->size = get_le32(d + 4);
+		} else {
+			uint8_t n = (cmd >> 2) & 7;
+
+			s->len = (s->len > n) ? s->len - n : 0;
+			s->stage = CO_SDO_END;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+nmt_command(co_engine_t *co, uint8_t cmd, uint8_t target)
+{
+	uint8_t state;
+
+	switch (cmd) {
+	case 0x01:
+		state = CO_STATE_OPERATIONAL;
+		break;
+	case 0x02:
+		state = CO_STATE_STOPPED;
+		break;
+	case 0x80:
+		state = CO_STATE_PREOPERATIONAL;
+		break;
+	case 0x81:
+	case 0x82:
+		/* Reset: the node reports itself with the boot-up message */
+		state = CO_STATE_UNKNOWN;
+		break;
+	default:
+		return;
+	}
+
+	if (target != 0) {
+		if (target < CO_NODES)
+			co->node[target].state = state;
+		return;
+	}
+	for (int i = 1; i < CO_NODES; i++)
+		if (co->node[i].seen)
+			co->node[i].state = state;
+}
+
+static void
+roll_window(co_engine_t *co, int64_t t)
+{
+	int64_t elapsed = t - co->window_start;
+
+	if (co->window_start == 0 || elapsed < 0) {
+		co->window_start = t;
+		return;
+	}
+	if (elapsed < USEC_PER_SEC)
+		return;
+
+	for (int i = 1; i < CO_NODES; i++) {
+		co_node_t *node = &co->node[i];
+
+		if (!node->seen)
+			continue;
+		node->tpdo_rate = (uint64_t) node->tpdo_window * USEC_PER_SEC / elapsed;
+		node->rpdo_rate = (uint64_t) node->rpdo_window * USEC_PER_SEC / elapsed;
+		node->tpdo_window = 0;
+		node->rpdo_window = 0;
+	}
+	co->window_start = t;
+}
+
+int
+co_process(co_engine_t *co, const can_packet_t *packet)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	const uint8_t *d = packet->data;
+	co_node_t *node;
+	uint8_t n, pdo;
+	int type;
+
+	type = co_classify(packet->id, &n, &pdo);
+	co->frames[type]++;
+	roll_window(co, t);
+
+	node = &co->node[n];
+	switch (type) {
+	case CO_NMT:
+		if (packet->dlc >= 2)
+			nmt_command(co, d[0], d[1]);
+		return type;
+
+	case CO_SYNC:
+		if (co->sync_last != 0)
+			co->sync_period = t - co->sync_last;
+		co->sync_last = t;
+		return type;
+
+	case CO_TIME:
+	case CO_LSS:
+	case CO_UNKNOWN:
+		return type;
+
+	case CO_EMCY:
+		node->emcy++;
+		if (packet->dlc >= 3) {
+			node->emcy_code = d[0] | (d[1] << 8);
+			node->emcy_register = d[2];
+		}
+		break;
+
+	case CO_TPDO:
+		node->tpdo[pdo - 1]++;
+		node->tpdo_window++;
+		break;
+
+	case CO_RPDO:
+		node->rpdo[pdo - 1]++;
+		node->rpdo_window++;
+		break;
+
+	case CO_SDO_RX:
+		if (packet->dlc == 8)
+			sdo_client(&node->sdo, d, t);
+		break;
+
+	case CO_SDO_TX:
+		if (packet->dlc == 8)
+			sdo_server(&node->sdo, d, t);
+		break;
+
+	case CO_HEARTBEAT:
+		if (packet->dlc < 1)
+			break;
+		node->state = d[0] & 0x7F;
+		if (node->state == CO_STATE_BOOTUP)
+			node->hb_last = 0;
+		if (node->hb_last != 0) {
+			uint32_t period = t - node->hb_last;
+
+			node->hb_period = period;
+			if (period < node->hb_min)
+				node->hb_min = period;
+			if (period > node->hb_max)
+				node->hb_max = period;
+		}
+		node->hb_last = t;
+		break;
+	}
+	node->seen = 1;
+
+	return type;
+}
@@ -0,0 +1,232 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "protocols/isotp.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC 1000000
+
+void
+isotp_init(isotp_engine_t *tp)
+{
+	memset(tp->channel, 0, sizeof(tp->channel));
+	memset(tp->pool_used, 0, sizeof(tp->pool_used));
+	tp->nchannels = 0;
+	tp->pdus = 0;
+	tp->seq_errors = 0;
+	tp->timeouts = 0;
+	tp->pool_exhausted = 0;
+	tp->overflows = 0;
+}
+
+int
+isotp_add_channel(isotp_engine_t *tp, uint32_t request_id, uint32_t response_id)
+{
+	isotp_channel_t *ch;
+
+	if (tp->nchannels >= ISOTP_CHANNELS)
+		return -1;
+
+	ch = &tp->channel[tp->nchannels];
+	memset(ch, 0, sizeof(*ch));
+	ch->id[ISOTP_REQUEST] = request_id;
+	ch->id[ISOTP_RESPONSE] = response_id;
+
+	return tp->nchannels++;
+}
+
+uint32_t
+isotp_stmin_usec(uint8_t stmin)
+{
+	if (stmin <= 0x7F)
+		return stmin * 1000;
+	if (stmin >= 0xF1 && stmin <= 0xF9)
+		return (stmin - 0xF0) * 100;
+
+	return 0x7F * 1000;
+}
+
+static void
+rx_release(isotp_engine_t *tp, isotp_rx_t *rx)
+{
+	if (rx->buf == NULL)
+		return;
+
+	tp->pool_used[(rx->buf - tp->pool[0]) / ISOTP_MAX] = 0;
+	rx->buf = NULL;
+}
+
+static uint8_t *
+pool_get(isotp_engine_t *tp, int64_t t)
+{
+	for (int pass = 0; pass < 2; pass++) {
+		for (int i = 0; i < ISOTP_BUFFERS; i++) {
+			if (!tp->pool_used[i]) {
+				tp->pool_used[i] = 1;
+				return tp->pool[i];
+			}
+		}
+
+		/* Reclaim the buffers of receptions that timed out */
+		for (int c = 0; c < tp->nchannels; c++) {
+			for (int d = 0; d < 2; d++) {
+				isotp_rx_t *rx = &tp->channel[c].rx[d];
+
+				if (rx->buf != NULL && t > rx->deadline) {
+					rx_release(tp, rx);
+					tp->timeouts++;
+				}
+			}
+		}
+	}
+
+	tp->pool_exhausted++;
+	return NULL;
+}
+
+static int
+complete(isotp_engine_t *tp, int channel, int direction, const uint8_t *data,
+    uint16_t len, int64_t start, int64_t end, isotp_pdu_t *pdu)
+{
+	pdu->channel = channel;
+	pdu->direction = direction;
+	pdu->data = data;
+	pdu->len = len;
+	pdu->start = start;
+	pdu->end = end;
+	tp->pdus++;
+
+	return 1;
+}
+
+int
+isotp_process(isotp_engine_t *tp, const can_packet_t *packet, isotp_pdu_t *pdu)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	const uint8_t *d = packet->data;
+	isotp_channel_t *ch = NULL;
+	isotp_rx_t *rx;
+	uint32_t id;
+	int c, dir = 0;
+	unsigned n;
+
+	if ((packet->id & (RTR_FLAG | ERR_FLAG)) || packet->dlc < 1)
+		return 0;
+
+	id = packet->id & (EFF_FLAG | EFF_MASK);
+	for (c = 0; c < tp->nchannels; c++) {
+		ch = &tp->channel[c];
+		if (ch->id[ISOTP_REQUEST] == id) {
+			dir = ISOTP_REQUEST;
+			break;
+		}
+		if (ch->id[ISOTP_RESPONSE] == id) {
+			dir = ISOTP_RESPONSE;
+			break;
+		}
+	}
+	if (c == tp->nchannels)
+		return 0;
+
+	rx = &ch->rx[dir];
+	switch (d[0] >> 4) {
+	case ISOTP_SF:
+		n = d[0] & 0x0F;
+		if (n == 0 || n + 1 > packet->dlc)
+			return 0;
+		/* A new PDU ends the reception in progress on this side */
+		rx_release(tp, rx);
+		return complete(tp, c, dir, d + 1, n, t, t, pdu);
+
+	case ISOTP_FF:
+		if (packet->dlc < 8)
+			return 0;
+		rx_release(tp, rx);
+		n = ((d[0] & 0x0F) << 8) | d[1];
+		/* Escaped 32 bit lengths are for CAN FD, out of range here */
+		if (n < 8)
+			return 0;
+		rx->buf = pool_get(tp, t);
+		if (rx->buf == NULL)
+			return 0;
+		rx->size = n;
+		memcpy(rx->buf, d + 2, 6);
+		rx->len = 6;
+		rx->seq = 1;
+		rx->start = t;
+		rx->deadline = t + ISOTP_N_CR;
+		return 0;
+
+	case ISOTP_CF:
+		if (rx->buf == NULL)
+			return 0;
+		if (t > rx->deadline) {
+			rx_release(tp, rx);
+			tp->timeouts++;
+			return 0;
+		}
+		if ((d[0] & 0x0F) != rx->seq) {
+			rx_release(tp, rx);
+			tp->seq_errors++;
+			return 0;
+		}
+		n = rx->size - rx->len;
+		if (n > 7)
+			n = 7;
+		if (n + 1 > packet->dlc) {
+			rx_release(tp, rx);
+			tp->seq_errors++;
+			return 0;
+		}
+		memcpy(rx->buf + rx->len, d + 1, n);
+		rx->len += n;
+		rx->seq = (rx->seq + 1) & 0x0F;
+		rx->deadline = t + ISOTP_N_CR;
+		if (rx->len < rx->size)
+			return 0;
+		complete(tp, c, dir, rx->buf, rx->size, rx->start, t, pdu);
+		/* The buffer keeps its data until a later first frame takes it */
+		rx_release(tp, rx);
+		return 1;
+
+	case ISOTP_FC:
+		if (packet->dlc < 3)
+			return 0;
+		if ((d[0] & 0x0F) == ISOTP_FC_OVFL) {
+			rx_release(tp, &ch->rx[!dir]);
+			tp->overflows++;
+			return 0;
+		}
+		ch->bs = d[1];
+		ch->stmin = d[2];
+		return 0;
+
+	default:
+		return 0;
+	}
+}
@@ -0,0 +1,424 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "protocols/j1939.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+#define CHECK_USEC      100000
+
+#define TP_RTS          16
+#define TP_CTS          17
+#define TP_EOMA         19
+#define TP_BAM          32
+#define TP_ABORT        255
+
+void
+j1939_split(uint32_t id, j1939_id_t *out)
+{
+	uint8_t pf, ps;
+
+	id &= EFF_MASK;
+	pf = (id >> 16) & 0xFF;
+	ps = (id >> 8) & 0xFF;
+
+	out->priority = (id >> 26) & 0x7;
+	out->sa = id & 0xFF;
+	/* EDP and DP are the two bits above PF */
+	out->pgn = (id >> 8) & 0x3FF00;
+	if (pf < 240) {
+		out->da = ps;
+	} else {
+		out->da = J1939_ADDR_GLOBAL;
+		out->pgn |= ps;
+	}
+}
+
+uint32_t
+j1939_make_id(const j1939_id_t *id)
+{
+	uint32_t r;
+
+	r = ((uint32_t) (id->priority & 0x7) << 26) | ((id->pgn & 0x3FF00) << 8) |
+	    id->sa;
+	if (((id->pgn >> 8) & 0xFF) < 240)
+		r |= (uint32_t) id->da << 8;
+	else
+		r |= (id->pgn & 0xFF) << 8;
+
+	return r | EFF_FLAG;
+}
+
+void
+j1939_init(j1939_engine_t *j)
+{
+	memset(j->session, 0, sizeof(j->session));
+	for (int i = 0; i < J1939_SESSIONS; i++)
+		j->session[i].buf = j->arena[i];
+
+	memset(j->pgn, 0, sizeof(j->pgn));
+	j->npgn = 0;
+	j->pgn_overflow = 0;
+	memset(j->address, 0, sizeof(j->address));
+	j->tp_completed = 0;
+	j->tp_aborted = 0;
+	j->tp_timeouts = 0;
+	j->tp_dropped = 0;
+	j->window_start = 0;
+	j->next_check = 0;
+}
+
+static uint32_t
+get_pgn(const uint8_t *d)
+{
+	return d[0] | (d[1] << 8) | ((d[2] & 0x03) << 16);
+}
+
+static j1939_pgn_stats_t *
+pgn_stats(j1939_engine_t *j, uint32_t pgn)
+{
+	uint32_t h = (pgn * 2654435761U) & (J1939_PGN_SLOTS - 1);
+
+	while (j->pgn[h].used) {
+		if (j->pgn[h].pgn == pgn)
+			return &j->pgn[h];
+		h = (h + 1) & (J1939_PGN_SLOTS - 1);
+	}
+
+	/* Keep the table half empty so probing stays short */
+	if (j->npgn >= J1939_PGN_SLOTS / 2) {
+		j->pgn_overflow++;
+		return NULL;
+	}
+	j->pgn[h].used = 1;
+	j->pgn[h].pgn = pgn;
+	j->npgn++;
+
+	return &j->pgn[h];
+}
+
+static void
+count_message(j1939_engine_t *j, uint32_t pgn, uint8_t sa, const uint8_t *data,
+    uint16_t len)
+{
+	j1939_pgn_stats_t *s = pgn_stats(j, pgn);
+
+	if (s == NULL)
+		return;
+	s->messages++;
+	s->window++;
+	s->bytes += len;
+	s->last_sa = sa;
+	s->last_len = len;
+	memset(s->last_data, 0, sizeof(s->last_data));
+	memcpy(s->last_data, data, (len < 8) ? len : 8);
+}
+
+static j1939_session_t *
+session_find(j1939_engine_t *j, uint8_t sa, uint8_t da)
+{
+	for (int i = 0; i < J1939_SESSIONS; i++) {
+		j1939_session_t *s = &j->session[i];
+
+		if (s->state != J1939_TP_IDLE && s->sa == sa && s->da == da)
+			return s;
+	}
+
+	return NULL;
+}
+
+static j1939_session_t *
+session_open(j1939_engine_t *j, uint8_t sa, uint8_t da)
+{
+	j1939_session_t *s = session_find(j, sa, da);
+
+	/* A new announce from the same originator drops the old session */
+	if (s != NULL) {
+		j->tp_aborted++;
+		return s;
+	}
+
+	for (int i = 0; i < J1939_SESSIONS; i++)
+		if (j->session[i].state == J1939_TP_IDLE)
+			return &j->session[i];
+
+	j->tp_dropped++;
+	return NULL;
+}
+
+static int
+session_complete(j1939_engine_t *j, j1939_session_t *s, j1939_message_t *msg)
+{
+	s->state = J1939_TP_IDLE;
+	j->tp_completed++;
+	count_message(j, s->pgn, s->sa, s->buf, s->size);
+
+	msg->id.priority = s->priority;
+	msg->id.pgn = s->pgn;
+	msg->id.sa = s->sa;
+	msg->id.da = s->da;
+	msg->data = s->buf;
+	msg->len = s->size;
+
+	return 1;
+}
+
+static void
+check_timeouts(j1939_engine_t *j, int64_t t)
+{
+	for (int i = 0; i < J1939_SESSIONS; i++) {
+		j1939_session_t *s = &j->session[i];
+
+		if (s->state != J1939_TP_IDLE && t > s->deadline) {
+			s->state = J1939_TP_IDLE;
+			j->tp_timeouts++;
+		}
+	}
+}
+
+static void
+roll_window(j1939_engine_t *j, int64_t t)
+{
+	int64_t elapsed = t - j->window_start;
+
+	if (j->window_start == 0 || elapsed < 0) {
+		j->window_start = t;
+		return;
+	}
+	if (elapsed < USEC_PER_SEC)
+		return;
+
+	for (int i = 0; i < J1939_PGN_SLOTS; i++) {
+		j1939_pgn_stats_t *s = &j->pgn[i];
+
+		if (!s->used)
+			continue;
+		s->rate = (uint64_t) s->window * USEC_PER_SEC / elapsed;
+		s->window = 0;
+	}
+	j->window_start = t;
+}
+
+static int
+tp_cm(j1939_engine_t *j, const j1939_id_t *id, const uint8_t *d, int64_t t,
+    j1939_message_t *msg)
+{
+	j1939_session_t *s;
+
+	switch (d[0]) {
+	case TP_RTS:
+	case TP_BAM:
+		if (d[0] == TP_BAM && id->da != J1939_ADDR_GLOBAL)
+			break;
+		s = session_open(j, id->sa, id->da);
+		if (s == NULL)
+			break;
+		s->size = d[1] | (d[2] << 8);
+		s->packets = d[3];
+		s->pgn = get_pgn(d + 5);
+		s->priority = id->priority;
+		s->sa = id->sa;
+		s->da = id->da;
+		s->next = 1;
+		if (s->size < 9 || s->size > J1939_TP_MAX ||
+		    s->packets != (s->size + 6) / 7) {
+			s->state = J1939_TP_IDLE;
+			j->tp_aborted++;
+			break;
+		}
+		if (d[0] == TP_BAM) {
+			s->state = J1939_TP_BAM;
+			s->window_end = s->packets;
+			s->deadline = t + J1939_T1;
+		} else {
+			s->state = J1939_TP_RTS;
+			s->window_end = 0;
+			s->deadline = t + J1939_T3;
+		}
+		break;
+
+	case TP_CTS:
+		/* From the responder to the originator */
+		s = session_find(j, id->da, id->sa);
+		if (s == NULL || s->state == J1939_TP_BAM)
+			break;
+		if (d[1] == 0) {
+			s->state = J1939_TP_HOLD;
+			s->deadline = t + J1939_T4;
+			break;
+		}
+		/* Packets are numbered from 1, a bad CTS is ignored */
+		if (d[2] == 0 || d[2] > s->packets)
+			break;
+		/* next may go back: the responder asks for a retransmission */
+		s->next = d[2];
+		s->window_end = (d[2] + d[1] - 1 > s->packets) ? s->packets :
+		    d[2] + d[1] - 1;
+		s->state = J1939_TP_DATA;
+		s->deadline = t + J1939_T2;
+		break;
+
+	case TP_EOMA:
+		s = session_find(j, id->da, id->sa);
+		if (s == NULL || s->state != J1939_TP_ACK)
+			break;
+		return session_complete(j, s, msg);
+
+	case TP_ABORT:
+		s = session_find(j, id->sa, id->da);
+		if (s == NULL)
+			s = session_find(j, id->da, id->sa);
+		if (s == NULL)
+			break;
+		s->state = J1939_TP_IDLE;
+		j->tp_aborted++;
+		break;
+
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int
+tp_dt(j1939_engine_t *j, const j1939_id_t *id, const uint8_t *d, int64_t t,
+    j1939_message_t *msg)
+{
+	j1939_session_t *s = session_find(j, id->sa, id->da);
+	unsigned offset, n;
+	uint8_t seq = d[0];
+
+	if (s == NULL || (s->state != J1939_TP_BAM && s->state != J1939_TP_DATA))
+		return 0;
+
+	/* Before the offset: seq 0 or past the end would write out of buf */
+	if (seq == 0 || seq > s->packets)
+		return 0;
+
+	if (seq != s->next || seq > s->window_end) {
+		if (s->state == J1939_TP_BAM) {
+			/* No retransmission on broadcast: the message is lost */
+			s->state = J1939_TP_IDLE;
+			j->tp_aborted++;
+		}
+		return 0;
+	}
+
+	offset = (seq - 1) * 7;
+	n = (s->size - offset < 7) ? s->size - offset : 7;
+	memcpy(s->buf + offset, d + 1, n);
+	s->next++;
+	s->deadline = t + J1939_T1;
+
+	if (seq < s->packets) {
+		if (s->state == J1939_TP_DATA && seq == s->window_end)
+			s->deadline = t + J1939_T3;
+		return 0;
+	}
+
+	if (s->state == J1939_TP_DATA) {
+		/* Complete once the responder acknowledges it */
+		s->state = J1939_TP_ACK;
+		s->deadline = t + J1939_T3;
+		return 0;
+	}
+
+	return session_complete(j, s, msg);
+}
+
+static void
+address_claim(j1939_engine_t *j, const j1939_id_t *id, const uint8_t *d,
+    int64_t t)
+{
+	j1939_address_t *a = &j->address[id->sa];
+	uint64_t name = 0;
+
+	for (int i = 7; i >= 0; i--)
+		name = (name << 8) | d[i];
+
+	/* Cannot claim address: the NAME is known, the address is not */
+	if (id->sa == J1939_ADDR_NULL)
+		return;
+
+	if (a->claimed && a->name != name) {
+		a->conflicts++;
+		/* The lower NAME wins the arbitration */
+		if (name > a->name)
+			return;
+	}
+	a->claimed = 1;
+	a->name = name;
+	a->last = t;
+}
+
+int
+j1939_process(j1939_engine_t *j, const can_packet_t *packet,
+    j1939_message_t *msg)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	j1939_pgn_stats_t *s;
+	j1939_id_t id;
+
+	if (!(packet->id & EFF_FLAG) || (packet->id & (RTR_FLAG | ERR_FLAG)))
+		return 0;
+
+	j1939_split(packet->id, &id);
+	roll_window(j, t);
+	if (t >= j->next_check) {
+		check_timeouts(j, t);
+		j->next_check = t + CHECK_USEC;
+	}
+
+	s = pgn_stats(j, id.pgn);
+	if (s != NULL)
+		s->frames++;
+
+	switch (id.pgn) {
+	case J1939_PGN_TP_CM:
+		return (packet->dlc == 8) ? tp_cm(j, &id, packet->data, t, msg) : 0;
+
+	case J1939_PGN_TP_DT:
+		return (packet->dlc == 8) ? tp_dt(j, &id, packet->data, t, msg) : 0;
+
+	case J1939_PGN_ADDRESS_CLAIM:
+		if (packet->dlc == 8)
+			address_claim(j, &id, packet->data, t);
+		break;
+
+	default:
+		break;
+	}
+
+	count_message(j, id.pgn, id.sa, packet->data, packet->dlc);
+	msg->id = id;
+	msg->data = packet->data;
+	msg->len = packet->dlc;
+
+	return 1;
+}
@@ -0,0 +1,656 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "protocols/nmea2000.h"
+#include "protocols/j1939.h"
+#include "canbus/can_drv.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+#define CHECK_USEC      100000
+
+/* 0.0001 rad and 0.01 K as degrees and Celsius */
+#define DEG             0.005729577951308232
+#define KELVIN          -273.15
+
+#define U(name, offset, bits, factor, add, unit) \
+	{ name, offset, bits, 0, factor, add, unit }
+#define S(name, offset, bits, factor, add, unit) \
+	{ name, offset, bits, 1, factor, add, unit }
+#define PGN(pgn, name, fast, fields) \
+	{ pgn, name, fast, sizeof(fields) / sizeof(fields[0]), fields }
+
+static const n2k_field_t f59392[] = {
+	U("Control", 0, 8, 1, 0, ""),
+	U("Group", 8, 8, 1, 0, ""),
+	U("PGN", 40, 24, 1, 0, ""),
+};
+
+static const n2k_field_t f59904[] = {
+	U("PGN", 0, 24, 1, 0, ""),
+};
+
+static const n2k_field_t f60928[] = {
+	U("Unique", 0, 21, 1, 0, ""),
+	U("Manufacturer", 21, 11, 1, 0, ""),
+	U("Function", 40, 8, 1, 0, ""),
+	U("Class", 49, 7, 1, 0, ""),
+	U("Industry", 60, 3, 1, 0, ""),
+};
+
+static const n2k_field_t f126992[] = {
+	U("Source", 8, 4, 1, 0, ""),
+	U("Date", 16, 16, 1, 0, "d"),
+	U("Time", 32, 32, 0.0001, 0, "s"),
+};
+
+static const n2k_field_t f126996[] = {
+	U("Version", 0, 16, 0.001, 0, ""),
+	U("Product", 16, 16, 1, 0, ""),
+};
+
+static const n2k_field_t f127245[] = {
+	U("Instance", 0, 8, 1, 0, ""),
+	U("Order", 8, 3, 1, 0, ""),
+	S("AngleOrder", 16, 16, DEG, 0, "deg"),
+	S("Position", 32, 16, DEG, 0, "deg"),
+};
+
+static const n2k_field_t f127250[] = {
+	U("Heading", 8, 16, DEG, 0, "deg"),
+	S("Deviation", 24, 16, DEG, 0, "deg"),
+	S("Variation", 40, 16, DEG, 0, "deg"),
+	U("Reference", 56, 2, 1, 0, ""),
+};
+
+static const n2k_field_t f127251[] = {
+	S("Rate", 8, 32, 3.125e-08 * 57.29577951308232, 0, "deg/s"),
+};
+
+static const n2k_field_t f127257[] = {
+	S("Yaw", 8, 16, DEG, 0, "deg"),
+	S("Pitch", 24, 16, DEG, 0, "deg"),
+	S("Roll", 40, 16, DEG, 0, "deg"),
+};
+
+static const n2k_field_t f127258[] = {
+	U("Source", 8, 4, 1, 0, ""),
+	U("Age", 16, 16, 1, 0, "d"),
+	S("Variation", 32, 16, DEG, 0, "deg"),
+};
+
+static const n2k_field_t f127488[] = {
+	U("Instance", 0, 8, 1, 0, ""),
+	U("Speed", 8, 16, 0.25, 0, "rpm"),
+	U("Boost", 24, 16, 100, 0, "Pa"),
+	S("Trim", 40, 8, 1, 0, "%"),
+};
+
+static const n2k_field_t f127489[] = {
+	U("Instance", 0, 8, 1, 0, ""),
+	U("OilPressure", 8, 16, 100, 0, "Pa"),
+	U("OilTemp", 24, 16, 0.1, KELVIN, "C"),
+	U("Temp", 40, 16, 0.01, KELVIN, "C"),
+	S("Alternator", 56, 16, 0.01, 0, "V"),
+	S("FuelRate", 72, 16, 0.1, 0, "L/h"),
+	U("Hours", 88, 32, 1, 0, "s"),
+	U("CoolantPressure", 120, 16, 100, 0, "Pa"),
+	U("FuelPressure", 136, 16, 1000, 0, "Pa"),
+	U("Status1", 160, 16, 1, 0, ""),
+	U("Status2", 176, 16, 1, 0, ""),
+	S("Load", 192, 8, 1, 0, "%"),
+	S("Torque", 200, 8, 1, 0, "%"),
+};
+
+static const n2k_field_t f127505[] = {
+	U("Instance", 0, 4, 1, 0, ""),
+	U("Type", 4, 4, 1, 0, ""),
+	S("Level", 8, 16, 0.004, 0, "%"),
+	U("Capacity", 24, 32, 0.1, 0, "L"),
+};
+
+static const n2k_field_t f127508[] = {
+	U("Instance", 0, 8, 1, 0, ""),
+	S("Voltage", 8, 16, 0.01, 0, "V"),
+	S("Current", 24, 16, 0.1, 0, "A"),
+	U("Temp", 40, 16, 0.01, KELVIN, "C"),
+};
+
+static const n2k_field_t f128259[] = {
+	U("Water", 8, 16, 0.01, 0, "m/s"),
+	U("Ground", 24, 16, 0.01, 0, "m/s"),
+};
+
+static const n2k_field_t f128267[] = {
+	U("Depth", 8, 32, 0.01, 0, "m"),
+	S("Offset", 40, 16, 0.001, 0, "m"),
+	U("Range", 56, 8, 10, 0, "m"),
+};
+
+static const n2k_field_t f129025[] = {
+	S("Lat", 0, 32, 1e-7, 0, "deg"),
+	S("Lon", 32, 32, 1e-7, 0, "deg"),
+};
+
+static const n2k_field_t f129026[] = {
+	U("Reference", 8, 2, 1, 0, ""),
+	U("COG", 16, 16, DEG, 0, "deg"),
+	U("SOG", 32, 16, 0.01, 0, "m/s"),
+};
+
+static const n2k_field_t f129029[] = {
+	U("Date", 8, 16, 1, 0, "d"),
+	U("Time", 24, 32, 0.0001, 0, "s"),
+	S("Lat", 56, 64, 1e-16, 0, "deg"),
+	S("Lon", 120, 64, 1e-16, 0, "deg"),
+	S("Alt", 184, 64, 1e-6, 0, "m"),
+	U("Type", 248, 4, 1, 0, ""),
+	U("Method", 252, 4, 1, 0, ""),
+	U("Sats", 264, 8, 1, 0, ""),
+	S("HDOP", 272, 16, 0.01, 0, ""),
+	S("PDOP", 288, 16, 0.01, 0, ""),
+	S("Geoid", 304, 32, 0.01, 0, "m"),
+};
+
+static const n2k_field_t f129033[] = {
+	U("Date", 0, 16, 1, 0, "d"),
+	U("Time", 16, 32, 0.0001, 0, "s"),
+	S("Offset", 48, 16, 1, 0, "min"),
+};
+
+/* AIS class A and B position reports share the head */
+static const n2k_field_t f129038[] = {
+	U("MMSI", 8, 32, 1, 0, ""),
+	S("Lon", 40, 32, 1e-7, 0, "deg"),
+	S("Lat", 72, 32, 1e-7, 0, "deg"),
+	U("COG", 112, 16, DEG, 0, "deg"),
+	U("SOG", 128, 16, 0.01, 0, "m/s"),
+};
+
+static const n2k_field_t f129283[] = {
+	U("Mode", 8, 4, 1, 0, ""),
+	S("XTE", 16, 32, 0.01, 0, "m"),
+};
+
+static const n2k_field_t f129284[] = {
+	U("Distance", 8, 32, 0.01, 0, "m"),
+	U("ETATime", 48, 32, 0.0001, 0, "s"),
+	U("ETADate", 80, 16, 1, 0, "d"),
+	U("BearingOrigin", 96, 16, DEG, 0, "deg"),
+	U("Bearing", 112, 16, DEG, 0, "deg"),
+	U("Origin", 128, 32, 1, 0, ""),
+	U("Destination", 160, 32, 1, 0, ""),
+	S("Lat", 192, 32, 1e-7, 0, "deg"),
+	S("Lon", 224, 32, 1e-7, 0, "deg"),
+	S("WCV", 256, 16, 0.01, 0, "m/s"),
+};
+
+static const n2k_field_t f129539[] = {
+	U("Desired", 8, 3, 1, 0, ""),
+	U("Actual", 11, 3, 1, 0, ""),
+	S("HDOP", 16, 16, 0.01, 0, ""),
+	S("VDOP", 32, 16, 0.01, 0, ""),
+	S("TDOP", 48, 16, 0.01, 0, ""),
+};
+
+static const n2k_field_t f129540[] = {
+	U("Mode", 8, 2, 1, 0, ""),
+	U("Sats", 16, 8, 1, 0, ""),
+};
+
+/* AIS static data reports */
+static const n2k_field_t f129794[] = {
+	U("MMSI", 8, 32, 1, 0, ""),
+};
+
+static const n2k_field_t f130306[] = {
+	U("Speed", 8, 16, 0.01, 0, "m/s"),
+	U("Angle", 24, 16, DEG, 0, "deg"),
+	U("Reference", 40, 3, 1, 0, ""),
+};
+
+static const n2k_field_t f130310[] = {
+	U("Water", 8, 16, 0.01, KELVIN, "C"),
+	U("Air", 24, 16, 0.01, KELVIN, "C"),
+	U("Pressure", 40, 16, 100, 0, "Pa"),
+};
+
+static const n2k_field_t f130311[] = {
+	U("TempSource", 8, 6, 1, 0, ""),
+	U("HumSource", 14, 2, 1, 0, ""),
+	U("Temp", 16, 16, 0.01, KELVIN, "C"),
+	S("Humidity", 32, 16, 0.004, 0, "%"),
+	U("Pressure", 48, 16, 100, 0, "Pa"),
+};
+
+static const n2k_field_t f130312[] = {
+	U("Instance", 8, 8, 1, 0, ""),
+	U("Source", 16, 8, 1, 0, ""),
+	U("Temp", 24, 16, 0.01, KELVIN, "C"),
+	U("Set", 40, 16, 0.01, KELVIN, "C"),
+};
+
+/* Sorted by PGN */
+static const n2k_pgn_info_t pgn_table[] = {
+	PGN(59392, "ISO Acknowledgement", 0, f59392),
+	PGN(59904, "ISO Request", 0, f59904),
+	PGN(60928, "ISO Address Claim", 0, f60928),
+	PGN(126992, "System Time", 0, f126992),
+	PGN(126996, "Product Information", 1, f126996),
+	PGN(127245, "Rudder", 0, f127245),
+	PGN(127250, "Vessel Heading", 0, f127250),
+	PGN(127251, "Rate of Turn", 0, f127251),
+	PGN(127257, "Attitude", 0, f127257),
+	PGN(127258, "Magnetic Variation", 0, f127258),
+	PGN(127488, "Engine Parameters, Rapid", 0, f127488),
+	PGN(127489, "Engine Parameters, Dynamic", 1, f127489),
+	PGN(127505, "Fluid Level", 0, f127505),
+	PGN(127508, "Battery Status", 0, f127508),
+	PGN(128259, "Speed", 0, f128259),
+	PGN(128267, "Water Depth", 0, f128267),
+	PGN(129025, "Position, Rapid", 0, f129025),
+	PGN(129026, "COG & SOG, Rapid", 0, f129026),
+	PGN(129029, "GNSS Position Data", 1, f129029),
+	PGN(129033, "Time & Date", 0, f129033),
+	PGN(129038, "AIS Class A Position", 1, f129038),
+	PGN(129039, "AIS Class B Position", 1, f129038),
+	PGN(129283, "Cross Track Error", 0, f129283),
+	PGN(129284, "Navigation Data", 1, f129284),
+	PGN(129539, "GNSS DOPs", 0, f129539),
+	PGN(129540, "GNSS Satellites in View", 1, f129540),
+	PGN(129794, "AIS Class A Static Data", 1, f129794),
+	PGN(129809, "AIS Class B Static Data A", 1, f129794),
+	PGN(129810, "AIS Class B Static Data B", 1, f129794),
+	PGN(130306, "Wind Data", 0, f130306),
+	PGN(130310, "Environmental Parameters", 0, f130310),
+	PGN(130311, "Environmental Parameters", 0, f130311),
+	PGN(130312, "Temperature", 0, f130312),
+};
+
+/* Fast-packet PGNs without a decoder, sorted */
+static const uint32_t fast_table[] = {
+	126208, 126464, 126720, 126983, 126984, 126985, 126986, 126987, 126988,
+	126998, 127233, 127237, 127496, 127497, 127498, 127503, 127504, 127506,
+	127507, 127509, 127510, 127511, 127512, 127513, 127514, 128275, 128520,
+	129041, 129044, 129045, 129285, 129301, 129302, 129538, 129541, 129542,
+	129545, 129547, 129549, 129551, 129556, 129792, 129793, 129795, 129796,
+	129797, 129798, 129799, 129800, 129801, 129802, 129803, 129804, 129805,
+	129806, 129807, 129808, 130052, 130053, 130054, 130060, 130061, 130064,
+	130065, 130066, 130067, 130068, 130069, 130070, 130071, 130072, 130073,
+	130074, 130320, 130321, 130322, 130323, 130324, 130560, 130567, 130577,
+	130578,
+};
+
+static int
+cmp_info(const void *key, const void *elem)
+{
+	uint32_t pgn = *(const uint32_t *) key;
+	uint32_t other = ((const n2k_pgn_info_t *) elem)->pgn;
+
+	return (pgn > other) - (pgn < other);
+}
+
+static int
+cmp_pgn(const void *key, const void *elem)
+{
+	uint32_t pgn = *(const uint32_t *) key;
+	uint32_t other = *(const uint32_t *) elem;
+
+	return (pgn > other) - (pgn < other);
+}
+
+const n2k_pgn_info_t *
+n2k_pgn_info(uint32_t pgn)
+{
+	return (const n2k_pgn_info_t *) bsearch(&pgn, pgn_table,
+	    sizeof(pgn_table) / sizeof(pgn_table[0]), sizeof(pgn_table[0]), cmp_info);
+}
+
+int
+n2k_is_fast(uint32_t pgn)
+{
+	const n2k_pgn_info_t *info = n2k_pgn_info(pgn);
+
+	if (info != NULL)
+		return info->fast;
+	/* Proprietary fast-packet range */
+	if (pgn >= 130816 && pgn <= 131071)
+		return 1;
+
+	return bsearch(&pgn, fast_table, sizeof(fast_table) / sizeof(fast_table[0]),
+	    sizeof(fast_table[0]), cmp_pgn) != NULL;
+}
+
+void
+n2k_init(n2k_engine_t *n)
+{
+	memset(n->slot, 0, sizeof(n->slot));
+	memset(n->pgn, 0, sizeof(n->pgn));
+	n->npgn = 0;
+	n->pgn_overflow = 0;
+	n->fp_completed = 0;
+	n->fp_lost = 0;
+	n->fp_timeouts = 0;
+	n->fp_dropped = 0;
+	n->fp_orphans = 0;
+	n->window_start = 0;
+	n->next_check = 0;
+}
+
+static n2k_pgn_stats_t *
+pgn_stats(n2k_engine_t *n, uint32_t pgn)
+{
+	uint32_t h = (pgn * 2654435761U) & (N2K_PGN_SLOTS - 1);
+
+	while (n->pgn[h].used) {
+		if (n->pgn[h].pgn == pgn)
+			return &n->pgn[h];
+		h = (h + 1) & (N2K_PGN_SLOTS - 1);
+	}
+
+	/* Keep the table half empty so probing stays short */
+	if (n->npgn >= N2K_PGN_SLOTS / 2) {
+		n->pgn_overflow++;
+		return NULL;
+	}
+	/* Resolved once per PGN, not per frame */
+	n->pgn[h].used = 1;
+	n->pgn[h].pgn = pgn;
+	n->pgn[h].info = n2k_pgn_info(pgn);
+	n->pgn[h].fast = n2k_is_fast(pgn);
+	n->npgn++;
+
+	return &n->pgn[h];
+}
+
+static void
+count_message(n2k_pgn_stats_t *s, uint8_t sa, const uint8_t *data, uint16_t len)
+{
+	s->messages++;
+	s->window++;
+	s->last_sa = sa;
+	s->last_len = len;
+	memcpy(s->last_data, data, len);
+}
+
+static void
+roll_window(n2k_engine_t *n, int64_t t)
+{
+	int64_t elapsed = t - n->window_start;
+
+	if (n->window_start == 0 || elapsed < 0) {
+		n->window_start = t;
+		return;
+	}
+	if (elapsed < USEC_PER_SEC)
+		return;
+
+	for (int i = 0; i < N2K_PGN_SLOTS; i++) {
+		n2k_pgn_stats_t *s = &n->pgn[i];
+
+		if (!s->used)
+			continue;
+		s->rate = (uint64_t) s->window * USEC_PER_SEC / elapsed;
+		s->window = 0;
+	}
+	n->window_start = t;
+}
+
+static void
+check_timeouts(n2k_engine_t *n, int64_t t)
+{
+	for (int i = 0; i < N2K_FP_SLOTS; i++) {
+		n2k_slot_t *s = &n->slot[i];
+
+		if (s->used && t > s->deadline) {
+			s->used = 0;
+			n->fp_timeouts++;
+		}
+	}
+}
+
+static uint32_t
+slot_hash(uint8_t sa, uint32_t pgn, uint8_t seq)
+{
+	return (((pgn << 11) | ((uint32_t) sa << 3) | seq) * 2654435761U) >> 16;
+}
+
+static n2k_slot_t *
+slot_find(n2k_engine_t *n, uint8_t sa, uint32_t pgn, uint8_t seq)
+{
+	uint32_t h = slot_hash(sa, pgn, seq);
+
+	/* Freed slots leave holes, so every probe position is checked */
+	for (int i = 0; i < N2K_FP_PROBE; i++) {
+		n2k_slot_t *s = &n->slot[(h + i) & (N2K_FP_SLOTS - 1)];
+
+		if (s->used && s->sa == sa && s->pgn == pgn && s->seq == seq)
+			return s;
+	}
+
+	return NULL;
+}
+
+static n2k_slot_t *
+slot_alloc(n2k_engine_t *n, uint8_t sa, uint32_t pgn, uint8_t seq, int64_t t)
+{
+	uint32_t h = slot_hash(sa, pgn, seq);
+
+	for (int i = 0; i < N2K_FP_PROBE; i++) {
+		n2k_slot_t *s = &n->slot[(h + i) & (N2K_FP_SLOTS - 1)];
+
+		if (s->used && t > s->deadline) {
+			s->used = 0;
+			n->fp_timeouts++;
+		}
+		if (!s->used) {
+			s->used = 1;
+			s->sa = sa;
+			s->pgn = pgn;
+			s->seq = seq;
+			return s;
+		}
+	}
+
+	n->fp_dropped++;
+	return NULL;
+}
+
+static int
+fast_packet(n2k_engine_t *n, const j1939_id_t *id, n2k_pgn_stats_t *stats,
+    const can_packet_t *packet, int64_t t, n2k_message_t *msg)
+{
+	const uint8_t *d = packet->data;
+	uint8_t counter = d[0] & 0x1F;
+	uint8_t seq = d[0] >> 5;
+	n2k_slot_t *s;
+	unsigned k;
+
+	if (packet->dlc < 2)
+		return 0;
+
+	s = slot_find(n, id->sa, id->pgn, seq);
+	if (counter == 0) {
+		if (s != NULL) {
+			/* Restarted before the previous one completed */
+			n->fp_lost++;
+		} else {
+			s = slot_alloc(n, id->sa, id->pgn, seq, t);
+			if (s == NULL)
+				return 0;
+		}
+		if (d[1] == 0 || d[1] > N2K_FAST_MAX) {
+			s->used = 0;
+			n->fp_lost++;
+			return 0;
+		}
+		s->size = d[1];
+		s->priority = id->priority;
+		s->da = id->da;
+		s->next = 1;
+		k = packet->dlc - 2;
+		if (k > 6)
+			k = 6;
+		if (k > s->size)
+			k = s->size;
+		memcpy(s->buf, d + 2, k);
+		s->len = k;
+	} else {
+		if (s == NULL) {
+			n->fp_orphans++;
+			return 0;
+		}
+		if (counter != s->next) {
+			s->used = 0;
+			n->fp_lost++;
+			return 0;
+		}
+		k = packet->dlc - 1;
+		if (k > 7)
+			k = 7;
+		if (k > (unsigned) (s->size - s->len))
+			k = s->size - s->len;
+		memcpy(s->buf + s->len, d + 1, k);
+		s->len += k;
+		s->next++;
+	}
+	s->deadline = t + N2K_FP_TIMEOUT;
+
+	if (s->len < s->size)
+		return 0;
+
+	/* The buffer stays untouched until a later frame reuses the slot */
+	s->used = 0;
+	n->fp_completed++;
+	if (stats != NULL)
+		count_message(stats, s->sa, s->buf, s->size);
+
+	msg->priority = s->priority;
+	msg->pgn = s->pgn;
+	msg->sa = s->sa;
+	msg->da = s->da;
+	msg->data = s->buf;
+	msg->len = s->size;
+
+	return 1;
+}
+
+int
+n2k_process(n2k_engine_t *n, const can_packet_t *packet, n2k_message_t *msg)
+{
+	int64_t t = packet->tv_sec * USEC_PER_SEC + packet->tv_usec;
+	n2k_pgn_stats_t *s;
+	j1939_id_t id;
+	uint8_t len;
+
+	if (!(packet->id & EFF_FLAG) || (packet->id & (RTR_FLAG | ERR_FLAG)))
+		return 0;
+
+	/* NMEA 2000 shares the J1939 identifier layout */
+	j1939_split(packet->id, &id);
+	roll_window(n, t);
+	if (t >= n->next_check) {
+		check_timeouts(n, t);
+		n->next_check = t + CHECK_USEC;
+	}
+
+	s = pgn_stats(n, id.pgn);
+	if (s != NULL)
+		s->frames++;
+
+	if ((s != NULL) ? s->fast : n2k_is_fast(id.pgn))
+		return fast_packet(n, &id, s, packet, t, msg);
+
+	len = (packet->dlc > 8) ? 8 : packet->dlc;
+	if (s != NULL)
+		count_message(s, id.sa, packet->data, len);
+	msg->priority = id.priority;
+	msg->pgn = id.pgn;
+	msg->sa = id.sa;
+	msg->da = id.da;
+	msg->data = packet->data;
+	msg->len = len;
+
+	return 1;
+}
+
+static int
+extract(const n2k_field_t *f, const uint8_t *data, uint16_t len, uint64_t *raw)
+{
+	unsigned first = f->offset / 8;
+	unsigned shift = f->offset % 8;
+	unsigned nbytes = (shift + f->bits + 7) / 8;
+	uint64_t mask = (f->bits == 64) ? ~0ULL : ((1ULL << f->bits) - 1);
+	uint64_t w = 0;
+
+	if (first + nbytes > len)
+		return 0;
+
+	for (unsigned i = 0; i < nbytes && i < 8; i++)
+		w |= (uint64_t) data[first + i] << (8 * i);
+	w >>= shift;
+	if (nbytes > 8)
+		w |= (uint64_t) data[first + 8] << (64 - shift);
+	*raw = w & mask;
+
+	/* One bit flags have no reserved value */
+	if (f->bits == 1)
+		return 1;
+	if (f->is_signed)
+		return *raw != (mask >> 1);
+
+	return *raw != mask;
+}
+
+int
+n2k_decode(const n2k_pgn_info_t *info, const uint8_t *data, uint16_t len,
+    double *values, uint8_t *present, int max)
+{
+	int n = (info->nfields < max) ? info->nfields : max;
+
+	for (int i = 0; i < n; i++) {
+		const n2k_field_t *f = &info->fields[i];
+		uint64_t raw;
+		double v;
+
+		present[i] = extract(f, data, len, &raw);
+		if (!present[i]) {
+			values[i] = 0.0;
+			continue;
+		}
+		if (f->is_signed && f->bits < 64 && (raw >> (f->bits - 1)))
+			v = (double) (int64_t) (raw | (~0ULL << f->bits));
+		else if (f->is_signed)
+			v = (double) (int64_t) raw;
+		else
+			v = (double) raw;
+		values[i] = v * f->factor + f->add;
+	}
+
+	return info->nfields;
+}
@@ -0,0 +1,213 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "protocols/uds.h"
+
+#include <string.h>
+
+typedef struct {
+	uint8_t code;
+	const char *name;
+} code_name_t;
+
+static const code_name_t service_names[] = {
+	{ 0x10, "DiagnosticSessionControl" },
+	{ 0x11, "ECUReset" },
+	{ 0x14, "ClearDiagnosticInformation" },
+	{ 0x19, "ReadDTCInformation" },
+	{ 0x22, "ReadDataByIdentifier" },
+	{ 0x23, "ReadMemoryByAddress" },
+	{ 0x24, "ReadScalingDataByIdentifier" },
+	{ 0x27, "SecurityAccess" },
+	{ 0x28, "CommunicationControl" },
+	{ 0x2A, "ReadDataByPeriodicIdentifier" },
+	{ 0x2C, "DynamicallyDefineDataIdentifier" },
+	{ 0x2E, "WriteDataByIdentifier" },
+	{ 0x2F, "InputOutputControlByIdentifier" },
+	{ 0x31, "RoutineControl" },
+	{ 0x34, "RequestDownload" },
+	{ 0x35, "RequestUpload" },
+	{ 0x36, "TransferData" },
+	{ 0x37, "RequestTransferExit" },
+	{ 0x38, "RequestFileTransfer" },
+	{ 0x3D, "WriteMemoryByAddress" },
+	{ 0x3E, "TesterPresent" },
+	{ 0x85, "ControlDTCSetting" },
+	{ 0x86, "ResponseOnEvent" },
+	{ 0x87, "LinkControl" },
+};
+
+static const code_name_t nrc_names[] = {
+	{ 0x10, "generalReject" },
+	{ 0x11, "serviceNotSupported" },
+	{ 0x12, "subFunctionNotSupported" },
+	{ 0x13, "incorrectMessageLengthOrInvalidFormat" },
+	{ 0x14, "responseTooLong" },
+	{ 0x21, "busyRepeatRequest" },
+	{ 0x22, "conditionsNotCorrect" },
+	{ 0x24, "requestSequenceError" },
+	{ 0x25, "noResponseFromSubnetComponent" },
+	{ 0x26, "failurePreventsExecutionOfRequestedAction" },
+	{ 0x31, "requestOutOfRange" },
+	{ 0x33, "securityAccessDenied" },
+	{ 0x35, "invalidKey" },
+	{ 0x36, "exceedNumberOfAttempts" },
+	{ 0x37, "requiredTimeDelayNotExpired" },
+	{ 0x70, "uploadDownloadNotAccepted" },
+	{ 0x71, "transferDataSuspended" },
+	{ 0x72, "generalProgrammingFailure" },
+	{ 0x73, "wrongBlockSequenceCounter" },
+	{ 0x78, "requestCorrectlyReceived-ResponsePending" },
+	{ 0x7E, "subFunctionNotSupportedInActiveSession" },
+	{ 0x7F, "serviceNotSupportedInActiveSession" },
+};
+
+static const char *
+lookup(const code_name_t *table, unsigned n, uint8_t code)
+{
+	for (unsigned i = 0; i < n; i++)
+		if (table[i].code == code)
+			return table[i].name;
+
+	return "Unknown";
+}
+
+const char *
+uds_service_name(uint8_t sid)
+{
+	return lookup(service_names, sizeof(service_names) / sizeof(service_names[0]), sid);
+}
+
+const char *
+uds_nrc_name(uint8_t nrc)
+{
+	return lookup(nrc_names, sizeof(nrc_names) / sizeof(nrc_names[0]), nrc);
+}
+
+/* Services whose sub-function byte may carry suppressPosRspMsgIndicationBit */
+static int
+has_subfunction(uint8_t sid)
+{
+	switch (sid) {
+	case 0x10: case 0x11: case 0x19: case 0x27: case 0x28: case 0x2C:
+	case 0x31: case 0x3E: case 0x85: case 0x86: case 0x87:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+void
+uds_init(uds_tracker_t *uds)
+{
+	memset(uds, 0, sizeof(*uds));
+}
+
+static uds_record_t *
+new_record(uds_tracker_t *uds, int channel)
+{
+	uds_record_t *r = &uds->record[uds->head % UDS_RECORDS];
+
+	memset(r, 0, sizeof(*r));
+	r->channel = channel;
+	r->sid = uds->request[channel].sid;
+	r->request_len = uds->request[channel].len;
+	r->time = uds->request[channel].end;
+	r->pending = uds->request[channel].pending;
+	uds->head++;
+
+	return r;
+}
+
+void
+uds_process(uds_tracker_t *uds, const isotp_pdu_t *pdu)
+{
+	int c = pdu->channel;
+	uds_record_t *r;
+	uint8_t sid;
+
+	if (pdu->len == 0 || c < 0 || c >= ISOTP_CHANNELS)
+		return;
+
+	/*
+	 * Silence is the expected answer of a suppressed request once P2 is
+	 * over, checked on the next PDU of the channel as there is no clock.
+	 */
+	if (uds->request[c].active && uds->request[c].suppressed &&
+	    pdu->start > uds->request[c].deadline) {
+		r = new_record(uds, c);
+		r->result = UDS_RESULT_NO_RESPONSE;
+		uds->request[c].active = 0;
+	}
+
+	if (pdu->direction == ISOTP_REQUEST) {
+		if (uds->request[c].active) {
+			r = new_record(uds, c);
+			r->result = UDS_RESULT_NO_RESPONSE;
+			if (!uds->request[c].suppressed)
+				uds->unanswered++;
+		}
+		uds->request[c].active = 1;
+		uds->request[c].sid = pdu->data[0];
+		uds->request[c].pending = 0;
+		uds->request[c].len = pdu->len;
+		uds->request[c].end = pdu->end;
+		uds->request[c].deadline = pdu->end + UDS_P2;
+
+		/* Positive response suppressed: only a negative one may come */
+		uds->request[c].suppressed = pdu->len >= 2 &&
+		    has_subfunction(pdu->data[0]) && (pdu->data[1] & 0x80);
+		return;
+	}
+
+	if (pdu->data[0] == UDS_NEGATIVE_RESPONSE) {
+		if (pdu->len < 3)
+			return;
+		sid = pdu->data[1];
+		if (pdu->data[2] == UDS_NRC_PENDING) {
+			uds->request[c].pending = 1;
+			uds->request[c].deadline = pdu->end + UDS_P2_EXT;
+			return;
+		}
+	} else
+		sid = pdu->data[0] - 0x40;
+
+	if (!uds->request[c].active || uds->request[c].sid != sid)
+		return;
+
+	r = new_record(uds, c);
+	r->response_len = pdu->len;
+	r->latency = pdu->start - uds->request[c].end;
+	if (pdu->data[0] == UDS_NEGATIVE_RESPONSE) {
+		r->result = UDS_RESULT_NEGATIVE;
+		r->nrc = pdu->data[2];
+		uds->negative++;
+	} else {
+		r->result = UDS_RESULT_POSITIVE;
+		uds->positive++;
+	}
+	uds->request[c].active = 0;
+}
@@ -58,6 +58,9 @@ QAppSettings::QAppSettings(QObject *parent)
 	case SIMULATION:
 		qDebug("Using connection over Simulation.");
 		break;
+	case GENERATOR:
+		qDebug("Using generated traffic.");
+		break;
 	default:
 		qDebug("No default connection. Please choose connection which you want to use.");
 
@@ -97,6 +100,29 @@ QAppSettings::QAppSettings(QObject *parent)
 	} else {
 		setValue("canNetServerPort", "8888");
 	}
+	if(contains("canNetFlushLatency")) {
+		qDebug("%s",qPrintable(value("canNetFlushLatency").toString()));
+	} else {
+		setValue("canNetFlushLatency", "1000");
+	}
+	if(contains("canNetOverflow")) {
+		qDebug("%s",qPrintable(value("canNetOverflow").toString()));
+	} else {
+		setValue("canNetOverflow", "drop");
+	}
+	if(!contains("PCANRcvBuf"))
+		setValue("PCANRcvBuf", "0");
+	if(!contains("PCANBusyPoll"))
+		setValue("PCANBusyPoll", "0");
+	if(!contains("PCANUring"))
+		setValue("PCANUring", "0");
+	if(!contains("GeneratorSpec"))
+		setValue("GeneratorSpec", "rate=1000 ids=100-1FF dlc=mix seed=1");
+	if(contains("canNetReconnect")) {
+		qDebug("%s",qPrintable(value("canNetReconnect").toString()));
+	} else {
+		setValue("canNetReconnect", "1000");
+	}
 
 	endGroup();
 
@@ -108,6 +134,53 @@ QAppSettings::QAppSettings(QObject *parent)
 	}
 	endGroup();
 
+	beginGroup("FlightRecorder");
+	if(!contains("Enabled"))
+		setValue("Enabled", "no");
+	if(!contains("Frames"))
+		setValue("Frames", "262144");
+	if(!contains("PreTriggerMs"))
+		setValue("PreTriggerMs", "10000");
+	if(!contains("PostTriggerMs"))
+		setValue("PostTriggerMs", "5000");
+	if(!contains("Directory"))
+		setValue("Directory", QDir::currentPath());
+	if(!contains("Format"))
+		setValue("Format", "tlog");
+	endGroup();
+
+	beginGroup("Database");
+	if(!contains("DbcFile"))
+		setValue("DbcFile", "");
+	endGroup();
+
+	beginGroup("IsoTp");
+	if(!contains("Channels"))
+		setValue("Channels", "7E0:7E8 7E1:7E9 7E2:7EA 7E3:7EB "
+				 "7E4:7EC 7E5:7ED 7E6:7EE 7E7:7EF");
+	endGroup();
+
+	beginGroup("BusLoad");
+	if(!contains("Stuffing"))
+		setValue("Stuffing", "actual");
+	endGroup();
+
+	beginGroup("Timing");
+	if(!contains("Tolerance"))
+		setValue("Tolerance", "50");
+	if(!contains("Expected"))
+		setValue("Expected", "");
+	endGroup();
+
+	beginGroup("Realtime");
+	if(!contains("Policy"))
+		setValue("Policy", "other");
+	if(!contains("Cpus"))
+		setValue("Cpus", "");
+	if(!contains("LockMemory"))
+		setValue("LockMemory", "no");
+	endGroup();
+
 	beginGroup("Paths");
 	if(contains("defaultOpenFilePath")) {
 		qDebug("%s",qPrintable(value("defaultOpenFilePath").toString()));
@@ -0,0 +1,124 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qbusloadanalyzer.h"
+#include "canbus/can_drv.h"
+
+#include <QMap>
+
+static QString percent(quint64 value, quint64 total)
+{
+	return QString::number((total != 0) ? value * 100.0 / total : 0.0, 'f', 2);
+}
+
+static QString hundredths(quint32 value)
+{
+	return QString::number(value / 100.0, 'f', 2) + "%";
+}
+
+QBusLoadAnalyzer::QBusLoadAnalyzer(int stuffing, QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	m_busload = new busload_engine_t;
+	m_view = new busload_engine_t;
+	busload_init(m_busload, 0, stuffing);
+}
+
+QBusLoadAnalyzer::~QBusLoadAnalyzer()
+{
+	delete m_busload;
+	delete m_view;
+}
+
+void QBusLoadAnalyzer::setBitrate(quint32 bitrate)
+{
+	QMutexLocker locker(&m_lock);
+
+	busload_init(m_busload, bitrate, m_busload->stuffing);
+}
+
+quint32 QBusLoadAnalyzer::load()
+{
+	QMutexLocker locker(&m_lock);
+
+	return m_busload->load_1s;
+}
+
+QString QBusLoadAnalyzer::title() const
+{
+	return tr("Bus load");
+}
+
+QStringList QBusLoadAnalyzer::header() const
+{
+	return QStringList() << "ID" << "Frames" << "TX frames" << "Bits"
+	       << "Share %" << "Last s bits" << "Bus %";
+}
+
+void QBusLoadAnalyzer::decode(const can_packet_t *packet)
+{
+	busload_update(m_busload, packet);
+}
+
+void QBusLoadAnalyzer::save()
+{
+	*m_view = *m_busload;
+}
+
+void QBusLoadAnalyzer::format(QList<QStringList> &rows, QString &summary)
+{
+	QMap<quint32, const busload_id_t *> sorted;
+	const busload_engine_t *b = m_view;
+
+	for (quint32 i = 0; i < b->nids; i++)
+		sorted[b->ids[i].id] = &b->ids[i];
+
+	foreach (const busload_id_t *s, sorted) {
+		rows.append(QStringList()
+		            << QString::number(s->id & EFF_MASK, 16).toUpper()
+		            << QString::number(s->frames)
+		            << QString::number(s->tx_frames)
+		            << QString::number(s->bits)
+		            << percent(s->bits, b->bits)
+		            << QString::number(s->last_window_bits)
+		            << percent(s->last_window_bits, b->bitrate));
+	}
+
+	summary = QString("10 ms: %1 (peak %2)  100 ms: %3 (peak %4)  1 s: %5 (peak %6)  "
+	                  "Frames: %7 (TX %8, errors %9)  Stuff bits: %10")
+	          .arg(hundredths(b->load_10ms)).arg(hundredths(b->peak_10ms))
+	          .arg(hundredths(b->load_100ms)).arg(hundredths(b->peak_100ms))
+	          .arg(hundredths(b->load_1s)).arg(hundredths(b->peak_1s))
+	          .arg(b->frames).arg(b->tx_frames).arg(b->error_frames)
+	          .arg(percent(b->stuff_bits, b->bits) + "%");
+	if (b->bitrate == 0)
+		summary += tr("  (bitrate unknown)");
+}
+
+void QBusLoadAnalyzer::clear()
+{
+	busload_reset(m_busload);
+}
@@ -24,13 +24,36 @@
 
 
 #include "qcanbuffer.h"
+#include "utils.h"
 
-QCanBuffer::QCanBuffer(QObject *parent) :
+QCanBuffer::QCanBuffer(const QString &name, QObject *parent) :
 	QObject(parent)
 {
+	QMetrics *metrics = QMetrics::instance();
+
+	m_queued = metrics->counter("consumer." + name + ".queued");
+	m_delivered = metrics->counter("consumer." + name + ".delivered");
+	m_latency = metrics->histogram("consumer." + name + ".latency_us");
+	metrics->addGauge("consumer." + name + ".queue_depth", m_queued, m_delivered);
+
+	connect(this, SIGNAL(packetQueued(can_packet_t)), this, SLOT(deliver(can_packet_t)),
+	        Qt::QueuedConnection);
 }
 
 void QCanBuffer::packetRecvFromThread(can_packet_t packet)
 {
+	m_queued->add();
+	emit packetQueued(packet);
+}
+
+void QCanBuffer::deliver(can_packet_t packet)
+{
+	int64_t sec, usec;
+
+	get_timestamp(&sec, &usec);
+	usec += (sec - packet.tv_sec) * 1000000 - packet.tv_usec;
+	m_latency->record((usec > 0) ? usec : 0);
+	m_delivered->add();
+
 	emit packetReceived(packet);
 }
@@ -0,0 +1,319 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qcanheadless.h"
+#include "qmetrics.h"
+#include "canbus/can_drv.h"
+#include "drivers/tcp_ops.h"
+#include "drivers/net_ops.h"
+#include "drivers/can_socket_ops.h"
+#include "utils.h"
+
+#include <QCoreApplication>
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#define POLL_MS 100
+
+static volatile sig_atomic_t s_shutdown_req;
+
+static void signal_shutdown(int)
+{
+	s_shutdown_req = 1;
+}
+
+QCanHeadless::QCanHeadless(const headless_options_t &options, QObject *parent) :
+	QObject(parent)
+{
+	m_options = options;
+	m_sk = NULL;
+	m_recvthr = NULL;
+	m_replay = NULL;
+	m_writer = new QCaptureWriter(this);
+	m_writer->setFilter(options.filter);
+	m_load = new QBusLoadAnalyzer(BUSLOAD_STUFF_ACTUAL, this);
+	m_load->setBitrate(options.bitrate);
+	m_errors = new QErrorAnalyzer(this);
+	m_last_msec = 0;
+	m_last_frames = 0;
+	m_done = false;
+	m_exporter = NULL;
+	m_bus_state = NULL;
+	m_bus_transitions = NULL;
+	m_bus_load = QMetrics::instance()->level("bus.load_basis_points");
+	m_last_state = -1;
+	m_reported = false;
+
+	m_poll = new QTimer(this);
+	connect(m_poll, SIGNAL(timeout()), this, SLOT(poll()));
+	m_stats = new QTimer(this);
+	connect(m_stats, SIGNAL(timeout()), this, SLOT(printStats()));
+}
+
+QCanHeadless::~QCanHeadless()
+{
+	closeDevice();
+}
+
+int QCanHeadless::installSignalHandlers()
+{
+#ifdef __linux
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = signal_shutdown;
+	sigemptyset(&sa.sa_mask);
+
+	if (sigaction(SIGINT, &sa, NULL) < 0 || sigaction(SIGTERM, &sa, NULL) < 0)
+		return -1;
+	return 0;
+#else
+	if (signal(SIGINT, signal_shutdown) == SIG_ERR ||
+	    signal(SIGTERM, signal_shutdown) == SIG_ERR)
+		return -1;
+	return 0;
+#endif
+}
+
+bool QCanHeadless::start(QString &error)
+{
+	QString driver = m_options.driver.toLower();
+	QString device = m_options.device;
+
+	QRealtime::configure(m_options.realtime);
+
+	if (driver == "socketcan") {
+		can_ops = get_can_ops("PCAN-USB");
+		if (can_ops != NULL) {
+			can_ops->attribute_set(CAN_SOCKET_RCVBUF, &m_options.rcvbuf,
+			                       sizeof(uint32_t));
+			can_ops->attribute_set(CAN_SOCKET_BUSY_POLL, &m_options.busy_poll,
+			                       sizeof(uint32_t));
+			can_ops->attribute_set(CAN_SOCKET_URING, &m_options.uring,
+			                       sizeof(uint32_t));
+		}
+	} else if (driver == "tcp" || driver == "udp") {
+		QStringList fields = device.split(':');
+		QByteArray addr = fields.at(0).toLatin1();
+		uint16_t port = (fields.size() > 1) ? fields.at(1).toUShort() : 0;
+
+		can_ops = get_can_ops((driver == "tcp") ? "CAN Over TCP" : "CAN Over UDP");
+		if (can_ops != NULL) {
+			can_ops->attribute_set((driver == "tcp") ? TCP_SOCKET_ADDR : NET_SOCKET_ADDR,
+			                       addr.constData(), addr.length());
+			can_ops->attribute_set((driver == "tcp") ? TCP_SOCKET_PORT : NET_SOCKET_PORT,
+			                       &port, sizeof(uint16_t));
+		}
+	} else if (driver == "sim") {
+		can_ops = get_can_ops("Simulation");
+	} else if (driver == "gen") {
+		can_ops = get_can_ops("Generator");
+	} else {
+		can_ops = NULL;
+	}
+	if (can_ops == NULL) {
+		error = tr("Driver %1 not supported").arg(m_options.driver);
+		return false;
+	}
+
+	if (!m_options.capture.isEmpty() && !m_writer->open(m_options.capture)) {
+		error = tr("Cannot write %1").arg(m_options.capture);
+		return false;
+	}
+
+	m_sk = new QCanSocket(device, m_options.bitrate);
+	if (m_sk->connect() <= 0) {
+		error = tr("Device %1 is not present").arg(device);
+		closeDevice();
+		return false;
+	}
+	if (m_sk->start() < 0) {
+		error = tr("Device %1 is not working").arg(device);
+		closeDevice();
+		return false;
+	}
+	m_sk->setTxConsumer(m_load);
+
+	if (!m_options.replay.isEmpty()) {
+		m_replay = new QCaptureReplay(m_sk, this);
+		if (!m_replay->open(m_options.replay)) {
+			error = tr("%1 is not a capture").arg(m_options.replay);
+			closeDevice();
+			return false;
+		}
+		m_replay->setFilter(m_options.filter);
+		m_replay->setSpeed(m_options.speed);
+		m_replay->setLoops(m_options.loops);
+		connect(m_replay, SIGNAL(finished()), this, SLOT(shutdown()));
+	}
+
+	m_recvthr = new QCanRecvThread(m_sk);
+	m_recvthr->linkPacketConsumer(m_writer);
+	m_recvthr->linkPacketConsumer(m_load);
+	m_recvthr->linkPacketConsumer(m_errors);
+	/* Set at creation, so a real-time policy set by the thread stays */
+	m_recvthr->start(QThread::HighestPriority);
+	if (m_replay != NULL)
+		m_replay->start();
+
+	if (!m_options.metrics_listen.isEmpty()) {
+		m_exporter = new QMetricsExporter(device, this);
+		if (!m_exporter->listen(m_options.metrics_listen, error))
+			return false;
+	}
+
+	m_clock.start();
+	m_poll->start(POLL_MS);
+	if (m_options.stats_sec != 0)
+		m_stats->start(m_options.stats_sec * 1000);
+	if (m_options.duration_sec != 0)
+		QTimer::singleShot(m_options.duration_sec * 1000, this, SLOT(shutdown()));
+
+	return true;
+}
+
+void QCanHeadless::poll()
+{
+	qcan_state_t state = QCAN_STATE_UNKNOWN;
+
+	if (s_shutdown_req) {
+		shutdown();
+		return;
+	}
+
+	/* The threads applied their settings by the first poll */
+	if (!m_reported) {
+		foreach (const QString &line, QRealtime::report())
+			fprintf(stderr, "%s\n", qPrintable(line));
+		m_reported = true;
+	}
+
+	if (m_sk != NULL && m_sk->getCanBusState(&state) == 0 &&
+	    state != QCAN_STATE_UNKNOWN) {
+		/* Registered on the first state, drivers without one never export it */
+		if (m_bus_state == NULL) {
+			m_bus_state = QMetrics::instance()->level("bus.state");
+			m_bus_transitions = QMetrics::instance()->counter("bus.state_transitions");
+		}
+		if (m_last_state >= 0 && (int) state != m_last_state)
+			m_bus_transitions->add(1);
+		m_last_state = state;
+		m_bus_state->set(state);
+	}
+	m_bus_load->set(m_load->load());
+}
+
+void QCanHeadless::printStats()
+{
+	qint64 msec = m_clock.elapsed();
+	quint64 frames = m_writer->frames();
+	quint32 load = m_load->load();
+	quint64 dropped = m_drops.poll();
+	double rate = 0.0;
+
+	if (msec > m_last_msec)
+		rate = (frames - m_last_frames) * 1000.0 / (msec - m_last_msec);
+	m_last_msec = msec;
+	m_last_frames = frames;
+
+	fprintf(stderr, "%8.1f s  rx %llu (%.0f/s)  err %llu  accepted %llu",
+	        msec / 1000.0, (unsigned long long) frames, rate,
+	        (unsigned long long) m_writer->errors(),
+	        (unsigned long long) m_writer->accepted());
+	if (!m_options.capture.isEmpty())
+		fprintf(stderr, "  written %llu%s", (unsigned long long) m_writer->written(),
+		        m_writer->failed() ? " (write error)" : "");
+	if (m_options.bitrate != 0)
+		fprintf(stderr, "  load %u.%02u%%", load / 100, load % 100);
+	if (m_drops.total() != 0)
+		fprintf(stderr, "  dropped %llu (+%llu)", (unsigned long long) m_drops.total(),
+		        (unsigned long long) dropped);
+	if (m_replay != NULL)
+		fprintf(stderr, "  tx %llu/%llu failed %llu",
+		        (unsigned long long) m_replay->sent(),
+		        (unsigned long long) m_replay->frames(),
+		        (unsigned long long) m_replay->failed());
+	fprintf(stderr, "\n");
+
+	/* Hand the buffered frames to the OS at least once per period */
+	m_writer->requestFlush();
+}
+
+void QCanHeadless::closeDevice()
+{
+	if (m_replay != NULL) {
+		m_replay->stop();
+		m_replay->wait();
+	}
+
+	/* Every frame received is in the capture before it is closed */
+	if (m_recvthr != NULL) {
+		m_recvthr->stop();
+		m_recvthr->unlinkPacketConsumer(m_writer);
+		m_recvthr->unlinkPacketConsumer(m_load);
+		m_recvthr->unlinkPacketConsumer(m_errors);
+		delete m_recvthr;
+		m_recvthr = NULL;
+	}
+	m_writer->close();
+
+	if (m_sk != NULL) {
+		m_sk->setTxConsumer(NULL);
+		m_sk->disconnect();
+		m_sk->close();
+		delete m_sk;
+		m_sk = NULL;
+	}
+
+	delete m_replay;
+	m_replay = NULL;
+}
+
+void QCanHeadless::shutdown()
+{
+	if (m_done)
+		return;
+	m_done = true;
+
+	m_poll->stop();
+	m_stats->stop();
+	closeDevice();
+	printStats();
+
+	if (!m_options.metrics.isEmpty()) {
+		FILE *fp = fopen(m_options.metrics.toLocal8Bit().constData(), "w");
+
+		if (fp != NULL) {
+			fprintf(fp, "%s\n", qPrintable(QMetrics::instance()->toJson()));
+			fclose(fp);
+		} else
+			fprintf(stderr, "Cannot write %s\n", qPrintable(m_options.metrics));
+	}
+
+	QCoreApplication::exit(m_writer->failed() ? 2 : 0);
+}
@@ -26,14 +26,23 @@
 #include "qcanmonitor.h"
 #include "canbus/can_drv.h"
 
-#include <QRegExp>
-
 
 QCanMonitor::QCanMonitor(QObject *parent) :
 	QCanPacketConsumer(parent),
-	m_reg_pattern("[0-9a-fA-F]+$")
+	m_filter(compile("[0-9a-fA-F]+$"))
+{
+
+}
+
+QCanMonitor::filter_t *QCanMonitor::compile(const QString &pattern)
 {
+	filter_t *filter = new filter_t;
+
+	filter->regexp = QRegExp(pattern, Qt::CaseInsensitive);
+	/* An empty or invalid pattern shows every frame */
+	filter->all = pattern.isEmpty() || !filter->regexp.isValid();
 
+	return filter;
 }
 
 void QCanMonitor::canPacketRecv(can_packet_t packet)
@@ -43,20 +52,22 @@ void QCanMonitor::canPacketRecv(can_packet_t packet)
 
 bool QCanMonitor::filterCallback(can_packet_t *packet)
 {
-	bool match = false;
-	QString strPktId = QString::number(packet->id & EFF_MASK, 16);
-	if (! m_reg_pattern.isEmpty()) {
-		QRegExp regexp = QRegExp(m_reg_pattern);
-		regexp.setCaseSensitivity(Qt::CaseInsensitive);
-		match = (regexp.isValid()) ?
-		        regexp.exactMatch(strPktId) : true;
-	} else
-		match = true;
+	const filter_t *filter = m_filter.readLock();
+	bool match;
+
+	/* The ID of an error frame is its error class, an ID filter never matches it */
+	if (packet->id & ERR_FLAG)
+		match = filter->all;
+	else
+		match = filter->all ||
+		    filter->regexp.exactMatch(QString::number(packet->id & EFF_MASK, 16));
+
+	m_filter.readUnlock();
 
 	return match;
 }
 
 void QCanMonitor::setFilterId(const QString &string)
 {
-	m_reg_pattern = string;
+	m_filter.publish(compile(string));
 }
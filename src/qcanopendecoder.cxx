@@ -0,0 +1,122 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qcanopendecoder.h"
+
+static QString usecToMs(quint32 usec)
+{
+	return QString::number(usec / 1000.0, 'f', 1);
+}
+
+static QString hex(quint32 value, int width)
+{
+	return QString::number(value, 16).rightJustified(width, '0').toUpper();
+}
+
+QCanOpenDecoder::QCanOpenDecoder(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Allocated once, decoding never allocates */
+	m_co = new co_engine_t;
+	m_view = new co_engine_t;
+	co_init(m_co);
+}
+
+QCanOpenDecoder::~QCanOpenDecoder()
+{
+	delete m_co;
+	delete m_view;
+}
+
+QString QCanOpenDecoder::title() const
+{
+	return tr("CANopen nodes");
+}
+
+QStringList QCanOpenDecoder::header() const
+{
+	return QStringList() << "Node" << "State" << "HB ms" << "HB min/max"
+	       << "TPDO/s" << "RPDO/s" << "EMCY" << "SDO ok/abort" << "Last SDO";
+}
+
+void QCanOpenDecoder::decode(const can_packet_t *packet)
+{
+	co_process(m_co, packet);
+}
+
+void QCanOpenDecoder::save()
+{
+	*m_view = *m_co;
+}
+
+void QCanOpenDecoder::format(QList<QStringList> &rows, QString &summary)
+{
+	for (int i = 1; i < CO_NODES; i++) {
+		const co_node_t *node = &m_view->node[i];
+		const co_sdo_result_t *r = &node->sdo.result;
+		QString emcy, sdo;
+
+		if (!node->seen)
+			continue;
+
+		emcy = QString::number(node->emcy);
+		if (node->emcy != 0)
+			emcy += QString(" (%1h)").arg(hex(node->emcy_code, 4));
+
+		if (node->sdo.completed + node->sdo.aborted != 0) {
+			sdo = QString("%1 %2:%3 ")
+			      .arg((r->direction == CO_SDO_UPLOAD) ? "Upload" : "Download")
+			      .arg(hex(r->index, 4)).arg(hex(r->subindex, 2));
+			if (r->abort_code != 0)
+				sdo += QString("abort %1h").arg(hex(r->abort_code, 8));
+			else
+				sdo += QString("%1 bytes%2 %3 ms").arg(r->size)
+				       .arg(r->block ? " block" : "").arg(usecToMs(r->usec));
+		}
+
+		rows.append(QStringList()
+		            << QString::number(i)
+		            << co_state_name(node->state)
+		            << ((node->hb_period != 0) ? usecToMs(node->hb_period) : "-")
+		            << ((node->hb_max != 0) ? usecToMs(node->hb_min) + " / " +
+		                usecToMs(node->hb_max) : "-")
+		            << QString::number(node->tpdo_rate)
+		            << QString::number(node->rpdo_rate)
+		            << emcy
+		            << QString("%1 / %2").arg(node->sdo.completed).arg(node->sdo.aborted)
+		            << sdo);
+	}
+
+	summary = QString("SYNC: %1 (%2 ms)  NMT: %3  TIME: %4  LSS: %5  Other: %6")
+	          .arg(m_view->frames[CO_SYNC]).arg(usecToMs(m_view->sync_period))
+	          .arg(m_view->frames[CO_NMT]).arg(m_view->frames[CO_TIME])
+	          .arg(m_view->frames[CO_LSS]).arg(m_view->frames[CO_UNKNOWN]);
+}
+
+void QCanOpenDecoder::clear()
+{
+	co_init(m_co);
+}
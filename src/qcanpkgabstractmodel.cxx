@@ -55,7 +55,7 @@ int QCanPkgAbstractModel::rowCount(const QModelIndex &parent) const
 int QCanPkgAbstractModel::columnCount(const QModelIndex &parent) const
 {
 	Q_UNUSED(parent);
-	return 7;
+	return 8;
 }
 
 QVariant QCanPkgAbstractModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -85,6 +85,9 @@ QVariant QCanPkgAbstractModel::headerData(int section, Qt::Orientation orientati
 			case 6 :
 				return tr("Dir");
 				break;
+			case 7 :
+				return tr("Signals");
+				break;
 			default :
 				break;
 			}
@@ -110,6 +113,7 @@ QVariant QCanPkgAbstractModel::data(const QModelIndex &index, int role) const
 			case 3:
 				return QVariant(Qt::AlignRight | Qt::AlignVCenter);
 			case 5:
+			case 7:
 				return QVariant(Qt::AlignLeft | Qt::AlignVCenter);
 			default:
 				return QVariant(Qt::AlignCenter | Qt::AlignVCenter);
@@ -146,6 +150,10 @@ QVariant QCanPkgAbstractModel::data(const QModelIndex &index, int role) const
 			case 6 : {
 				ret = QVariant(canpkg.direction);
 			}
+			break;
+			case 7 : {
+				ret = QVariant(canpkg.decoded);
+			}
 			default :
 				break;
 			}
@@ -184,7 +192,7 @@ QMimeData* QCanPkgAbstractModel::mimeData(const QModelIndexList &indexes) const
 			continue;
 		} else {
 			for(int i = 0; i < columnCount(); i++) {
-				if((i==2) || (i==3)) {
+				if((i==2) || (i==3) || (i==7)) {
 					continue;
 				} else {
 					QModelIndex index2 = this->index(actualRow, i);
@@ -24,24 +24,37 @@
 
 #include "qcanrecvthread.h"
 #include "os_utils.h"
+#include "qrealtime.h"
 #include "canbus/can_drv.h"
+#include "utils.h"
 
 #include <QDebug>
+#include <QCoreApplication>
 
 QCanRecvThread::QCanRecvThread(QCanSocket *sk, QObject *parent) :
-	QThread(parent)
+	QThread(parent),
+	m_stop(0),
+	m_woken(0),
+	m_filter_list(new FilterList)
 {
 	this->sk = sk;
 
 	moveToThread(this);
-	m_stop = false;
+
+	m_frames = QMetrics::instance()->counter("recv.frames");
+	m_error_frames = QMetrics::instance()->counter("recv.error_frames");
+	m_kernel_dropped = QMetrics::instance()->counter("recv.kernel_dropped");
+	m_last_dropped = 0;
+	m_wakeup = QMetrics::instance()->histogram("recv.wakeup_us");
+	m_cpu = QMetrics::instance()->counter("recv.cpu_us");
+	m_cpu_sec = 0;
 }
 
 QCanRecvThread::~QCanRecvThread()
 {
-	QList<ConnectionFilter *>::const_iterator it;
+	FilterList::const_iterator it;
 
-	for (it = m_filter_list.begin(); it != m_filter_list.end(); ++it)
+	for (it = m_filter_list.value()->begin(); it != m_filter_list.value()->end(); ++it)
 		delete (*it);
 }
 
@@ -49,49 +62,83 @@ void QCanRecvThread::run()
 {
 	int r;
 	can_packet_t packet;
+	quint32 dropped;
+	int64_t sec, usec;
 
-	while (!m_stop) {
+	QRealtime::enter(QRealtime::Receive);
+	while (!m_stop.loadAcquire()) {
 		r = sk->recv(&packet.id, &packet.dlc, (void *) packet.data, &packet.tv_sec,
 		             &packet.tv_usec);
 		if (r <= 0) {
-			m_stop = 1;
-			continue;
+			/* Woken up by stop(), else the driver has no more frames */
+			if (r == 0 && m_woken.testAndSetOrdered(1, 0))
+				continue;
+			break;
 		}
 		packet.direction = DIRECTION_RX;
-		QList<ConnectionFilter *>::iterator it;
+		get_timestamp(&sec, &usec);
+		m_frames->add();
+		usec += (sec - packet.tv_sec) * 1000000 - packet.tv_usec;
+		m_wakeup->record((usec > 0) ? usec : 0);
+		if (sec != m_cpu_sec && get_thread_cputime(&usec) == 0) {
+			m_cpu->set(usec);
+			m_cpu_sec = sec;
+		}
+		if (packet.id & ERR_FLAG)
+			m_error_frames->add();
+		/* Drops of the socket so far, the driver reports them with the frames */
+		if (sk->rxDropped(&dropped) == 0 && dropped != m_last_dropped) {
+			m_kernel_dropped->add(dropped - m_last_dropped);
+			m_last_dropped = dropped;
+		}
+		const FilterList *filters = m_filter_list.readLock();
+		FilterList::const_iterator it;
 
-		for (it = m_filter_list.begin(); it != m_filter_list.end(); ++it) {
+		for (it = filters->begin(); it != filters->end(); ++it) {
+			(*it)->received->add();
 			if (!(*it)->consumer->filterCallback(&packet))
 				continue;
 
 			QCanBuffer *buffer = (*it)->buffer;
 			buffer->packetRecvFromThread(packet);
 		}
-		if (packet.id & ERR_FLAG)
-			QThread::usleep(2000);
+		m_filter_list.readUnlock();
 
 		emit packetReceived(packet);
 	}
-	QThread::run();
 }
 
 void QCanRecvThread::stop()
 {
-	m_stop = true;
+	m_stop.storeRelease(1);
+	if (!isRunning())
+		return;
+
+	/*
+	 * A wakeup left by a thread that saw m_stop first is taken by the
+	 * first recv after a restart, m_woken tells it apart from the end.
+	 */
+	m_woken.storeRelease(1);
+	sk->wakeup();
+	wait();
 }
 
 void QCanRecvThread::restart()
 {
-	m_stop = false;
-	run();
+	stop();
+	m_stop.storeRelease(0);
+	/* Set at creation, so a real-time policy set by the thread stays */
+	start(QThread::HighestPriority);
 }
 
 void QCanRecvThread::linkPacketConsumer(QCanPacketConsumer *pkt_consumer)
 {
-	QCanBuffer *buffer = new QCanBuffer;
+	QCanBuffer *buffer = new QCanBuffer(consumerName(pkt_consumer));
 
+	/* The buffer queues to its own thread, then calls the consumer */
+	buffer->moveToThread(pkt_consumer->thread());
 	connect(buffer, SIGNAL(packetReceived(can_packet_t)), pkt_consumer, SLOT(canPacketRecv(can_packet_t)),
-	        Qt::QueuedConnection);
+	        Qt::DirectConnection);
 	m_map_buffers[pkt_consumer] = buffer;
 	addFilterRule(pkt_consumer, buffer);
 }
@@ -101,19 +148,28 @@ void QCanRecvThread::unlinkPacketConsumer(QCanPacketConsumer *pkt_consumer)
 	if (! m_map_buffers.contains(pkt_consumer))
 		return;
 
-	QCanBuffer *buffer = m_map_buffers[pkt_consumer];
+	QCanBuffer *buffer = m_map_buffers.take(pkt_consumer);
 
-	disconnect(buffer);
-	delete buffer;
-	m_map_buffers.remove(pkt_consumer);
+	/* Returns once the receive thread can't hand it frames any more */
 	removeFilterRule(pkt_consumer);
+	/* Queued frames are delivered before the buffer goes */
+	if (buffer->thread() == QThread::currentThread()) {
+		QCoreApplication::sendPostedEvents(buffer, QEvent::MetaCall);
+		delete buffer;
+	} else
+		buffer->deleteLater();
 }
 
 void QCanRecvThread::addFilterRule(QCanPacketConsumer *consumer, QCanBuffer *buffer)
 {
-	ConnectionFilter *filter = new ConnectionFilter(consumer, buffer);
+	QString name = "consumer." + consumerName(consumer) + ".received";
+	ConnectionFilter *filter = new ConnectionFilter(consumer, buffer,
+	                                                QMetrics::instance()->counter(name));
+	FilterList *filters = new FilterList(*m_filter_list.value());
+
 	m_map_filters[consumer] = filter;
-	m_filter_list.append(filter);
+	filters->append(filter);
+	m_filter_list.publish(filters);
 }
 
 void QCanRecvThread::removeFilterRule(QCanPacketConsumer *consumer)
@@ -121,8 +177,18 @@ void QCanRecvThread::removeFilterRule(QCanPacketConsumer *consumer)
 	if (! m_map_filters.contains(consumer))
 		return;
 
-	ConnectionFilter *filter = m_map_filters[consumer];
+	ConnectionFilter *filter = m_map_filters.take(consumer);
+	FilterList *filters = new FilterList(*m_filter_list.value());
+
+	filters->removeOne(filter);
+	m_filter_list.publish(filters);
 	delete filter;
-	m_map_filters.remove(consumer);
-	m_filter_list.removeOne(filter);
+}
+
+QString QCanRecvThread::consumerName(QCanPacketConsumer *consumer)
+{
+	if (!consumer->objectName().isEmpty())
+		return consumer->objectName();
+
+	return consumer->metaObject()->className();
 }
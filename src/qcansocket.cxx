@@ -24,8 +24,10 @@
 
 #include "qcansocket.h"
 #include "canbus/can_drv.h"
+#include "utils.h"
 #include <QDebug>
 #include <string>
+#include <string.h>
 
 QCanSocket::QCanSocket(QString &dev, unsigned bitrate, QObject *parent) :
 	QAbstractSocket(UnknownSocketType, parent),
@@ -34,7 +36,7 @@ QCanSocket::QCanSocket(QString &dev, unsigned bitrate, QObject *parent) :
 	m_dev = dev;
 	m_bitrate = bitrate;
 	status = UnconnectedState;
-
+	m_tx_consumer = NULL;
 }
 
 QCanSocket::QCanSocket(const char *dev, unsigned bitrate, QObject *parent) :
@@ -44,6 +46,7 @@ QCanSocket::QCanSocket(const char *dev, unsigned bitrate, QObject *parent) :
 	m_dev = sDev;
 	m_bitrate = bitrate;
 	status = UnconnectedState;
+	m_tx_consumer = NULL;
 }
 
 QCanSocket::~QCanSocket()
@@ -116,6 +119,16 @@ size_t QCanSocket::send(unsigned id, uint8_t dlc, void *data)
 		ret = can_ops->send(skt, id, dlc, data);
 		//m_semaphore.release(1);
 	}
+	if ((int) ret > 0 && m_tx_consumer != NULL) {
+		can_packet_t packet;
+
+		packet.id = id;
+		packet.dlc = dlc;
+		memcpy(packet.data, data, (dlc > 8) ? 8 : dlc);
+		get_timestamp(&packet.tv_sec, &packet.tv_usec);
+		packet.direction = DIRECTION_TX;
+		m_tx_consumer->filterCallback(&packet);
+	}
 	return ret;
 }
 
@@ -134,6 +147,22 @@ size_t QCanSocket::recv(unsigned *id, uint8_t *dlc, void *data, int64_t *sec, in
 
 }
 
+int QCanSocket::rxDropped(quint32 *dropped)
+{
+	if (can_ops->rx_dropped == NULL)
+		return -1;
+
+	return can_ops->rx_dropped(skt, dropped);
+}
+
+int QCanSocket::wakeup()
+{
+	if (can_ops->wakeup == NULL)
+		return -1;
+
+	return can_ops->wakeup(skt);
+}
+
 QAbstractSocket::SocketState QCanSocket::state() const
 {
 	return this->status;
@@ -169,3 +198,8 @@ int QCanSocket::checkCurrentCanBusState()
 
 	return r;
 }
+
+void QCanSocket::setTxConsumer(QCanPacketConsumer *consumer)
+{
+	m_tx_consumer = consumer;
+}
@@ -0,0 +1,141 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qcapturereplay.h"
+#include "qrealtime.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+#define USEC_PER_SEC    1000000
+
+/* Left to spin before a frame is due, below the sleep granularity */
+#define SPIN_NSEC       100000
+
+QCaptureReplay::QCaptureReplay(QCanSocket *sk, QObject *parent) :
+	QThread(parent),
+	m_stop(0),
+	m_sent(0),
+	m_failed(0)
+{
+	m_sk = sk;
+	m_speed = 1.0;
+	m_loops = 1;
+	memset(&m_map, 0, sizeof(m_map));
+	memset(&m_filter, 0, sizeof(m_filter));
+}
+
+QCaptureReplay::~QCaptureReplay()
+{
+	stop();
+	wait();
+	capture_unmap(&m_map);
+}
+
+bool QCaptureReplay::open(const QString &fileName)
+{
+	capture_unmap(&m_map);
+	return capture_map(fileName.toLocal8Bit().constData(), &m_map) == 0;
+}
+
+void QCaptureReplay::setFilter(const idfilter_t &filter)
+{
+	m_filter = filter;
+}
+
+void QCaptureReplay::setSpeed(double speed)
+{
+	m_speed = (speed > 0.0) ? speed : 0.0;
+}
+
+void QCaptureReplay::setLoops(unsigned loops)
+{
+	m_loops = loops;
+}
+
+void QCaptureReplay::stop()
+{
+	m_stop.storeRelease(1);
+}
+
+quint64 QCaptureReplay::frames() const
+{
+	return m_map.count;
+}
+
+quint64 QCaptureReplay::sent() const
+{
+	return m_sent.load();
+}
+
+quint64 QCaptureReplay::failed() const
+{
+	return m_failed.load();
+}
+
+void QCaptureReplay::waitUntil(const QElapsedTimer &clock, qint64 nsec)
+{
+	qint64 left;
+
+	while ((left = nsec - clock.nsecsElapsed()) > 0 && !m_stop.loadAcquire()) {
+		if (left > 2 * SPIN_NSEC)
+			QThread::usleep((left - SPIN_NSEC) / 1000);
+	}
+}
+
+void QCaptureReplay::run()
+{
+	QElapsedTimer clock;
+	qint64 first;
+
+	if (m_map.count == 0)
+		return;
+
+	QRealtime::enter(QRealtime::Transmit);
+	for (unsigned loop = 0; m_loops == 0 || loop < m_loops; loop++) {
+		first = m_map.frames[0].tv_sec * USEC_PER_SEC + m_map.frames[0].tv_usec;
+		clock.start();
+
+		for (quint64 i = 0; i < m_map.count; i++) {
+			can_packet_t p = m_map.frames[i];
+			qint64 t = p.tv_sec * USEC_PER_SEC + p.tv_usec;
+
+			if (m_stop.loadAcquire())
+				return;
+			if ((p.id & ERR_FLAG) ||
+			    !idfilter_match(&m_filter, p.id & (EFF_FLAG | EFF_MASK)))
+				continue;
+
+			/* Captures are in receive order, a step back is sent at once */
+			if (m_speed > 0.0 && t > first)
+				waitUntil(clock, (qint64) ((t - first) * 1000 / m_speed));
+			if ((int) m_sk->send(p.id, p.dlc, p.data) > 0)
+				m_sent.store(m_sent.load() + 1);
+			else
+				m_failed.store(m_failed.load() + 1);
+		}
+	}
+}
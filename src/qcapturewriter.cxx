@@ -0,0 +1,201 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qcapturewriter.h"
+#include "qrealtime.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+QCaptureWriter::QCaptureWriter(QObject *parent) :
+	QCanPacketConsumer(parent),
+	m_open(0),
+	m_busy(0),
+	m_flush_req(0),
+	m_frames(0),
+	m_errors(0),
+	m_accepted(0),
+	m_written(0),
+	m_stored(0),
+	m_failed(0)
+{
+	m_capture = new capture_writer_t;
+	memset(m_capture, 0, sizeof(*m_capture));
+	memset(&m_filter, 0, sizeof(m_filter));
+	/* Touch every page now so the receive thread never faults them in */
+	m_batches = new batch_t[CAPTURE_WRITER_BATCHES];
+	memset(m_batches, 0, sizeof(batch_t) * CAPTURE_WRITER_BATCHES);
+	m_fill = 0;
+	m_take = 0;
+	m_thread = new Writer(this);
+	m_backlog = QMetrics::instance()->level("writer.backlog");
+	m_flushed = QMetrics::instance()->counter("writer.flushed");
+	m_stalls = QMetrics::instance()->counter("writer.stalls");
+}
+
+QCaptureWriter::~QCaptureWriter()
+{
+	close();
+	delete m_thread;
+	delete [] m_batches;
+	delete m_capture;
+}
+
+void QCaptureWriter::setFilter(const idfilter_t &filter)
+{
+	m_filter = filter;
+}
+
+bool QCaptureWriter::open(const QString &fileName)
+{
+	if (m_open.loadAcquire())
+		return false;
+	if (capture_open(m_capture, fileName.toLocal8Bit().constData()) < 0)
+		return false;
+
+	m_fill = m_take = 0;
+	m_batches[0].count = 0;
+	m_free.release(CAPTURE_WRITER_BATCHES - 1 - m_free.available());
+	m_written.store(0);
+	m_stored.store(0);
+	m_thread->start(QThread::LowPriority);
+	m_open.storeRelease(1);
+	return true;
+}
+
+bool QCaptureWriter::close()
+{
+	if (!m_open.fetchAndStoreOrdered(0))
+		return false;
+	while (m_busy.loadAcquire())
+		QThread::yieldCurrentThread();
+
+	/* What is left, then an empty batch telling the writer thread to end */
+	if (m_batches[m_fill].count != 0)
+		queueBatch();
+	queueBatch();
+	m_thread->wait();
+	m_flushed->set(m_stored.load());
+	m_backlog->set(0);
+
+	return capture_close(m_capture) == 0;
+}
+
+void QCaptureWriter::queueBatch()
+{
+	/* Only waits when the disk is behind by every batch */
+	if (!m_free.tryAcquire()) {
+		m_stalls->add();
+		m_free.acquire();
+	}
+	m_pending.release();
+	m_fill = (m_fill + 1) % CAPTURE_WRITER_BATCHES;
+	m_batches[m_fill].count = 0;
+}
+
+void QCaptureWriter::requestFlush()
+{
+	m_flush_req.storeRelease(1);
+}
+
+quint64 QCaptureWriter::frames() const
+{
+	return m_frames.load();
+}
+
+quint64 QCaptureWriter::errors() const
+{
+	return m_errors.load();
+}
+
+quint64 QCaptureWriter::accepted() const
+{
+	return m_accepted.load();
+}
+
+quint64 QCaptureWriter::written() const
+{
+	return m_written.load();
+}
+
+bool QCaptureWriter::failed() const
+{
+	return m_failed.loadAcquire() != 0;
+}
+
+void QCaptureWriter::canPacketRecv(can_packet_t)
+{
+}
+
+bool QCaptureWriter::filterCallback(can_packet_t *packet)
+{
+	m_frames.store(m_frames.load() + 1);
+	if (packet->id & ERR_FLAG) {
+		m_errors.store(m_errors.load() + 1);
+		return false;
+	}
+	if (!idfilter_match(&m_filter, packet->id & (EFF_FLAG | EFF_MASK)))
+		return false;
+	m_accepted.store(m_accepted.load() + 1);
+
+	m_busy.fetchAndStoreOrdered(1);
+	if (m_open.loadAcquire()) {
+		batch_t *batch = &m_batches[m_fill];
+
+		batch->frames[batch->count++] = *packet;
+		if (batch->count == CAPTURE_BATCH ||
+		    (m_flush_req.loadAcquire() && m_flush_req.testAndSetOrdered(1, 0)))
+			queueBatch();
+		m_written.store(m_written.load() + 1);
+		m_backlog->set(m_written.load() - m_stored.load());
+	}
+	m_busy.storeRelease(0);
+
+	return false;
+}
+
+QCaptureWriter::Writer::Writer(QCaptureWriter *writer)
+{
+	m_writer = writer;
+}
+
+void QCaptureWriter::Writer::run()
+{
+	QRealtime::enter(QRealtime::Writer);
+	for (;;) {
+		m_writer->m_pending.acquire();
+		batch_t *batch = &m_writer->m_batches[m_writer->m_take];
+
+		if (batch->count == 0)
+			break;
+		if (capture_append_frames(m_writer->m_capture, batch->frames, batch->count) < 0)
+			m_writer->m_failed.storeRelease(1);
+		m_writer->m_stored.store(m_writer->m_capture->count);
+		m_writer->m_flushed->set(m_writer->m_capture->count);
+		m_writer->m_take = (m_writer->m_take + 1) % CAPTURE_WRITER_BATCHES;
+		m_writer->m_free.release();
+	}
+}
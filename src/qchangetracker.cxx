@@ -0,0 +1,150 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qchangetracker.h"
+#include "canbus/can_drv.h"
+
+#include <QMap>
+#include <QDateTime>
+
+QChangeTracker::QChangeTracker(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Statistics of every ID are allocated once with the engine */
+	m_changes = new changes_engine_t;
+	changes_init(m_changes);
+	m_view_overflow = 0;
+}
+
+QChangeTracker::~QChangeTracker()
+{
+	delete m_changes;
+}
+
+QString QChangeTracker::title() const
+{
+	return tr("Payload changes");
+}
+
+QStringList QChangeTracker::header() const
+{
+	QStringList header;
+
+	header << "ID" << "Frames" << "Changes";
+	for (int b = 0; b < CHANGES_BYTES; b++)
+		header << QString("D%1").arg(b);
+	header << "Last change" << "Fields";
+
+	return header;
+}
+
+void QChangeTracker::copy(QVector<changes_id_t> &ids)
+{
+	QMutexLocker locker(&m_lock);
+	QMap<quint32, quint32> sorted;
+
+	for (quint32 i = 0; i < m_changes->nids; i++)
+		sorted[m_changes->ids[i].id] = i;
+
+	ids.resize(sorted.size());
+	int n = 0;
+	foreach (quint32 i, sorted)
+		ids[n++] = m_changes->ids[i];
+}
+
+QString QChangeTracker::fields(const changes_id_t &s)
+{
+	QStringList list;
+
+	for (int b = 0; b < s.dlc; b++) {
+		int f = changes_field(&s, b);
+
+		if (f & CHANGES_FIELD_COUNTER)
+			list << QString("D%1 counter").arg(b);
+		else if (f & CHANGES_FIELD_NIBBLE)
+			list << QString("D%1 nibble counter").arg(b);
+		if (f & CHANGES_FIELD_SUM)
+			list << QString("D%1 sum").arg(b);
+	}
+	if (changes_has_xor(&s))
+		list << "XOR";
+
+	return list.join(", ");
+}
+
+void QChangeTracker::decode(const can_packet_t *packet)
+{
+	changes_update(m_changes, packet);
+}
+
+void QChangeTracker::save()
+{
+	m_view.resize(m_changes->nids);
+	for (quint32 i = 0; i < m_changes->nids; i++)
+		m_view[i] = m_changes->ids[i];
+	m_view_overflow = m_changes->overflow;
+}
+
+void QChangeTracker::format(QList<QStringList> &rows, QString &summary)
+{
+	QMap<quint32, const changes_id_t *> sorted;
+
+	for (int i = 0; i < m_view.size(); i++)
+		sorted[m_view.at(i).id] = &m_view.at(i);
+
+	foreach (const changes_id_t *s, sorted) {
+		QStringList row;
+		qint64 last = 0;
+
+		row << QString::number(s->id & EFF_MASK, 16).toUpper()
+		    << QString::number(s->frames) << QString::number(s->changes);
+		for (int b = 0; b < CHANGES_BYTES; b++) {
+			if (b >= s->dlc) {
+				row << "";
+				continue;
+			}
+			if (changes_field(s, b) & CHANGES_FIELD_CONSTANT)
+				row << QString("%1").arg(s->min[b], 2, 16, QChar('0')).toUpper();
+			else
+				row << QString("%1-%2").arg(s->min[b], 2, 16, QChar('0'))
+				       .arg(s->max[b], 2, 16, QChar('0')).toUpper();
+			last = qMax(last, (qint64) s->last_change[b]);
+		}
+		row << ((s->changes != 0) ?
+		        QDateTime::fromMSecsSinceEpoch(last / 1000).time().toString("hh:mm:ss.zzz") :
+		        QString("-"))
+		    << fields(*s);
+		rows.append(row);
+	}
+
+	summary = QString("IDs: %1  Untracked frames: %2  Fields guessed after %3 frames")
+	          .arg(m_view.size()).arg(m_view_overflow).arg(CHANGES_MIN_FRAMES);
+}
+
+void QChangeTracker::clear()
+{
+	changes_reset(m_changes);
+}
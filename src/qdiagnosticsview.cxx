@@ -0,0 +1,136 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qdiagnosticsview.h"
+#include "qrealtime.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFile>
+#include <QTextStream>
+
+#define REFRESH_MS 500
+
+QDiagnosticsView::QDiagnosticsView(QWidget *parent) :
+	QDialog(parent)
+{
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	QHBoxLayout *buttons = new QHBoxLayout;
+	QPushButton *btnSave = new QPushButton(tr("Save JSON..."), this);
+	QPushButton *btnClose = new QPushButton(tr("Close"), this);
+	QStringList header;
+
+	setWindowTitle(tr("Diagnostics"));
+	setAttribute(Qt::WA_DeleteOnClose);
+
+	header << "Metric" << "Value" << "p50 us" << "p99 us" << "Max us";
+	m_table = new QTableWidget(0, header.size(), this);
+	m_table->setHorizontalHeaderLabels(header);
+	m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+	m_table->verticalHeader()->hide();
+	m_table->verticalHeader()->setDefaultSectionSize(17);
+	m_table->horizontalHeader()->setStretchLastSection(true);
+	m_table->setColumnWidth(0, 280);
+
+	/* What the threads made of the real-time settings */
+	m_realtime = new QLabel(this);
+
+	buttons->addStretch();
+	buttons->addWidget(btnSave);
+	buttons->addWidget(btnClose);
+	layout->addWidget(m_table);
+	layout->addWidget(m_realtime);
+	layout->addLayout(buttons);
+	resize(640, 480);
+
+	connect(btnSave, SIGNAL(clicked()), this, SLOT(saveJson()));
+	connect(btnClose, SIGNAL(clicked()), this, SLOT(close()));
+
+	m_timer = new QTimer(this);
+	connect(m_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+	m_timer->start(REFRESH_MS);
+	refresh();
+}
+
+void QDiagnosticsView::refresh()
+{
+	QList<QMetrics::sample_t> samples;
+	QStringList realtime = QRealtime::report();
+
+	m_realtime->setText(realtime.join("\n"));
+	m_realtime->setVisible(!realtime.isEmpty());
+
+	QMetrics::instance()->snapshot(samples);
+	m_table->setRowCount(samples.size());
+	for (int r = 0; r < samples.size(); r++) {
+		const QMetrics::sample_t &s = samples.at(r);
+		QStringList text;
+
+		text << s.name << QString::number(s.value);
+		if (s.kind == METRIC_HISTOGRAM)
+			text << QString::number(s.p50) << QString::number(s.p99)
+			     << QString::number(s.max);
+		else
+			text << "" << "" << "";
+
+		for (int c = 0; c < text.size(); c++) {
+			QTableWidgetItem *it = m_table->item(r, c);
+
+			if (it == NULL) {
+				it = new QTableWidgetItem;
+				m_table->setItem(r, c, it);
+			}
+			if (it->text() != text.at(c))
+				it->setText(text.at(c));
+		}
+	}
+}
+
+void QDiagnosticsView::saveJson()
+{
+	QString fileName;
+
+	fileName = QFileDialog::getSaveFileName(this, tr("Save JSON"), "metrics.json",
+	                                        tr("JSON files (*.json)"));
+	if (fileName.isEmpty())
+		return;
+
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text)) {
+		QMessageBox::warning(this, windowTitle(),
+		                     tr("Cannot write %1").arg(fileName), QMessageBox::Ok);
+		return;
+	}
+
+	QTextStream out(&file);
+	out << QMetrics::instance()->toJson() << endl;
+	file.close();
+}
@@ -0,0 +1,81 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qdropmonitor.h"
+
+#include <string.h>
+
+
+QDropMonitor::QDropMonitor(const QString &consumer)
+{
+	m_dropped = QMetrics::instance()->counter("recv.kernel_dropped");
+	m_latency = NULL;
+	m_total = m_dropped->value();
+	m_interval = 0;
+	m_p99 = 0;
+	memset(m_buckets, 0, sizeof(m_buckets));
+	if (!consumer.isEmpty()) {
+		m_latency = QMetrics::instance()->histogram("consumer." + consumer + ".latency_us");
+		m_latency->buckets(m_buckets);
+	}
+}
+
+quint64 QDropMonitor::poll()
+{
+	quint64 total = m_dropped->value();
+	quint64 n[METRICS_BUCKETS];
+
+	if (m_latency != NULL) {
+		m_latency->buckets(n);
+		for (int b = 0; b < METRICS_BUCKETS; b++) {
+			quint64 cur = n[b];
+
+			n[b] -= m_buckets[b];
+			m_buckets[b] = cur;
+		}
+		m_p99 = QMetrics::Histogram::percentile(n, 99.0);
+	}
+
+	m_interval = total - m_total;
+	m_total = total;
+
+	return m_interval;
+}
+
+quint64 QDropMonitor::total() const
+{
+	return m_total;
+}
+
+quint64 QDropMonitor::latency() const
+{
+	return m_p99;
+}
+
+bool QDropMonitor::lagging() const
+{
+	return m_interval != 0 && m_p99 >= DROP_LAG_USEC;
+}
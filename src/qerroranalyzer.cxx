@@ -0,0 +1,151 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qerroranalyzer.h"
+#include "canbus/can_drv.h"
+
+#include <QDateTime>
+
+static const char *metric_names[ERRFRAME_CLASSES] = {
+	"tx_timeout", "lost_arbitration", "controller", "protocol",
+	"transceiver", "no_ack", "bus_off", "bus_error", "restarted", "counters"
+};
+
+static QString stateName(qcan_state_t state)
+{
+	switch (state) {
+	case QCAN_STATE_ACTIVE:
+		return "Active";
+
+	case QCAN_STATE_WARNING:
+		return "Warning";
+
+	case QCAN_STATE_PASSIVE:
+		return "Passive";
+
+	case QCAN_STATE_BUS_OFF:
+		return "Bus off";
+
+	default:
+		return "Unknown";
+	}
+}
+
+QErrorAnalyzer::QErrorAnalyzer(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	errframe_init(&m_stats);
+
+	for (int b = 0; b < ERRFRAME_CLASSES; b++)
+		m_classes[b] = QMetrics::instance()->counter(QString("errors.") + metric_names[b]);
+	m_tec = QMetrics::instance()->level("errors.tec");
+	m_rec = QMetrics::instance()->level("errors.rec");
+}
+
+QString QErrorAnalyzer::title() const
+{
+	return tr("Error frames");
+}
+
+QStringList QErrorAnalyzer::header() const
+{
+	return QStringList() << "Category" << "Error" << "Count";
+}
+
+bool QErrorAnalyzer::filterCallback(can_packet_t *packet)
+{
+	/* Data frames never take the lock */
+	if (!(packet->id & ERR_FLAG))
+		return false;
+
+	return QProtocolDecoder::filterCallback(packet);
+}
+
+void QErrorAnalyzer::decode(const can_packet_t *packet)
+{
+	quint32 classes = errframe_update(&m_stats, packet);
+
+	for (int b = 0; b < ERRFRAME_CLASSES; b++)
+		if (classes & (1U << b))
+			m_classes[b]->add();
+	if (m_stats.counters) {
+		m_tec->set(m_stats.tec);
+		m_rec->set(m_stats.rec);
+	}
+}
+
+void QErrorAnalyzer::save()
+{
+	m_view = m_stats;
+}
+
+void QErrorAnalyzer::format(QList<QStringList> &rows, QString &summary)
+{
+	const errframe_stats_t *s = &m_view;
+	qint64 now = QDateTime::currentMSecsSinceEpoch() * 1000;
+
+	for (int b = 0; b < ERRFRAME_CLASSES; b++) {
+		QString name = errframe_class_name(b);
+
+		if (s->classes[b] == 0)
+			continue;
+		if ((1U << b) == ERRFRAME_LOSTARB && s->arb_bit != 0)
+			name += QString(" (last at bit %1)").arg(s->arb_bit);
+		rows.append(QStringList() << "Class" << name << QString::number(s->classes[b]));
+	}
+
+	for (int b = 0; b < 8; b++)
+		if (s->crtl[b] != 0)
+			rows.append(QStringList() << "Controller" << errframe_crtl_name(b)
+			            << QString::number(s->crtl[b]));
+
+	for (int b = 0; b < ERRFRAME_PROT_TYPES; b++)
+		if (s->prot_type[b] != 0)
+			rows.append(QStringList() << "Violation" << errframe_prot_type_name(b)
+			            << QString::number(s->prot_type[b]));
+
+	for (int l = 0; l < ERRFRAME_PROT_LOCATIONS; l++)
+		if (s->prot_loc[l] != 0)
+			rows.append(QStringList() << "Location" << errframe_prot_loc_name(l)
+			            << QString::number(s->prot_loc[l]));
+
+	if (s->trx != 0)
+		rows.append(QStringList() << "Transceiver"
+		            << QString("%1 (last)").arg(errframe_trx_name(s->trx_last))
+		            << QString::number(s->trx));
+
+	summary = QString("Error frames: %1  Rate: %2/s  Peak: %3/s  State: %4  Transitions: %5")
+	          .arg(s->frames).arg(errframe_rate(s, now)).arg(s->peak_rate)
+	          .arg(stateName(s->state)).arg(s->transitions);
+	if (s->counters)
+		summary += QString("  TEC: %1 (max %2)  REC: %3 (max %4)")
+		           .arg(s->tec).arg(s->tec_max).arg(s->rec).arg(s->rec_max);
+}
+
+void QErrorAnalyzer::clear()
+{
+	errframe_init(&m_stats);
+}
@@ -0,0 +1,302 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#include "qflightrecorder.h"
+#include "qrealtime.h"
+#include "canbus/can_drv.h"
+#include "analysis/capture.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QVector>
+
+#include <signal.h>
+#include <string.h>
+
+/* Past the post-trigger window, a quiet bus lets the writer close it */
+#define POST_SLACK_MS 50
+
+static volatile sig_atomic_t s_signal_req;
+
+#ifdef __linux
+static void signal_trigger(int)
+{
+	s_signal_req = 1;
+}
+#endif
+
+QFlightRecorder::QFlightRecorder(unsigned frames, unsigned pre_ms, unsigned post_ms,
+    const QString &directory, QObject *parent) :
+	QCanPacketConsumer(parent),
+	m_window(WINDOW_NONE),
+	m_busy(0),
+	m_trigger_req(0),
+	m_writer_busy(0),
+	m_missed(0)
+{
+	m_frames = (frames != 0) ? frames : 1;
+	m_pre_usec = (qint64) pre_ms * 1000;
+	m_post_usec = (qint64) post_ms * 1000;
+	m_directory = directory;
+	m_raw = false;
+
+	/* Touch every page now so recording never faults them in */
+	for (int i = 0; i < 2; i++) {
+		m_ring[i] = new can_packet_t[m_frames];
+		memset(m_ring[i], 0, sizeof(can_packet_t) * m_frames);
+	}
+	m_active = 0;
+	m_head = 0;
+	m_trigger_usec = 0;
+	m_stop = false;
+
+	m_writer = new Writer(this);
+	m_writer->start(QThread::LowPriority);
+}
+
+QFlightRecorder::~QFlightRecorder()
+{
+	m_writer->stop();
+	delete m_writer;
+	delete [] m_ring[0];
+	delete [] m_ring[1];
+}
+
+int QFlightRecorder::installSignalTrigger(int signo)
+{
+#ifdef __linux
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = signal_trigger;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	return sigaction(signo, &sa, NULL);
+#else
+	Q_UNUSED(signo);
+	return -1;
+#endif
+}
+
+quint64 QFlightRecorder::missedTriggers() const
+{
+	return m_missed.loadAcquire();
+}
+
+void QFlightRecorder::setRawFormat(bool enable)
+{
+	m_raw = enable;
+}
+
+void QFlightRecorder::trigger()
+{
+	m_trigger_req.storeRelease(1);
+}
+
+void QFlightRecorder::canPacketRecv(can_packet_t)
+{
+}
+
+bool QFlightRecorder::filterCallback(can_packet_t *packet)
+{
+	qint64 t = packet->tv_sec * 1000000 + packet->tv_usec;
+	int window;
+
+	m_busy.fetchAndStoreOrdered(1);
+	window = m_window.loadAcquire();
+	if (window == WINDOW_CLOSING) {
+		/* Past the window, only lost to the next pre-trigger history */
+		m_busy.storeRelease(0);
+		return false;
+	}
+
+	m_ring[m_active][m_head % m_frames] = *packet;
+	m_head++;
+
+	if (s_signal_req) {
+		s_signal_req = 0;
+		m_trigger_req.storeRelease(1);
+	}
+
+	if (window == WINDOW_NONE) {
+		if (m_trigger_req.loadAcquire() && m_trigger_req.testAndSetOrdered(1, 0)) {
+			m_trigger_usec = t;
+			m_window.storeRelease(WINDOW_OPEN);
+			/* Starts the writer's timer */
+			m_pending.release();
+		}
+	} else if (t >= m_trigger_usec + m_post_usec &&
+	           m_window.testAndSetOrdered(WINDOW_OPEN, WINDOW_NONE)) {
+		if (closeWindow())
+			m_pending.release();
+	}
+	m_busy.storeRelease(0);
+
+	return false;
+}
+
+/*
+ * Hands the ring to the writer, called by whoever moved the window out of
+ * WINDOW_OPEN: only the writer clears m_writer_busy.
+ */
+bool QFlightRecorder::closeWindow()
+{
+	if (m_writer_busy.loadAcquire()) {
+		/* Still writing out the previous window */
+		m_missed.fetchAndAddRelaxed(1);
+		return false;
+	}
+
+	m_snapshot.ring = m_ring[m_active];
+	m_snapshot.head = m_head;
+	m_snapshot.start_usec = m_trigger_usec - m_pre_usec;
+	m_snapshot.end_usec = m_trigger_usec + m_post_usec;
+	m_writer_busy.storeRelease(1);
+
+	m_active ^= 1;
+	m_head = 0;
+
+	return true;
+}
+
+/* Writer thread: no frame came past the window, close it here */
+void QFlightRecorder::closeWindowLate()
+{
+	if (!m_window.testAndSetOrdered(WINDOW_OPEN, WINDOW_CLOSING))
+		return;
+	/* Wait for the receive thread to leave filterCallback */
+	while (m_busy.loadAcquire())
+		QThread::yieldCurrentThread();
+
+	closeWindow();
+	m_window.storeRelease(WINDOW_NONE);
+}
+
+void QFlightRecorder::dumpRaw()
+{
+	const snapshot_t &snap = m_snapshot;
+	QVector<can_packet_t> window;
+	quint64 count;
+	QString fileName;
+
+	count = qMin(snap.head, (quint64) m_frames);
+	window.reserve(count);
+	for (quint64 i = snap.head - count; i < snap.head; i++) {
+		const can_packet_t &p = snap.ring[i % m_frames];
+		qint64 t = p.tv_sec * 1000000 + p.tv_usec;
+
+		if (t >= snap.start_usec && t <= snap.end_usec)
+			window.append(p);
+	}
+
+	fileName = m_directory +
+	    QDateTime::currentDateTime().toString("/'flight-'yyyyMMdd-hhmmss'.cap'");
+	if (capture_write(fileName.toLocal8Bit().constData(), window.constData(),
+	    window.size()) < 0)
+		return;
+
+	emit dumped(fileName, window.size());
+}
+
+void QFlightRecorder::dump()
+{
+	const snapshot_t &snap = m_snapshot;
+	quint64 count, first;
+	qint64 t, last = 0;
+	unsigned written = 0;
+	QString fileName;
+
+	fileName = m_directory +
+	    QDateTime::currentDateTime().toString("/'flight-'yyyyMMdd-hhmmss'.tlog'");
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text))
+		return;
+
+	QTextStream out(&file);
+	count = qMin(snap.head, (quint64) m_frames);
+	first = snap.head - count;
+	for (quint64 i = first; i < snap.head; i++) {
+		const can_packet_t &p = snap.ring[i % m_frames];
+		QString data, s;
+
+		t = p.tv_sec * 1000000 + p.tv_usec;
+		if (t < snap.start_usec || t > snap.end_usec)
+			continue;
+
+		for (unsigned b = 0; b < p.dlc && b < 8; b++)
+			data += QString("%1 ").arg(p.data[b], 2, 16, QChar('0')).toUpper();
+
+		out << QString::number(p.id & EFF_MASK, 16).toUpper() << " ";
+		out << "[" << p.dlc << "] ";
+		out << data << s.fill(' ', 39 - data.length() + 5);
+		out << ((p.id & EFF_FLAG) ? "Ext " : "Std ") << " T:"
+		    << QDateTime::fromMSecsSinceEpoch(t / 1000).time().toString("hh:mm:ss.zzz")
+		    << " " << ((written != 0) ? (t - last) / 1000 : 0) << endl;
+		last = t;
+		written++;
+	}
+	file.close();
+
+	emit dumped(fileName, written);
+}
+
+QFlightRecorder::Writer::Writer(QFlightRecorder *recorder)
+{
+	m_recorder = recorder;
+}
+
+void QFlightRecorder::Writer::run()
+{
+	QFlightRecorder *r = m_recorder;
+	bool open = false;
+
+	QRealtime::enter(QRealtime::Writer);
+	for (;;) {
+		/* Released on a trigger, on a window closed by a frame and on stop */
+		if (!open)
+			r->m_pending.acquire();
+		else if (!r->m_pending.tryAcquire(1, r->m_post_usec / 1000 + POST_SLACK_MS))
+			r->closeWindowLate();
+		if (r->m_stop)
+			break;
+		if (r->m_writer_busy.loadAcquire()) {
+			if (r->m_raw)
+				r->dumpRaw();
+			else
+				r->dump();
+			r->m_writer_busy.storeRelease(0);
+		}
+		open = r->m_window.loadAcquire() == WINDOW_OPEN;
+	}
+}
+
+void QFlightRecorder::Writer::stop()
+{
+	m_recorder->m_stop = true;
+	m_recorder->m_pending.release();
+	wait();
+}
@@ -0,0 +1,155 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qheatmapview.h"
+#include "canbus/can_drv.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QColor>
+
+#define REFRESH_MS 500
+
+/* ID and Frames columns come before the bits */
+#define FIRST_BIT_COLUMN 2
+
+/* White for bits that never flip, through yellow to red for toggling ones */
+static QColor heatColor(double ratio)
+{
+	if (ratio <= 0.0)
+		return QColor(Qt::white);
+	if (ratio > 1.0)
+		ratio = 1.0;
+
+	return QColor::fromHsvF((1.0 - ratio) * (60.0 / 360.0), 0.15 + 0.85 * ratio, 1.0);
+}
+
+QHeatmapView::QHeatmapView(QChangeTracker *tracker, QWidget *parent) :
+	QDialog(parent)
+{
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	QHBoxLayout *buttons = new QHBoxLayout;
+	QPushButton *btnReset = new QPushButton(tr("Reset"), this);
+	QPushButton *btnClose = new QPushButton(tr("Close"), this);
+	QStringList header;
+
+	m_tracker = tracker;
+	setWindowTitle(tr("Change heatmap"));
+	setAttribute(Qt::WA_DeleteOnClose);
+
+	/* Bytes left to right, bits MSB first as the payload is usually read */
+	header << "ID" << "Frames";
+	for (int b = 0; b < CHANGES_BYTES; b++)
+		for (int n = 7; n >= 0; n--)
+			header << ((n == 7) ? QString("D%1").arg(b) : QString::number(n));
+	header << "Fields";
+
+	m_table = new QTableWidget(0, header.size(), this);
+	m_table->setHorizontalHeaderLabels(header);
+	m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_table->setSelectionMode(QAbstractItemView::NoSelection);
+	m_table->verticalHeader()->hide();
+	m_table->verticalHeader()->setDefaultSectionSize(17);
+	m_table->horizontalHeader()->setStretchLastSection(true);
+	m_table->horizontalHeader()->setHighlightSections(false);
+	for (int c = FIRST_BIT_COLUMN; c < FIRST_BIT_COLUMN + CHANGES_BITS; c++)
+		m_table->setColumnWidth(c, 22);
+	m_summary = new QLabel(this);
+
+	buttons->addStretch();
+	buttons->addWidget(btnReset);
+	buttons->addWidget(btnClose);
+	layout->addWidget(m_table);
+	layout->addWidget(m_summary);
+	layout->addLayout(buttons);
+	resize(1000, 400);
+
+	connect(btnReset, SIGNAL(clicked()), this, SLOT(reset()));
+	connect(btnClose, SIGNAL(clicked()), this, SLOT(close()));
+
+	m_timer = new QTimer(this);
+	connect(m_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+	m_timer->start(REFRESH_MS);
+	refresh();
+}
+
+void QHeatmapView::refresh()
+{
+	/* Copied under the lock, painted without holding the receive thread */
+	m_tracker->copy(m_ids);
+
+	m_table->setRowCount(m_ids.size());
+	for (int r = 0; r < m_ids.size(); r++) {
+		const changes_id_t &s = m_ids.at(r);
+		quint32 pairs = (s.frames > 1) ? s.frames - 1 : 0;
+		QStringList text;
+
+		text << QString::number(s.id & EFF_MASK, 16).toUpper()
+		     << QString::number(s.frames);
+		for (int b = 0; b < CHANGES_BYTES; b++)
+			for (int n = 7; n >= 0; n--)
+				text << "";
+		text << QChangeTracker::fields(s);
+
+		for (int c = 0; c < text.size(); c++) {
+			QTableWidgetItem *it = m_table->item(r, c);
+
+			if (it == NULL) {
+				it = new QTableWidgetItem;
+				m_table->setItem(r, c, it);
+			}
+			if (it->text() != text.at(c))
+				it->setText(text.at(c));
+		}
+
+		for (int b = 0; b < CHANGES_BYTES; b++) {
+			for (int n = 7; n >= 0; n--) {
+				int c = FIRST_BIT_COLUMN + b * 8 + (7 - n);
+				QTableWidgetItem *it = m_table->item(r, c);
+				quint32 flips = changes_flips(&s, b * 8 + n);
+
+				if (b >= s.dlc) {
+					it->setBackground(QColor(Qt::lightGray));
+					it->setToolTip(QString());
+					continue;
+				}
+				it->setBackground(heatColor(pairs ? (double) flips / pairs : 0.0));
+				it->setToolTip(QString("D%1.%2: %3 flips in %4 frames")
+				               .arg(b).arg(n).arg(flips).arg(s.frames));
+			}
+		}
+	}
+	m_summary->setText(tr("IDs: %1  Cell colour: flips per frame of the bit")
+	                   .arg(m_ids.size()));
+}
+
+void QHeatmapView::reset()
+{
+	m_tracker->reset();
+	refresh();
+}
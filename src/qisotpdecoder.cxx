@@ -0,0 +1,172 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qisotpdecoder.h"
+#include "canbus/can_drv.h"
+
+#include <QDateTime>
+#include <QRegExp>
+
+#include <string.h>
+
+static QString idToString(quint32 id)
+{
+	return QString::number(id & EFF_MASK, 16).toUpper();
+}
+
+QIsoTpDecoder::QIsoTpDecoder(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Reassembly buffers and records are allocated once */
+	m_tp = new isotp_engine_t;
+	m_uds = new uds_tracker_t;
+	m_view_tp = new isotp_engine_t;
+	m_view_uds = new uds_tracker_t;
+	isotp_init(m_tp);
+	uds_init(m_uds);
+}
+
+QIsoTpDecoder::~QIsoTpDecoder()
+{
+	delete m_tp;
+	delete m_uds;
+	delete m_view_tp;
+	delete m_view_uds;
+}
+
+void QIsoTpDecoder::setChannels(const QString &channels)
+{
+	QMutexLocker locker(&m_lock);
+	QStringList pairs = channels.split(QRegExp("[\\s,;]+"), QString::SkipEmptyParts);
+
+	isotp_init(m_tp);
+	uds_init(m_uds);
+	foreach (const QString &pair, pairs) {
+		QStringList ids = pair.split(':');
+		quint32 id[2];
+		bool ok[2];
+
+		if (ids.size() != 2)
+			continue;
+		for (int i = 0; i < 2; i++) {
+			id[i] = ids.at(i).toUInt(&ok[i], 16);
+			/* More than 3 digits means a 29 bit identifier */
+			if (id[i] > 0x7FF || ids.at(i).length() > 3)
+				id[i] |= EFF_FLAG;
+		}
+		if (ok[0] && ok[1])
+			isotp_add_channel(m_tp, id[0], id[1]);
+	}
+}
+
+QString QIsoTpDecoder::title() const
+{
+	return tr("ISO-TP / UDS services");
+}
+
+QStringList QIsoTpDecoder::header() const
+{
+	return QStringList() << "Time" << "Request" << "Response" << "Service"
+	       << "Result" << "Req bytes" << "Resp bytes" << "Latency ms";
+}
+
+void QIsoTpDecoder::decode(const can_packet_t *packet)
+{
+	isotp_pdu_t pdu;
+
+	if (isotp_process(m_tp, packet, &pdu))
+		uds_process(m_uds, &pdu);
+}
+
+void QIsoTpDecoder::save()
+{
+	*m_view_tp = *m_tp;
+	*m_view_uds = *m_uds;
+}
+
+void QIsoTpDecoder::format(QList<QStringList> &rows, QString &summary)
+{
+	quint32 first = (m_view_uds->head > UDS_RECORDS) ? m_view_uds->head - UDS_RECORDS : 0;
+
+	/* Newest first */
+	for (quint32 i = m_view_uds->head; i > first; i--) {
+		const uds_record_t *r = &m_view_uds->record[(i - 1) % UDS_RECORDS];
+		const isotp_channel_t *ch = &m_view_tp->channel[r->channel];
+		QString result;
+
+		switch (r->result) {
+		case UDS_RESULT_POSITIVE:
+			result = "Positive";
+			break;
+		case UDS_RESULT_NEGATIVE:
+			result = QString("NRC %1h %2")
+			         .arg(QString::number(r->nrc, 16).rightJustified(2, '0').toUpper())
+			         .arg(uds_nrc_name(r->nrc));
+			break;
+		default:
+			result = "No response";
+			break;
+		}
+		if (r->pending)
+			result += " (after pending)";
+
+		rows.append(QStringList()
+		            << QDateTime::fromMSecsSinceEpoch(r->time / 1000).time().toString("hh:mm:ss.zzz")
+		            << idToString(ch->id[ISOTP_REQUEST])
+		            << idToString(ch->id[ISOTP_RESPONSE])
+		            << QString("%1h %2")
+		               .arg(QString::number(r->sid, 16).rightJustified(2, '0').toUpper())
+		               .arg(uds_service_name(r->sid))
+		            << result
+		            << QString::number(r->request_len)
+		            << ((r->result == UDS_RESULT_NO_RESPONSE) ? QString("-") :
+		                QString::number(r->response_len))
+		            << ((r->result == UDS_RESULT_NO_RESPONSE) ? QString("-") :
+		                QString::number(r->latency / 1000.0, 'f', 3)));
+	}
+
+	summary = QString("PDUs: %1  Positive: %2  Negative: %3  Unanswered: %4  "
+	                  "Sequence errors: %5  Timeouts: %6  No buffer: %7")
+	          .arg(m_view_tp->pdus).arg(m_view_uds->positive)
+	          .arg(m_view_uds->negative).arg(m_view_uds->unanswered)
+	          .arg(m_view_tp->seq_errors).arg(m_view_tp->timeouts)
+	          .arg(m_view_tp->pool_exhausted);
+}
+
+void QIsoTpDecoder::clear()
+{
+	/* Keep the channels, drop the transfers and the records */
+	for (int c = 0; c < m_tp->nchannels; c++)
+		for (int d = 0; d < 2; d++)
+			m_tp->channel[c].rx[d].buf = NULL;
+	memset(m_tp->pool_used, 0, sizeof(m_tp->pool_used));
+	m_tp->pdus = 0;
+	m_tp->seq_errors = 0;
+	m_tp->timeouts = 0;
+	m_tp->pool_exhausted = 0;
+	m_tp->overflows = 0;
+	uds_init(m_uds);
+}
@@ -0,0 +1,117 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qisotpdialog.h"
+#include "canbus/can_drv.h"
+
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+
+static bool parseId(const QString &text, quint32 *id)
+{
+	bool ok;
+
+	*id = text.trimmed().toUInt(&ok, 16);
+	if (!ok || *id > EFF_MASK)
+		return false;
+	if (*id > 0x7FF || text.trimmed().length() > 3)
+		*id |= EFF_FLAG;
+
+	return true;
+}
+
+QIsoTpDialog::QIsoTpDialog(QIsoTpSender *sender, QWidget *parent) :
+	QDialog(parent)
+{
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	QFormLayout *form = new QFormLayout;
+	QHBoxLayout *buttons = new QHBoxLayout;
+	QPushButton *btnClose = new QPushButton(tr("Close"), this);
+
+	m_sender = sender;
+	setWindowTitle(tr("Send ISO-TP"));
+	setAttribute(Qt::WA_DeleteOnClose);
+
+	m_txId = new QLineEdit("7E0", this);
+	m_rxId = new QLineEdit("7E8", this);
+	m_data = new QLineEdit("10 03", this);
+	m_data->setMinimumWidth(360);
+	m_btnSend = new QPushButton(tr("Send"), this);
+	m_status = new QLabel(this);
+
+	form->addRow(tr("TX ID (hex)"), m_txId);
+	form->addRow(tr("RX ID (hex)"), m_rxId);
+	form->addRow(tr("Data (hex)"), m_data);
+	buttons->addWidget(m_status);
+	buttons->addStretch();
+	buttons->addWidget(m_btnSend);
+	buttons->addWidget(btnClose);
+	layout->addLayout(form);
+	layout->addLayout(buttons);
+
+	connect(m_btnSend, SIGNAL(clicked()), this, SLOT(send()));
+	connect(btnClose, SIGNAL(clicked()), this, SLOT(close()));
+	connect(m_sender, SIGNAL(sent(int, qint64)), this, SLOT(sent(int, qint64)));
+	connect(m_sender, SIGNAL(failed(QString)), this, SLOT(failed(QString)));
+	/* The sender goes away on disconnect */
+	connect(m_sender, SIGNAL(destroyed()), this, SLOT(close()));
+}
+
+void QIsoTpDialog::send()
+{
+	QByteArray data;
+	quint32 tx, rx;
+
+	if (!parseId(m_txId->text(), &tx) || !parseId(m_rxId->text(), &rx)) {
+		m_status->setText(tr("Invalid ID"));
+		return;
+	}
+	data = QByteArray::fromHex(m_data->text().toLatin1());
+	if (data.isEmpty()) {
+		m_status->setText(tr("No data"));
+		return;
+	}
+
+	m_btnSend->setEnabled(false);
+	m_status->setText(tr("Sending %1 bytes...").arg(data.size()));
+	m_sender->transmit(tx, rx, data);
+}
+
+void QIsoTpDialog::sent(int bytes, qint64 usec)
+{
+	m_btnSend->setEnabled(true);
+	m_status->setText(tr("%1 bytes in %2 ms (%3 kB/s)")
+	                  .arg(bytes)
+	                  .arg(usec / 1000.0, 0, 'f', 1)
+	                  .arg((usec > 0) ? bytes * 1000.0 / usec : 0.0, 0, 'f', 1));
+}
+
+void QIsoTpDialog::failed(QString reason)
+{
+	m_btnSend->setEnabled(true);
+	m_status->setText(reason);
+}
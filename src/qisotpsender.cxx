@@ -0,0 +1,246 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qisotpsender.h"
+#include "qrealtime.h"
+#include "canbus/can_drv.h"
+#include "protocols/isotp.h"
+
+#include <string.h>
+
+/* N_Bs: flow control timeout */
+#define FC_TIMEOUT_MS   1000
+#define FC_MAX_WAIT     10
+/* Below this the worker spins instead of sleeping */
+#define SPIN_NSEC       100000
+#define PADDING         0xCC
+
+QIsoTpSender::QIsoTpSender(QCanSocket *sk, QObject *parent) :
+	QCanPacketConsumer(parent),
+	m_listen(0)
+{
+	m_sk = sk;
+	m_stop = false;
+	m_rx_id = 0;
+	memset(m_fc, 0, sizeof(m_fc));
+
+	m_worker = new Worker(this);
+	m_worker->start(QThread::HighPriority);
+}
+
+QIsoTpSender::~QIsoTpSender()
+{
+	m_worker->stop();
+	delete m_worker;
+}
+
+void QIsoTpSender::transmit(quint32 tx_id, quint32 rx_id, const QByteArray &data)
+{
+	job_t job;
+
+	job.tx_id = tx_id;
+	job.rx_id = rx_id;
+	job.data = data;
+
+	m_queue_lock.lock();
+	m_queue.append(job);
+	m_queue_lock.unlock();
+	m_pending.release();
+}
+
+void QIsoTpSender::canPacketRecv(can_packet_t)
+{
+}
+
+bool QIsoTpSender::filterCallback(can_packet_t *packet)
+{
+	if (!m_listen.loadAcquire() || (packet->id & (ERR_FLAG | RTR_FLAG)))
+		return false;
+	if (packet->id != m_rx_id || packet->dlc < 3 ||
+	    (packet->data[0] >> 4) != ISOTP_FC)
+		return false;
+
+	m_fc_lock.lock();
+	memcpy(m_fc, packet->data, sizeof(m_fc));
+	m_fc_lock.unlock();
+	m_fc_ready.release();
+
+	return false;
+}
+
+bool QIsoTpSender::sendFrame(quint32 id, const quint8 *data, int len)
+{
+	quint8 frame[8];
+
+	memset(frame, PADDING, sizeof(frame));
+	memcpy(frame, data, len);
+
+	return (int) m_sk->send(id, 8, frame) > 0;
+}
+
+bool QIsoTpSender::waitFlowControl(quint8 *bs, quint8 *stmin)
+{
+	quint8 fc[3];
+
+	for (int waits = 0; ; waits++) {
+		if (!m_fc_ready.tryAcquire(1, FC_TIMEOUT_MS) || m_stop) {
+			emit failed(tr("No flow control received"));
+			return false;
+		}
+		m_fc_lock.lock();
+		memcpy(fc, m_fc, sizeof(fc));
+		m_fc_lock.unlock();
+
+		switch (fc[0] & 0x0F) {
+		case ISOTP_FC_CTS:
+			*bs = fc[1];
+			*stmin = fc[2];
+			return true;
+
+		case ISOTP_FC_WAIT:
+			if (waits < FC_MAX_WAIT)
+				continue;
+			emit failed(tr("Too many flow control wait frames"));
+			return false;
+
+		case ISOTP_FC_OVFL:
+			emit failed(tr("Receiver overflow"));
+			return false;
+
+		default:
+			emit failed(tr("Invalid flow control status"));
+			return false;
+		}
+	}
+}
+
+void QIsoTpSender::waitUntil(const QElapsedTimer &clock, qint64 nsec)
+{
+	qint64 left;
+
+	/* Sleep for the bulk of the gap, the scheduler can't do better than ~50 us */
+	while ((left = nsec - clock.nsecsElapsed()) > 0) {
+		if (left > 2 * SPIN_NSEC)
+			QThread::usleep((left - SPIN_NSEC) / 1000);
+	}
+}
+
+void QIsoTpSender::send(const job_t &job)
+{
+	const quint8 *data = (const quint8 *) job.data.constData();
+	int len = job.data.size();
+	QElapsedTimer clock;
+	quint8 frame[8];
+	quint8 bs, stmin, seq;
+	qint64 gap, next;
+	int off, n;
+
+	if (len == 0 || len > ISOTP_MAX) {
+		emit failed(tr("Invalid length %1").arg(len));
+		return;
+	}
+
+	clock.start();
+	if (len <= 7) {
+		frame[0] = len;
+		memcpy(frame + 1, data, len);
+		if (!sendFrame(job.tx_id, frame, len + 1)) {
+			emit failed(tr("Send error"));
+			return;
+		}
+		emit sent(len, clock.nsecsElapsed() / 1000);
+		return;
+	}
+
+	/* Forget flow control left over from an earlier transfer */
+	while (m_fc_ready.tryAcquire())
+		;
+	m_rx_id = job.rx_id;
+	m_listen.storeRelease(1);
+
+	frame[0] = (ISOTP_FF << 4) | (len >> 8);
+	frame[1] = len & 0xFF;
+	memcpy(frame + 2, data, 6);
+	if (!sendFrame(job.tx_id, frame, 8)) {
+		emit failed(tr("Send error"));
+		goto exit;
+	}
+
+	off = 6;
+	seq = 1;
+	while (off < len) {
+		if (!waitFlowControl(&bs, &stmin))
+			goto exit;
+
+		gap = (qint64) isotp_stmin_usec(stmin) * 1000;
+		next = clock.nsecsElapsed();
+		for (int block = 0; off < len && (bs == 0 || block < bs); block++) {
+			waitUntil(clock, next);
+			n = qMin(7, len - off);
+			frame[0] = (ISOTP_CF << 4) | (seq++ & 0x0F);
+			memcpy(frame + 1, data + off, n);
+			if (!sendFrame(job.tx_id, frame, n + 1)) {
+				emit failed(tr("Send error"));
+				goto exit;
+			}
+			off += n;
+			next = clock.nsecsElapsed() + gap;
+		}
+	}
+	emit sent(len, clock.nsecsElapsed() / 1000);
+
+exit:
+	m_listen.storeRelease(0);
+}
+
+QIsoTpSender::Worker::Worker(QIsoTpSender *sender)
+{
+	m_sender = sender;
+}
+
+void QIsoTpSender::Worker::run()
+{
+	job_t job;
+
+	QRealtime::enter(QRealtime::Transmit);
+	for (;;) {
+		m_sender->m_pending.acquire();
+		if (m_sender->m_stop)
+			break;
+		m_sender->m_queue_lock.lock();
+		job = m_sender->m_queue.takeFirst();
+		m_sender->m_queue_lock.unlock();
+		m_sender->send(job);
+	}
+}
+
+void QIsoTpSender::Worker::stop()
+{
+	m_sender->m_stop = true;
+	m_sender->m_pending.release();
+	m_sender->m_fc_ready.release();
+	wait();
+}
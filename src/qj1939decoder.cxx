@@ -0,0 +1,115 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qj1939decoder.h"
+
+#include <QMap>
+
+QJ1939Decoder::QJ1939Decoder(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Sessions and their buffers are allocated once with the engine */
+	m_j1939 = new j1939_engine_t;
+	m_view = new j1939_engine_t;
+	j1939_init(m_j1939);
+}
+
+QJ1939Decoder::~QJ1939Decoder()
+{
+	delete m_j1939;
+	delete m_view;
+}
+
+QString QJ1939Decoder::title() const
+{
+	return tr("J1939 PGNs");
+}
+
+QStringList QJ1939Decoder::header() const
+{
+	return QStringList() << "PGN" << "Frames" << "Messages" << "Msg/s"
+	       << "Bytes" << "Last SA" << "Len" << "Data";
+}
+
+void QJ1939Decoder::decode(const can_packet_t *packet)
+{
+	j1939_message_t msg;
+
+	j1939_process(m_j1939, packet, &msg);
+}
+
+void QJ1939Decoder::save()
+{
+	*m_view = *m_j1939;
+}
+
+void QJ1939Decoder::format(QList<QStringList> &rows, QString &summary)
+{
+	QMap<quint32, const j1939_pgn_stats_t *> sorted;
+	QStringList claimed;
+	quint32 conflicts = 0;
+
+	for (int i = 0; i < J1939_PGN_SLOTS; i++)
+		if (m_view->pgn[i].used)
+			sorted[m_view->pgn[i].pgn] = &m_view->pgn[i];
+
+	foreach (const j1939_pgn_stats_t *s, sorted) {
+		QString data;
+
+		for (int b = 0; b < s->last_len && b < 8; b++)
+			data += QString::number(s->last_data[b], 16).rightJustified(2, '0').toUpper() + " ";
+		if (s->last_len > 8)
+			data += "...";
+
+		rows.append(QStringList()
+		            << QString::number(s->pgn, 16).rightJustified(5, '0').toUpper()
+		            << QString::number(s->frames)
+		            << QString::number(s->messages)
+		            << QString::number(s->rate)
+		            << QString::number(s->bytes)
+		            << QString::number(s->last_sa, 16).rightJustified(2, '0').toUpper()
+		            << QString::number(s->last_len)
+		            << data);
+	}
+
+	for (int a = 0; a < 256; a++) {
+		if (!m_view->address[a].claimed)
+			continue;
+		claimed << QString::number(a, 16).rightJustified(2, '0').toUpper();
+		conflicts += m_view->address[a].conflicts;
+	}
+
+	summary = QString("TP: %1 completed, %2 aborted, %3 timed out, %4 dropped  "
+	                  "Claimed: %5 (%6 conflicts)")
+	          .arg(m_view->tp_completed).arg(m_view->tp_aborted)
+	          .arg(m_view->tp_timeouts).arg(m_view->tp_dropped)
+	          .arg(claimed.isEmpty() ? "-" : claimed.join(" ")).arg(conflicts);
+}
+
+void QJ1939Decoder::clear()
+{
+	j1939_init(m_j1939);
+}
@@ -0,0 +1,258 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qmetrics.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <string.h>
+
+QMetrics::Histogram::Histogram() :
+	m_count(0),
+	m_sum(0),
+	m_max(0)
+{
+	for (int b = 0; b < METRICS_BUCKETS; b++)
+		m_buckets[b].store(0);
+}
+
+quint64 QMetrics::Histogram::count() const
+{
+	return m_count.load();
+}
+
+quint64 QMetrics::Histogram::sum() const
+{
+	return m_sum.load();
+}
+
+quint64 QMetrics::Histogram::max() const
+{
+	return m_max.load();
+}
+
+quint64 QMetrics::Histogram::bucket(int b) const
+{
+	return m_buckets[b].load();
+}
+
+quint64 QMetrics::Histogram::percentile(double p) const
+{
+	quint64 n[METRICS_BUCKETS], value;
+
+	/* Buckets are read once: totals stay consistent while recording */
+	buckets(n);
+	value = percentile(n, p);
+
+	return (value >= 1ULL << (METRICS_BUCKETS - 2)) ? m_max.load() : value;
+}
+
+void QMetrics::Histogram::buckets(quint64 n[METRICS_BUCKETS]) const
+{
+	for (int b = 0; b < METRICS_BUCKETS; b++)
+		n[b] = m_buckets[b].load();
+}
+
+quint64 QMetrics::Histogram::percentile(const quint64 n[METRICS_BUCKETS], double p)
+{
+	quint64 total = 0, seen = 0, rank;
+
+	for (int b = 0; b < METRICS_BUCKETS; b++)
+		total += n[b];
+	if (total == 0)
+		return 0;
+
+	rank = (quint64) (p / 100.0 * total + 0.5);
+	if (rank == 0)
+		rank = 1;
+	for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+		seen += n[b];
+		if (seen >= rank)
+			return (b == 0) ? 0 : (1ULL << b) - 1;
+	}
+
+	/* The last bucket is open ended, this is its lower bound */
+	return 1ULL << (METRICS_BUCKETS - 2);
+}
+
+QMetrics::QMetrics()
+{
+}
+
+QMetrics::~QMetrics()
+{
+	qDeleteAll(m_counters);
+	qDeleteAll(m_levels);
+	qDeleteAll(m_histograms);
+}
+
+QMetrics *QMetrics::instance()
+{
+	static QMetrics metrics;
+
+	return &metrics;
+}
+
+QMetrics::Counter *QMetrics::counter(const QString &name)
+{
+	QMutexLocker locker(&m_lock);
+	Counter *c = m_counters.value(name, NULL);
+
+	if (c == NULL) {
+		c = new Counter;
+		m_counters[name] = c;
+	}
+
+	return c;
+}
+
+QMetrics::Counter *QMetrics::level(const QString &name)
+{
+	QMutexLocker locker(&m_lock);
+	Counter *c = m_levels.value(name, NULL);
+
+	if (c == NULL) {
+		c = new Counter;
+		m_levels[name] = c;
+	}
+
+	return c;
+}
+
+QMetrics::Histogram *QMetrics::histogram(const QString &name)
+{
+	QMutexLocker locker(&m_lock);
+	Histogram *h = m_histograms.value(name, NULL);
+
+	if (h == NULL) {
+		h = new Histogram;
+		m_histograms[name] = h;
+	}
+
+	return h;
+}
+
+void QMetrics::addGauge(const QString &name, const Counter *in, const Counter *out)
+{
+	QMutexLocker locker(&m_lock);
+
+	m_gauges[name] = qMakePair(in, out);
+}
+
+void QMetrics::snapshot(QList<sample_t> &samples) const
+{
+	QMutexLocker locker(&m_lock);
+	QMap<QString, sample_t> sorted;
+	sample_t s;
+
+	memset(s.buckets, 0, sizeof(s.buckets));
+	s.p50 = s.p99 = s.max = s.sum = 0;
+
+	s.kind = METRIC_COUNTER;
+	for (QMap<QString, Counter *>::const_iterator it = m_counters.begin();
+	     it != m_counters.end(); ++it) {
+		s.name = it.key();
+		s.value = it.value()->value();
+		sorted[s.name] = s;
+	}
+
+	s.kind = METRIC_LEVEL;
+	for (QMap<QString, Counter *>::const_iterator it = m_levels.begin();
+	     it != m_levels.end(); ++it) {
+		s.name = it.key();
+		s.value = it.value()->value();
+		sorted[s.name] = s;
+	}
+
+	/* Out is read first: a frame counted in between doesn't go negative */
+	for (QMap<QString, QPair<const Counter *, const Counter *> >::const_iterator it =
+	     m_gauges.begin(); it != m_gauges.end(); ++it) {
+		quint64 out = it.value().second->value();
+
+		s.name = it.key();
+		s.value = (qint64) (it.value().first->value() - out);
+		sorted[s.name] = s;
+	}
+
+	s.kind = METRIC_HISTOGRAM;
+	for (QMap<QString, Histogram *>::const_iterator it = m_histograms.begin();
+	     it != m_histograms.end(); ++it) {
+		const Histogram *h = it.value();
+
+		/* Everything from the same read of the buckets */
+		h->buckets(s.buckets);
+		s.name = it.key();
+		s.value = 0;
+		for (int b = 0; b < METRICS_BUCKETS; b++)
+			s.value += s.buckets[b];
+		s.sum = h->sum();
+		s.max = h->max();
+		s.p50 = qMin(Histogram::percentile(s.buckets, 50.0), s.max);
+		s.p99 = qMin(Histogram::percentile(s.buckets, 99.0), s.max);
+		sorted[s.name] = s;
+	}
+
+	samples = sorted.values();
+}
+
+QString QMetrics::toJson() const
+{
+	QStringList counters, levels, histograms;
+	QList<sample_t> samples;
+	QString json;
+
+	snapshot(samples);
+	for (int i = 0; i < samples.size(); i++) {
+		const sample_t &s = samples.at(i);
+		QStringList buckets;
+
+		switch (s.kind) {
+		case METRIC_COUNTER:
+			counters << QString("\"%1\":%2").arg(s.name).arg(s.value);
+			break;
+
+		case METRIC_LEVEL:
+			levels << QString("\"%1\":%2").arg(s.name).arg(s.value);
+			break;
+
+		default:
+			for (int b = 0; b < METRICS_BUCKETS; b++)
+				buckets << QString::number(s.buckets[b]);
+			histograms << QString("\"%1\":{\"count\":%2,\"sum_us\":%3,\"p50_us\":%4,"
+			                      "\"p99_us\":%5,\"max_us\":%6,\"buckets\":[%7]}")
+			              .arg(s.name).arg(s.value).arg(s.sum).arg(s.p50)
+			              .arg(s.p99).arg(s.max).arg(buckets.join(","));
+			break;
+		}
+	}
+
+	json = "{\"counters\":{" + counters.join(",") + "},";
+	json += "\"levels\":{" + levels.join(",") + "},";
+	json += "\"histograms\":{" + histograms.join(",") + "}}";
+
+	return json;
+}
@@ -0,0 +1,202 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qmetricsexporter.h"
+#include "qmetrics.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QHostAddress>
+#include <QStringList>
+#include <QMap>
+
+/* Requests are a line and a few headers, anything longer is not a scraper */
+#define REQUEST_MAX 8192
+
+QMetricsExporter::QMetricsExporter(const QString &bus, QObject *parent) :
+	QObject(parent)
+{
+	m_bus = bus;
+	m_tcp = NULL;
+	m_local = NULL;
+}
+
+bool QMetricsExporter::listen(const QString &address, QString &error)
+{
+	if (address.startsWith("unix:")) {
+		QString path = address.mid(5);
+
+		m_local = new QLocalServer(this);
+		QLocalServer::removeServer(path);
+		if (!m_local->listen(path)) {
+			error = QString("Cannot listen on %1: %2").arg(path).arg(m_local->errorString());
+			return false;
+		}
+		connect(m_local, SIGNAL(newConnection()), this, SLOT(acceptLocal()));
+		return true;
+	}
+
+	QHostAddress host(QHostAddress::LocalHost);
+	QString port = address;
+	int colon = address.lastIndexOf(':');
+
+	if (colon >= 0) {
+		port = address.mid(colon + 1);
+		if (colon > 0 && !host.setAddress(address.left(colon))) {
+			error = QString("Invalid address %1").arg(address.left(colon));
+			return false;
+		}
+	}
+
+	m_tcp = new QTcpServer(this);
+	if (!m_tcp->listen(host, port.toUShort())) {
+		error = QString("Cannot listen on %1: %2").arg(address).arg(m_tcp->errorString());
+		return false;
+	}
+	connect(m_tcp, SIGNAL(newConnection()), this, SLOT(acceptTcp()));
+
+	return true;
+}
+
+void QMetricsExporter::acceptTcp()
+{
+	while (m_tcp->hasPendingConnections())
+		accept(m_tcp->nextPendingConnection());
+}
+
+void QMetricsExporter::acceptLocal()
+{
+	while (m_local->hasPendingConnections())
+		accept(m_local->nextPendingConnection());
+}
+
+void QMetricsExporter::accept(QIODevice *socket)
+{
+	connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+	connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+}
+
+void QMetricsExporter::readRequest()
+{
+	QIODevice *socket = qobject_cast<QIODevice *>(sender());
+	QByteArray request, status, body;
+
+	if (socket == NULL)
+		return;
+
+	/* The request may come in pieces, keep it with the socket */
+	request = socket->property("request").toByteArray() + socket->readAll();
+	if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) {
+		if (request.size() > REQUEST_MAX)
+			socket->close();
+		else
+			socket->setProperty("request", request);
+		return;
+	}
+	disconnect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+
+	QList<QByteArray> line = request.left(request.indexOf('\n')).trimmed().split(' ');
+	if (line.size() >= 2 && line.at(0) == "GET" &&
+	    (line.at(1) == "/metrics" || line.at(1).startsWith("/metrics?"))) {
+		status = "200 OK";
+		body = format(m_bus).toUtf8();
+	} else {
+		status = "404 Not Found";
+		body = "Not found, metrics are at /metrics\n";
+	}
+
+	socket->write("HTTP/1.0 " + status + "\r\n");
+	socket->write("Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n");
+	socket->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n");
+	socket->write("Connection: close\r\n\r\n");
+	socket->write(body);
+	/* Both sockets write out what is pending before disconnecting */
+	socket->close();
+}
+
+static QString sanitize(const QString &name)
+{
+	QString s = name;
+
+	for (int i = 0; i < s.size(); i++)
+		if (!s.at(i).isLetterOrNumber() && s.at(i) != QChar('_'))
+			s[i] = QChar('_');
+
+	return s;
+}
+
+QString QMetricsExporter::format(const QString &bus)
+{
+	static const char *types[] = { "counter", "gauge", "histogram" };
+	QMap<QString, QStringList> families;
+	QMap<QString, int> kinds;
+	QList<QMetrics::sample_t> samples;
+	QString page;
+
+	QMetrics::instance()->snapshot(samples);
+	for (int i = 0; i < samples.size(); i++) {
+		const QMetrics::sample_t &s = samples.at(i);
+		QStringList parts = s.name.split('.');
+		QString family, labels;
+
+		/* "consumer.QCanMonitor.queued" is canspy_consumer_queued{consumer="QCanMonitor"} */
+		labels = QString("bus=\"%1\"").arg(bus);
+		if (parts.size() == 3) {
+			family = "canspy_" + sanitize(parts.at(0) + "_" + parts.at(2));
+			labels += QString(",%1=\"%2\"").arg(sanitize(parts.at(0))).arg(parts.at(1));
+		} else
+			family = "canspy_" + sanitize(parts.join("_"));
+		if (s.kind == METRIC_COUNTER)
+			family += "_total";
+		kinds[family] = s.kind;
+
+		QStringList &lines = families[family];
+		if (s.kind != METRIC_HISTOGRAM) {
+			lines << QString("%1{%2} %3").arg(family).arg(labels).arg(s.value);
+			continue;
+		}
+
+		quint64 cumulative = 0;
+		for (int b = 0; b < METRICS_BUCKETS - 1; b++) {
+			cumulative += s.buckets[b];
+			lines << QString("%1_bucket{%2,le=\"%3\"} %4").arg(family).arg(labels)
+			         .arg((b == 0) ? 0 : (1ULL << b) - 1).arg(cumulative);
+		}
+		lines << QString("%1_bucket{%2,le=\"+Inf\"} %3").arg(family).arg(labels).arg(s.value);
+		lines << QString("%1_sum{%2} %3").arg(family).arg(labels).arg(s.sum);
+		lines << QString("%1_count{%2} %3").arg(family).arg(labels).arg(s.value);
+	}
+
+	for (QMap<QString, QStringList>::const_iterator it = families.begin();
+	     it != families.end(); ++it) {
+		page += QString("# TYPE %1 %2\n").arg(it.key()).arg(types[kinds[it.key()]]);
+		page += it.value().join("\n") + "\n";
+	}
+
+	return page;
+}
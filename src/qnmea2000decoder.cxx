@@ -0,0 +1,123 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qnmea2000decoder.h"
+
+#include <QMap>
+
+QNmea2000Decoder::QNmea2000Decoder(QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Reassembly slots are allocated once with the engine */
+	m_n2k = new n2k_engine_t;
+	m_view = new n2k_engine_t;
+	n2k_init(m_n2k);
+}
+
+QNmea2000Decoder::~QNmea2000Decoder()
+{
+	delete m_n2k;
+	delete m_view;
+}
+
+QString QNmea2000Decoder::title() const
+{
+	return tr("NMEA 2000 PGNs");
+}
+
+QStringList QNmea2000Decoder::header() const
+{
+	return QStringList() << "PGN" << "Name" << "Frames" << "Messages" << "Msg/s"
+	       << "Last SA" << "Len" << "Values";
+}
+
+void QNmea2000Decoder::decode(const can_packet_t *packet)
+{
+	n2k_message_t msg;
+
+	n2k_process(m_n2k, packet, &msg);
+}
+
+void QNmea2000Decoder::save()
+{
+	*m_view = *m_n2k;
+}
+
+void QNmea2000Decoder::format(QList<QStringList> &rows, QString &summary)
+{
+	QMap<quint32, const n2k_pgn_stats_t *> sorted;
+	double values[N2K_DECODE_MAX];
+	uint8_t present[N2K_DECODE_MAX];
+
+	for (int i = 0; i < N2K_PGN_SLOTS; i++)
+		if (m_view->pgn[i].used)
+			sorted[m_view->pgn[i].pgn] = &m_view->pgn[i];
+
+	foreach (const n2k_pgn_stats_t *s, sorted) {
+		QString text;
+
+		if (s->messages == 0) {
+			text = "";
+		} else if (s->info != NULL) {
+			int n = n2k_decode(s->info, s->last_data, s->last_len, values,
+			    present, N2K_DECODE_MAX);
+
+			for (int f = 0; f < n && f < N2K_DECODE_MAX; f++) {
+				if (!present[f])
+					continue;
+				text += QString("%1=%2%3 ").arg(s->info->fields[f].name)
+				        .arg(values[f], 0, 'g', 10).arg(s->info->fields[f].unit);
+			}
+		} else {
+			for (int b = 0; b < s->last_len && b < 8; b++)
+				text += QString::number(s->last_data[b], 16).rightJustified(2, '0').toUpper() + " ";
+			if (s->last_len > 8)
+				text += "...";
+		}
+
+		rows.append(QStringList()
+		            << QString::number(s->pgn)
+		            << ((s->info != NULL) ? QString(s->info->name) :
+		                (s->fast ? QString("(fast-packet)") : QString("")))
+		            << QString::number(s->frames)
+		            << QString::number(s->messages)
+		            << QString::number(s->rate)
+		            << QString::number(s->last_sa, 16).rightJustified(2, '0').toUpper()
+		            << QString::number(s->last_len)
+		            << text);
+	}
+
+	summary = QString("Fast-packets: %1 completed, %2 lost, %3 timed out, "
+	                  "%4 no slot, %5 orphan frames")
+	          .arg(m_view->fp_completed).arg(m_view->fp_lost)
+	          .arg(m_view->fp_timeouts).arg(m_view->fp_dropped)
+	          .arg(m_view->fp_orphans);
+}
+
+void QNmea2000Decoder::clear()
+{
+	n2k_init(m_n2k);
+}
@@ -0,0 +1,97 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qpacketstats.h"
+#include "canbus/can_drv.h"
+
+#include <string.h>
+
+QPacketStats::QPacketStats()
+{
+}
+
+QPacketStats::~QPacketStats()
+{
+	clear();
+}
+
+QPacketStats::statistic_t *QPacketStats::update(const can_packet_t &packet, QString &data,
+                                                QString &interval, bool *created)
+{
+	/* Error frames carry the error class in the ID, keep them on rows of their own */
+	quint32 pck_id = packet.id & (EFF_MASK | ERR_FLAG);
+	statistic_t *s;
+
+	s = m_stats.value(pck_id, NULL);
+	*created = s == NULL;
+	if (s == NULL) {
+		s = new statistic_t;
+		s->lastSec = packet.tv_sec;
+		s->lastUSec = packet.tv_usec;
+		memset(s->data, 0, 8);
+		s->count = 0;
+		s->row = 0;
+		m_stats[pck_id] = s;
+	}
+
+	data = "";
+	for (unsigned i = 0; i < packet.dlc; i++) {
+		if (s->count <= 1 || packet.data[i] != s->data[i])
+			data += "<font color=\"red\">";
+		else
+			data += "<font color=\"black\">";
+		QString tok;
+		data += tok.sprintf("%02X ", packet.data[i]).toUpper();
+
+		if (packet.data[i] != s->data[i])
+			data += "</font>";
+		s->data[i] = packet.data[i];
+	}
+	s->count++;
+
+	int64_t usec = ((packet.tv_sec - s->lastSec) * 1000000) +
+	               packet.tv_usec - s->lastUSec;
+	interval = QString::number(usec / 1000.0, 'f', 3);
+	s->lastSec = packet.tv_sec;
+	s->lastUSec = packet.tv_usec;
+
+	return s;
+}
+
+int QPacketStats::size() const
+{
+	return m_stats.size();
+}
+
+void QPacketStats::clear()
+{
+	QMapIterator <unsigned, statistic_t *>itr(m_stats);
+	for (; itr.hasNext();) {
+		itr.next();
+		delete itr.value();
+	}
+	m_stats.clear();
+}
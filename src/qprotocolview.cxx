@@ -0,0 +1,156 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qprotocolview.h"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QFile>
+#include <QTextStream>
+#include <QMessageBox>
+
+#define REFRESH_MS 500
+
+static QString csvField(const QString &text)
+{
+	QString s = text.trimmed();
+
+	if (!s.contains(',') && !s.contains('"'))
+		return s;
+
+	return "\"" + s.replace("\"", "\"\"") + "\"";
+}
+
+QProtocolView::QProtocolView(QProtocolDecoder *decoder, QWidget *parent) :
+	QDialog(parent)
+{
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	QHBoxLayout *buttons = new QHBoxLayout;
+	QPushButton *btnReset = new QPushButton(tr("Reset"), this);
+	QPushButton *btnExport = new QPushButton(tr("Export..."), this);
+	QPushButton *btnClose = new QPushButton(tr("Close"), this);
+	QStringList header = decoder->header();
+
+	m_decoder = decoder;
+	setWindowTitle(decoder->title());
+	setAttribute(Qt::WA_DeleteOnClose);
+
+	m_table = new QTableWidget(0, header.size(), this);
+	m_table->setHorizontalHeaderLabels(header);
+	m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+	m_table->setAlternatingRowColors(true);
+	m_table->verticalHeader()->hide();
+	m_table->verticalHeader()->setDefaultSectionSize(17);
+	m_table->horizontalHeader()->setStretchLastSection(true);
+	m_table->horizontalHeader()->setHighlightSections(false);
+	m_summary = new QLabel(this);
+
+	buttons->addStretch();
+	buttons->addWidget(btnExport);
+	buttons->addWidget(btnReset);
+	buttons->addWidget(btnClose);
+	layout->addWidget(m_table);
+	layout->addWidget(m_summary);
+	layout->addLayout(buttons);
+	resize(720, 400);
+
+	connect(btnReset, SIGNAL(clicked()), this, SLOT(reset()));
+	connect(btnExport, SIGNAL(clicked()), this, SLOT(exportCsv()));
+	connect(btnClose, SIGNAL(clicked()), this, SLOT(close()));
+
+	m_timer = new QTimer(this);
+	connect(m_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+	m_timer->start(REFRESH_MS);
+	refresh();
+}
+
+void QProtocolView::refresh()
+{
+	QList<QStringList> rows;
+	QString summary;
+
+	m_decoder->snapshot(rows, summary);
+
+	m_table->setRowCount(rows.size());
+	for (int r = 0; r < rows.size(); r++) {
+		const QStringList &row = rows.at(r);
+
+		for (int c = 0; c < row.size() && c < m_table->columnCount(); c++) {
+			QTableWidgetItem *it = m_table->item(r, c);
+
+			if (it == NULL) {
+				it = new QTableWidgetItem;
+				m_table->setItem(r, c, it);
+			}
+			if (it->text() != row.at(c))
+				it->setText(row.at(c));
+		}
+	}
+	m_summary->setText(summary);
+}
+
+void QProtocolView::reset()
+{
+	m_decoder->reset();
+	refresh();
+}
+
+void QProtocolView::exportCsv()
+{
+	QList<QStringList> rows;
+	QStringList fields;
+	QString summary, fileName;
+
+	fileName = QFileDialog::getSaveFileName(this, tr("Export"), "untitled.csv",
+	                                        tr("CSV files (*.csv)"));
+	if (fileName.isEmpty())
+		return;
+
+	QFile file(fileName);
+	if (!file.open(QFile::WriteOnly | QFile::Text)) {
+		QMessageBox::warning(this, windowTitle(),
+		                     tr("Cannot write %1").arg(fileName), QMessageBox::Ok);
+		return;
+	}
+
+	/* A fresh snapshot, not what the table last showed */
+	m_decoder->snapshot(rows, summary);
+
+	QTextStream out(&file);
+	foreach (const QString &h, m_decoder->header())
+		fields << csvField(h);
+	out << fields.join(",") << endl;
+	foreach (const QStringList &row, rows) {
+		fields.clear();
+		foreach (const QString &value, row)
+			fields << csvField(value);
+		out << fields.join(",") << endl;
+	}
+	file.close();
+}
@@ -0,0 +1,145 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qrealtime.h"
+#include "utils.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QMap>
+
+#include <errno.h>
+#include <string.h>
+
+/* Stack touched by a real-time thread so it never faults it in later */
+#define STACK_PREFAULT  (64 * 1024)
+
+static const char *thread_names[] = { "recv", "transmit", "writer" };
+
+static QRealtime::options_t s_options = { RT_POLICY_OTHER, 0, { -1, -1, -1 }, false };
+static QMutex s_lock;
+static QMap<QString, QStringList> s_report;
+
+static QString outcome(int r)
+{
+	return (r == 0) ? QString("applied") :
+	       QString("not applied (%1)").arg(strerror(errno));
+}
+
+static void prefault_stack(void)
+{
+	volatile unsigned char stack[STACK_PREFAULT];
+
+	for (unsigned i = 0; i < sizeof(stack); i += 4096)
+		stack[i] = 0;
+}
+
+bool QRealtime::parsePolicy(const QString &spec, options_t &options)
+{
+	QStringList fields = spec.toLower().split(':');
+	bool ok = true;
+
+	if (fields.at(0) == "other" || fields.at(0) == "none") {
+		options.policy = RT_POLICY_OTHER;
+		options.priority = 0;
+		return fields.size() == 1;
+	}
+
+	if (fields.at(0) == "fifo")
+		options.policy = RT_POLICY_FIFO;
+	else if (fields.at(0) == "rr")
+		options.policy = RT_POLICY_RR;
+	else
+		return false;
+
+	/* Room below for the transmit threads */
+	options.priority = (fields.size() > 1) ? fields.at(1).toInt(&ok) : 80;
+
+	return ok && fields.size() <= 2 && options.priority >= 2 && options.priority <= 99;
+}
+
+bool QRealtime::parseCpus(const QString &spec, options_t &options)
+{
+	QStringList fields = spec.split(',');
+
+	if (fields.size() > 3)
+		return false;
+
+	for (int i = 0; i < 3; i++) {
+		bool ok = true;
+
+		options.cpu[i] = (i < fields.size() && !fields.at(i).trimmed().isEmpty()) ?
+		                 fields.at(i).trimmed().toInt(&ok) : -1;
+		if (!ok || options.cpu[i] < -1)
+			return false;
+	}
+
+	return true;
+}
+
+void QRealtime::configure(const options_t &options)
+{
+	QMutexLocker locker(&s_lock);
+
+	s_options = options;
+	s_report.remove("memory");
+	if (options.lock_memory)
+		s_report["memory"] << QString("memory: locked %1").arg(outcome(lock_memory()));
+}
+
+void QRealtime::enter(Thread thread)
+{
+	QMutexLocker locker(&s_lock);
+	const char *name = thread_names[thread];
+	int policy = s_options.policy;
+	int priority = s_options.priority - ((thread == Transmit) ? 1 : 0);
+	int cpu = s_options.cpu[thread];
+	QStringList lines;
+
+	/* Dumps to disk must never starve the capture */
+	if (policy != RT_POLICY_OTHER && thread != Writer) {
+		lines << QString("%1: %2 priority %3 %4").arg(name)
+		         .arg((policy == RT_POLICY_FIFO) ? "SCHED_FIFO" : "SCHED_RR")
+		         .arg(priority).arg(outcome(set_thread_scheduler(policy, priority)));
+		prefault_stack();
+	}
+	if (cpu >= 0)
+		lines << QString("%1: CPU %2 %3").arg(name).arg(cpu)
+		         .arg(outcome(set_thread_cpu(cpu)));
+
+	s_report[name] = lines;
+}
+
+QStringList QRealtime::report()
+{
+	QMutexLocker locker(&s_lock);
+	QStringList lines;
+
+	foreach (const QStringList &l, s_report)
+		lines << l;
+
+	return lines;
+}
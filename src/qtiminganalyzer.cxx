@@ -0,0 +1,136 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+
+#include "qtiminganalyzer.h"
+#include "canbus/can_drv.h"
+
+#include <QMap>
+#include <QRegExp>
+
+static QString usecToMs(quint32 usec)
+{
+	return QString::number(usec / 1000.0, 'f', 3);
+}
+
+QTimingAnalyzer::QTimingAnalyzer(unsigned tolerance, QObject *parent) :
+	QProtocolDecoder(parent)
+{
+	/* Histograms of every ID are allocated once with the engine */
+	m_timing = new timing_engine_t;
+	timing_init(m_timing, tolerance);
+	m_view_overflow = 0;
+	m_view_tolerance = tolerance;
+}
+
+QTimingAnalyzer::~QTimingAnalyzer()
+{
+	delete m_timing;
+}
+
+void QTimingAnalyzer::setExpected(const QString &periods)
+{
+	QMutexLocker locker(&m_lock);
+	QStringList pairs = periods.split(QRegExp("[\\s,;]+"), QString::SkipEmptyParts);
+
+	foreach (const QString &pair, pairs) {
+		QStringList fields = pair.split(':');
+		bool ok_id, ok_ms;
+		quint32 id;
+		double ms;
+
+		if (fields.size() != 2)
+			continue;
+		id = fields.at(0).toUInt(&ok_id, 16);
+		ms = fields.at(1).toDouble(&ok_ms);
+		if (!ok_id || !ok_ms || ms <= 0.0)
+			continue;
+		/* More than 3 digits means a 29 bit identifier */
+		if (id > 0x7FF || fields.at(0).length() > 3)
+			id |= EFF_FLAG;
+		timing_set_expected(m_timing, id, (quint32) (ms * 1000.0 + 0.5));
+	}
+}
+
+QString QTimingAnalyzer::title() const
+{
+	return tr("Timing analysis");
+}
+
+QStringList QTimingAnalyzer::header() const
+{
+	return QStringList() << "ID" << "Periods" << "Mean ms" << "Jitter ms"
+	       << "Min ms" << "Max ms" << "p50 ms" << "p99 ms" << "p99.9 ms"
+	       << "Expected ms" << "Missed";
+}
+
+void QTimingAnalyzer::decode(const can_packet_t *packet)
+{
+	timing_update(m_timing, packet);
+}
+
+void QTimingAnalyzer::save()
+{
+	/* Only the IDs seen, the engine is megabytes */
+	m_view.resize(m_timing->nids);
+	for (quint32 i = 0; i < m_timing->nids; i++)
+		m_view[i] = m_timing->ids[i];
+	m_view_overflow = m_timing->overflow;
+	m_view_tolerance = m_timing->tolerance;
+}
+
+void QTimingAnalyzer::format(QList<QStringList> &rows, QString &summary)
+{
+	QMap<quint32, const timing_id_t *> sorted;
+
+	for (int i = 0; i < m_view.size(); i++)
+		sorted[m_view.at(i).id] = &m_view.at(i);
+
+	foreach (const timing_id_t *s, sorted) {
+		bool any = s->count != 0;
+
+		rows.append(QStringList()
+		            << QString::number(s->id & EFF_MASK, 16).toUpper()
+		            << QString::number(s->count)
+		            << (any ? usecToMs(timing_mean(s)) : QString("-"))
+		            << (any ? usecToMs(timing_stddev(s)) : QString("-"))
+		            << (any ? usecToMs(s->min) : QString("-"))
+		            << (any ? usecToMs(s->max) : QString("-"))
+		            << (any ? usecToMs(timing_percentile(s, 50.0)) : QString("-"))
+		            << (any ? usecToMs(timing_percentile(s, 99.0)) : QString("-"))
+		            << (any ? usecToMs(timing_percentile(s, 99.9)) : QString("-"))
+		            << ((s->expected != 0) ? usecToMs(s->expected) : QString("auto"))
+		            << QString::number(s->missed));
+	}
+
+	summary = QString("IDs: %1  Untracked frames: %2  Deadline: expected + %3%  "
+	                  "Percentiles within 3%")
+	          .arg(m_view.size()).arg(m_view_overflow).arg(m_view_tolerance);
+}
+
+void QTimingAnalyzer::clear()
+{
+	timing_reset(m_timing);
+}
@@ -0,0 +1,219 @@
+/*
+ *  canspy - A simple tool for users who need to interface with a device based on
+ *           CAN (CAN/CANopen/J1939/NMEA2000/DeviceNet) such as motors,
+ *           sensors and many other devices.
+ *  Copyright (C) 2015-2016  Manuele Conti (manuele.conti@gmail.com)
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * This code is made available on the understanding that it will not be
+ * used in safety-critical situations without a full and competent review.
+ */
+
+
+#include "qtriggerengine.h"
+#include "canbus/can_drv.h"
+
+#include <QThread>
+
+
+QTriggerEngine::QTriggerEngine(QObject *parent) :
+	QCanPacketConsumer(parent),
+	m_armed(0),
+	m_busy(0)
+{
+	memset(m_level, 0, sizeof(m_level));
+	m_use[0] = m_use[1] = false;
+	m_need_both = false;
+	m_action = TRIGGER_ACTION_MESSAGE;
+}
+
+bool QTriggerEngine::compileCondition(int condition, quint64 start, quint64 end,
+    quint64 max, insn_t *insn)
+{
+	quint64 lo, hi;
+
+	insn->negate = 0;
+	switch (condition) {
+	case TRIGGER_COND_EQUAL:
+		lo = hi = start;
+		break;
+
+	case TRIGGER_COND_NOT_EQUAL:
+		lo = hi = start;
+		insn->negate = 1;
+		break;
+
+	case TRIGGER_COND_GREATER:
+		if (start >= max)
+			return false;
+		lo = start + 1;
+		hi = max;
+		break;
+
+	case TRIGGER_COND_LESS:
+		if (start == 0)
+			return false;
+		lo = 0;
+		hi = start - 1;
+		break;
+
+	case TRIGGER_COND_OUT_RANGE:
+		insn->negate = 1;
+		/* fall through */
+	case TRIGGER_COND_IN_RANGE:
+		lo = qMin(start, end);
+		hi = qMax(start, end);
+		break;
+
+	default:
+		return false;
+	}
+	insn->lo = lo;
+	insn->span = hi - lo;
+
+	return true;
+}
+
+void QTriggerEngine::compileLevel(const trigger_level_t &src, level_t *dst)
+{
+	insn_t *insn;
+
+	memset(dst, 0, sizeof(*dst));
+	dst->count_limit = qMax(src.count_limit, 1);
+
+	if (src.check_id) {
+		insn = &dst->insn[dst->ninsn];
+		insn->operand = OPERAND_ID;
+		if (compileCondition(src.id_condition, src.id_start & EFF_MASK,
+		    src.id_end & EFF_MASK, EFF_MASK, insn))
+			dst->ninsn++;
+		else
+			dst->count_limit = 0;
+	}
+
+	if (src.check_value && src.data_mask != 0) {
+		insn = &dst->insn[dst->ninsn];
+		insn->operand = OPERAND_VALUE;
+		/* Selected bytes form a big-endian value, D0 most significant */
+		for (int i = 0; i < 8; i++) {
+			if (!(src.data_mask & (1 << i)))
+				continue;
+			insn->bytes[insn->nbytes++] = i;
+			insn->min_dlc = i + 1;
+		}
+		if (compileCondition(src.value_condition, src.value_start,
+		    src.value_end, 0xFFFFFFFFU, insn))
+			dst->ninsn++;
+		else
+			dst->count_limit = 0;
+	}
+}
+
+bool QTriggerEngine::matchLevel(const level_t *level, const can_packet_t *packet)
+{
+	quint64 x;
+
+	/* A condition that can never be true compiles to a zero limit */
+	if (level->count_limit == 0)
+		return false;
+
+	for (int i = 0; i < level->ninsn; i++) {
+		const insn_t *insn = &level->insn[i];
+
+		if (insn->operand == OPERAND_ID)
+			x = packet->id & EFF_MASK;
+		else {
+			if (packet->dlc < insn->min_dlc)
+				return false;
+			x = 0;
+			for (int b = 0; b < insn->nbytes; b++)
+				x = (x << 8) | packet->data[insn->bytes[b]];
+		}
+		if (((x - insn->lo) <= insn->span) == (bool) insn->negate)
+			return false;
+	}
+
+	return true;
+}
+
+void QTriggerEngine::arm(const trigger_config_t &config)
+{
+	disarm();
+
+	compileLevel(config.a, &m_level[0]);
+	compileLevel(config.b, &m_level[1]);
+	m_use[0] = config.level_condition != TRIGGER_LEVEL_B;
+	m_use[1] = config.level_condition != TRIGGER_LEVEL_A;
+	m_need_both = config.level_condition == TRIGGER_LEVEL_A_AND_B;
+	m_action = config.action;
+
+	m_armed.storeRelease(1);
+}
+
+void QTriggerEngine::disarm()
+{
+	m_armed.fetchAndStoreOrdered(0);
+	/* Wait for the receive thread to leave filterCallback */
+	while (m_busy.loadAcquire())
+		QThread::yieldCurrentThread();
+}
+
+bool QTriggerEngine::isArmed() const
+{
+	return m_armed.loadAcquire() != 0;
+}
+
+void QTriggerEngine::canPacketRecv(can_packet_t)
+{
+}
+
+bool QTriggerEngine::filterCallback(can_packet_t *packet)
+{
+	bool fired;
+
+	m_busy.fetchAndStoreOrdered(1);
+	if (!m_armed.loadAcquire() || (packet->id & ERR_FLAG)) {
+		m_busy.storeRelease(0);
+		return false;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		level_t *level = &m_level[i];
+
+		if (m_use[i] && level->count < level->count_limit &&
+		    matchLevel(level, packet))
+			level->count++;
+	}
+
+	if (m_need_both)
+		fired = m_level[0].count_limit != 0 && m_level[1].count_limit != 0 &&
+		    m_level[0].count >= m_level[0].count_limit &&
+		    m_level[1].count >= m_level[1].count_limit;
+	else
+		fired = (m_use[0] && m_level[0].count_limit != 0 &&
+		    m_level[0].count >= m_level[0].count_limit) ||
+		    (m_use[1] && m_level[1].count_limit != 0 &&
+		    m_level[1].count >= m_level[1].count_limit);
+
+	if (fired) {
+		/* One shot: the GUI re-arms once the action has been handled */
+		m_armed.storeRelease(0);
+		emit triggered(m_action, *packet);
+	}
+	m_busy.storeRelease(0);
+
+	return false;
+}
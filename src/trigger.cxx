@@ -69,6 +69,54 @@ QTriggerDialog::QTriggerDialog(QWidget *parent)
 	initActionsConnections();
 }
 
+void QTriggerDialog::loadLevel(const trigger_level_t &level, QSpinBox *times,
+                               QCheckBox *value_enable, QCheckBox *const data[8],
+                               QComboBox *value_cond, QLineEdit *value_start,
+                               QLineEdit *value_end, QCheckBox *id_enable,
+                               QComboBox *id_cond, QLineEdit *id_start, QLineEdit *id_end)
+{
+	times->setValue(level.count_limit);
+	value_enable->setChecked(level.check_value);
+	for (int i = 0; i < 8; i++)
+		data[i]->setChecked(level.data_mask & (1 << i));
+	value_cond->setCurrentIndex(level.value_condition);
+	value_start->setText(QString::number(level.value_start, 16).toUpper());
+	value_end->setText(QString::number(level.value_end, 16).toUpper());
+	id_enable->setChecked(level.check_id);
+	id_cond->setCurrentIndex(level.id_condition);
+	id_start->setText(QString::number(level.id_start, 16).toUpper());
+	id_end->setText(QString::number(level.id_end, 16).toUpper());
+}
+
+void QTriggerDialog::setConfig(const trigger_config_t &config, bool delay, int delay_ms,
+                               const QString &cmd)
+{
+	QCheckBox *const data_a[8] = {
+		ui->chkLevAD0, ui->chkLevAD1, ui->chkLevAD2, ui->chkLevAD3,
+		ui->chkLevAD4, ui->chkLevAD5, ui->chkLevAD6, ui->chkLevAD7
+	};
+	QCheckBox *const data_b[8] = {
+		ui->chkLevBD0, ui->chkLevBD1, ui->chkLevBD2, ui->chkLevBD3,
+		ui->chkLevBD4, ui->chkLevBD5, ui->chkLevBD6, ui->chkLevBD7
+	};
+
+	/* The widgets signal the changes, but for the data bytes */
+	ui->comLevelCond->setCurrentIndex(config.level_condition);
+	ui->comAction->setCurrentIndex(config.action);
+	ui->chkActDelayEnable->setChecked(delay);
+	ui->ediActDelay->setText(QString::number(delay_ms));
+	ui->ediActionCommand->setText(cmd);
+
+	loadLevel(config.a, ui->spiLevATimes, ui->chkLevAValEnable, data_a,
+	          ui->comLevAValueCond, ui->ediLevAValueStart, ui->ediLevAValueEnd,
+	          ui->chkLevAIDEnable, ui->comLevAIDCond, ui->ediLevAIDStart, ui->ediLevAIDEnd);
+	m_level_a_check_data = config.a.data_mask;
+	loadLevel(config.b, ui->spiLevBTimes, ui->chkLevBValEnable, data_b,
+	          ui->comLevBValueCond, ui->ediLevBValueStart, ui->ediLevBValueEnd,
+	          ui->chkLevBIDEnable, ui->comLevBIDCond, ui->ediLevBIDStart, ui->ediLevBIDEnd);
+	m_level_b_check_data = config.b.data_mask;
+}
+
 int QTriggerDialog::levelCondition() const
 {
 	return m_level_condition;
@@ -235,7 +283,7 @@ void QTriggerDialog::setLevelACheckData(bool enable, int ofs)
 	if (enable)
 		m_level_a_check_data |=  (1 << ofs);
 	else
-		m_level_a_check_data ^= ~(1 << ofs);
+		m_level_a_check_data &= ~(1 << ofs);
 }
 
 void QTriggerDialog::setLevelACheckData0(bool enable)
@@ -330,7 +378,7 @@ void QTriggerDialog::setLevelBCheckData(bool enable, int ofs)
 	if (enable)
 		m_level_b_check_data |=  (1 << ofs);
 	else
-		m_level_b_check_data ^= ~(1 << ofs);
+		m_level_b_check_data &= ~(1 << ofs);
 }
 
 void QTriggerDialog::setLevelBCheckData0(bool enable)
@@ -412,7 +460,8 @@ void QTriggerDialog::setLevelBIdEnd(QString value)
 
 void QTriggerDialog::initActionsConnections(void)
 {
-	connect(ui->btnOk, SIGNAL(clicked(bool)), this, SLOT(close()));
+	connect(ui->btnOk, SIGNAL(clicked(bool)), this, SLOT(accept()));
+	connect(ui->btnCancel, SIGNAL(clicked(bool)), this, SLOT(reject()));
 	connect(ui->comLevelCond, SIGNAL(currentIndexChanged(int)), this, SLOT(setLevelCondition(int)));
 	connect(ui->chkActDelayEnable, SIGNAL(toggled(bool)), this, SLOT(setActionDelayEnable(bool)));
 	connect(ui->ediActDelay, SIGNAL(textChanged(QString)), this, SLOT(setActionDelayValue(QString)));